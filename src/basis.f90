@@ -260,15 +260,13 @@ subroutine readbasis(natomxiao,natomstart,natomfinal,nbasisstart,nbasisfinal)
 
    ! Allocate the arrays now that we know the sizes
 
+   call allocate_eri_scratch(quick_method%ffunxiao,MAXPRIM**4)
+
    if(quick_method%ffunxiao)then
-      if(.not. allocated(Yxiao))        allocate(Yxiao(10000,56,56))
-      if(.not. allocated(Yxiaotemp))    allocate(Yxiaotemp(56,56,0:10))
       if(.not. allocated(Yxiaoprim))    allocate(Yxiaoprim(MAXPRIM,MAXPRIM,56,56))
       if(.not. allocated(attraxiao))    allocate(attraxiao(56,56,0:6))
       if(.not. allocated(attraxiaoopt)) allocate(attraxiaoopt(3,56,56,0:5))
    else
-      if(.not. allocated(Yxiao))        allocate(Yxiao(10000,120,120))
-      if(.not. allocated(Yxiaotemp))    allocate(Yxiaotemp(120,120,0:14))
       if(.not. allocated(Yxiaoprim))    allocate(Yxiaoprim(MAXPRIM,MAXPRIM,120,120))
       if(.not. allocated(attraxiao))    allocate(attraxiao(120,120,0:8))
       if(.not. allocated(attraxiaoopt)) allocate(attraxiaoopt(3,120,120,0:7))
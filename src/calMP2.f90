@@ -10,6 +10,7 @@ subroutine calmp2
   double precision cutoffTest,testtmp,testCutoff
   integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
   common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+  !$omp threadprivate(/hrrstore/)
     integer :: nelec,nelecb
     
     nelec = quick_molspec%nelec
@@ -263,6 +264,7 @@ subroutine MPI_calmp2
   double precision, allocatable:: temp4d(:,:,:,:)
   integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
   common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+  !$omp threadprivate(/hrrstore/)
 
   if (bMPI) then
 !     call MPI_BCAST(DENSE,nbasis*nbasis,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
@@ -563,6 +565,7 @@ subroutine calmp2divcon
   double precision Xiaotest,testtmp
   integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
   common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+  !$omp threadprivate(/hrrstore/)
 
   is = 0
   quick_basis%first_shell_basis_function(1) = 1
@@ -13,6 +13,7 @@
     double precision Xiaotest,testtmp
  integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
  common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+ !$omp threadprivate(/hrrstore/)
 
  is = 0
  quick_basis%first_shell_basis_function(1) = 1
@@ -1704,6 +1704,10 @@ void gpu_get_octree_info(QUICKDouble *gridx, QUICKDouble *gridy, QUICKDouble *gr
 
 	unsigned int nbins = (unsigned int) (count/SM_2X_XCGRAD_THREADS_PER_BLOCK);
 
+	//cfweight & pfweight are bitsets, each bin starts at a word boundary
+	unsigned long cfsize = nbins * gpack_bitset_words(gpu -> nbasis) * sizeof(unsigned int);
+	unsigned long pfsize = nbins * gpack_bitset_words((unsigned long) gpu -> nbasis * gpu -> gpu_basis-> maxcontract) * sizeof(unsigned int);
+
         gpu -> gpu_xcq -> npoints       = count;
         gpu -> xc_threadsPerBlock       = SM_2X_XCGRAD_THREADS_PER_BLOCK;
 
@@ -1731,12 +1735,12 @@ void gpu_get_octree_info(QUICKDouble *gridx, QUICKDouble *gridy, QUICKDouble *gr
 	unsigned int  *d_cfweight, *d_pfweight;
 
 	cudaMalloc((void**)&d_gpweight, gpu -> gpu_xcq -> npoints * sizeof(unsigned char));
-	cudaMalloc((void**)&d_cfweight, nbins * gpu -> nbasis * sizeof(unsigned int));	
-	cudaMalloc((void**)&d_pfweight, nbins * gpu -> nbasis * gpu -> gpu_basis-> maxcontract * sizeof(unsigned int));
+	cudaMalloc((void**)&d_cfweight, cfsize);	
+	cudaMalloc((void**)&d_pfweight, pfsize);
 
 	cudaMemcpy(d_gpweight, gpweight, gpu -> gpu_xcq -> npoints * sizeof(unsigned char), cudaMemcpyHostToDevice);
-	cudaMemcpy(d_cfweight, cfweight, nbins * gpu -> nbasis * sizeof(unsigned int), cudaMemcpyHostToDevice);
-	cudaMemcpy(d_pfweight, pfweight, nbins * gpu -> nbasis * gpu -> gpu_basis-> maxcontract * sizeof(unsigned int), cudaMemcpyHostToDevice);
+	cudaMemcpy(d_cfweight, cfweight, cfsize, cudaMemcpyHostToDevice);
+	cudaMemcpy(d_pfweight, pfweight, pfsize, cudaMemcpyHostToDevice);
 
         upload_sim_to_constant_dft(gpu);
 
@@ -1761,8 +1765,8 @@ void gpu_get_octree_info(QUICKDouble *gridx, QUICKDouble *gridy, QUICKDouble *gr
         get_primf_contraf_lists(gpu, d_gpweight, d_cfweight, d_pfweight);
 
 	cudaMemcpy(gpweight, d_gpweight, gpu -> gpu_xcq -> npoints * sizeof(unsigned char), cudaMemcpyDeviceToHost);
-	cudaMemcpy(cfweight, d_cfweight, nbins * gpu -> nbasis * sizeof(unsigned int), cudaMemcpyDeviceToHost);
-	cudaMemcpy(pfweight, d_pfweight, nbins * gpu -> nbasis * gpu -> gpu_basis -> maxcontract * sizeof(unsigned int), cudaMemcpyDeviceToHost);
+	cudaMemcpy(cfweight, d_cfweight, cfsize, cudaMemcpyDeviceToHost);
+	cudaMemcpy(pfweight, d_pfweight, pfsize, cudaMemcpyDeviceToHost);
 
 /*	for(int i=0; i<nbins;i++){
 		//unsigned int cfweight_sum =0;
@@ -590,6 +590,10 @@ __global__ void get_primf_contraf_lists_kernel(unsigned char *gpweight, unsigned
 
 			unsigned int binIdx = (unsigned int) (gid/blockDim.x);
 
+			//Bit offsets of the bin in the cfweight & pfweight bitsets, see gpack_bitset_words
+			unsigned long cfbin = (unsigned long) binIdx * ((devSim_dft.nbasis + 31) / 32) * 32;
+			unsigned long pfbin = (unsigned long) binIdx * ((devSim_dft.nbasis * devSim_dft.maxcontract + 31) / 32) * 32;
+
         	        QUICKDouble gridx = devSim_dft.gridx[gid];
 	                QUICKDouble gridy = devSim_dft.gridy[gid];
 	                QUICKDouble gridz = devSim_dft.gridz[gid];
@@ -600,7 +604,7 @@ __global__ void get_primf_contraf_lists_kernel(unsigned char *gpweight, unsigned
 
                 	for(int ibas=0; ibas<devSim_dft.nbasis;ibas++){
 
-                        	unsigned long cfwid = binIdx * devSim_dft.nbasis + ibas; 
+                        	unsigned long cfwid = cfbin + ibas; 
 
                         	QUICKDouble x1 = gridx - LOC2(devSim_dft.xyz, 0, devSim_dft.ncenter[ibas]-1, 3, devSim_dft.natom);
                         	QUICKDouble y1 = gridy - LOC2(devSim_dft.xyz, 1, devSim_dft.ncenter[ibas]-1, 3, devSim_dft.natom);
@@ -656,7 +660,7 @@ __global__ void get_primf_contraf_lists_kernel(unsigned char *gpweight, unsigned
 
                                 	for(int kprim=0; kprim< devSim_dft.ncontract[ibas]; kprim++){
 
-                                        	unsigned long pfwid = binIdx * devSim_dft.nbasis * devSim_dft.maxcontract + ibas * devSim_dft.maxcontract + kprim;
+                                        	unsigned long pfwid = pfbin + ibas * devSim_dft.maxcontract + kprim;
 
                                         	QUICKDouble tmp = LOC2(devSim_dft.dcoeff, kprim, ibas, devSim_dft.maxcontract, devSim_dft.nbasis) *
                                                 	exp( - LOC2(devSim_dft.aexp, kprim, ibas, devSim_dft.maxcontract, devSim_dft.nbasis) * dist);
@@ -671,7 +675,7 @@ __global__ void get_primf_contraf_lists_kernel(unsigned char *gpweight, unsigned
 
                                         	//Check the significance of the primitive
 						if(abs(tmp+tmpdx+tmpdy+tmpdz) > devSim_dft.DMCutoff){
-							atomicAdd(&pfweight[pfwid], 1);
+							atomicOr(&pfweight[pfwid >> 5], 1u << (pfwid & 31));
                                         	}
                                 	}
 
@@ -683,7 +687,7 @@ __global__ void get_primf_contraf_lists_kernel(unsigned char *gpweight, unsigned
                         	}
 
                         	if (abs(phi+dphidx+dphidy+dphidz)> devSim_dft.DMCutoff ){
-					atomicAdd(&cfweight[cfwid], 1);
+					atomicOr(&cfweight[cfwid >> 5], 1u << (cfwid & 31));
 					sigcfcount++;
                         	}
 			
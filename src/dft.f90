@@ -648,6 +648,7 @@ subroutine dftoperator
 
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2, I, J
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
 !#ifndef CUDA
    !Variables required for libxc
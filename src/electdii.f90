@@ -401,7 +401,7 @@ subroutine electdiis(jscf,PRMS)
 
         ! Now diagonalize the operator matrix.
         call cpu_time(timer_begin%TDiag)
-        call DIAG(nbasis,quick_qm_struct%o,nbasis,quick_method%DMCutoff,V2,quick_qm_struct%E,& 
+        call DIAGDC(nbasis,quick_qm_struct%o,nbasis,quick_method%DMCutoff,V2,quick_qm_struct%E,& 
             quick_qm_struct%idegen,quick_qm_struct%vec,IERROR)
         call cpu_time(timer_end%TDiag)
 
@@ -767,7 +767,7 @@ end subroutine electdiis
             !--------------------------------------------
             call cpu_time(timer_begin%TDiag) ! Trigger the dc timer for subsytem
 
-            call DIAG(NtempN,Odcsubtemp,NtempN,quick_method%DMCutoff,Vtemp,EVAL1temp,IDEGEN1temp,VECtemp,IERROR)
+            call DIAGDC(NtempN,Odcsubtemp,NtempN,quick_method%DMCutoff,Vtemp,EVAL1temp,IDEGEN1temp,VECtemp,IERROR)
 
             call cpu_time(timer_end%TDiag)  ! Stop the timer
 
@@ -20,6 +20,9 @@ Subroutine deallocate_calculated
   use allmod
   if (allocated(Yxiao)) deallocate(Yxiao)
   if (allocated(Yxiaotemp)) deallocate(Yxiaotemp)
+  if (allocated(Tbatch)) deallocate(Tbatch)
+  if (allocated(FMbatch)) deallocate(FMbatch)
+  if (allocated(VRRbatch)) deallocate(VRRbatch)
   if (allocated(Yxiaoprim)) deallocate(Yxiaoprim)
   if (allocated(attraxiao)) deallocate(attraxiao)
   if (allocated(attraxiaoopt)) deallocate(attraxiaoopt)
@@ -48,6 +51,8 @@ subroutine deallocateall
     
     if (quick_method%DFT) then
     call  deform_dft_grid(quick_dft_grid)
+    call  dealloc_xcg_tmp_variables(quick_xcg_tmp)
+    if (quick_method%uselibxc) call end_libxc_handles
     endif
 
 
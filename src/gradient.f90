@@ -147,6 +147,7 @@ subroutine scf_gradient
 
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 #ifdef MPIV
 !   double precision:: tmp_grad(3*natom)
    include "mpif.h"
@@ -347,42 +348,23 @@ endif
    timer_cumer%TGrad=timer_cumer%TGrad+timer_end%TGrad-timer_begin%TGrad
 
 #ifdef MPIV
-!  slave node will send infos
-   if(.not.master) then
+!  Sum the gradients of all nodes into the master
+   call MPI_REDUCE(quick_qm_struct%gradient,tmp_grad,3*natom,mpi_double_precision,MPI_SUM,0,MPI_COMM_WORLD,mpierror)
+   if(master) then
       do i=1,natom*3
-         tmp_grad(i)=quick_qm_struct%gradient(i)
+         quick_qm_struct%gradient(i)=tmp_grad(i)
       enddo
-
-   call MPI_SEND(tmp_grad,3*natom,mpi_double_precision,0,mpirank,MPI_COMM_WORLD,IERROR)
-
-   if(quick_molspec%nextatom.gt.0) then
-      do i=1,quick_molspec%nextatom*3
-         tmp_ptchg_grad(i) = quick_qm_struct%ptchg_gradient(i)
-      enddo
-      call MPI_SEND(tmp_ptchg_grad,3*quick_molspec%nextatom,mpi_double_precision,0,mpirank,MPI_COMM_WORLD,IERROR)
    endif
 
-   else
-!  master node will receive infos from every nodes
-      do i=1,mpisize-1
-!  receive opertors from slave nodes
-         call MPI_RECV(tmp_grad,3*natom,mpi_double_precision,i,i,MPI_COMM_WORLD,MPI_STATUS,IERROR)
-!  and sum them into operator
-         do ii=1,natom*3
-            quick_qm_struct%gradient(ii)=quick_qm_struct%gradient(ii)+tmp_grad(ii)
+   if(quick_molspec%nextatom.gt.0) then
+      call MPI_REDUCE(quick_qm_struct%ptchg_gradient,tmp_ptchg_grad,3*quick_molspec%nextatom,mpi_double_precision, &
+      MPI_SUM,0,MPI_COMM_WORLD,mpierror)
+      if(master) then
+         do i=1,quick_molspec%nextatom*3
+            quick_qm_struct%ptchg_gradient(i)=tmp_ptchg_grad(i)
          enddo
-
-         if(quick_molspec%nextatom.gt.0) then
-
-            call MPI_RECV(tmp_ptchg_grad,3*quick_molspec%nextatom,mpi_double_precision,i,i,MPI_COMM_WORLD,MPI_STATUS,IERROR)
-
-            do ii=1,quick_molspec%nextatom*3
-               quick_qm_struct%ptchg_gradient(ii) = quick_qm_struct%ptchg_gradient(ii) + tmp_ptchg_grad(ii)
-            enddo
-
-         endif
-      enddo
-  endif
+      endif
+   endif
 #endif
 
 !!!!!!!!!!!!!!!!!!!!!!!Madu!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
@@ -445,6 +427,7 @@ subroutine get_nuclear_repulsion_grad
    double precision, external :: rootSquare
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
 !  This subroutine calculates the nuclear repulsion gradients. 
 
@@ -525,6 +508,7 @@ subroutine get_kinetic_grad
 
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
    logical :: ijcon
 #ifdef MPIV
    include "mpif.h"
@@ -640,6 +624,7 @@ subroutine get_electron_replusion_grad
 
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 #ifdef MPIV
    include "mpif.h"
 #endif
@@ -767,19 +752,18 @@ subroutine get_xc_grad
 !-------------------------------------------------------------------------
 
    use allmod
-   use xc_f90_types_m
-   use xc_f90_lib_m
    implicit double precision(a-h,o-z)
 
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
-   double precision, dimension(1) :: libxc_rho
-   double precision, dimension(1) :: libxc_sigma
-   double precision, dimension(1) :: libxc_exc
-   double precision, dimension(1) :: libxc_vrhoa
-   double precision, dimension(1) :: libxc_vsigmaa
-   type(xc_f90_pointer_t), dimension(quick_method%nof_functionals) ::xc_func
-   type(xc_f90_pointer_t), dimension(quick_method%nof_functionals) ::xc_info
+   !$omp threadprivate(/hrrstore/)
+!  libxc input and output of the points of a bin
+   double precision, allocatable, dimension(:) :: libxc_rho, libxc_sigma, libxc_exc, &
+   libxc_vrhoa, libxc_vsigmaa
+
+!  Bin scratch, see xc_bin.f90
+   integer, allocatable :: bgp(:), bfn(:)
+   double precision, allocatable :: bphi(:,:,:), bmat(:,:), btmp(:,:), bdens(:,:)
    
    double precision, dimension(natom*50*194) :: init_grid_ptx, init_grid_pty, init_grid_ptz, arr_wtang, arr_rwt, arr_rad3
    integer, dimension(natom*50*194) :: init_grid_atm
@@ -807,23 +791,23 @@ quick_method%xc_polarization)
    endif
 #else
 
-   if(quick_method%uselibxc) then
-!  Initiate the libxc functionals
-      do ifunc=1, quick_method%nof_functionals
-         if(quick_method%xc_polarization > 0 ) then
-            call xc_f90_func_init(xc_func(ifunc), xc_info(ifunc), &
-            quick_method%functional_id(ifunc),XC_POLARIZED)
-         else
-            call xc_f90_func_init(xc_func(ifunc), &
-            xc_info(ifunc),quick_method%functional_id(ifunc),XC_UNPOLARIZED)
-         endif
-      enddo
-   endif
+!  Initiate the libxc functionals, the handles are kept across calls
+   if(quick_method%uselibxc) call init_libxc_handles(quick_method)
+
+!  Size the bin scratch for the largest bin
+   mpt=1
+   mbf=1
+   do Ibin=1, quick_dft_grid%nbins
+      mpt=max(mpt,quick_dft_grid%bin_counter(Ibin+1)-quick_dft_grid%bin_counter(Ibin))
+      mbf=max(mbf,quick_dft_grid%basf_counter(Ibin+1)-quick_dft_grid%basf_counter(Ibin))
+   enddo
+   allocate(bgp(mpt),bfn(mbf),bphi(mpt,mbf,4),bmat(mbf,mbf),btmp(mpt,mbf),bdens(mpt,4))
+   allocate(libxc_rho(mpt),libxc_sigma(mpt),libxc_exc(mpt),libxc_vrhoa(mpt),libxc_vsigmaa(mpt))
 
 #if defined MPIV && !defined CUDA_MPIV
       if(bMPI) then
-         irad_init = quick_dft_grid%igridptll(mpirank+1)
-         irad_end = quick_dft_grid%igridptul(mpirank+1)
+         irad_init = quick_dft_grid%igradptll(mpirank+1)
+         irad_end = quick_dft_grid%igradptul(mpirank+1)
       else
          irad_init = 1
          irad_end = quick_dft_grid%nbins
@@ -847,182 +831,153 @@ quick_method%xc_polarization)
 !            gridy=xyz(2,Iatm)+rad*RGRID(Irad)*YANG(Iang)
 !            gridz=xyz(3,Iatm)+rad*RGRID(Irad)*ZANG(Iang)
 
-!  Calculate the weight of the grid point in the SSW scheme.  If
-!  the grid point has a zero weight, we can skip it.
-
-!    do Ibin=1, quick_dft_grid%nbins
-        Igp=quick_dft_grid%bin_counter(Ibin)+1
-
-        do while(Igp < quick_dft_grid%bin_counter(Ibin+1)+1)
+        nbf=quick_dft_grid%basf_counter(Ibin+1)-quick_dft_grid%basf_counter(Ibin)
 
-           gridx=quick_dft_grid%gridxb(Igp)
-           gridy=quick_dft_grid%gridyb(Igp)
-           gridz=quick_dft_grid%gridzb(Igp)
-
-           sswt=quick_dft_grid%gridb_sswt(Igp)
-           weight=quick_dft_grid%gridb_weight(Igp)
-           Iatm=quick_dft_grid%gridb_atm(Igp)
+!  Collect the grid points of the bin that carry weight. If a grid point
+!  has a zero weight, we can skip it.
+        npt=0
+        do Igp=quick_dft_grid%bin_counter(Ibin)+1, quick_dft_grid%bin_counter(Ibin+1)
+           if (quick_dft_grid%gridb_weight(Igp) >= quick_method%DMCutoff ) then
+              npt=npt+1
+              bgp(npt)=Igp
+           endif
+        enddo
 
-!            sswt=SSW(gridx,gridy,gridz,Iatm)
-!            weight=sswt*WTANG(Iang)*RWT(Irad)*rad3
-            
-            if (weight < quick_method%DMCutoff ) then
-               continue
-            else
+        if (npt == 0 .or. nbf == 0) cycle
 
-               icount=quick_dft_grid%basf_counter(Ibin)+1
-               do while (icount < quick_dft_grid%basf_counter(Ibin+1)+1)
-                  Ibas=quick_dft_grid%basf(icount)+1
+!  evaluate the basis functions, the densities and their gradients at all
+!  points of the bin
+        call xc_bin_density(Ibin,npt,mpt,mbf,bgp,bfn,nd,bphi,bmat,btmp,bdens)
 
-                  call pteval_new_imp(gridx,gridy,gridz,phi,dphidx,dphidy, &
-                  dphidz,Ibas,icount)
+!  Evaluate the libxc functionals for all points of the bin at once
+        if(quick_method%uselibxc) then
+           do ip=1,npt
+              libxc_rho(ip)=2.0d0*bdens(ip,1)
+              libxc_sigma(ip)=4.0d0*(bdens(ip,2)**2+bdens(ip,3)**2+bdens(ip,4)**2)
+           enddo
+           call xc_bin_libxc(npt,libxc_rho,libxc_sigma,libxc_exc,libxc_vrhoa,libxc_vsigmaa)
+        endif
 
-                  phixiao(Ibas)=phi
-                  dphidxxiao(Ibas)=dphidx
-                  dphidyxiao(Ibas)=dphidy
-                  dphidzxiao(Ibas)=dphidz
+        do ip=1,npt
+           Igp=bgp(ip)
 
-                  icount=icount+1
-               enddo
+           gridx=quick_dft_grid%gridb_org(1,Ibin)+dble(quick_dft_grid%gridxb(Igp))
+           gridy=quick_dft_grid%gridb_org(2,Ibin)+dble(quick_dft_grid%gridyb(Igp))
+           gridz=quick_dft_grid%gridb_org(3,Ibin)+dble(quick_dft_grid%gridzb(Igp))
 
-               
+           sswt=quick_dft_grid%gridb_sswt(Igp)
+           weight=quick_dft_grid%gridb_weight(Igp)
+           Iatm=quick_dft_grid%gridb_atm(Igp)
 
-!  evaluate the densities at the grid point and the gradient at that grid point            
-               call denspt_new_imp(gridx,gridy,gridz,density,densityb,gax,gay,gaz, &
-               gbx,gby,gbz,Ibin)
+           density=bdens(ip,1)
+           gax=bdens(ip,2)
+           gay=bdens(ip,3)
+           gaz=bdens(ip,4)
+           densityb=density
+           gbx=gax
+           gby=gay
+           gbz=gaz
 
-               if (density < quick_method%DMCutoff ) then
-                  continue
+           if (density < quick_method%DMCutoff ) then
+              continue
 
-               else
+           else
 !  This allows the calculation of the derivative of the functional
 !  with regard to the density (dfdr), with regard to the alpha-alpha
 !  density invariant (df/dgaa), and the alpha-beta density invariant.
 
-                  densitysum=2.0d0*density
-                  sigma=4.0d0*(gax*gax+gay*gay+gaz*gaz)
-
-                  libxc_rho(1)=densitysum
-                  libxc_sigma(1)=sigma
+              densitysum=2.0d0*density
+              sigma=4.0d0*(gax*gax+gay*gay+gaz*gaz)
 
-                  tsttmp_exc=0.0d0
-                  tsttmp_vrhoa=0.0d0
-                  tsttmp_vsigmaa=0.0d0
+              if(quick_method%uselibxc) then
+                 zkec=densitysum*libxc_exc(ip)
+                 dfdr=libxc_vrhoa(ip)
+                 xiaodot=libxc_vsigmaa(ip)*4
 
-                  if(quick_method%uselibxc) then
-                     do ifunc=1, quick_method%nof_functionals
-                        select case(xc_f90_info_family(xc_info(ifunc)))
-                           case(XC_FAMILY_LDA)
-                              call xc_f90_lda_exc_vxc(xc_func(ifunc),1,libxc_rho(1), &
-                              libxc_exc(1), libxc_vrhoa(1))
-                           case(XC_FAMILY_GGA, XC_FAMILY_HYB_GGA)
-                              call xc_f90_gga_exc_vxc(xc_func(ifunc),1,libxc_rho(1), libxc_sigma(1), &
-                              libxc_exc(1), libxc_vrhoa(1), libxc_vsigmaa(1))
-                        end select
+                 xdot=xiaodot*gax
+                 ydot=xiaodot*gay
+                 zdot=xiaodot*gaz
+              
+              elseif(quick_method%BLYP) then
 
-                        tsttmp_exc=tsttmp_exc+libxc_exc(1)
-                        tsttmp_vrhoa=tsttmp_vrhoa+libxc_vrhoa(1)
-                        tsttmp_vsigmaa=tsttmp_vsigmaa+libxc_vsigmaa(1)
-                     enddo
+                 call becke_E(density, densityb, gax, gay, gaz, gbx, gby,gbz, Ex)
+                 call lyp_e(density, densityb, gax, gay, gaz, gbx, gby, gbz,Ec)
 
-                     zkec=densitysum*tsttmp_exc
-                     dfdr=tsttmp_vrhoa
-                     xiaodot=tsttmp_vsigmaa*4
+                 zkec=Ex+Ec
 
-                     xdot=xiaodot*gax
-                     ydot=xiaodot*gay
-                     zdot=xiaodot*gaz
-                  
-                  elseif(quick_method%BLYP) then
+                 call becke(density, gax, gay, gaz, gbx, gby, gbz, dfdr, dfdgaa, dfdgab)
+                 call lyp(density, densityb, gax, gay, gaz, gbx, gby, gbz, dfdr2, dfdgaa2, dfdgab2)
+        
+                 dfdr = dfdr + dfdr2
+                 dfdgaa = dfdgaa + dfdgaa2
+                 dfdgab = dfdgab + dfdgab2
 
-                     call becke_E(density, densityb, gax, gay, gaz, gbx, gby,gbz, Ex)
-                     call lyp_e(density, densityb, gax, gay, gaz, gbx, gby, gbz,Ec)
+                 xdot = 2.d0*dfdgaa*gax + dfdgab*gbx
+                 ydot = 2.d0*dfdgaa*gay + dfdgab*gby
+                 zdot = 2.d0*dfdgaa*gaz + dfdgab*gbz
 
-                     zkec=Ex+Ec
+              elseif(quick_method%B3LYP) then
 
-                     call becke(density, gax, gay, gaz, gbx, gby, gbz, dfdr, dfdgaa, dfdgab)
-                     call lyp(density, densityb, gax, gay, gaz, gbx, gby, gbz, dfdr2, dfdgaa2, dfdgab2)
-            
-                     dfdr = dfdr + dfdr2
-                     dfdgaa = dfdgaa + dfdgaa2
-                     dfdgab = dfdgab + dfdgab2
+                 call b3lyp_e(densitysum, sigma, zkec)
+                 call b3lypf(densitysum, sigma, dfdr, xiaodot)
 
-                     xdot = 2.d0*dfdgaa*gax + dfdgab*gbx
-                     ydot = 2.d0*dfdgaa*gay + dfdgab*gby
-                     zdot = 2.d0*dfdgaa*gaz + dfdgab*gbz
+                 xdot=xiaodot*gax
+                 ydot=xiaodot*gay
+                 zdot=xiaodot*gaz
 
-                  elseif(quick_method%B3LYP) then
-
-                     call b3lyp_e(densitysum, sigma, zkec)
-                     call b3lypf(densitysum, sigma, dfdr, xiaodot)
-
-                     xdot=xiaodot*gax
-                     ydot=xiaodot*gay
-                     zdot=xiaodot*gaz
-
-                  endif
+              endif
 
 ! Now loop over basis functions and compute the addition to the matrix
-! element.
-                  icount=quick_dft_grid%basf_counter(Ibin)+1
-                  do while (icount < quick_dft_grid%basf_counter(Ibin+1)+1)
-                     Ibas=quick_dft_grid%basf(icount)+1
-
-                     phi=phixiao(Ibas)
-                     dphidx=dphidxxiao(Ibas)
-                     dphidy=dphidyxiao(Ibas)
-                     dphidz=dphidzxiao(Ibas)
-
-                     !call pteval_new_imp(gridx,gridy,gridz,phi,dphidx,dphidy, &
-                     !dphidz,Ibas,icount)
-
-
-                     quicktest = DABS(dphidx+dphidy+dphidz+phi)
-                     
-                     if (quicktest < quick_method%DMCutoff ) then
-                        continue
-                     else
-                        call pt2der(gridx,gridy,gridz,dxdx,dxdy,dxdz, &
-                        dydy,dydz,dzdz,Ibas,icount)
-
-                        Ibasstart=(quick_basis%ncenter(Ibas)-1)*3
-
-                        jcount=quick_dft_grid%basf_counter(Ibin)+1
-                        do while(jcount<quick_dft_grid%basf_counter(Ibin+1)+1)
-                           Jbas = quick_dft_grid%basf(jcount)+1 
-
-                           phi2=phixiao(Jbas)
-                           dphi2dx=dphidxxiao(Jbas)
-                           dphi2dy=dphidyxiao(Jbas)
-                           dphi2dz=dphidzxiao(Jbas)
-
-                           !call pteval_new_imp(gridx,gridy,gridz,phi2,dphi2dx,dphi2dy, &
-                           !dphi2dz,Jbas,jcount)
-
-                           quick_qm_struct%gradient(Ibasstart+1) =quick_qm_struct%gradient(Ibasstart+1) - &
-                           2.d0*quick_qm_struct%dense(Ibas,Jbas)*weight*&
-                           (dfdr*dphidx*phi2 &
-                           + xdot*(dxdx*phi2+dphidx*dphi2dx) &
-                           + ydot*(dxdy*phi2+dphidx*dphi2dy) &
-                           + zdot*(dxdz*phi2+dphidx*dphi2dz))
-                           quick_qm_struct%gradient(Ibasstart+2)= quick_qm_struct%gradient(Ibasstart+2) - &
-                           2.d0*quick_qm_struct%dense(Ibas,Jbas)*weight*&
-                           (dfdr*dphidy*phi2 &
-                           + xdot*(dxdy*phi2+dphidy*dphi2dx) &
-                           + ydot*(dydy*phi2+dphidy*dphi2dy) &
-                           + zdot*(dydz*phi2+dphidy*dphi2dz))
-                           quick_qm_struct%gradient(Ibasstart+3)= quick_qm_struct%gradient(Ibasstart+3) - &
-                           2.d0*quick_qm_struct%dense(Ibas,Jbas)*weight*&
-                           (dfdr*dphidz*phi2 &
-                           + xdot*(dxdz*phi2+dphidz*dphi2dx) &
-                           + ydot*(dydz*phi2+dphidz*dphi2dy) &
-                           + zdot*(dzdz*phi2+dphidz*dphi2dz))
-                           jcount=jcount+1
-                        enddo
-                     endif
-
-                  icount=icount+1
-                  enddo
+! element. The density screening in xc_bin_density reorders the columns
+! of bphi, bfn gives their position in basf.
+              do i=1,nbf
+                 icount=bfn(i)
+                 Ibas=quick_dft_grid%basf(icount)+1
+
+                 phi=bphi(ip,i,1)
+                 dphidx=bphi(ip,i,2)
+                 dphidy=bphi(ip,i,3)
+                 dphidz=bphi(ip,i,4)
+
+                 quicktest = DABS(dphidx+dphidy+dphidz+phi)
+                 
+                 if (quicktest < quick_method%DMCutoff ) then
+                    continue
+                 else
+                    call pt2der(gridx,gridy,gridz,dxdx,dxdy,dxdz, &
+                    dydy,dydz,dzdz,Ibas,icount)
+
+                    Ibasstart=(quick_basis%ncenter(Ibas)-1)*3
+
+                    do j=1,nbf
+                       Jbas = quick_dft_grid%basf(bfn(j))+1
+
+                       phi2=bphi(ip,j,1)
+                       dphi2dx=bphi(ip,j,2)
+                       dphi2dy=bphi(ip,j,3)
+                       dphi2dz=bphi(ip,j,4)
+
+                       quick_qm_struct%gradient(Ibasstart+1) =quick_qm_struct%gradient(Ibasstart+1) - &
+                       2.d0*quick_qm_struct%dense(Ibas,Jbas)*weight*&
+                       (dfdr*dphidx*phi2 &
+                       + xdot*(dxdx*phi2+dphidx*dphi2dx) &
+                       + ydot*(dxdy*phi2+dphidx*dphi2dy) &
+                       + zdot*(dxdz*phi2+dphidx*dphi2dz))
+                       quick_qm_struct%gradient(Ibasstart+2)= quick_qm_struct%gradient(Ibasstart+2) - &
+                       2.d0*quick_qm_struct%dense(Ibas,Jbas)*weight*&
+                       (dfdr*dphidy*phi2 &
+                       + xdot*(dxdy*phi2+dphidy*dphi2dx) &
+                       + ydot*(dydy*phi2+dphidy*dphi2dy) &
+                       + zdot*(dydz*phi2+dphidy*dphi2dz))
+                       quick_qm_struct%gradient(Ibasstart+3)= quick_qm_struct%gradient(Ibasstart+3) - &
+                       2.d0*quick_qm_struct%dense(Ibas,Jbas)*weight*&
+                       (dfdr*dphidz*phi2 &
+                       + xdot*(dxdz*phi2+dphidz*dphi2dx) &
+                       + ydot*(dydz*phi2+dphidz*dphi2dy) &
+                       + zdot*(dzdz*phi2+dphidz*dphi2dz))
+                    enddo
+                 endif
+              enddo
 
 !  We are now completely done with the derivative of the exchange correlation energy with nuclear displacement
 !  at this point. Now we need to do the quadrature weight derivatives. At this point in the loop, we know that
@@ -1030,25 +985,17 @@ quick_method%xc_polarization)
 !  actually calculate the energy and the derivatives of the quadrature at this point. Due to the volume of code,
 !  this is done in sswder. Note that if a new weighting scheme is ever added, this needs
 !  to be modified with a second subprogram.
-                  if (sswt == 1.d0) then
-                     continue
-                  else
-                     call sswder(gridx,gridy,gridz,zkec,weight/sswt,Iatm)
-                  endif
-               endif
-            endif
-!         enddo
-
-      Igp=Igp+1
-      enddo
+              if (sswt == 1.d0) then
+                 continue
+              else
+                 call sswder(gridx,gridy,gridz,zkec,weight/sswt,Iatm)
+              endif
+           endif
+        enddo
    enddo
 
-   if(quick_method%uselibxc) then
-!  Uninitilize libxc functionals
-      do ifunc=1, quick_method%nof_functionals
-         call xc_f90_func_end(xc_func(ifunc))
-      enddo
-   endif
+   deallocate(bgp,bfn,bphi,bmat,btmp,bdens)
+   deallocate(libxc_rho,libxc_sigma,libxc_exc,libxc_vrhoa,libxc_vsigmaa)
 #endif
 
    return
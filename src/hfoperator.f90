@@ -39,6 +39,7 @@ subroutine hfoperator(oneElecO, deltaO)
    logical :: deltaO
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2, I, J
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
    !-----------------------------------------------------------------
    ! Step 1. evaluate 1e integrals
@@ -116,9 +117,7 @@ subroutine hfoperator(oneElecO, deltaO)
 
       ! Schwartz cutoff is implemented here. (ab|cd)**2<=(ab|ab)*(cd|cd)
       ! Reference: Strout DL and Scuseria JCP 102(1995),8448.
-      do II=1,jshell
-         call get2e(II)
-      enddo
+      call get2e_omp(jshell,(/(I,I=1,jshell)/))
 !stop
 
 #ifdef CUDA
@@ -161,6 +160,7 @@ subroutine hfoperatordeltadc
    double precision cutoffTest,testtmp
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
    double precision fmmonearrayfirst(0:2,0:2,1:2,1:6,1:6,1:6,1:6)
    double precision fmmtwoarrayfirst(0:2,0:2,1:2,1:6,1:6,1:6,1:6)
@@ -372,6 +372,7 @@ subroutine hfoperatordc(oneElecO)
    double precision cutoffTest,testtmp,oneElecO(nbasis,nbasis)
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
    double precision fmmonearrayfirst(0:2,0:2,1:2,1:6,1:6,1:6,1:6)
    double precision fmmtwoarrayfirst(0:2,0:2,1:2,1:6,1:6,1:6,1:6)
@@ -461,15 +462,13 @@ subroutine mpi_hfoperator(oneElecO, deltaO)
    double precision testtmp,cutoffTest,oneElecO(nbasis,nbasis)
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
-   double precision,allocatable:: temp2d(:,:)
+   !$omp threadprivate(/hrrstore/)
    logical deltaO
 
    double precision fmmonearrayfirst(0:2,0:2,1:2,1:6,1:6,1:6,1:6)
    double precision fmmtwoarrayfirst(0:2,0:2,1:2,1:6,1:6,1:6,1:6)
 
 
-   allocate(temp2d(nbasis,nbasis))
-
    !------- MPI/MASTER -------------------
    if(MASTER) then
       call copyDMat(oneElecO,quick_qm_struct%o,nbasis)
@@ -545,37 +544,10 @@ subroutine mpi_hfoperator(oneElecO, deltaO)
       call get2e(II)
    enddo
 
-   ! After evaluation of 2e integrals, we can communicate every node so
-   ! that we can sum all integrals
-
-call MPI_BARRIER(MPI_COMM_WORLD,mpierror) !Madu
-!stop !Madu
-
-   ! slave node will send infos
-   if(.not.master) then
-
-      ! Copy Opertor to a temp array and then send it to master
-      call copyDMat(quick_qm_struct%o,temp2d,nbasis)
-      ! send operator to master node
-      call MPI_SEND(temp2d,nbasis*nbasis,mpi_double_precision,0,mpirank,MPI_COMM_WORLD,IERROR)
-
-   else
-
-      ! master node will receive infos from every nodes
-      do i=1,mpisize-1
-         ! receive opertors from slave nodes
-         call MPI_RECV(temp2d,nbasis*nbasis,mpi_double_precision,i,i,MPI_COMM_WORLD,MPI_STATUS,IERROR)
-         ! and sum them into operator
-         do ii=1,nbasis
-            do jj=1,nbasis
-               quick_qm_struct%o(ii,jj)=quick_qm_struct%o(ii,jj)+temp2d(ii,jj)
-            enddo
-         enddo
-      enddo
-   endif
-
-   ! sync all nodes
-   call MPI_BARRIER(MPI_COMM_WORLD,mpierror)
+   ! After evaluation of 2e integrals, sum the operators of all nodes
+   ! into the master. Only the lower triangle is reduced, as the master
+   ! completes the operator with copySym below.
+   call reduce_lower_mpi(quick_qm_struct%o,nbasis)
 
    ! recover density if calculate difference
    if (deltaO) call CopyDMat(quick_qm_struct%denseSave,quick_qm_struct%dense,nbasis)
@@ -614,7 +586,7 @@ subroutine mpi_hfoperatordc(oneElecO)
    double precision testtmp,cutoffTest,oneElecO(nbasis,nbasis)
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
-   double precision,allocatable:: temp2d(:,:)
+   !$omp threadprivate(/hrrstore/)
 
    double precision fmmonearrayfirst(0:2,0:2,1:2,1:6,1:6,1:6,1:6)
    double precision fmmtwoarrayfirst(0:2,0:2,1:2,1:6,1:6,1:6,1:6)
@@ -631,8 +603,6 @@ subroutine mpi_hfoperatordc(oneElecO)
    !-------------------------------------------------------
 
 
-   allocate(temp2d(nbasis,nbasis))
-
    !------- MPI/ ALL NODES -------------------
 
    !=================================================================
@@ -718,37 +688,9 @@ subroutine mpi_hfoperatordc(oneElecO)
       call get2edc
    enddo
 
-   ! After evaluation of 2e integrals, we can communicate every node so
-   ! that we can sum all integrals
-
-   ! slave node will send infos
-
-
-   if(.not.master) then
-      do i=1,nbasis
-         do j=1,nbasis
-            temp2d(i,j)=quick_qm_struct%o(i,j)
-         enddo
-      enddo
-      ! send operator to master node
-      call MPI_SEND(temp2d,nbasis*nbasis,mpi_double_precision,0,mpirank,MPI_COMM_WORLD,IERROR)
-
-      ! master node will receive infos from every nodes
-   else
-      do i=1,mpisize-1
-         ! receive opertors from slave nodes
-         call MPI_RECV(temp2d,nbasis*nbasis,mpi_double_precision,i,i,MPI_COMM_WORLD,MPI_STATUS,IERROR)
-         ! and sum them into operator
-         do ii=1,nbasis
-            do jj=1,nbasis
-               quick_qm_struct%o(ii,jj)=quick_qm_struct%o(ii,jj)+temp2d(ii,jj)
-            enddo
-         enddo
-      enddo
-   endif
-
-   ! sync all nodes
-   call MPI_BARRIER(MPI_COMM_WORLD,mpierror)
+   ! After evaluation of 2e integrals, sum the lower triangles of the
+   ! operators of all nodes into the master
+   call reduce_lower_mpi(quick_qm_struct%o,nbasis)
 
 !-----------------Madu----------------
    if(master) then
@@ -790,33 +732,141 @@ subroutine get2e(II_arg)
    !------------------------------------------------
    use allmod
    implicit double precision(a-h,o-z)
+   integer II_arg, JJ_arg
+
+   do JJ_arg = II_arg,jshell
+      call get2e_pair(II_arg,JJ_arg)
+   enddo
+end subroutine get2e
+
+!------------------------------------------------
+! get2e_pair
+!------------------------------------------------
+subroutine get2e_pair(II_arg,JJ_arg)
+
+   !------------------------------------------------
+   ! This subroutine is to get the 2e integrals of
+   ! all (II JJ|KK LL) quartets with II<=KK<=LL
+   !------------------------------------------------
+   use allmod
+   implicit double precision(a-h,o-z)
    double precision testtmp,cutoffTest
-   integer II_arg
+   integer II_arg, JJ_arg, ipair, icache, icacheEnd
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
    II = II_arg
-   do JJ = II,jshell
-      testtmp = Ycutoff(II,JJ)
-      do KK = II,jshell
-         do LL = KK,jshell
-
-          cutoffTest = testtmp * Ycutoff(KK,LL)
-          if (cutoffTest .gt. quick_method%integralCutoff) then
-            DNmax =  max(4.0d0*cutmatrix(II,JJ), &
-                  4.0d0*cutmatrix(KK,LL), &
-                  cutmatrix(II,LL), &
-                  cutmatrix(II,KK), &
-                  cutmatrix(JJ,KK), &
-                  cutmatrix(JJ,LL))
-            ! (IJ|KL)^2<=(II|JJ)*(KK|LL) if smaller than cutoff criteria, then
-            ! ignore the calculation to save computation time
-            
-            if ( cutoffTest * DNmax  .gt. quick_method%integralCutoff ) &
-                  call shell
-           endif
-         enddo
+   JJ = JJ_arg
+   testtmp = Ycutoff(II,JJ)
+   ! semi-direct scf: the cached ket pairs of (II JJ), in the order of shellPair
+   icache = 1
+   icacheEnd = 0
+   if (allocated(eriCacheBra)) then
+      icache = eriCacheBra(1,II,JJ)
+      icacheEnd = eriCacheBra(2,II,JJ)
+   endif
+   ! 4*cutmatrixMax bounds DNmax below. In the delta density cycles cutmatrix
+   ! holds the density difference, so the loop ends early.
+   DNbound = 4.0d0*cutmatrixMax
+   do ipair = 1,nshellpair
+      KK = shellPair(1,ipair)
+      LL = shellPair(2,ipair)
+
+      cutoffTest = testtmp * Ycutoff(KK,LL)
+      ! the ket pairs are sorted by Ycutoff, none of the rest can pass
+      if (cutoffTest * DNbound .le. quick_method%integralCutoff) exit
+
+      if (KK .ge. II .and. cutoffTest .gt. quick_method%integralCutoff) then
+         DNmax =  max(4.0d0*cutmatrix(II,JJ), &
+               4.0d0*cutmatrix(KK,LL), &
+               cutmatrix(II,LL), &
+               cutmatrix(II,KK), &
+               cutmatrix(JJ,KK), &
+               cutmatrix(JJ,LL))
+         ! (IJ|KL)^2<=(II|JJ)*(KK|LL) if smaller than cutoff criteria, then
+         ! ignore the calculation to save computation time
+         
+         if ( cutoffTest * DNmax  .gt. quick_method%integralCutoff ) then
+            do while (icache .le. icacheEnd)
+               if (eriCacheKet(icache) .ge. ipair) exit
+               icache = icache+1
+            enddo
+            if (icache .le. icacheEnd) then
+               if (eriCacheKet(icache) .eq. ipair) then
+                  call shellcache(icache)
+                  cycle
+               endif
+            endif
+            call shell
+         endif
+      endif
+   enddo
+end subroutine get2e_pair
+
+!------------------------------------------------
+! get2e_omp
+!------------------------------------------------
+subroutine get2e_omp(nII,IIlist)
+
+   !------------------------------------------------
+   ! This subroutine is to get the 2e integrals of all
+   ! quartets whose first shell is in IIlist and add them
+   ! to quick_qm_struct%o. The (II JJ) shell pairs are handed
+   ! out to the OpenMP threads one at a time. The master
+   ! thread adds to the operator directly, the others to
+   ! their own copy, which is summed in at the end.
+   !------------------------------------------------
+   use allmod
+!$ use omp_lib
+   implicit double precision(a-h,o-z)
+   integer nII, IIlist(nII)
+   integer i, JJ_arg, nprimquart
+   logical isWorker
+
+   nprimquart = maxval(quick_basis%kprim(1:jshell))**4
+
+   ! semi-direct scf: adjust_cutoff may have tightened primLimit since the
+   ! cache was filled, recompute the cached integrals with the new one
+   if (allocated(eriCacheFilled)) then
+      if (quick_method%primLimit .ne. eriCachePrimLimit) then
+         eriCacheFilled = .false.
+         eriCachePrimLimit = quick_method%primLimit
+         if (master) write(ioutfile,'(4x,"--------------- SEMI-DIRECT CACHE REFILLED FOR PRIM CUTOFF ",E10.4," -------------")') &
+               eriCachePrimLimit
+      endif
+   endif
+
+!$omp parallel private(i,JJ_arg,isWorker)
+   isWorker = .false.
+!$ isWorker = omp_get_thread_num() .ne. 0
+   if (isWorker) then
+      call allocate_eri_scratch(quick_method%ffunxiao,nprimquart)
+      Yxiaotemp = 0.0d0
+      allocate(o2eThread(nbasis,nbasis))
+      o2eThread = 0.0d0
+   endif
+
+!$omp do schedule(dynamic) collapse(2)
+   do i=1,nII
+      do JJ_arg=1,jshell
+         if (JJ_arg .ge. IIlist(i)) call get2e_pair(IIlist(i),JJ_arg)
       enddo
    enddo
-end subroutine get2e
+!$omp end do
+
+   if (isWorker) then
+!$omp critical (get2e_omp_sum)
+      quick_qm_struct%o = quick_qm_struct%o + o2eThread
+!$omp end critical (get2e_omp_sum)
+      deallocate(o2eThread)
+      deallocate(Yxiao)
+      deallocate(Yxiaotemp)
+      deallocate(Tbatch)
+      deallocate(FMbatch)
+      deallocate(VRRbatch)
+   endif
+!$omp end parallel
+
+end subroutine get2e_omp
 
 !------------------------------------------------
 ! get2edc
@@ -829,6 +879,7 @@ subroutine get2edc
    implicit double precision(a-h,o-z)
    double precision testtmp,cutoffTest
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
    call cpu_time(timer_begin%t2e) !Trigger the timer for 2e-integrals
 
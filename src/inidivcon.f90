@@ -928,7 +928,7 @@ subroutine divideX
 
      !    call DIAG(NBASIS,HOLD,NBASIS,TOL,V,Sminhalf,IDEGEN1,Uxiao,IERROR)
 
-     call DIAG(NBASIS,Odcsubtemp,NBASIS,1d-10,Vtemp,EVAL1temp,IDEGEN1temp,VECtemp,IERROR)
+     call DIAGDC(NBASIS,Odcsubtemp,NBASIS,1d-10,Vtemp,EVAL1temp,IDEGEN1temp,VECtemp,IERROR)
 
      ! Consider the following:
 
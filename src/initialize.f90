@@ -40,6 +40,7 @@ subroutine initialize1(ierr)
 
    call init(quick_method)     !initialize quick_method namelist
    call init(quick_molspec)    !initialize quick_molspec namelist
+   call FmT_init               !tabulate the Boys function grid
 
    ierr=0
    call cpu_time(timer_begin%TTotal) !Trigger time counter
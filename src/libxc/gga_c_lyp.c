@@ -56,6 +56,11 @@ void xc_gga_c_lyp_set_params(xc_func_type *p, double A, double B, double c, doub
 #include "maple2c/gga_c_lyp.c"
 #endif
 
+#if !defined CUDA && !defined CUDA_MPIV
+#include "maple2c_batch/gga_c_lyp.c"
+#define func_batch xc_gga_c_lyp_func_batch
+#endif
+
 #define func maple2c_func
 #include "work_gga_c.c"
 
@@ -108,6 +108,11 @@ xc_gga_c_pbe_set_params(xc_func_type *p, double beta)
 #include "maple2c/gga_c_pbe.c" 
 #endif 
  
+#if !defined CUDA && !defined CUDA_MPIV
+#include "maple2c_batch/gga_c_pbe.c"
+#define func_batch xc_gga_c_pbe_func_batch
+#endif
+
 #define func maple2c_func 
 #include "work_gga_c.c" 
  
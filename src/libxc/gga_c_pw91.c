@@ -14,6 +14,11 @@
 #include "maple2c/gga_c_pw91.c" 
 #endif 
  
+#if !defined CUDA && !defined CUDA_MPIV
+#include "maple2c_batch/gga_c_pw91.c"
+#define func_batch xc_gga_c_pw91_func_batch
+#endif
+
 #define func maple2c_func 
 #include "work_gga_c.c" 
  
@@ -76,6 +76,11 @@ xc_gga_x_b88_set_params(xc_func_type *p, double beta, double gamma)
 #include "maple2c/gga_x_b88.c"
 #endif
 
+#if !defined CUDA && !defined CUDA_MPIV
+#include "maple2c_batch/gga_x_b88.c"
+#define func_batch xc_gga_x_b88_enhance_batch
+#endif
+
 #define func xc_gga_x_b88_enhance
 #include "work_gga_x.c"
 
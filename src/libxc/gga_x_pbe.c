@@ -141,6 +141,11 @@ xc_gga_x_pbe_set_params(xc_func_type *p, double kappa, double mu)
 #include "maple2c/gga_x_pbe.c" 
 #endif 
  
+#if !defined CUDA && !defined CUDA_MPIV
+#include "maple2c_batch/gga_x_pbe.c"
+#define func_batch xc_gga_x_pbe_enhance_batch
+#endif
+
 #define func xc_gga_x_pbe_enhance 
 #include "work_gga_x.c" 
  
@@ -87,6 +87,11 @@ xc_gga_x_pw91_set_params2(xc_func_type *p, double bt, double alpha, double expo)
 #include "maple2c/gga_x_pw91.c" 
 #endif 
  
+#if !defined CUDA && !defined CUDA_MPIV
+#include "maple2c_batch/gga_x_pw91.c"
+#define func_batch xc_gga_x_pw91_enhance_batch
+#endif
+
 #define func maple2c_func 
 #include "work_gga_x.c" 
  
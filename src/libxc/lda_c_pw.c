@@ -110,6 +110,11 @@ lda_c_pw_init(xc_func_type *p)
 #include "maple2c/lda_c_pw.c" 
 #endif 
  
+#if !defined CUDA && !defined CUDA_MPIV
+#include "maple2c_batch/lda_c_pw.c"
+#define func_batch xc_lda_c_pw_func0_batch
+#endif
+
 #define func maple2c_func 
 #include "work_lda.c" 
  
@@ -19,6 +19,11 @@
 #include "maple2c/lda_c_vwn.c" 
 #endif 
  
+#if !defined CUDA && !defined CUDA_MPIV
+#include "maple2c_batch/lda_c_vwn.c"
+#define func_batch xc_lda_c_vwn_func0_batch
+#endif
+
 #define func maple2c_func 
 #include "work_lda.c" 
  
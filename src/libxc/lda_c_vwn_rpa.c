@@ -14,6 +14,11 @@
 #include "maple2c/lda_c_vwn_rpa.c"
 #endif
 
+#if !defined CUDA && !defined CUDA_MPIV
+#include "maple2c_batch/lda_c_vwn_rpa.c"
+#define func_batch xc_lda_c_vwn_rpa_func0_batch
+#endif
+
 #define func maple2c_func
 #include "work_lda.c"
 
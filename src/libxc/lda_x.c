@@ -182,6 +182,11 @@ xc_lda_x_attenuation_function(int interaction, int order, double aa,
 #include "maple2c/lda_x.c"
 #endif
 
+#if !defined CUDA && !defined CUDA_MPIV
+#include "maple2c_batch/lda_x.c"
+#define func_batch xc_lda_x_func0_batch
+#endif
+
 #define func maple2c_func
 #include "work_lda.c"
 
@@ -0,0 +1,122 @@
+/*
+  Batched CPU port of maple2c/gga_c_lyp.c, see work_gga_c.c.
+  Evaluates the energy per particle and its derivatives by rs, xt and xs of xc_gga_c_lyp_func
+  for n unpolarized points with a loop without branches, so that it can
+  be vectorized across the points.
+*/
+static void
+xc_gga_c_lyp_func_batch(const xc_func_type *p, int n, const double *rs, const double *xt, const double *xs,
+ double *f, double *dfdrs, double *dfdxt, double *dfdxs)
+{
+  gga_c_lyp_params prm;
+  int i;
+
+  assert(p->params != NULL);
+  prm = *(gga_c_lyp_params *)(p->params);
+
+  for(i = 0; i < n; i++){
+    double t7, t8, t10, t11, t12, t13, t15, t16;
+    double t17, t20, t21, t22, t26, t27, t28, t30;
+    double t32, t34, t37, t39, t40, t41, t42, t43;
+    double t44, t45, t46, t47, t48, t49, t50, t51;
+    double t52, t53, t57, t58, t60, t61, t62, t63;
+    double t64, t65, t66, t70, t72, t75, t77, t78;
+    double t83, t86, t92, t93, t96, t97, t102, t103;
+    double t104, t108, t111, t112, t115, t116, t117, t119;
+    double t120, t121, t122, t127, t128, t131, t132, t136;
+    double t137, t140, t141, t195, t196, t197, t198, t201;
+    double t202, t203, t206, t207, t210, t212, t218;
+
+    t7 = 0.0 * 0.0;
+    t8 = -t7 + 0.1e1;
+    t10 = M_CBRT3;
+    t11 = t10 * t10;
+    t12 = M_CBRT4;
+    t13 = t11 * t12;
+    t15 = cbrt(0.1e1 / 0.31415926535897932385e1);
+    t16 = 0.1e1 / t15;
+    t17 = t13 * t16;
+    t20 = 0.1e1 + prm.d * rs[i] * t17 / 0.3e1;
+    t21 = 0.1e1 / t20;
+    t22 = t8 * t21;
+    t26 = exp(-prm.c * rs[i] * t17 / 0.3e1);
+    t27 = prm.B * t26;
+    t28 = xt[i] * xt[i];
+    t30 = prm.d * t21 + prm.c;
+    t32 = t30 * rs[i] * t17;
+    t34 = 0.47e2 - 0.7e1 / 0.3e1 * t32;
+    t37 = t8 * t34 / 0.72e2 - 0.2e1 / 0.3e1;
+    t39 = 0.31415926535897932385e1 * 0.31415926535897932385e1;
+    t40 = cbrt(t39);
+    t41 = t40 * t40;
+    t42 = t11 * t41;
+    t43 = 0.1e1 + 0.0;
+    t44 = t43 * t43;
+    t45 = cbrt(t43);
+    t46 = t45 * t45;
+    t47 = t46 * t44;
+    t48 = 0.1e1 - 0.0;
+    t49 = t48 * t48;
+    t50 = cbrt(t48);
+    t51 = t50 * t50;
+    t52 = t51 * t49;
+    t53 = t47 + t52;
+    t57 = M_CBRT2;
+    t58 = t57 * t8;
+    t60 = 0.5e1 / 0.2e1 - t32 / 0.54e2;
+    t61 = xs[i] * xs[i];
+    t62 = t61 * t47;
+    t63 = xs[i] * xs[i];
+    t64 = t63 * t52;
+    t65 = t62 + t64;
+    t66 = t60 * t65;
+    t70 = t32 / 0.3e1 - 0.11e2;
+    t72 = t46 * t44 * t43;
+    t75 = t51 * t49 * t48;
+    t77 = t61 * t72 + t63 * t75;
+    t78 = t70 * t77;
+    t83 = t44 * t63;
+    t86 = t49 * t61;
+    t92 = -t28 * t37 - 0.3e1 / 0.20e2 * t42 * t8 * t53 + t58 * t66 / 0.32e2 + t58 * t78 / 0.576e3 - t57 * (0.2e1 / 0.3e1 * t62 + 0.2e1 / 0.3e1 * t64 - t83 * t52 / 0.4e1 - t86 * t47 / 0.4e1) / 0.8e1;
+    t93 = t21 * t92;
+    f[i] = prm.A * (t27 * t93 - t22);
+    t96 = t20 * t20;
+    t97 = 0.1e1 / t96;
+    t102 = prm.B * prm.c;
+    t103 = t102 * t13;
+    t104 = t16 * t26;
+    t108 = t97 * t92;
+    t111 = t12 * t16;
+    t112 = prm.d * t11 * t111;
+    t115 = t28 * t8;
+    t116 = prm.d * prm.d;
+    t117 = t116 * t97;
+    t119 = t12 * t12;
+    t120 = t15 * t15;
+    t121 = 0.1e1 / t120;
+    t122 = t119 * t121;
+    t127 = t117 * t10 * t122 * rs[i] - t30 * t11 * t111;
+    t128 = 0.7e1 / 0.3e1 * t127;
+    t131 = t127 / 0.54e2;
+    t132 = t131 * t65;
+    t136 = -t127 / 0.3e1;
+    t137 = t136 * t77;
+    t140 = -t115 * t128 / 0.72e2 + t58 * t132 / 0.32e2 + t58 * t137 / 0.576e3;
+    t141 = t21 * t140;
+    dfdrs[i] = prm.A * (t8 * t97 * prm.d * t17 / 0.3e1 - t103 * t104 * t93 / 0.3e1 - t27 * t108 * t112 / 0.3e1 + t27 * t141);
+    t195 = prm.A * prm.B;
+    t196 = t195 * t26;
+    t197 = t21 * xt[i];
+    t198 = t197 * t37;
+    dfdxt[i] = -0.2e1 * t196 * t198;
+    t201 = t26 * t21;
+    t202 = t60 * xs[i];
+    t203 = t202 * t47;
+    t206 = t70 * xs[i];
+    t207 = t206 * t72;
+    t210 = xs[i] * t47;
+    t212 = t49 * xs[i];
+    t218 = t58 * t203 / 0.16e2 + t58 * t207 / 0.288e3 - t57 * (0.4e1 / 0.3e1 * t210 - t212 * t47 / 0.2e1) / 0.8e1;
+    dfdxs[i] = t195 * t201 * t218;
+  }
+}
@@ -0,0 +1,175 @@
+/*
+  Batched CPU port of maple2c/gga_c_pbe.c, see work_gga_c.c.
+  Evaluates the energy per particle and its derivatives by rs, xt and xs of xc_gga_c_pbe_func
+  for n unpolarized points with a loop without branches, so that it can
+  be vectorized across the points.
+*/
+static void
+xc_gga_c_pbe_func_batch(const xc_func_type *p, int n, const double *rs, const double *xt, const double *xs,
+ double *f, double *dfdrs, double *dfdxt, double *dfdxs)
+{
+  gga_c_pbe_params prm;
+  int i;
+
+  assert(p->params != NULL);
+  prm = *(gga_c_pbe_params *)(p->params);
+
+  for(i = 0; i < n; i++){
+    double t2, t3, t6, t8, t10, t13, t14, t16;
+    double t17, t18, t19, t20, t21, t22, t23, t24;
+    double t25, t26, t27, t30, t32, t37, t40, t41;
+    double t45, t50, t53, t54, t55, t58, t59, t60;
+    double t62, t63, t64, t66, t67, t68, t69, t70;
+    double t71, t72, t73, t74, t77, t78, t80, t81;
+    double t83, t84, t85, t86, t87, t88, t89, t90;
+    double t91, t92, t93, t94, t98, t99, t100, t103;
+    double t104, t105, t107, t108, t110, t111, t112, t113;
+    double t114, t116, t119, t120, t121, t123, t125, t126;
+    double t127, t131, t132, t133, t137, t138, t139, t143;
+    double t144, t145, t149, t150, t152, t153, t155, t157;
+    double t158, t161, t162, t163, t164, t165, t167, t169;
+    double t170, t171, t174, t178, t179, t183, t184, t186;
+    double t187, t188, t189, t190, t192, t197, t198, t200;
+    double t201, t202, t265, t268, t269, t273, t274, t276;
+    double t277, t278, t279, t280, t282, t283;
+
+    t2 = 0.1e1 + 0.21370e0 * rs[i];
+    t3 = sqrt(rs[i]);
+    t6 = POW_3_2(rs[i]);
+    t8 = rs[i] * rs[i];
+    t10 = 0.75957e1 * t3 + 0.35876e1 * rs[i] + 0.16382e1 * t6 + 0.49294e0 * t8;
+    t13 = 0.1e1 + 0.16081979498692535067e2 / t10;
+    t14 = log(t13);
+    t16 = 0.621814e-1 * t2 * t14;
+    t17 = 0.0 * 0.0;
+    t18 = t17 * t17;
+    t19 = 0.1e1 + 0.0;
+    t20 = POW_1_3(t19);
+    t21 = t20 * t19;
+    t22 = 0.1e1 - 0.0;
+    t23 = POW_1_3(t22);
+    t24 = t23 * t22;
+    t25 = t21 + t24 - 0.2e1;
+    t26 = t18 * t25;
+    t27 = POW_1_3(0.2e1);
+    t30 = 0.1e1 / (0.2e1 * t27 - 0.2e1);
+    t32 = 0.1e1 + 0.20548e0 * rs[i];
+    t37 = 0.141189e2 * t3 + 0.61977e1 * rs[i] + 0.33662e1 * t6 + 0.62517e0 * t8;
+    t40 = 0.1e1 + 0.32163958997385070134e2 / t37;
+    t41 = log(t40);
+    t45 = 0.1e1 + 0.11125e0 * rs[i];
+    t50 = 0.10357e2 * t3 + 0.36231e1 * rs[i] + 0.88026e0 * t6 + 0.49671e0 * t8;
+    t53 = 0.1e1 + 0.29608749977793437516e2 / t50;
+    t54 = log(t53);
+    t55 = t45 * t54;
+    t58 = t30 * (-0.3109070e-1 * t32 * t41 + t16 - 0.19751673498613801407e-1 * t55);
+    t59 = t26 * t58;
+    t60 = t25 * t30;
+    t62 = 0.19751673498613801407e-1 * t60 * t55;
+    t63 = t20 * t20;
+    t64 = t23 * t23;
+    t66 = t63 / 0.2e1 + t64 / 0.2e1;
+    t67 = t66 * t66;
+    t68 = t67 * t66;
+    t69 = prm.gamma * t68;
+    t70 = xt[i] * xt[i];
+    t71 = t70 * t27;
+    t72 = 0.1e1 / t67;
+    t73 = 0.1e1 / rs[i];
+    t74 = t72 * t73;
+    t77 = prm.BB * prm.beta;
+    t78 = 0.1e1 / prm.gamma;
+    t80 = (-t16 + t59 + t62) * t78;
+    t81 = 0.1e1 / t68;
+    t83 = exp(-t80 * t81);
+    t84 = t83 - 0.1e1;
+    t85 = 0.1e1 / t84;
+    t86 = t78 * t85;
+    t87 = t77 * t86;
+    t88 = t70 * t70;
+    t89 = t27 * t27;
+    t90 = t88 * t89;
+    t91 = t67 * t67;
+    t92 = 0.1e1 / t91;
+    t93 = 0.1e1 / t8;
+    t94 = t92 * t93;
+    t98 = t71 * t74 / 0.32e2 + t87 * t90 * t94 / 0.1024e4;
+    t99 = prm.beta * t98;
+    t100 = prm.beta * t78;
+    t103 = t100 * t85 * t98 + 0.1e1;
+    t104 = 0.1e1 / t103;
+    t105 = t78 * t104;
+    t107 = t99 * t105 + 0.1e1;
+    t108 = log(t107);
+    f[i] = t69 * t108 - t16 + t59 + t62;
+    t110 = 0.13288165180e-1 * t14;
+    t111 = t10 * t10;
+    t112 = 0.1e1 / t111;
+    t113 = t2 * t112;
+    t114 = 0.1e1 / t3;
+    t116 = sqrt(rs[i]);
+    t119 = 0.37978500000000000000e1 * t114 + 0.35876e1 + 0.245730e1 * t116 + 0.98588e0 * rs[i];
+    t120 = 0.1e1 / t13;
+    t121 = t119 * t120;
+    t123 = 0.10000000000000000000e1 * t113 * t121;
+    t125 = t37 * t37;
+    t126 = 0.1e1 / t125;
+    t127 = t32 * t126;
+    t131 = 0.70594500000000000000e1 * t114 + 0.61977e1 + 0.504930e1 * t116 + 0.125034e1 * rs[i];
+    t132 = 0.1e1 / t40;
+    t133 = t131 * t132;
+    t137 = t50 * t50;
+    t138 = 0.1e1 / t137;
+    t139 = t45 * t138;
+    t143 = 0.51785000000000000000e1 * t114 + 0.36231e1 + 0.1320390e1 * t116 + 0.99342e0 * rs[i];
+    t144 = 0.1e1 / t53;
+    t145 = t143 * t144;
+    t149 = t30 * (-0.63885170360e-2 * t41 + 0.10000000000000000000e1 * t127 * t133 + t110 - t123 - 0.21973736767207854065e-2 * t54 + 0.58482236226346462070e0 * t139 * t145);
+    t150 = t26 * t149;
+    t152 = 0.21973736767207854065e-2 * t60 * t54;
+    t153 = t60 * t45;
+    t155 = t138 * t143 * t144;
+    t157 = 0.58482236226346462070e0 * t153 * t155;
+    t158 = t72 * t93;
+    t161 = prm.gamma * prm.gamma;
+    t162 = 0.1e1 / t161;
+    t163 = t84 * t84;
+    t164 = 0.1e1 / t163;
+    t165 = t162 * t164;
+    t167 = t77 * t165 * t88;
+    t169 = 0.1e1 / t91 / t68;
+    t170 = t89 * t169;
+    t171 = -t110 + t123 + t150 + t152 - t157;
+    t174 = t170 * t93 * t171 * t83;
+    t178 = 0.1e1 / t8 / rs[i];
+    t179 = t92 * t178;
+    t183 = -t71 * t158 / 0.32e2 + t167 * t174 / 0.1024e4 - t87 * t90 * t179 / 0.512e3;
+    t184 = prm.beta * t183;
+    t186 = t103 * t103;
+    t187 = 0.1e1 / t186;
+    t188 = t78 * t187;
+    t189 = prm.beta * t162;
+    t190 = t189 * t164;
+    t192 = t81 * t83;
+    t197 = t190 * t98 * t171 * t192 + t100 * t85 * t183;
+    t198 = t188 * t197;
+    t200 = t184 * t105 - t99 * t198;
+    t201 = 0.1e1 / t107;
+    t202 = t200 * t201;
+    dfdrs[i] = t69 * t202 - t110 + t123 + t150 + t152 - t157;
+    t265 = xt[i] * t27;
+    t268 = t70 * xt[i];
+    t269 = t268 * t89;
+    t273 = t265 * t74 / 0.16e2 + t87 * t269 * t94 / 0.256e3;
+    t274 = prm.beta * t273;
+    t276 = prm.beta * prm.beta;
+    t277 = t276 * t98;
+    t278 = t277 * t162;
+    t279 = t187 * t85;
+    t280 = t279 * t273;
+    t282 = t274 * t105 - t278 * t280;
+    t283 = t282 * t201;
+    dfdxt[i] = t69 * t283;
+    dfdxs[i] = 0.0e0;
+  }
+}
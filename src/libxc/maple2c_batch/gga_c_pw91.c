@@ -0,0 +1,223 @@
+/*
+  Batched CPU port of maple2c/gga_c_pw91.c, see work_gga_c.c.
+  Evaluates the energy per particle and its derivatives by rs, xt and xs of xc_gga_c_pw91_func
+  for n unpolarized points with a loop without branches, so that it can
+  be vectorized across the points.
+*/
+static void
+xc_gga_c_pw91_func_batch(const xc_func_type *p, int n, const double *rs, const double *xt, const double *xs,
+ double *f, double *dfdrs, double *dfdxt, double *dfdxs)
+{
+  int i;
+
+  for(i = 0; i < n; i++){
+    double t2, t3, t6, t8, t10, t13, t14, t16;
+    double t17, t18, t19, t20, t21, t22, t23, t24;
+    double t25, t26, t27, t30, t32, t37, t40, t41;
+    double t45, t50, t53, t54, t55, t58, t59, t60;
+    double t62, t63, t64, t65, t66, t67, t68, t69;
+    double t70, t72, t73, t74, t76, t77, t78, t79;
+    double t80, t81, t82, t84, t85, t87, t88, t91;
+    double t92, t93, t94, t95, t96, t97, t98, t99;
+    double t100, t101, t102, t105, t108, t109, t110, t113;
+    double t114, t118, t119, t123, t124, t127, t130, t131;
+    double t133, t134, t135, t136, t138, t140, t141, t143;
+    double t148, t149, t150, t153, t154, t155, t156, t157;
+    double t159, t162, t163, t164, t166, t168, t169, t170;
+    double t174, t175, t176, t180, t181, t182, t186, t187;
+    double t188, t192, t193, t195, t196, t198, t200, t201;
+    double t202, t204, t205, t206, t207, t208, t209, t210;
+    double t211, t215, t216, t217, t220, t224, t225, t226;
+    double t227, t228, t229, t230, t231, t232, t238, t239;
+    double t241, t242, t243, t244, t245, t247, t252, t256;
+    double t258, t263, t265, t266, t267, t269, t271, t272;
+    double t273, t277, t278, t366, t371, t372, t378, t379;
+    double t381, t382, t383, t386, t394, t398, t403, t404;
+    double t406, t408, t409, t410;
+
+    t2 = 0.1e1 + 0.21370e0 * rs[i];
+    t3 = sqrt(rs[i]);
+    t6 = POW_3_2(rs[i]);
+    t8 = rs[i] * rs[i];
+    t10 = 0.75957e1 * t3 + 0.35876e1 * rs[i] + 0.16382e1 * t6 + 0.49294e0 * t8;
+    t13 = 0.1e1 + 0.16081824322151104822e2 / t10;
+    t14 = log(t13);
+    t16 = 0.62182e-1 * t2 * t14;
+    t17 = 0.0 * 0.0;
+    t18 = t17 * t17;
+    t19 = 0.1e1 + 0.0;
+    t20 = POW_1_3(t19);
+    t21 = t20 * t19;
+    t22 = 0.1e1 - 0.0;
+    t23 = POW_1_3(t22);
+    t24 = t23 * t22;
+    t25 = t21 + t24 - 0.2e1;
+    t26 = t18 * t25;
+    t27 = POW_1_3(0.2e1);
+    t30 = 0.1e1 / (0.2e1 * t27 - 0.2e1);
+    t32 = 0.1e1 + 0.20548e0 * rs[i];
+    t37 = 0.141189e2 * t3 + 0.61977e1 * rs[i] + 0.33662e1 * t6 + 0.62517e0 * t8;
+    t40 = 0.1e1 + 0.32164683177870697974e2 / t37;
+    t41 = log(t40);
+    t45 = 0.1e1 + 0.11125e0 * rs[i];
+    t50 = 0.10357e2 * t3 + 0.36231e1 * rs[i] + 0.88026e0 * t6 + 0.49671e0 * t8;
+    t53 = 0.1e1 + 0.29608574643216675549e2 / t50;
+    t54 = log(t53);
+    t55 = t45 * t54;
+    t58 = t30 * (-0.31090e-1 * t32 * t41 + t16 - 0.19751789702565206229e-1 * t55);
+    t59 = t26 * t58;
+    t60 = t25 * t30;
+    t62 = 0.19751789702565206229e-1 * t60 * t55;
+    t63 = POW_1_3(0.3e1);
+    t64 = t63 * t63;
+    t65 = 0.31415926535897932385e1 * 0.31415926535897932385e1;
+    t66 = POW_1_3(t65);
+    t67 = t66 * t66;
+    t68 = t64 * t67;
+    t69 = t20 * t20;
+    t70 = t23 * t23;
+    t72 = t69 / 0.2e1 + t70 / 0.2e1;
+    t73 = t72 * t72;
+    t74 = t73 * t72;
+    t76 = t64 / t66;
+    t77 = xt[i] * xt[i];
+    t78 = t77 * t27;
+    t79 = 0.1e1 / t73;
+    t80 = 0.1e1 / rs[i];
+    t81 = t79 * t80;
+    t82 = t78 * t81;
+    t84 = -t16 + t59 + t62;
+    t85 = 0.1e1 / t74;
+    t87 = 0.1e1 / t67;
+    t88 = t63 * t87;
+    t91 = exp(-0.12897460341341234505e3 * t84 * t85 * t88);
+    t92 = t91 - 0.1e1;
+    t93 = 0.1e1 / t92;
+    t94 = t76 * t93;
+    t95 = t77 * t77;
+    t96 = t27 * t27;
+    t97 = t95 * t96;
+    t98 = t73 * t73;
+    t99 = 0.1e1 / t98;
+    t100 = 0.1e1 / t8;
+    t101 = t99 * t100;
+    t102 = t97 * t101;
+    t105 = t82 / 0.32e2 + 0.27166129655589868295e-2 * t94 * t102;
+    t108 = t92 * t92;
+    t109 = 0.1e1 / t108;
+    t110 = t88 * t109;
+    t113 = 0.1e1 + 0.86931614897887578544e-1 * t94 * t82 + 0.22671317006263888779e-1 * t110 * t102;
+    t114 = 0.1e1 / t113;
+    t118 = 0.1e1 + 0.27818116767324025134e1 * t76 * t105 * t114;
+    t119 = log(t118);
+    t123 = 0.1e1 / 0.31415926535897932385e1;
+    t124 = t123 * t63;
+    t127 = 0.2568e1 + 0.23266e2 * rs[i] + 0.7389e-2 * t8;
+    t130 = 0.1000e4 + 0.8723000e4 * rs[i] + 0.472000e3 * t8;
+    t131 = 0.1e1 / t130;
+    t133 = t127 * t131 - 0.18535714285714285714e-2;
+    t134 = t66 * t133;
+    t135 = t124 * t134;
+    t136 = t72 * t77;
+    t138 = POW_1_3(0.4e1);
+    t140 = POW_1_3(0.9e1);
+    t141 = t140 * t140;
+    t143 = POW_1_3(t123);
+    t148 = exp(-0.25e2 / 0.18e2 * t123 * t138 * t141 * t143 * t73 * t78);
+    t149 = t27 * t80 * t148;
+    t150 = t136 * t149;
+    f[i] = -t16 + t59 + t62 + 0.25844881434903430496e-2 * t68 * t74 * t119 + t135 * t150 / 0.2e1;
+    t153 = 0.1328829340e-1 * t14;
+    t154 = t10 * t10;
+    t155 = 0.1e1 / t154;
+    t156 = t2 * t155;
+    t157 = 0.1e1 / t3;
+    t159 = sqrt(rs[i]);
+    t162 = 0.37978500000000000000e1 * t157 + 0.35876e1 + 0.245730e1 * t159 + 0.98588e0 * rs[i];
+    t163 = 0.1e1 / t13;
+    t164 = t162 * t163;
+    t166 = 0.10000000000000000000e1 * t156 * t164;
+    t168 = t37 * t37;
+    t169 = 0.1e1 / t168;
+    t170 = t32 * t169;
+    t174 = 0.70594500000000000000e1 * t157 + 0.61977e1 + 0.504930e1 * t159 + 0.125034e1 * rs[i];
+    t175 = 0.1e1 / t40;
+    t176 = t174 * t175;
+    t180 = t50 * t50;
+    t181 = 0.1e1 / t180;
+    t182 = t45 * t181;
+    t186 = 0.51785000000000000000e1 * t157 + 0.36231e1 + 0.1320390e1 * t159 + 0.99342e0 * rs[i];
+    t187 = 0.1e1 / t53;
+    t188 = t186 * t187;
+    t192 = t30 * (-0.638837320e-2 * t41 + 0.10000000000000000000e1 * t170 * t176 + t153 - t166 - 0.21973866044103791930e-2 * t54 + 0.58482233974552040708e0 * t182 * t188);
+    t193 = t26 * t192;
+    t195 = 0.21973866044103791930e-2 * t60 * t54;
+    t196 = t60 * t45;
+    t198 = t181 * t186 * t187;
+    t200 = 0.58482233974552040708e0 * t196 * t198;
+    t201 = t79 * t100;
+    t202 = t78 * t201;
+    t204 = t109 * t95;
+    t205 = t204 * t96;
+    t206 = t98 * t74;
+    t207 = 0.1e1 / t206;
+    t208 = t207 * t100;
+    t209 = -t153 + t166 + t193 + t195 - t200;
+    t210 = t209 * t91;
+    t211 = t208 * t210;
+    t215 = 0.1e1 / t8 / rs[i];
+    t216 = t99 * t215;
+    t217 = t97 * t216;
+    t220 = -t202 / 0.32e2 + 0.10650094946724463253e0 * t205 * t211 - 0.54332259311179736590e-2 * t94 * t217;
+    t224 = t113 * t113;
+    t225 = 0.1e1 / t224;
+    t226 = t105 * t225;
+    t227 = t109 * t77;
+    t228 = t227 * t27;
+    t229 = t98 * t72;
+    t230 = 0.1e1 / t229;
+    t231 = t230 * t80;
+    t232 = t231 * t210;
+    t238 = 0.1e1 / t66 / t65;
+    t239 = t64 * t238;
+    t241 = 0.1e1 / t108 / t92;
+    t242 = t241 * t95;
+    t243 = t239 * t242;
+    t244 = t96 * t207;
+    t245 = t100 * t209;
+    t247 = t244 * t245 * t91;
+    t252 = 0.34080303829518282408e1 * t228 * t232 - 0.86931614897887578544e-1 * t94 * t202 + 0.58480482394852717949e1 * t243 * t247 - 0.45342634012527777558e-1 * t110 * t217;
+    t256 = 0.27818116767324025134e1 * t76 * t220 * t114 - 0.27818116767324025134e1 * t76 * t226 * t252;
+    t258 = 0.1e1 / t118;
+    t263 = 0.23266e2 + 0.14778e-1 * rs[i];
+    t265 = t130 * t130;
+    t266 = 0.1e1 / t265;
+    t267 = t127 * t266;
+    t269 = 0.8723000e4 + 0.944000e3 * rs[i];
+    t271 = t263 * t131 - t267 * t269;
+    t272 = t66 * t271;
+    t273 = t124 * t272;
+    t277 = t27 * t100 * t148;
+    t278 = t136 * t277;
+    dfdrs[i] = -t153 + t166 + t193 + t195 - t200 + 0.25844881434903430496e-2 * t68 * t74 * t256 * t258 + t273 * t150 / 0.2e1 - t135 * t278 / 0.2e1;
+    t366 = 0.1e1 / t65 * t63 * t66;
+    t371 = t96 * t80 * t138;
+    t372 = t141 * t143;
+    t378 = xt[i] * t27;
+    t379 = t378 * t81;
+    t381 = t77 * xt[i];
+    t382 = t381 * t96;
+    t383 = t382 * t101;
+    t386 = t379 / 0.16e2 + 0.10866451862235947318e-1 * t94 * t383;
+    t394 = 0.17386322979577515709e0 * t94 * t379 + 0.90685268025055555116e-1 * t110 * t383;
+    t398 = 0.27818116767324025134e1 * t76 * t386 * t114 - 0.27818116767324025134e1 * t76 * t226 * t394;
+    t403 = t72 * xt[i];
+    t404 = t403 * t149;
+    t406 = t133 * t74;
+    t408 = t366 * t406 * t381;
+    t409 = t372 * t148;
+    t410 = t371 * t409;
+    dfdxt[i] = 0.25844881434903430496e-2 * t68 * t74 * t398 * t258 + t135 * t404 - 0.25e2 / 0.18e2 * t408 * t410;
+    dfdxs[i] = 0.0e0;
+  }
+}
@@ -0,0 +1,45 @@
+/*
+  Batched CPU port of maple2c/gga_x_b88.c, see work_gga_x.c.
+  Evaluates the enhancement factor and its derivative by x of xc_gga_x_b88_enhance
+  for n unpolarized points with a loop without branches, so that it can
+  be vectorized across the points.
+*/
+static void
+xc_gga_x_b88_enhance_batch(const xc_func_type *p, int n, const double *x, double *f, double *dfdx)
+{
+  gga_x_b88_params prm;
+  int i;
+
+  assert(p->params != NULL);
+  prm = *(gga_x_b88_params *)(p->params);
+
+  for(i = 0; i < n; i++){
+    double t1, t2, t3, t4, t5, t7, t8, t9;
+    double t10, t11, t12, t15, t16, t20, t24, t25;
+    double t27, t28, t29, t32, t33;
+
+    t1 = M_CBRT3;
+    t2 = t1 * t1;
+    t3 = prm.beta * t2;
+    t4 = M_CBRT4;
+    t5 = t3 * t4;
+    t7 = cbrt(0.1e1 / 0.31415926535897932385e1);
+    t8 = 0.1e1 / t7;
+    t9 = x[i] * x[i];
+    t10 = t8 * t9;
+    t11 = prm.gamma * prm.beta;
+    t12 = log(x[i] + sqrt(x[i] * x[i] + 0.1e1));
+    t15 = t11 * x[i] * t12 + 0.1e1;
+    t16 = 0.1e1 / t15;
+    f[i] = 0.1e1 + 0.2e1 / 0.9e1 * t5 * t10 * t16;
+    t20 = t8 * x[i];
+    t24 = t15 * t15;
+    t25 = 0.1e1 / t24;
+    t27 = t9 + 0.1e1;
+    t28 = sqrt(t27);
+    t29 = 0.1e1 / t28;
+    t32 = t11 * x[i] * t29 + t11 * t12;
+    t33 = t25 * t32;
+    dfdx[i] = 0.4e1 / 0.9e1 * t5 * t20 * t16 - 0.2e1 / 0.9e1 * t5 * t10 * t33;
+  }
+}
@@ -0,0 +1,34 @@
+/*
+  Batched CPU port of maple2c/gga_x_pbe.c, see work_gga_x.c.
+  Evaluates the enhancement factor and its derivative by x of xc_gga_x_pbe_enhance
+  for n unpolarized points with a loop without branches, so that it can
+  be vectorized across the points.
+*/
+static void
+xc_gga_x_pbe_enhance_batch(const xc_func_type *p, int n, const double *x, double *f, double *dfdx)
+{
+  gga_x_pbe_params prm;
+  int i;
+
+  assert(p->params != NULL);
+  prm = *(gga_x_pbe_params *)(p->params);
+
+  for(i = 0; i < n; i++){
+    double t1, t2, t3, t4, t5, t6, t7, t11;
+    double t16, t17, t19;
+
+    t1 = M_CBRT6;
+    t2 = prm.mu * t1;
+    t3 = 0.31415926535897932385e1 * 0.31415926535897932385e1;
+    t4 = cbrt(t3);
+    t5 = t4 * t4;
+    t6 = 0.1e1 / t5;
+    t7 = x[i] * x[i];
+    t11 = prm.kappa + t2 * t6 * t7 / 0.24e2;
+    f[i] = 0.1e1 + prm.kappa * (0.1e1 - prm.kappa / t11);
+    t16 = prm.kappa * prm.kappa;
+    t17 = t11 * t11;
+    t19 = t16 / t17;
+    dfdx[i] = t19 * prm.mu * t1 * t6 * x[i] / 0.12e2;
+  }
+}
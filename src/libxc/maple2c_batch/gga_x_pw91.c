@@ -0,0 +1,57 @@
+/*
+  Batched CPU port of maple2c/gga_x_pw91.c, see work_gga_x.c.
+  Evaluates the enhancement factor and its derivative by x of xc_gga_x_pw91_enhance
+  for n unpolarized points with a loop without branches, so that it can
+  be vectorized across the points.
+*/
+static void
+xc_gga_x_pw91_enhance_batch(const xc_func_type *p, int n, const double *x, double *f, double *dfdx)
+{
+  gga_x_pw91_params prm;
+  int i;
+
+  assert(p->params != NULL);
+  prm = *(gga_x_pw91_params *)(p->params);
+
+  for(i = 0; i < n; i++){
+    double t1, t3, t4, t5, t6, t7, t8, t11;
+    double t14, t17, t18, t19, t22, t23, t24, t30;
+    double t34, t35, t38, t40, t41, t51, t52, t54;
+    double t55, t56, t60, t63, t67, t68, t70, t73;
+
+    t1 = M_CBRT6;
+    t3 = 0.31415926535897932385e1 * 0.31415926535897932385e1;
+    t4 = cbrt(t3);
+    t5 = t4 * t4;
+    t6 = 0.1e1 / t5;
+    t7 = x[i] * x[i];
+    t8 = t6 * t7;
+    t11 = exp(-prm.alpha * t1 * t8 / 0.24e2);
+    t14 = (prm.d * t11 + prm.c) * t1;
+    t17 = t1 * t1;
+    t18 = 0.1e1 / t4;
+    t19 = t17 * t18;
+    t22 = pow(t19 * x[i] / 0.12e2, prm.expo);
+    t23 = prm.f * t22;
+    t24 = t14 * t8 / 0.24e2 - t23;
+    t30 = log(prm.b * t17 * t18 * x[i] / 0.12e2 + sqrt(pow(prm.b * t17 * t18 * x[i] / 0.12e2, 0.2e1) + 0.1e1));
+    t34 = 0.1e1 + t19 * x[i] * prm.a * t30 / 0.12e2 + t23;
+    t35 = 0.1e1 / t34;
+    f[i] = t24 * t35 + 0.1e1;
+    t38 = prm.d * prm.alpha * t17;
+    t40 = 0.1e1 / t4 / t3;
+    t41 = t7 * x[i];
+    t51 = t23 * prm.expo / x[i];
+    t52 = -t38 * t40 * t41 * t11 / 0.288e3 + t14 * t6 * x[i] / 0.12e2 - t51;
+    t54 = t34 * t34;
+    t55 = 0.1e1 / t54;
+    t56 = t24 * t55;
+    t60 = t1 * t6;
+    t63 = prm.b * prm.b;
+    t67 = 0.6e1 * t63 * t1 * t8 + 0.144e3;
+    t68 = sqrt(t67);
+    t70 = prm.a * prm.b / t68;
+    t73 = t19 * prm.a * t30 / 0.12e2 + t60 * x[i] * t70 / 0.2e1 + t51;
+    dfdx[i] = t52 * t35 - t56 * t73;
+  }
+}
@@ -0,0 +1,46 @@
+/*
+  Batched CPU port of maple2c/lda_c_pw.c, see work_lda.c.
+  Evaluates the energy per particle and its derivative by rs of func0
+  for n unpolarized points with a loop without branches, so that it can
+  be vectorized across the points.
+*/
+static void
+xc_lda_c_pw_func0_batch(const xc_func_type *p, int n, const double *rs, double *f, double *dfdrs)
+{
+  lda_c_pw_params prm;
+  int i;
+
+  assert(p->params != NULL);
+  prm = *(lda_c_pw_params *)(p->params);
+
+  for(i = 0; i < n; i++){
+    double t1, t2, t4, t6, t7, t8, t10, t12;
+    double t13, t17, t18, t19, t20, t24, t25, t31;
+    double t32, t33, t37, t43, t44, t45;
+
+    t1 = prm.a[0];
+    t2 = prm.alpha1[0];
+    t4 = rs[i] * t2 + 0.1e1;
+    t6 = 0.1e1 / t1;
+    t7 = prm.beta1[0];
+    t8 = sqrt(rs[i]);
+    t10 = prm.beta2[0];
+    t12 = prm.beta3[0];
+    t13 = POW_3_2(rs[i]);
+    t17 = prm.pp[0] + 0.1e1;
+    t18 = pow(rs[i], t17);
+    t19 = prm.beta4[0] * t18;
+    t20 = t10 * rs[i] + t12 * t13 + t7 * t8 + t19;
+    t24 = 0.1e1 + t6 / t20 / 0.2e1;
+    t25 = log(t24);
+    f[i] = -0.2e1 * t1 * t4 * t25;
+    t31 = t20 * t20;
+    t32 = 0.1e1 / t31;
+    t33 = t4 * t32;
+    t37 = sqrt(rs[i]);
+    t43 = t7 / t8 / 0.2e1 + t10 + 0.15e1 * t12 * t37 + t19 * t17 / rs[i];
+    t44 = 0.1e1 / t24;
+    t45 = t43 * t44;
+    dfdrs[i] = -0.2e1 * t1 * t2 * t25 + t33 * t45;
+  }
+}
@@ -0,0 +1,46 @@
+/*
+  Batched CPU port of maple2c/lda_c_vwn_rpa.c, see work_lda.c.
+  Evaluates the energy per particle and its derivative by rs of func0
+  for n unpolarized points with a loop without branches, so that it can
+  be vectorized across the points.
+*/
+static void
+xc_lda_c_vwn_rpa_func0_batch(const xc_func_type *p, int n, const double *rs, double *f, double *dfdrs)
+{
+  int i;
+
+  for(i = 0; i < n; i++){
+    double t1, t3, t4, t6, t9, t12, t14, t15;
+    double t17, t19, t20, t22, t24, t26, t27, t28;
+    double t31, t32, t35, t36, t39, t41, t43, t44;
+    double t45;
+
+    t1 = sqrt(rs[i]);
+    t3 = rs[i] + 0.130720e2 * t1 + 0.427198e2;
+    t4 = 0.1e1 / t3;
+    t6 = log(rs[i] * t4);
+    t9 = 0.2e1 * t1 + 0.130720e2;
+    t12 = atan(0.44899888641287296627e-1 / t9);
+    t14 = t1 + 0.409286e0;
+    t15 = t14 * t14;
+    t17 = log(t15 * t4);
+    f[i] = 0.310907e-1 * t6 + 0.20521972937837502661e2 * t12 + 0.44313737677495382697e-2 * t17;
+    t19 = t3 * t3;
+    t20 = 0.1e1 / t19;
+    t22 = 0.1e1 / t1;
+    t24 = 0.1e1 + 0.65360000000000000000e1 * t22;
+    t26 = -rs[i] * t20 * t24 + t4;
+    t27 = 0.1e1 / rs[i];
+    t28 = t26 * t27;
+    t31 = t9 * t9;
+    t32 = 0.1e1 / t31;
+    t35 = 0.20160000000000000000e-2 * t32 + 0.1e1;
+    t36 = 0.1e1 / t35;
+    t39 = t14 * t4;
+    t41 = t15 * t20;
+    t43 = t39 * t22 - t41 * t24;
+    t44 = 0.1e1 / t15;
+    t45 = t43 * t44;
+    dfdrs[i] = 0.310907e-1 * t28 * t3 - 0.92143429960841537844e0 * t32 * t22 * t36 + 0.44313737677495382697e-2 * t45 * t3;
+  }
+}
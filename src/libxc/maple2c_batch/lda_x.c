@@ -0,0 +1,33 @@
+/*
+  Batched CPU port of maple2c/lda_x.c, see work_lda.c.
+  Evaluates the energy per particle and its derivative by rs of func0
+  for n unpolarized points with a loop without branches, so that it can
+  be vectorized across the points.
+*/
+static void
+xc_lda_x_func0_batch(const xc_func_type *p, int n, const double *rs, double *f, double *dfdrs)
+{
+  lda_x_params prm;
+  int i;
+
+  assert(p->params != NULL);
+  prm = *(lda_x_params *)(p->params);
+
+  for(i = 0; i < n; i++){
+    double t1, t2, t4, t5, t7, t8, t9, t10;
+    double t11, t16;
+
+    t1 = M_CBRT3;
+    t2 = t1 * t1;
+    t4 = M_CBRT4;
+    t5 = prm.alpha * t2 * t4;
+    t7 = cbrt(0.1e1 / 0.31415926535897932385e1);
+    t8 = t7 * t7;
+    t9 = M_CBRT2;
+    t10 = t9 * t9;
+    t11 = t8 * t10;
+    f[i] = -0.18750000000000000000e0 * t5 * t11 / rs[i];
+    t16 = rs[i] * rs[i];
+    dfdrs[i] = 0.18750000000000000000e0 * t5 * t11 / t16;
+  }
+}
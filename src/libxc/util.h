@@ -76,6 +76,11 @@
 #define max(x,y)  (((x)<(y)) ? (y) : (x))
 #endif
 
+/* number of points per call of the batched CPU kernels in maple2c_batch */
+#ifndef XC_CPU_BLOCK
+#define XC_CPU_BLOCK 8
+#endif
+
 /* some useful constants */
 #define LOG_DBL_MIN   (log(DBL_MIN))
 #define LOG_DBL_MAX   (log(DBL_MAX))
@@ -62,6 +62,53 @@ work_gga_c(const xc_func_type *p, int np, const double *rho, const double *sigma
 	//test_cu(p, (gpu_ggac_work_params*) gpu_work_params, rho, sigma, np);
 //}
 #else
+#if defined func_batch && !defined XC_NO_CPU_BATCH
+  /* Unpolarized energies and potentials are evaluated XC_CPU_BLOCK points
+     at a time by the batched port of func in maple2c_batch, with the
+     points below the density threshold masked, see work_gga_x.c */
+  if(p->nspin == XC_UNPOLARIZED && r.order <= 1){
+    double bm[XC_CPU_BLOCK], bd[XC_CPU_BLOCK], bst[XC_CPU_BLOCK];
+    double brs[XC_CPU_BLOCK], bxt[XC_CPU_BLOCK], bxs[XC_CPU_BLOCK];
+    double bf[XC_CPU_BLOCK], bdfdrs[XC_CPU_BLOCK], bdfdxt[XC_CPU_BLOCK], bdfdxs[XC_CPU_BLOCK];
+    int do_exc = (zk   != NULL && (p->info->flags & XC_FLAGS_HAVE_EXC));
+    int do_vxc = (vrho != NULL && (p->info->flags & XC_FLAGS_HAVE_VXC));
+    int ib, nb;
+
+    for(ip = 0; ip < np; ip += XC_CPU_BLOCK){
+      nb = min(XC_CPU_BLOCK, np - ip);
+
+      for(ib = 0; ib < nb; ib++){
+        bm[ib]  = (rho[ip + ib] >= p->dens_threshold) ? 1.0 : 0.0;
+        bd[ib]  = max(rho[ip + ib], p->dens_threshold);
+        bst[ib] = max(min_grad2, sigma[ip + ib]);
+        brs[ib] = RS(bd[ib]);
+        bxt[ib] = sqrt(bst[ib])/pow(bd[ib], 4.0/3.0);
+        bxs[ib] = M_CBRT2*bxt[ib];
+      }
+
+      func_batch(p, nb, brs, bxt, bxs, bf, bdfdrs, bdfdxt, bdfdxs);
+
+      for(ib = 0; ib < nb; ib++){
+        if(do_exc)
+          zk[ip + ib] = bm[ib]*bf[ib];
+
+        if(do_vxc){
+          drs   =     -brs[ib]/(3.0*bd[ib]);
+          dxtdn = -4.0*bxt[ib]/(3.0*bd[ib]);
+          dxtds = bxt[ib]/(2.0*bst[ib]);
+
+          /* factor of 2 comes from sum over sigma */
+          vrho[ip + ib]   = bm[ib]*(bf[ib] + bd[ib]*(bdfdrs[ib]*drs + bdfdxt[ib]*dxtdn)
+                                    + 2.0*bd[ib]*bdfdxs[ib]*M_CBRT2*dxtdn);
+          vsigma[ip + ib] = bm[ib]*bd[ib]*(bdfdxt[ib]*dxtds + 2.0*bdfdxs[ib]*M_CBRT2*dxtds);
+        }
+      }
+    }
+
+    return;
+  }
+#endif
+
   for(ip = 0; ip < np; ip++){
     xc_rho2dzeta(p->nspin, rho, &(r.dens), &(r.z));
 
@@ -145,6 +145,53 @@ work_gga_x
         beta, c_zk[0], c_vrho[0], c_vrho[1], c_vrho[2], c_vsigma[0], c_vsigma[1], kernel_id, (gpu_ggax_work_params*)gpu_work_params);
 
 #else
+#if defined func_batch && !defined XC_NO_CPU_BATCH
+  /* Unpolarized energies and potentials are evaluated XC_CPU_BLOCK points
+     at a time by the batched port of func in maple2c_batch. Points below
+     the density threshold are masked instead of skipped, with the density
+     and gradient clamped so that the kernel stays finite for them. */
+  if(p->nspin == XC_UNPOLARIZED && r.order <= 1){
+    double bm[XC_CPU_BLOCK], bds[XC_CPU_BLOCK], bx[XC_CPU_BLOCK];
+    double bf[XC_CPU_BLOCK], bdfdx[XC_CPU_BLOCK];
+    double thr = p->dens_threshold, bs;
+    int do_exc = (zk   != NULL && (p->info->flags & XC_FLAGS_HAVE_EXC));
+    int do_vxc = (vrho != NULL && (p->info->flags & XC_FLAGS_HAVE_VXC));
+    int ib, nb;
+
+    for(ip = 0; ip < np; ip += XC_CPU_BLOCK){
+      nb = min(XC_CPU_BLOCK, np - ip);
+
+      for(ib = 0; ib < nb; ib++){
+        bm[ib]  = (rho[ip + ib] >= thr) ? 1.0 : 0.0;
+        bds[ib] = max(rho[ip + ib], thr)/sfact;
+        gdm     = max(sqrt(sigma[ip + ib])/sfact, thr);
+        bx[ib]  = gdm/pow(bds[ib], beta);
+      }
+
+      func_batch(p, nb, bx, bf, bdfdx);
+
+      for(ib = 0; ib < nb; ib++){
+        rhoLDA = bm[ib]*pow(bds[ib], alpha);
+        bdfdx[ib] *= bx[ib];
+
+        if(do_exc)
+          zk[ip + ib] += rhoLDA*c_zk[0]*bf[ib]/(sfact*bds[ib]);
+
+        if(do_vxc){
+          vrho[ip + ib] += (rhoLDA/bds[ib])*
+            (c_vrho[0]*bf[ib] + c_vrho[1]*bdfdx[ib]);
+
+          bs = (sqrt(sigma[ip + ib])/sfact > thr) ? 1.0 : 0.0;
+          vsigma[ip + ib] += bs*rhoLDA*
+            (c_vsigma[0]*bdfdx[ib]/(2.0*max(sigma[ip + ib], sfact2*thr*thr)));
+        }
+      }
+    }
+
+    return;
+  }
+#endif
+
   /* the loop over the points starts */
   for(ip = 0; ip < np; ip++){
     dens = (p->nspin == XC_UNPOLARIZED) ? rho[0] : rho[0] + rho[1];
@@ -72,6 +72,43 @@ work_lda(const xc_func_type *p, int np, const double *rho,
         set_gpu_lda_work_params(p->dens_threshold, cnst_rs, xc_dim, kernel_id, (gpu_lda_work_params*)gpu_work_params);
 
 #else
+#if defined func_batch && !defined XC_NO_CPU_BATCH
+  /* Unpolarized energies and potentials are evaluated XC_CPU_BLOCK points
+     at a time by the batched port of func in maple2c_batch, with the
+     points below the density threshold masked, see work_gga_x.c */
+  if(p->nspin == XC_UNPOLARIZED && r.order <= 1){
+    double bm[XC_CPU_BLOCK], bd[XC_CPU_BLOCK], brs[XC_CPU_BLOCK];
+    double bf[XC_CPU_BLOCK], bdfdrs[XC_CPU_BLOCK];
+    int do_exc = (zk   != NULL && (p->info->flags & XC_FLAGS_HAVE_EXC));
+    int do_vxc = (vrho != NULL && (p->info->flags & XC_FLAGS_HAVE_VXC));
+    int ib, nb;
+
+    for(ip = 0; ip < np; ip += XC_CPU_BLOCK){
+      nb = min(XC_CPU_BLOCK, np - ip);
+
+      for(ib = 0; ib < nb; ib++){
+        bm[ib]  = (rho[ip + ib] >= p->dens_threshold) ? 1.0 : 0.0;
+        bd[ib]  = max(rho[ip + ib], p->dens_threshold);
+        brs[ib] = cnst_rs*pow(bd[ib], -1.0/XC_DIMENSIONS);
+      }
+
+      func_batch(p, nb, brs, bf, bdfdrs);
+
+      for(ib = 0; ib < nb; ib++){
+        if(do_exc)
+          zk[ip + ib] = bm[ib]*bf[ib];
+
+        if(do_vxc){
+          drs = -brs[ib]/(XC_DIMENSIONS*bd[ib]);
+          vrho[ip + ib] = bm[ib]*(bf[ib] + bd[ib]*bdfdrs[ib]*drs);
+        }
+      }
+    }
+
+    return;
+  }
+#endif
+
   for(ip = 0; ip < np; ip++){
     xc_rho2dzeta(p->nspin, rho, &dens, &r.z);
 
@@ -129,6 +129,7 @@ module quick_basis_module
    
    ! used for 2e integral indices
    integer :: IJKLtype,III,JJJ,KKK,LLL,IJtype,KLtype
+!$omp threadprivate(IJKLtype,III,JJJ,KKK,LLL,IJtype,KLtype)
    integer, parameter :: longLongInt = selected_int_kind (16)
    integer(kind=longLongInt) :: intIndex
    integer, parameter :: bufferSize = 150000
@@ -152,6 +153,7 @@ integer, dimension(incoreSize) :: bIncore
 
    ! used for hrr and vrr
    double precision :: Y,dnmax
+!$omp threadprivate(Y,dnmax)
    double precision :: Yaa(3),Ybb(3),Ycc(3)  ! only used for opt
    
    
@@ -165,6 +167,31 @@ integer, dimension(incoreSize) :: bIncore
       
    ! they are for Schwartz cutoff
    double precision, allocatable, dimension(:,:) :: Ycutoff,cutmatrix,cutprim
+   double precision :: cutmatrixMax  ! maximum of cutmatrix
+
+   ! shell pairs (II,JJ), II<=JJ, sorted by decreasing Ycutoff, and the
+   ! primitive pair data of every shell pair in the loop order of shell:
+   ! pairPrim(1:5,pairPrimStart(II,JJ)...) = AB, P(1:3), cutprim
+   integer :: nshellpair
+   integer, allocatable, dimension(:,:) :: shellPair,pairPrimStart
+   double precision, allocatable, dimension(:,:) :: pairPrim
+
+   ! semi-direct SCF: quartets whose integrals are computed once and kept in
+   ! eriCache. The cached ket pairs of the bra pair (II,JJ) are
+   ! eriCacheKet(eriCacheBra(1,II,JJ):eriCacheBra(2,II,JJ)), given by their
+   ! position in shellPair, and the integrals of entry n follow eriCacheOffset(n)
+   integer, allocatable, dimension(:,:,:) :: eriCacheBra
+   integer, allocatable, dimension(:) :: eriCacheKet
+   integer(kind=longLongInt), allocatable, dimension(:) :: eriCacheOffset
+   logical, allocatable, dimension(:) :: eriCacheFilled
+   double precision, allocatable, dimension(:) :: eriCache
+   ! primLimit the cached integrals were computed with
+   double precision :: eriCachePrimLimit
+   ! 0: shell computes its integrals, 1: it also stores them at eriCachePtr,
+   ! 2: it reads them from eriCachePtr instead
+   integer :: eriCacheMode = 0
+   integer(kind=longLongInt) :: eriCachePtr
+!$omp threadprivate(eriCacheMode,eriCachePtr)
    double precision, allocatable, dimension(:,:,:,:) :: Yxiaoprim !Yxiaoprim only used at shwartz cutoff
 
 
@@ -178,6 +205,20 @@ integer, dimension(incoreSize) :: bIncore
    
    ! 
    double precision, allocatable, dimension(:,:,:) :: Yxiao,Yxiaotemp,attraxiao
+!$omp threadprivate(Yxiao,Yxiaotemp)
+
+   ! Boys function arguments and values of the primitive quartets of a shell
+   ! quartet, evaluated together by FmT_batch, and their vrr parameters
+   ! (Ptemp, WPtemp, Qtemp, WQtemp, ABtemp, CDtemp, ABcom, CDcom, ABCDtemp)
+   ! for vertical_batch
+   double precision, allocatable, dimension(:) :: Tbatch
+   double precision, allocatable, dimension(:,:) :: FMbatch,VRRbatch
+!$omp threadprivate(Tbatch,FMbatch,VRRbatch)
+
+   ! 2e part of the operator built by a worker thread of get2e_omp. Unallocated
+   ! in the master thread, which adds its integrals to quick_qm_struct%o directly
+   double precision, allocatable, dimension(:,:), target :: o2eThread
+!$omp threadprivate(o2eThread)
    
     !only for opt
    double precision, allocatable, dimension(:,:,:,:) :: attraxiaoopt
@@ -307,6 +348,14 @@ contains
         if(allocated(Apri))          deallocate(Apri)
         if(allocated(Kpri))          deallocate(Kpri)
         if(allocated(cutprim))       deallocate(cutprim)
+        if(allocated(shellPair))     deallocate(shellPair)
+        if(allocated(pairPrimStart)) deallocate(pairPrimStart)
+        if(allocated(pairPrim))      deallocate(pairPrim)
+        if(allocated(eriCacheBra))   deallocate(eriCacheBra)
+        if(allocated(eriCacheKet))   deallocate(eriCacheKet)
+        if(allocated(eriCacheOffset)) deallocate(eriCacheOffset)
+        if(allocated(eriCacheFilled)) deallocate(eriCacheFilled)
+        if(allocated(eriCache))      deallocate(eriCache)
         if(allocated(Ppri))          deallocate(Ppri)
         if(allocated(quick_basis%Xcoeff)) deallocate(quick_basis%Xcoeff)
         if(quick_method%DFT)then
@@ -328,6 +377,9 @@ contains
       if(.not. allocated(Apri)) allocate(Apri(jbasis,jbasis))
       if(.not. allocated(Kpri)) allocate(Kpri(jbasis,jbasis))
       if(.not. allocated(cutprim)) allocate(cutprim(jbasis,jbasis))
+      if(.not. allocated(shellPair)) allocate(shellPair(2,jshell*(jshell+1)/2))
+      if(.not. allocated(pairPrimStart)) allocate(pairPrimStart(jshell,jshell))
+      if(.not. allocated(pairPrim)) allocate(pairPrim(5,jbasis*jbasis))
       if(.not. allocated(Ppri)) allocate(Ppri(3,jbasis,jbasis))
       if(.not. allocated(quick_basis%Xcoeff)) allocate(quick_basis%Xcoeff(jbasis,jbasis,0:3,0:3))
       if(quick_method_arg%DFT)then
@@ -338,6 +390,26 @@ contains
       end if
    end subroutine
    
+   ! Allocates the vrr/hrr scratch of the calling thread for up to nprimquart
+   ! primitive quartets per shell quartet
+   subroutine allocate_eri_scratch(ffunxiao,nprimquart)
+      implicit none
+      logical ffunxiao
+      integer nprimquart
+
+      if(.not. allocated(Tbatch))          allocate(Tbatch(nprimquart))
+      if(.not. allocated(VRRbatch))        allocate(VRRbatch(nprimquart,17))
+      if(ffunxiao)then
+         if(.not. allocated(Yxiao))        allocate(Yxiao(nprimquart,56,56))
+         if(.not. allocated(Yxiaotemp))    allocate(Yxiaotemp(56,56,0:10))
+         if(.not. allocated(FMbatch))      allocate(FMbatch(nprimquart,0:10))
+      else
+         if(.not. allocated(Yxiao))        allocate(Yxiao(nprimquart,120,120))
+         if(.not. allocated(Yxiaotemp))    allocate(Yxiaotemp(120,120,0:14))
+         if(.not. allocated(FMbatch))      allocate(FMbatch(nprimquart,0:14))
+      endif
+   end subroutine
+
    subroutine print_quick_basis(self,ioutfile)
         implicit none
         type(quick_basis_type) self
@@ -47,6 +47,10 @@ module quick_calculated_module
       ! saved operator matrix
       double precision,dimension(:,:), allocatable :: oSave
 
+      ! two electron part of the operator of the last scf cycle, the
+      ! delta density build adds to it
+      double precision,dimension(:,:), allocatable :: o2eSave
+
       ! saved dft operator matrix
       double precision,dimension(:,:), allocatable :: oSaveDFT
 
@@ -138,7 +142,7 @@ module quick_calculated_module
 
    end type quick_qm_struct_type
 
-   type (quick_qm_struct_type) quick_qm_struct
+   type (quick_qm_struct_type), target :: quick_qm_struct
 
    !----------------------
    ! Interface
@@ -197,6 +201,7 @@ contains
       if(.not. allocated(self%x)) allocate(self%x(nbasis,nbasis))
       if(.not. allocated(self%o)) allocate(self%o(nbasis,nbasis))
       if(.not. allocated(self%oSave)) allocate(self%oSave(nbasis,nbasis))
+      if(.not. allocated(self%o2eSave)) allocate(self%o2eSave(nbasis,nbasis))
       if(.not. allocated(self%co)) allocate(self%co(nbasis,nbasis))
       if(.not. allocated(self%vec)) allocate(self%vec(nbasis,nbasis))
       if(.not. allocated(self%dense)) allocate(self%dense(nbasis,nbasis))
@@ -321,6 +326,7 @@ contains
       if (allocated(self%x)) deallocate(self%x)
       if (allocated(self%o)) deallocate(self%o)
       if (allocated(self%oSave)) deallocate(self%oSave)
+      if (allocated(self%o2eSave)) deallocate(self%o2eSave)
       if (allocated(self%co)) deallocate(self%co)
       if (allocated(self%vec)) deallocate(self%vec)
       if (allocated(self%dense)) deallocate(self%dense)
@@ -472,6 +478,7 @@ contains
       call zeroMatrix(self%x,nbasis)
       call zeroMatrix(self%o,nbasis)
       call zeroMatrix(self%oSave,nbasis)
+      call zeroMatrix(self%o2eSave,nbasis)
       call zeroMatrix(self%co,nbasis)
       call zeroMatrix(self%vec,nbasis)
       call zeroMatrix(self%dense,nbasis)
@@ -26,12 +26,25 @@ module quick_gridpoints_module
 
     type quick_xc_grid_type
 
+#if defined CUDA || defined CUDA_MPIV
     !Binned grid point coordinates
     double precision,dimension(:), allocatable   :: gridxb    
 
     double precision,dimension(:), allocatable   :: gridyb
 
     double precision,dimension(:), allocatable   :: gridzb 
+#else
+    !Binned grid point coordinates, kept as offsets from the origin of their bin.
+    !A point is at gridb_org(:,Ibin) + (gridxb, gridyb, gridzb)
+    real*4,dimension(:), allocatable   :: gridxb
+
+    real*4,dimension(:), allocatable   :: gridyb
+
+    real*4,dimension(:), allocatable   :: gridzb
+
+    !Origin of each bin
+    double precision,dimension(:,:), allocatable   :: gridb_org
+#endif
     
     !Binned sswt & weight
     double precision,dimension(:), allocatable   :: gridb_sswt
@@ -45,7 +58,12 @@ module quick_gridpoints_module
     integer,dimension(:), allocatable   :: basf
 
     !array of primitive functions beloning to binned basis functions
+#if defined CUDA || defined CUDA_MPIV
     integer,dimension(:), allocatable   :: primf
+#else
+    !primitive numbers are below MAXPRIM, so they are kept in 16 bits
+    integer*2,dimension(:), allocatable   :: primf
+#endif
 
     !a counter to keep track of which basis functions belong to which bin
     integer,dimension(:), allocatable   :: basf_counter
@@ -61,6 +79,9 @@ module quick_gridpoints_module
     !in cpu case, we will have bins with different number of points. This array keeps track
     !of the size of each bin
     integer,dimension(:), allocatable   :: bin_counter
+
+    !estimated xc cost of each bin, number of points times the squared number of basis functions
+    double precision,dimension(:), allocatable   :: bin_cost
 #endif
 
     !length of binned grid arrays
@@ -81,6 +102,16 @@ module quick_gridpoints_module
 #ifdef MPIV
     integer, dimension(:), allocatable :: igridptul
     integer, dimension(:), allocatable :: igridptll
+
+#ifndef CUDA_MPIV
+    !bin ranges of each rank in the xc gradient, which also includes the ssw derivatives
+    integer, dimension(:), allocatable :: igradptul
+    integer, dimension(:), allocatable :: igradptll
+
+    !xc cost of each bin used to split the bins between ranks. Starts from bin_cost
+    !and is rescaled by the time each rank actually spends in get_xc.
+    double precision,dimension(:), allocatable   :: bin_xc_wt
+#endif
 #endif
     end type quick_xc_grid_type
 
@@ -111,6 +142,17 @@ module quick_gridpoints_module
     double precision, dimension(:), allocatable :: tmp_weight
 #endif
 
+    !Largest atomic displacement for which the ss weight of a point stays at 0 or 1
+    double precision,  dimension(:), allocatable :: ssw_pin
+
+    !Geometry of the last full grid formation and of the last grid update
+    double precision,  dimension(:,:), allocatable :: ref_xyz
+
+    double precision,  dimension(:,:), allocatable :: prev_xyz
+
+    !True if the grid is kept for repacking at the next geometry
+    logical :: isReusable = .false.
+
     integer :: rad_gps = 50
    
     integer :: ang_gps = 194
@@ -146,20 +188,35 @@ module quick_gridpoints_module
     use quick_molspec_module
     use quick_basis_module    
     use quick_timer_module
+!$  use omp_lib
 
     implicit double precision(a-h,o-z) 
     type(quick_xc_grid_type) self
     type(quick_xcg_tmp_type) xcg_tmp
+    integer :: nthreads
+    logical :: isRepacked
     !Form the quadrature and store coordinates and other information
     !Measure the time to form grid
 
-    call alloc_xcg_tmp_variables(xcg_tmp)    
+    !Number of threads for grid weights and packing, 0 lets the packer use all available threads
+    nthreads = quick_method%nGpackThreads
+!$  if(nthreads .lt. 1) nthreads = omp_get_max_threads()
 
 #ifdef MPIV
   if(bMPI) then
     call alloc_mpi_grid_variables(self)
   endif
+#endif
+
+    !Reuse the grid of the previous geometry if atoms moved little
+    if(quick_method%gridReuseDist .gt. 0.0d0) then
+        call repack_xc_quadrature(self, xcg_tmp, nthreads, isRepacked)
+        if(isRepacked) return
+    endif
 
+    call alloc_xcg_tmp_variables(xcg_tmp)    
+
+#ifdef MPIV
    if(master) then
 #endif
     call cpu_time(timer_begin%TDFTGrdGen)
@@ -233,13 +290,17 @@ module quick_gridpoints_module
       iend = idx_grid
    endif
 
+!$omp parallel do num_threads(nthreads) schedule(dynamic,256)
    do idx=ist, iend
 #else
+!$omp parallel do num_threads(nthreads) schedule(dynamic,256)
    do idx=1, idx_grid
 #endif
         xcg_tmp%sswt(idx)=SSW(xcg_tmp%init_grid_ptx(idx), xcg_tmp%init_grid_pty(idx), xcg_tmp%init_grid_ptz(idx), &
         xcg_tmp%init_grid_atm(idx))
         xcg_tmp%weight(idx)=xcg_tmp%sswt(idx)*xcg_tmp%arr_wtang(idx)*xcg_tmp%arr_rwt(idx)*xcg_tmp%arr_rad3(idx)
+        if(quick_method%gridReuseDist .gt. 0.0d0) xcg_tmp%ssw_pin(idx)=ssw_pin_slack(xcg_tmp%init_grid_ptx(idx), &
+        xcg_tmp%init_grid_pty(idx), xcg_tmp%init_grid_ptz(idx), xcg_tmp%init_grid_atm(idx))
     enddo
 
 #if defined MPIV && !defined CUDA_MPIV
@@ -274,11 +335,16 @@ module quick_gridpoints_module
     ! initialize cpp data structure for octree and grid point packing
     call gpack_initialize()
 
+#if !defined CUDA && !defined CUDA_MPIV
+    ! keep the leaves of the octree for repacking at the next geometry
+    if(quick_method%gridReuseDist .gt. 0.0d0 .and. master) call gpack_reuse_initialize()
+#endif
+
     ! run octree, pack grid points and get the array sizes for f90 memory allocation
     call gpack_pack_pts(xcg_tmp%init_grid_ptx, xcg_tmp%init_grid_pty, xcg_tmp%init_grid_ptz, &
     xcg_tmp%init_grid_atm, xcg_tmp%sswt, xcg_tmp%weight, xcg_tmp%idx_grid, natom, &
     nbasis, maxcontract, quick_method%DMCutoff, sigrad2, ncontract, aexp, dcoeff, quick_basis%ncenter, itype, xyz, & 
-    self%gridb_count, self%ntgpts, self%nbins, self%nbtotbf, self%nbtotpf, timer_cumer%TDFTGrdOct, timer_cumer%TDFTPrscrn) 
+    nthreads, self%gridb_count, self%ntgpts, self%nbins, self%nbtotbf, self%nbtotpf, timer_cumer%TDFTGrdOct, timer_cumer%TDFTPrscrn) 
 
 #ifdef CUDA_MPIV
     endif
@@ -321,8 +387,8 @@ module quick_gridpoints_module
 
 #else
     ! save packed grid information into f90 data structures 
-    call get_cpu_grid_info(self%gridxb, self%gridyb, self%gridzb, self%gridb_sswt, self%gridb_weight, self%gridb_atm, &
-    self%basf, self%primf, self%basf_counter, self%primf_counter, self%bin_counter)
+    call get_cpu_grid_info(self%gridxb, self%gridyb, self%gridzb, self%gridb_org, self%gridb_sswt, self%gridb_weight, &
+    self%gridb_atm, self%basf, self%primf, self%basf_counter, self%primf_counter, self%bin_counter, self%bin_cost)
 
 #endif
 
@@ -374,8 +440,20 @@ module quick_gridpoints_module
     endif
 #endif
 
-    ! relinquish memory allocated for temporary f90 variables
+    ! relinquish memory allocated for temporary f90 variables, unless the grid is kept for repacking
+#if defined CUDA || defined CUDA_MPIV
     call dealloc_xcg_tmp_variables(xcg_tmp)
+#else
+    if(quick_method%gridReuseDist .gt. 0.0d0 .and. master) then
+        if (.not. allocated(xcg_tmp%ref_xyz)) allocate(xcg_tmp%ref_xyz(3,natom))
+        if (.not. allocated(xcg_tmp%prev_xyz)) allocate(xcg_tmp%prev_xyz(3,natom))
+        xcg_tmp%ref_xyz(:,:) = xyz(:,1:natom)
+        xcg_tmp%prev_xyz(:,:) = xyz(:,1:natom)
+        xcg_tmp%isReusable = .true.
+    else
+        call dealloc_xcg_tmp_variables(xcg_tmp)
+    endif
+#endif
 
 #ifdef MPIV
     if(master) then
@@ -395,6 +473,130 @@ module quick_gridpoints_module
 
     end subroutine    
 
+    ! Repacks the grid kept from a previous geometry if no atom moved further than gridReuseDist
+    ! since the grid was formed. Grid points move along with their parent atoms, so the grid is
+    ! the one that form_xc_quadrature would generate. Ss weights are only recomputed for points
+    ! whose weight may have left 0 or 1, and the packer skips the octree and prescreens again only
+    ! those bins whose surroundings changed. isRepacked is false if a full grid formation is due.
+    subroutine repack_xc_quadrature(self, xcg_tmp, nthreads, isRepacked)
+    use quick_method_module
+    use quick_molspec_module
+    use quick_basis_module
+    use quick_timer_module
+
+    implicit double precision(a-h,o-z)
+    type(quick_xc_grid_type) self
+    type(quick_xcg_tmp_type) xcg_tmp
+    integer :: nthreads, ierr
+    logical :: isRepacked
+    double precision :: dmax, dx, dy, dz
+#ifdef MPIV
+    include 'mpif.h'
+#endif
+
+    isRepacked = .false.
+
+#if !defined CUDA && !defined CUDA_MPIV
+
+#ifdef MPIV
+    if(master) then
+#endif
+    if(xcg_tmp%isReusable) then
+        if(size(xcg_tmp%ref_xyz,2) .eq. natom) then
+            dmax = 0.0d0
+            do iatm=1, natom
+                dmax = max(dmax, dsqrt(sum((xyz(:,iatm)-xcg_tmp%ref_xyz(:,iatm))**2)))
+            enddo
+            isRepacked = (dmax .le. quick_method%gridReuseDist)
+        endif
+        if(.not. isRepacked) call dealloc_xcg_tmp_variables(xcg_tmp)
+    endif
+#ifdef MPIV
+    endif
+    if(bMPI) call MPI_BCAST(isRepacked,1,mpi_logical,0,MPI_COMM_WORLD,mpierror)
+#endif
+
+    if(.not. isRepacked) return
+
+#ifdef MPIV
+    if(master) then
+#endif
+    timer_cumer%TDFTGrdGen = 0.0d0
+    timer_cumer%TDFTGrdOct = 0.0d0
+
+    call cpu_time(timer_begin%TDFTGrdWt)
+
+    !Move the points along with their parent atoms and update the weights that are not pinned
+!$omp parallel do num_threads(nthreads) schedule(dynamic,256) private(iatm,dx,dy,dz)
+    do idx=1, xcg_tmp%idx_grid
+        iatm = xcg_tmp%init_grid_atm(idx)
+        dx = xyz(1,iatm) - xcg_tmp%prev_xyz(1,iatm)
+        dy = xyz(2,iatm) - xcg_tmp%prev_xyz(2,iatm)
+        dz = xyz(3,iatm) - xcg_tmp%prev_xyz(3,iatm)
+        xcg_tmp%init_grid_ptx(idx) = xcg_tmp%init_grid_ptx(idx) + dx
+        xcg_tmp%init_grid_pty(idx) = xcg_tmp%init_grid_pty(idx) + dy
+        xcg_tmp%init_grid_ptz(idx) = xcg_tmp%init_grid_ptz(idx) + dz
+        if(xcg_tmp%ssw_pin(idx) .lt. dmax) then
+            xcg_tmp%sswt(idx)=SSW(xcg_tmp%init_grid_ptx(idx), xcg_tmp%init_grid_pty(idx), xcg_tmp%init_grid_ptz(idx), iatm)
+            xcg_tmp%weight(idx)=xcg_tmp%sswt(idx)*xcg_tmp%arr_wtang(idx)*xcg_tmp%arr_rwt(idx)*xcg_tmp%arr_rad3(idx)
+        endif
+    enddo
+
+    xcg_tmp%prev_xyz(:,:) = xyz(:,1:natom)
+
+    call cpu_time(timer_end%TDFTGrdWt)
+
+    timer_cumer%TDFTGrdWt = timer_end%TDFTGrdWt - timer_begin%TDFTGrdWt
+
+    call cpu_time(timer_begin%TDFTGrdPck)
+
+    call gpack_initialize()
+
+    call gpack_repack_pts(xcg_tmp%init_grid_ptx, xcg_tmp%init_grid_pty, xcg_tmp%init_grid_ptz, &
+    xcg_tmp%init_grid_atm, xcg_tmp%sswt, xcg_tmp%weight, xcg_tmp%idx_grid, natom, &
+    nbasis, maxcontract, quick_method%DMCutoff, sigrad2, ncontract, aexp, dcoeff, quick_basis%ncenter, itype, xyz, &
+    nthreads, self%gridb_count, self%ntgpts, self%nbins, self%nbtotbf, self%nbtotpf, timer_cumer%TDFTPrscrn, ierr)
+
+    ! points that became significant outside of the kept bins require a full grid formation
+    if(ierr .ne. 0) then
+        call gpack_finalize()
+        call dealloc_xcg_tmp_variables(xcg_tmp)
+        isRepacked = .false.
+    endif
+#ifdef MPIV
+    endif
+    if(bMPI) call MPI_BCAST(isRepacked,1,mpi_logical,0,MPI_COMM_WORLD,mpierror)
+#endif
+
+    if(.not. isRepacked) return
+
+#ifdef MPIV
+    call setup_xc_mpi_1
+#endif
+    call alloc_grid_variables(self)
+
+#ifdef MPIV
+    if(master) then
+#endif
+    call get_cpu_grid_info(self%gridxb, self%gridyb, self%gridzb, self%gridb_org, self%gridb_sswt, self%gridb_weight, &
+    self%gridb_atm, self%basf, self%primf, self%basf_counter, self%primf_counter, self%bin_counter, self%bin_cost)
+
+    call gpack_finalize()
+
+    call cpu_time(timer_end%TDFTGrdPck)
+
+    timer_cumer%TDFTGrdPck = timer_end%TDFTGrdPck - timer_begin%TDFTGrdPck - timer_cumer%TDFTPrscrn
+#ifdef MPIV
+    endif
+    if(bMPI) then
+       call setup_xc_mpi_new_imp
+    endif
+#endif
+
+#endif
+
+    end subroutine repack_xc_quadrature
+
     ! allocate gridpoints
     subroutine allocate_quick_gridpoints(nbasis)
         implicit double precision(a-h,o-z)
@@ -429,12 +631,18 @@ module quick_gridpoints_module
         if (.not. allocated(self%dweight)) allocate(self%dweight(self%gridb_count))
 #else
         if (.not. allocated(self%bin_counter)) allocate(self%bin_counter(self%nbins+1))
+        if (.not. allocated(self%gridb_org)) allocate(self%gridb_org(3,self%nbins))
+        if (.not. allocated(self%bin_cost)) allocate(self%bin_cost(self%nbins))
+#ifdef MPIV
+        if (.not. allocated(self%bin_xc_wt)) allocate(self%bin_xc_wt(self%nbins))
+#endif
 #endif
 
     end subroutine
 
     subroutine alloc_xcg_tmp_variables(xcg_tmp)
         use quick_molspec_module
+        use quick_method_module
         implicit none
         type(quick_xcg_tmp_type) xcg_tmp
         integer :: tot_gps
@@ -454,6 +662,9 @@ module quick_gridpoints_module
         if (.not. allocated(xcg_tmp%tmp_sswt)) allocate(xcg_tmp%tmp_sswt(tot_gps))
         if (.not. allocated(xcg_tmp%tmp_weight)) allocate(xcg_tmp%tmp_weight(tot_gps))        
 #endif
+        if (quick_method%gridReuseDist .gt. 0.0d0) then
+            if (.not. allocated(xcg_tmp%ssw_pin)) allocate(xcg_tmp%ssw_pin(tot_gps))
+        endif
     end subroutine
 
 #ifdef MPIV
@@ -464,6 +675,10 @@ module quick_gridpoints_module
 
         if (.not. allocated(self%igridptul)) allocate(self%igridptul(mpisize))
         if (.not. allocated(self%igridptll)) allocate(self%igridptll(mpisize))
+#ifndef CUDA_MPIV
+        if (.not. allocated(self%igradptul)) allocate(self%igradptul(mpisize))
+        if (.not. allocated(self%igradptll)) allocate(self%igradptll(mpisize))
+#endif
 
    end subroutine
 #endif    
@@ -488,6 +703,11 @@ module quick_gridpoints_module
         if (allocated(self%dweight)) deallocate(self%dweight)
 #else
         if (allocated(self%bin_counter)) deallocate(self%bin_counter)
+        if (allocated(self%gridb_org)) deallocate(self%gridb_org)
+        if (allocated(self%bin_cost)) deallocate(self%bin_cost)
+#ifdef MPIV
+        if (allocated(self%bin_xc_wt)) deallocate(self%bin_xc_wt)
+#endif
 #endif
 
 #ifdef MPIV
@@ -515,6 +735,14 @@ module quick_gridpoints_module
         if (allocated(xcg_tmp%tmp_sswt)) deallocate(xcg_tmp%tmp_sswt)
         if (allocated(xcg_tmp%tmp_weight)) deallocate(xcg_tmp%tmp_weight)
 #endif
+        if (allocated(xcg_tmp%ssw_pin)) deallocate(xcg_tmp%ssw_pin)
+        if (allocated(xcg_tmp%ref_xyz)) deallocate(xcg_tmp%ref_xyz)
+        if (allocated(xcg_tmp%prev_xyz)) deallocate(xcg_tmp%prev_xyz)
+
+        if (xcg_tmp%isReusable) then
+            call gpack_reuse_finalize()
+            xcg_tmp%isReusable = .false.
+        endif
     end subroutine
 
 #ifdef MPIV
@@ -525,6 +753,10 @@ module quick_gridpoints_module
 
         if (allocated(self%igridptul)) deallocate(self%igridptul)
         if (allocated(self%igridptll)) deallocate(self%igridptll)
+#ifndef CUDA_MPIV
+        if (allocated(self%igradptul)) deallocate(self%igradptul)
+        if (allocated(self%igradptll)) deallocate(self%igradptll)
+#endif
    end subroutine
 #endif
 
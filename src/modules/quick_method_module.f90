@@ -8,6 +8,7 @@
 
 module quick_method_module
     use quick_constants_module
+    use xc_f90_types_m, only: xc_f90_pointer_t
     implicit none
     
     type quick_method_type
@@ -35,6 +36,7 @@ module quick_method_module
         logical :: readDMX =  .false.  ! flag to read density matrix
         logical :: writePMat = .false. ! flag to write density matrix
         logical :: diisSCF =  .false.  ! DIIS SCF
+        logical :: purify = .false.    ! density by TRS4 purification instead of diagonalization
         logical :: prtGap =  .false.   ! flag to print HOMO-LUMO gap
         logical :: opt =  .false.      ! optimization
         logical :: grad = .false.      ! if calculate gradient
@@ -67,6 +69,8 @@ module quick_method_module
         
         ! this is DFT grid
         integer :: iSG = 1             ! =0. SG0, =1. SG1(DEFAULT)
+        integer :: nGpackThreads = 0   ! threads for grid weights & packing, 0 means OpenMP default
+        double precision :: gridReuseDist = 0.0d0 ! max atom displacement (bohr) for incremental grid repacking, 0 disables
         
         ! Initial guess part
         logical :: SAD = .true.        ! SAD initial guess(defualt
@@ -85,6 +89,15 @@ module quick_method_module
         
         ! start cycle for delta density cycle
         integer :: ncyc =1000
+
+        ! delta density cycles between two full operator builds
+        integer :: nrebuild = 8
+
+        ! memory (MB) for the 2e integrals kept by semi-direct scf, 0 is fully direct
+        double precision :: semidirectMem = 0.0d0
+
+        ! scf eigensolver, =0. DIAG (QL), =1. divide and conquer(DEFAULT)
+        integer :: iDiag = 1
         
         ! following are some cutoff criteria
         double precision :: integralCutoff = 1.0d-7   ! integral cutoff
@@ -124,6 +137,14 @@ module quick_method_module
     end type quick_method_type
     
     type (quick_method_type),save :: quick_method
+
+    ! libxc functional handles and families, created by init_libxc_handles
+    ! for the functionals of quick_method and kept for the whole job
+    integer, save :: libxc_nfunc = 0
+    integer, save :: libxc_pol = 0
+    integer, dimension(10), save :: libxc_id = 0
+    integer, dimension(10), save :: libxc_family = 0
+    type(xc_f90_pointer_t), dimension(10), save :: libxc_func, libxc_info
     
     interface print
         module procedure print_quick_method
@@ -175,6 +196,7 @@ module quick_method_module
             call MPI_BCAST(self%nodirect,1,mpi_logical,0,MPI_COMM_WORLD,mpierror)
             call MPI_BCAST(self%readDMX,1,mpi_logical,0,MPI_COMM_WORLD,mpierror)
             call MPI_BCAST(self%diisSCF,1,mpi_logical,0,MPI_COMM_WORLD,mpierror)
+            call MPI_BCAST(self%purify,1,mpi_logical,0,MPI_COMM_WORLD,mpierror)
             call MPI_BCAST(self%prtGap,1,mpi_logical,0,MPI_COMM_WORLD,mpierror)
             call MPI_BCAST(self%opt,1,mpi_logical,0,MPI_COMM_WORLD,mpierror)
             call MPI_BCAST(self%grad,1,mpi_logical,0,MPI_COMM_WORLD,mpierror)
@@ -204,10 +226,15 @@ module quick_method_module
             call MPI_BCAST(self%MFCC,1,mpi_logical,0,MPI_COMM_WORLD,mpierror)
             call MPI_BCAST(self%ifragbasis,1,mpi_integer,0,MPI_COMM_WORLD,mpierror)
             call MPI_BCAST(self%iSG,1,mpi_integer,0,MPI_COMM_WORLD,mpierror)
+            call MPI_BCAST(self%nGpackThreads,1,mpi_integer,0,MPI_COMM_WORLD,mpierror)
+            call MPI_BCAST(self%gridReuseDist,1,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
             call MPI_BCAST(self%iscf,1,mpi_integer,0,MPI_COMM_WORLD,mpierror)
             call MPI_BCAST(self%iopt,1,mpi_integer,0,MPI_COMM_WORLD,mpierror)
             call MPI_BCAST(self%maxdiisscf,1,mpi_integer,0,MPI_COMM_WORLD,mpierror)
             call MPI_BCAST(self%ncyc,1,mpi_integer,0,MPI_COMM_WORLD,mpierror)
+            call MPI_BCAST(self%nrebuild,1,mpi_integer,0,MPI_COMM_WORLD,mpierror)
+            call MPI_BCAST(self%semidirectMem,1,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
+            call MPI_BCAST(self%iDiag,1,mpi_integer,0,MPI_COMM_WORLD,mpierror)
             call MPI_BCAST(self%integralCutoff,1,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
             call MPI_BCAST(self%leastIntegralCutoff,1,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
             call MPI_BCAST(self%maxIntegralCutoff,1,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
@@ -324,6 +351,8 @@ module quick_method_module
         
 if (self%nodirect) then
 write(io,'("| SAVE 2E INT TO DISK ")')
+else if (self%semidirectMem .gt. 0.0d0) then
+write(io,'("| SEMI-DIRECT SCF, INTEGRAL CACHE = ",f10.2," MB")') self%semidirectMem
 else
 write(io,'("| DIRECT SCF ")')
 endif
@@ -357,6 +386,9 @@ endif
             if (self%DFT) then
                 if (self%iSG .eq. 0) write(io,'("| STANDARD GRID = SG0")')
                 if (self%iSG .eq. 1) write(io,'("| STANDARD GRID = SG1")')
+                if (self%nGpackThreads .gt. 0) write(io,'("| GRID PACKING THREADS = ",i4)') self%nGpackThreads
+                if (self%gridReuseDist .gt. 0.0d0) write(io,'("| INCREMENTAL GRID REPACKING, MAX DISPLACEMENT = ",f8.4, &
+                " A")') self%gridReuseDist*BOHRS_TO_A
             endif
                
             if (self%opt) then         
@@ -403,6 +435,13 @@ endif
             write(io,'("| MAX SCF CYCLES = ",i6)') self%iscf
             if (self%diisSCF) write (io,'("| MAX DIIS CYCLES = ",I4)') self%maxdiisscf
             write (io,'("| DELTA DENSITY START CYCLE = ",I4)') self%ncyc
+            if (.not. self%DIVCON) write (io,'("| DELTA DENSITY REBUILD CYCLE = ",I4)') self%nrebuild
+            if (self%iDiag .eq. 0) then
+                write (io,'("| EIGENSOLVER = DIAG (QL)")')
+            else
+                write (io,'("| EIGENSOLVER = DIVIDE AND CONQUER")')
+            endif
+            if (self%purify) write (io,'("| DENSITY MATRIX BY TRS4 PURIFICATION")')
             
             ! cutoff size
             write (io,'("| COMPUATIONAL CUTOFF: ")')
@@ -486,6 +525,7 @@ endif
             if (index(keyWD,'FORCE').ne.0)      self%grad=.true.
         
             if (index(keyWD,'NODIRECT').ne.0)      self%NODIRECT=.true.
+            if (index(keyWD,'PURIFY').ne.0)        self%purify=.true.
 
             if (index(keywd,'DIVCON') .ne. 0) then
                 self%divcon = .true.
@@ -564,12 +604,27 @@ endif
                 self%gradCutoff=self%acutoff
             endif
         
+            ! threads for grid weights & packing
+            if (index(keywd,'GPACKTHREADS=') /= 0) self%nGpackThreads = rdinml(keywd,'GPACKTHREADS')
+
+            ! repack the grid of displaced geometries incrementally, the max displacement is given in angstrom
+            if (index(keywd,'GRIDREUSE=') /= 0) self%gridReuseDist = rdnml(keywd,'GRIDREUSE')*A_TO_BOHRS
+
             ! Max DIIS cycles
             if (index(keywd,'MAXDIIS=') /= 0) self%maxdiisscf=rdinml(keywd,'MAXDIIS')
             
             ! Delta DM Cycle Start
             if (index(keywd,'NCYC=') /= 0) self%ncyc = rdinml(keywd,'NCYC')
 
+            ! Full operator rebuild every NREBUILD delta density cycles
+            if (index(keywd,'NREBUILD=') /= 0) self%nrebuild = rdinml(keywd,'NREBUILD')
+
+            ! Semi-direct scf, memory in MB for the cached 2e integrals
+            if (index(keywd,'SEMIDIRECT=') /= 0) self%semidirectMem = rdnml(keywd,'SEMIDIRECT')
+
+            ! SCF eigensolver, DIAG=0 falls back to the QL solver
+            if (index(keywd,'DIAG=') /= 0) self%iDiag = rdinml(keywd,'DIAG')
+
             ! DM cutoff
             if (index(keywd,'MATRIXZERO=') /= 0) self%DMCutoff = rdnml(keywd,'MAXTRIXZERO')
 
@@ -605,6 +660,7 @@ endif
             self%nodirect = .false.  ! conventional SCF
             self%readDMX =  .false.  ! flag to read density matrix
             self%diisSCF =  .false.  ! DIIS SCF
+            self%purify = .false.    ! TRS4 purification
             self%prtGap =  .false.   ! flag to print HOMO-LUMO gap
             self%opt =  .false.      ! optimization
             self%grad =  .false.     ! gradient
@@ -632,12 +688,17 @@ endif
         
             self%ifragbasis = 1        ! =2.residue basis,=1.atom basis(DEFUALT),=3 non-h atom basis
             self%iSG = 1               ! =0. SG0, =1. SG1(DEFAULT)
+            self%nGpackThreads = 0     ! threads for grid weights & packing
+            self%gridReuseDist = 0.0d0 ! incremental grid repacking
             self%MFCC = .false.        ! MFCC
             
             self%iscf = 200
             self%maxdiisscf = 10
             self%iopt = 0
             self%ncyc = 1000
+            self%nrebuild = 8
+            self%semidirectMem = 0.0d0
+            self%iDiag = 1
 
             self%integralCutoff = 1.0d-7   ! integral cutoff
             self%leastIntegralCutoff = LEASTCUTOFF 
@@ -821,4 +882,52 @@ endif
         self%nof_functionals=nof_f
 
         end subroutine set_libxc_func_info
+
+        !------------------------
+        ! create the libxc functional handles of quick_method, unless those
+        ! of the same functionals already exist
+        !------------------------
+        subroutine init_libxc_handles(self)
+           use xc_f90_lib_m
+           implicit none
+           type(quick_method_type) self
+           integer :: ifunc
+
+           if (libxc_nfunc == self%nof_functionals .and. libxc_pol == self%xc_polarization) then
+              if (all(libxc_id(1:libxc_nfunc) == self%functional_id(1:libxc_nfunc))) return
+           endif
+
+           call end_libxc_handles
+
+           do ifunc=1, self%nof_functionals
+              if(self%xc_polarization > 0) then
+                 call xc_f90_func_init(libxc_func(ifunc), libxc_info(ifunc), &
+                 self%functional_id(ifunc), XC_POLARIZED)
+              else
+                 call xc_f90_func_init(libxc_func(ifunc), libxc_info(ifunc), &
+                 self%functional_id(ifunc), XC_UNPOLARIZED)
+              endif
+              libxc_family(ifunc)=xc_f90_info_family(libxc_info(ifunc))
+              libxc_id(ifunc)=self%functional_id(ifunc)
+           enddo
+
+           libxc_nfunc=self%nof_functionals
+           libxc_pol=self%xc_polarization
+
+        end subroutine init_libxc_handles
+
+        !------------------------
+        ! release the libxc functional handles
+        !------------------------
+        subroutine end_libxc_handles
+           use xc_f90_lib_m
+           implicit none
+           integer :: ifunc
+
+           do ifunc=1, libxc_nfunc
+              call xc_f90_func_end(libxc_func(ifunc))
+           enddo
+           libxc_nfunc=0
+
+        end subroutine end_libxc_handles
 end module quick_method_module
@@ -422,10 +422,6 @@
    use allmod
    implicit double precision(a-h,o-z)
 
-   integer, dimension(1:mpisize) :: itotgridspn
-!   integer, dimension(0:mpisize-1) :: igridptul
-!   integer, dimension(0:mpisize-1) :: igridptll
-
    include 'mpif.h'
  
    call MPI_BARRIER(MPI_COMM_WORLD,mpierror)
@@ -433,32 +429,11 @@
 #ifndef CUDA_MPIV
 
    if(master) then
-      do impi=1, mpisize
-         itotgridspn(impi)=0
-         quick_dft_grid%igridptul(impi)=0
-         quick_dft_grid%igridptll(impi)=0
-      enddo
-
-      itmpgriddist=quick_dft_grid%nbins
-      do while(itmpgriddist .gt. 0)
-         do impi=1, mpisize
-            itotgridspn(impi)=itotgridspn(impi)+1
-            itmpgriddist=itmpgriddist-1
-            if (itmpgriddist .lt. 1) exit
-         enddo
-      enddo
-
-      itmpgridptul=0
-      do impi=1, mpisize
-         itmpgridptul=itmpgridptul+itotgridspn(impi)
-         quick_dft_grid%igridptul(impi)=itmpgridptul
-         if(impi .eq. 1) then
-            quick_dft_grid%igridptll(impi)=1
-         else
-            quick_dft_grid%igridptll(impi)=quick_dft_grid%igridptul(impi-1)+1
-         endif
+      do ibin=1, quick_dft_grid%nbins
+         quick_dft_grid%bin_xc_wt(ibin)=quick_dft_grid%bin_cost(ibin)
       enddo
 
+      call partition_xc_bins_mpi
    endif
 
 #endif
@@ -477,17 +452,28 @@
 #else
       call MPI_BCAST(quick_dft_grid%igridptll,mpisize,mpi_integer,0,MPI_COMM_WORLD,mpierror)
       call MPI_BCAST(quick_dft_grid%igridptul,mpisize,mpi_integer,0,MPI_COMM_WORLD,mpierror)
+      call MPI_BCAST(quick_dft_grid%igradptll,mpisize,mpi_integer,0,MPI_COMM_WORLD,mpierror)
+      call MPI_BCAST(quick_dft_grid%igradptul,mpisize,mpi_integer,0,MPI_COMM_WORLD,mpierror)
       call MPI_BCAST(quick_dft_grid%bin_counter,quick_dft_grid%nbins+1,mpi_integer,0,MPI_COMM_WORLD,mpierror)
+      call MPI_BCAST(quick_dft_grid%bin_cost,quick_dft_grid%nbins,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
 #endif
 
       call MPI_BCAST(quick_dft_grid%basf_counter,quick_dft_grid%nbins+1,mpi_integer,0,MPI_COMM_WORLD,mpierror)
       call MPI_BCAST(quick_dft_grid%primf_counter,quick_dft_grid%nbtotbf+1,mpi_integer,0,MPI_COMM_WORLD,mpierror)
       call MPI_BCAST(quick_dft_grid%basf,quick_dft_grid%nbtotbf,mpi_integer,0,MPI_COMM_WORLD,mpierror)
 
+#ifdef CUDA_MPIV
       call MPI_BCAST(quick_dft_grid%primf,quick_dft_grid%nbtotpf,mpi_integer,0,MPI_COMM_WORLD,mpierror)
       call MPI_BCAST(quick_dft_grid%gridxb,quick_dft_grid%gridb_count,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
       call MPI_BCAST(quick_dft_grid%gridyb,quick_dft_grid%gridb_count,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
       call MPI_BCAST(quick_dft_grid%gridzb,quick_dft_grid%gridb_count,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
+#else
+      call MPI_BCAST(quick_dft_grid%primf,quick_dft_grid%nbtotpf,mpi_integer2,0,MPI_COMM_WORLD,mpierror)
+      call MPI_BCAST(quick_dft_grid%gridb_org,3*quick_dft_grid%nbins,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
+      call MPI_BCAST(quick_dft_grid%gridxb,quick_dft_grid%gridb_count,mpi_real,0,MPI_COMM_WORLD,mpierror)
+      call MPI_BCAST(quick_dft_grid%gridyb,quick_dft_grid%gridb_count,mpi_real,0,MPI_COMM_WORLD,mpierror)
+      call MPI_BCAST(quick_dft_grid%gridzb,quick_dft_grid%gridb_count,mpi_real,0,MPI_COMM_WORLD,mpierror)
+#endif
       call MPI_BCAST(quick_dft_grid%gridb_sswt,quick_dft_grid%gridb_count,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
       call MPI_BCAST(quick_dft_grid%gridb_weight,quick_dft_grid%gridb_count,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
       call MPI_BCAST(quick_dft_grid%gridb_atm,quick_dft_grid%gridb_count,mpi_integer,0,MPI_COMM_WORLD,mpierror)
@@ -499,6 +485,195 @@
    return
  end subroutine setup_xc_mpi_new_imp
 
+ subroutine partition_mpi_work(nitems,cost,ll,ul)
+!-----------------------------------------------------------------------------
+!  Splits items 1..nitems into mpisize contiguous ranges of roughly equal total
+!  cost. An item goes to the rank whose share of the cost prefix sum contains
+!  the middle of the item. Ranks left without work get an empty range
+!  (ll = ul+1). Items of zero total cost are split by count.
+!-----------------------------------------------------------------------------
+   use allmod
+   implicit double precision(a-h,o-z)
+
+   integer :: nitems
+   double precision, dimension(nitems) :: cost
+   integer, dimension(mpisize) :: ll, ul
+
+   totcost=0.0d0
+   do i=1, nitems
+      totcost=totcost+cost(i)
+   enddo
+
+   do impi=1, mpisize
+      ul(impi)=0
+   enddo
+
+   acccost=0.0d0
+   do i=1, nitems
+      if(totcost .gt. 0.0d0) then
+         xmid=(acccost+0.5d0*cost(i))/totcost
+         acccost=acccost+cost(i)
+      else
+         xmid=(dble(i)-0.5d0)/dble(nitems)
+      endif
+      impi=min(mpisize,int(xmid*dble(mpisize))+1)
+      ul(impi)=i
+   enddo
+
+   ll(1)=1
+   do impi=2, mpisize
+      ul(impi)=max(ul(impi),ul(impi-1))
+      ll(impi)=ul(impi-1)+1
+   enddo
+
+ end subroutine partition_mpi_work
+
+#ifndef CUDA_MPIV
+
+ subroutine partition_xc_bins_mpi
+!-----------------------------------------------------------------------------
+!  Sets the bin ranges of each rank for get_xc and get_xc_grad from the bin
+!  costs in quick_dft_grid%bin_xc_wt. Points with a weight below one also pay
+!  for sswder in the gradient, which loops over all atom pairs. Master only.
+!-----------------------------------------------------------------------------
+   use allmod
+   implicit double precision(a-h,o-z)
+
+   double precision, allocatable :: gradcost(:)
+
+   call partition_mpi_work(quick_dft_grid%nbins,quick_dft_grid%bin_xc_wt,quick_dft_grid%igridptll, &
+   quick_dft_grid%igridptul)
+
+   allocate(gradcost(quick_dft_grid%nbins))
+
+   sswcost=dble(natom)*dble(natom)
+   do ibin=1, quick_dft_grid%nbins
+      gradcost(ibin)=quick_dft_grid%bin_xc_wt(ibin)
+      do igp=quick_dft_grid%bin_counter(ibin)+1, quick_dft_grid%bin_counter(ibin+1)
+         if(quick_dft_grid%gridb_sswt(igp) .ne. 1.0d0) gradcost(ibin)=gradcost(ibin)+sswcost
+      enddo
+   enddo
+
+   call partition_mpi_work(quick_dft_grid%nbins,gradcost,quick_dft_grid%igradptll,quick_dft_grid%igradptul)
+
+   deallocate(gradcost)
+
+ end subroutine partition_xc_bins_mpi
+
+ subroutine rebalance_xc_mpi(txc)
+!-----------------------------------------------------------------------------
+!  Rescales the xc cost of each bin by the time its rank spent on the bins in
+!  the last get_xc call (txc) and splits the bins again if the slowest rank
+!  took more than 5% longer than the average. Called by all ranks.
+!-----------------------------------------------------------------------------
+   use allmod
+   implicit double precision(a-h,o-z)
+
+   double precision :: txc
+   double precision, dimension(1:mpisize) :: trank
+   logical :: isRebalanced
+
+   include 'mpif.h'
+
+   call MPI_GATHER(txc,1,mpi_double_precision,trank,1,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
+
+   if(master) then
+      tsum=0.0d0
+      tmax=0.0d0
+      do impi=1, mpisize
+         tsum=tsum+trank(impi)
+         tmax=max(tmax,trank(impi))
+      enddo
+
+      isRebalanced = tmax .gt. 1.05d0*tsum/dble(mpisize)
+
+      if(isRebalanced) then
+         wsum=0.0d0
+         do ibin=1, quick_dft_grid%nbins
+            wsum=wsum+quick_dft_grid%bin_xc_wt(ibin)
+         enddo
+
+!  Scale the bins of each rank so that their share of the total cost equals
+!  the share of the time the rank spent on them
+         do impi=1, mpisize
+            wrank=0.0d0
+            do ibin=quick_dft_grid%igridptll(impi), quick_dft_grid%igridptul(impi)
+               wrank=wrank+quick_dft_grid%bin_xc_wt(ibin)
+            enddo
+
+            if(wrank .gt. 0.0d0 .and. trank(impi) .gt. 0.0d0) then
+               wscale=(trank(impi)/tsum)*(wsum/wrank)
+               do ibin=quick_dft_grid%igridptll(impi), quick_dft_grid%igridptul(impi)
+                  quick_dft_grid%bin_xc_wt(ibin)=quick_dft_grid%bin_xc_wt(ibin)*wscale
+               enddo
+            endif
+         enddo
+
+         call partition_xc_bins_mpi
+      endif
+   endif
+
+   call MPI_BCAST(isRebalanced,1,mpi_logical,0,MPI_COMM_WORLD,mpierror)
+
+   if(isRebalanced) then
+      call MPI_BCAST(quick_dft_grid%igridptll,mpisize,mpi_integer,0,MPI_COMM_WORLD,mpierror)
+      call MPI_BCAST(quick_dft_grid%igridptul,mpisize,mpi_integer,0,MPI_COMM_WORLD,mpierror)
+      call MPI_BCAST(quick_dft_grid%igradptll,mpisize,mpi_integer,0,MPI_COMM_WORLD,mpierror)
+      call MPI_BCAST(quick_dft_grid%igradptul,mpisize,mpi_integer,0,MPI_COMM_WORLD,mpierror)
+   endif
+
+ end subroutine rebalance_xc_mpi
+
+#endif
+
+ subroutine reduce_lower_mpi(O,n)
+!-----------------------------------------------------------------------------
+!  Sums the lower triangle of O, diagonal included, over all ranks into the
+!  master with one MPI_REDUCE of the packed triangle. The upper triangle is
+!  not communicated, the callers complete O with copySym. The slave copies of
+!  O are left as they are. Called by all ranks.
+!-----------------------------------------------------------------------------
+   use allmod
+   implicit double precision(a-h,o-z)
+
+   integer :: n
+   double precision, dimension(n,n) :: O
+   double precision, allocatable :: opack(:), osum(:)
+
+   include 'mpif.h'
+
+   npack=n*(n+1)/2
+   allocate(opack(npack))
+   if(master) then
+      allocate(osum(npack))
+   else
+      allocate(osum(1))
+   endif
+
+   k=0
+   do j=1, n
+      do i=j, n
+         k=k+1
+         opack(k)=O(i,j)
+      enddo
+   enddo
+
+   call MPI_REDUCE(opack,osum,npack,mpi_double_precision,MPI_SUM,0,MPI_COMM_WORLD,mpierror)
+
+   if(master) then
+      k=0
+      do j=1, n
+         do i=j, n
+            k=k+1
+            O(i,j)=osum(k)
+         enddo
+      enddo
+   endif
+
+   deallocate(opack,osum)
+
+ end subroutine reduce_lower_mpi
+
    subroutine setup_ssw_mpi
 
    use allmod
@@ -545,6 +720,12 @@
         quick_xcg_tmp%tmp_weight(j) = 0.0d0
     enddo
 
+    if(quick_method%gridReuseDist .gt. 0.0d0) then
+       do j=1,quick_xcg_tmp%idx_grid
+          quick_xcg_tmp%ssw_pin(j) = 0.0d0
+       enddo
+    endif
+
 
    if(bMPI) then
 
@@ -581,6 +762,9 @@ call MPI_BARRIER(MPI_COMM_WORLD,mpierror)
    if(.not. master) then
       call MPI_SEND(quick_xcg_tmp%sswt,quick_xcg_tmp%idx_grid,mpi_double_precision,0,mpirank,MPI_COMM_WORLD,IERROR)
       call MPI_SEND(quick_xcg_tmp%weight,quick_xcg_tmp%idx_grid,mpi_double_precision,0,mpirank,MPI_COMM_WORLD,IERROR)
+      if(quick_method%gridReuseDist .gt. 0.0d0) then
+         call MPI_SEND(quick_xcg_tmp%ssw_pin,quick_xcg_tmp%idx_grid,mpi_double_precision,0,mpirank,MPI_COMM_WORLD,IERROR)
+      endif
    else
 
       do i=1,mpisize-1
@@ -591,6 +775,13 @@ call MPI_BARRIER(MPI_COMM_WORLD,mpierror)
             quick_xcg_tmp%sswt(j)=quick_xcg_tmp%sswt(j)+quick_xcg_tmp%tmp_sswt(j)
             quick_xcg_tmp%weight(j)=quick_xcg_tmp%weight(j)+quick_xcg_tmp%tmp_weight(j)
          enddo
+
+         if(quick_method%gridReuseDist .gt. 0.0d0) then
+            call MPI_RECV(quick_xcg_tmp%tmp_sswt,quick_xcg_tmp%idx_grid,mpi_double_precision,i,i,MPI_COMM_WORLD,MPI_STATUS,IERROR)
+            do j=1,quick_xcg_tmp%idx_grid
+               quick_xcg_tmp%ssw_pin(j)=quick_xcg_tmp%ssw_pin(j)+quick_xcg_tmp%tmp_sswt(j)
+            enddo
+         endif
       enddo
 
    endif
@@ -0,0 +1,824 @@
+/*
+  !---------------------------------------------------------------------!
+  ! Copyright (C) 2020-2021 Merz lab                                    !
+  ! Copyright (C) 2020-2021 Götz lab                                    !
+  !                                                                     !
+  ! This Source Code Form is subject to the terms of the Mozilla Public !
+  ! License, v. 2.0. If a copy of the MPL was not distributed with this !
+  ! file, You can obtain one at http://mozilla.org/MPL/2.0/.            !
+  !_____________________________________________________________________!
+
+  !---------------------------------------------------------------------!
+  ! Standalone benchmark for the octree grid packer. Builds the unpruned!
+  ! xc grid and a 6-31G* like basis set of synthetic systems (water     !
+  ! clusters, polyglycine beta sheets and random C/H boxes), calls      !
+  ! gpack_pack_pts_ directly and reports the time of each phase, the    !
+  ! peak memory and the retained points, bins and functions.            !
+  !                                                                     !
+  ! Usage: gpack_bench [--system water|peptide|box|all] [--atoms n,...] !
+  !        [--threads n,...] [--repeat n] [--json file]                 !
+  !        [--baseline file]                                            !
+  !---------------------------------------------------------------------!
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+extern "C" {
+
+void gpack_initialize_();
+
+void gpack_finalize_();
+
+void gpack_pack_pts_(double *grid_ptx, double *grid_pty, double *grid_ptz, int *grid_atm, double *grid_sswt, double *grid_weight, int *arr_size, int *natoms, int *nbasis, int *maxcontract, double *DMCutoff, double *sigrad2, int *ncontract, double *aexp, double *dcoeff, int *ncenter, int *itype, double *xyz, int *nthreads, int *ngpts, int *ntgpts, int *nbins, int *nbtotbf, int *nbtotpf, double *toct, double *tprscrn);
+
+void gpack_get_pack_stats_(double *tssw, double *toct, double *tprscrn, double *tpack, int *nsswpts);
+
+void get_cpu_grid_info_(float *gridx, float *gridy, float *gridz, double *gridorg, double *ssw, double *weight, int *atm, int *basf, short *primf, int *basf_counter, int *primf_counter, int *bin_counter, double *bin_cost);
+
+}
+
+static const double ANG_TO_BOHR = 1.0/0.52917721067;
+
+// default cutoffs of quick_method
+static const double DM_CUTOFF    = 1.0e-10;
+static const double BASIS_CUTOFF = 1.0e-10;
+
+// grid points farther than this from their parent atom (bohr) carry no density and are not generated
+static const double MAX_GRID_RADIUS = 15.0;
+
+static const int NRAD = 50;
+
+static const int MAXCONTRACT = 6;
+
+/* A synthetic molecule, atoms are given by their atomic number and position in bohr*/
+struct bench_system{
+
+        string name;
+        vector<int> iz;
+        vector<double> xyz;
+};
+
+/* Unpruned grid and basis set in the layout expected by gpack_pack_pts_*/
+struct bench_input{
+
+        vector<double> gridx, gridy, gridz, sswt, weight;
+        vector<int> atm;
+
+        int nbasis;
+        vector<double> sigrad2, aexp, dcoeff;
+        vector<int> ncontract, ncenter, itype;
+};
+
+/* Results of a single packing*/
+struct bench_result{
+
+        char system[16];
+        int natoms;
+        int nbasis;
+        int nthreads;
+        int npts;       // unpruned grid points
+        int nsswpts;    // points kept after ss weight pruning
+        int ngpts;      // packed points, including dummy points
+        int ntgpts;     // true packed points
+        int nbins;
+        int nbtotbf;
+        int nbtotpf;
+        double time_ssw_prune;
+        double time_octree;
+        double time_prescreen;
+        double time_pack_output;
+        double time_transfer;
+        double time_total;
+        long peak_rss_kb;
+};
+
+/*-------------------------- synthetic geometries ---------------------------*/
+
+static void add_atom(bench_system *s, int iz, double x, double y, double z){
+
+        s->iz.push_back(iz);
+        s->xyz.push_back(x*ANG_TO_BOHR);
+        s->xyz.push_back(y*ANG_TO_BOHR);
+        s->xyz.push_back(z*ANG_TO_BOHR);
+}
+
+// applies a uniformly distributed random rotation to (x,y,z)
+static void random_rotate(mt19937 &rng, double *x, double *y, double *z){
+
+        uniform_real_distribution<double> u(0.0, 1.0);
+
+        // random unit quaternion (Shoemake)
+        double u1 = u(rng), u2 = 2.0*M_PI*u(rng), u3 = 2.0*M_PI*u(rng);
+        double a = sqrt(1.0-u1)*sin(u2), b = sqrt(1.0-u1)*cos(u2);
+        double c = sqrt(u1)*sin(u3), d = sqrt(u1)*cos(u3);
+
+        double r[3][3] = {{1-2*(b*b+c*c), 2*(a*b-c*d), 2*(a*c+b*d)},
+                          {2*(a*b+c*d), 1-2*(a*a+c*c), 2*(b*c-a*d)},
+                          {2*(a*c-b*d), 2*(b*c+a*d), 1-2*(a*a+b*b)}};
+
+        double v[3] = {*x, *y, *z};
+        *x = r[0][0]*v[0] + r[0][1]*v[1] + r[0][2]*v[2];
+        *y = r[1][0]*v[0] + r[1][1]*v[1] + r[1][2]*v[2];
+        *z = r[2][0]*v[0] + r[2][1]*v[1] + r[2][2]*v[2];
+}
+
+// randomly oriented water molecules on a cubic lattice with liquid water spacing
+static void make_water_cluster(bench_system *s, int natoms, mt19937 &rng){
+
+        int nmol = max(1, (natoms + 2) / 3);
+        int side = (int) ceil(cbrt((double) nmol));
+        const double spacing = 3.1;
+
+        // O at the origin, H-O-H angle 104.52 degrees, O-H 0.9572 A
+        const double hx = 0.9572*sin(0.5*104.52*M_PI/180.0);
+        const double hz = 0.9572*cos(0.5*104.52*M_PI/180.0);
+
+        for(int m=0; m<nmol; m++){
+                double ox = spacing * (m % side);
+                double oy = spacing * ((m / side) % side);
+                double oz = spacing * (m / (side*side));
+
+                double h[2][3] = {{hx, 0.0, hz}, {-hx, 0.0, hz}};
+
+                add_atom(s, 8, ox, oy, oz);
+                for(int i=0; i<2; i++){
+                        random_rotate(rng, &h[i][0], &h[i][1], &h[i][2]);
+                        add_atom(s, 1, ox+h[i][0], oy+h[i][1], oz+h[i][2]);
+                }
+        }
+}
+
+// stacked polyglycine beta sheets. Each residue (N, H, CA, 2 HA, C, O) adds 7 atoms, strands have
+// 16 residues, sheets 8 strands 4.8 A apart and sheets are stacked 10 A apart.
+static void make_peptide(bench_system *s, int natoms){
+
+        const int res_per_strand = 16;
+        const int strands_per_sheet = 8;
+
+        int nres = max(1, (natoms + 6) / 7);
+
+        for(int r=0; r<nres; r++){
+                int ires   = r % res_per_strand;
+                int strand = (r / res_per_strand) % strands_per_sheet;
+                int sheet  = r / (res_per_strand * strands_per_sheet);
+
+                double x0 = 3.45 * ires;
+                double y0 = 4.8 * strand;
+                double z0 = 10.0 * sheet;
+                double sg = (ires % 2 == 0) ? 1.0 : -1.0;
+
+                add_atom(s, 7, x0,       y0+0.35*sg,  z0);
+                add_atom(s, 1, x0,       y0+1.35*sg,  z0);
+                add_atom(s, 6, x0+1.20,  y0-0.35*sg,  z0);
+                add_atom(s, 1, x0+1.20,  y0-0.95*sg,  z0+0.89);
+                add_atom(s, 1, x0+1.20,  y0-0.95*sg,  z0-0.89);
+                add_atom(s, 6, x0+2.30,  y0+0.35*sg,  z0);
+                add_atom(s, 8, x0+2.30,  y0+1.57*sg,  z0);
+        }
+}
+
+// C/H box at the atom density of a liquid hydrocarbon (0.1 atoms/A^3), atoms are jittered lattice points
+static void make_box(bench_system *s, int natoms, mt19937 &rng){
+
+        uniform_real_distribution<double> jit(-0.3, 0.3);
+        uniform_real_distribution<double> u(0.0, 1.0);
+
+        const double spacing = cbrt(1.0/0.1);
+        int side = (int) ceil(cbrt((double) natoms));
+
+        for(int i=0; i<natoms; i++){
+                double x = spacing * (i % side) + jit(rng);
+                double y = spacing * ((i / side) % side) + jit(rng);
+                double z = spacing * (i / (side*side)) + jit(rng);
+                add_atom(s, (u(rng) < 1.0/3.0) ? 6 : 1, x, y, z);
+        }
+}
+
+static bool make_system(const string &name, int natoms, bench_system *s){
+
+        mt19937 rng(20211022 + natoms);
+
+        s->name = name;
+
+        if(name == "water") make_water_cluster(s, natoms, rng);
+        else if(name == "peptide") make_peptide(s, natoms);
+        else if(name == "box") make_box(s, natoms, rng);
+        else return false;
+
+        return true;
+}
+
+/*------------------------------ basis set ----------------------------------*/
+
+/* Contracted shells of a 6-31G* like basis, sp shells share exponents*/
+struct bench_shell{
+
+        int L;          // 0, 1 or 2, -1 for an sp shell
+        int nprim;
+        double aexp[MAXCONTRACT];
+        double cs[MAXCONTRACT];
+        double cp[MAXCONTRACT];
+};
+
+static vector<bench_shell> element_shells(int iz){
+
+        vector<bench_shell> sh;
+
+        if(iz == 1){
+                sh.push_back({0, 3, {18.7311370, 2.8253937, 0.6401217}, {0.0334946, 0.2347270, 0.8137573}, {0}});
+                sh.push_back({0, 1, {0.1612778}, {1.0}, {0}});
+                return sh;
+        }
+
+        if(iz == 6){
+                sh.push_back({0, 6, {3047.5249, 457.36951, 103.94869, 29.210155, 9.2866630, 3.1639270},
+                                    {0.0018347, 0.0140373, 0.0688426, 0.2321844, 0.4679413, 0.3623120}, {0}});
+                sh.push_back({-1, 3, {7.8682724, 1.8812885, 0.5442493}, {-0.1193324, -0.1608542, 1.1434564},
+                                     {0.0689991, 0.3164240, 0.7443083}});
+                sh.push_back({-1, 1, {0.1687144}, {1.0}, {1.0}});
+        }else if(iz == 7){
+                sh.push_back({0, 6, {4173.5110, 627.45790, 142.90210, 40.234330, 12.820210, 4.3904370},
+                                    {0.0018348, 0.0139950, 0.0685870, 0.2322410, 0.4690700, 0.3604550}, {0}});
+                sh.push_back({-1, 3, {11.626358, 2.7162800, 0.7722180}, {-0.1149610, -0.1691180, 1.1458520},
+                                     {0.0675800, 0.3239070, 0.7408950}});
+                sh.push_back({-1, 1, {0.2120313}, {1.0}, {1.0}});
+        }else{
+                sh.push_back({0, 6, {5484.6717, 825.23495, 188.04696, 52.964500, 16.897570, 5.7996353},
+                                    {0.0018311, 0.0139501, 0.0684451, 0.2327143, 0.4701930, 0.3585209}, {0}});
+                sh.push_back({-1, 3, {15.539616, 3.5999336, 1.0137618}, {-0.1107775, -0.1480263, 1.1307670},
+                                     {0.0708743, 0.3397528, 0.7271586}});
+                sh.push_back({-1, 1, {0.2700058}, {1.0}, {1.0}});
+        }
+
+        sh.push_back({2, 1, {0.8}, {1.0}, {0}});
+
+        return sh;
+}
+
+// normalization of a cartesian primitive gaussian
+static double prim_norm(double a, int l, int m, int n){
+
+        double dfact = 1.0;
+        for(int i=2*l-1; i>1; i-=2) dfact *= i;
+        for(int i=2*m-1; i>1; i-=2) dfact *= i;
+        for(int i=2*n-1; i>1; i-=2) dfact *= i;
+
+        return pow(2.0*a/M_PI, 0.75) * pow(4.0*a, 0.5*(l+m+n)) / sqrt(dfact);
+}
+
+// radius of significance of a basis function, as computed in dft.f90
+static double significance_radius2(double amin, int L){
+
+        double gamma = 1.0;
+        for(int i=1; i<=L+1; i++) gamma *= (double)(L+1-i) + 0.5;
+        double gamma2pi = gamma * 11.13665599366341569;
+
+        double target = BASIS_CUTOFF * pow(pow(2.0*amin, L+1.5)/gamma2pi, -0.5);
+
+        double stepsize = 1.0;
+        double radial = 0.0;
+
+        while(stepsize > 1.0e-4){
+                radial += stepsize;
+                double current = exp(-amin*radial*radial) * pow(radial, L);
+                if(current < target){
+                        radial -= stepsize;
+                        stepsize /= 10.0;
+                }
+        }
+
+        return radial*radial;
+}
+
+static void add_basis_function(bench_input *in, int iatm, const bench_shell &sh, int lx, int ly, int lz, bool pcoeff){
+
+        int L = lx + ly + lz;
+        double amin = 1.0e10;
+
+        for(int k=0; k<MAXCONTRACT; k++){
+                double a = (k < sh.nprim) ? sh.aexp[k] : 0.0;
+                double c = (k < sh.nprim) ? (pcoeff ? sh.cp[k] : sh.cs[k]) * prim_norm(a, lx, ly, lz) : 0.0;
+                in->aexp.push_back(a);
+                in->dcoeff.push_back(c);
+                if(k < sh.nprim) amin = min(amin, a);
+        }
+
+        in->ncontract.push_back(sh.nprim);
+        in->ncenter.push_back(iatm+1);
+        in->itype.push_back(lx);
+        in->itype.push_back(ly);
+        in->itype.push_back(lz);
+        in->sigrad2.push_back(significance_radius2(amin, L));
+}
+
+static void make_basis(const bench_system &s, bench_input *in){
+
+        static const int pxyz[3][3] = {{1,0,0}, {0,1,0}, {0,0,1}};
+        static const int dxyz[6][3] = {{2,0,0}, {0,2,0}, {0,0,2}, {1,1,0}, {1,0,1}, {0,1,1}};
+
+        for(int i=0; i<(int) s.iz.size(); i++){
+                vector<bench_shell> sh = element_shells(s.iz[i]);
+                for(int j=0; j<(int) sh.size(); j++){
+                        if(sh[j].L <= 0) add_basis_function(in, i, sh[j], 0, 0, 0, false);
+                        if(sh[j].L == -1 || sh[j].L == 1)
+                                for(int k=0; k<3; k++) add_basis_function(in, i, sh[j], pxyz[k][0], pxyz[k][1], pxyz[k][2], true);
+                        if(sh[j].L == 2)
+                                for(int k=0; k<6; k++) add_basis_function(in, i, sh[j], dxyz[k][0], dxyz[k][1], dxyz[k][2], false);
+                }
+        }
+
+        in->nbasis = (int) in->ncontract.size();
+}
+
+/*------------------------------- xc grid -----------------------------------*/
+
+// points on a sphere, spread along a golden angle spiral with equal weights
+static void sphere_points(int n, vector<double> *pts){
+
+        const double golden = M_PI * (3.0 - sqrt(5.0));
+
+        pts->resize(3*n);
+        for(int i=0; i<n; i++){
+                double z = 1.0 - (2.0*i + 1.0) / n;
+                double r = sqrt(1.0 - z*z);
+                (*pts)[3*i]   = r * cos(golden*i);
+                (*pts)[3*i+1] = r * sin(golden*i);
+                (*pts)[3*i+2] = z;
+        }
+}
+
+// SG-1 atomic radii (bohr)
+static double sg1_radius(int iz){
+
+        switch(iz){
+                case 1: return 1.0000;
+                case 6: return 1.2308;
+                case 7: return 1.0256;
+                default: return 0.8791;
+        }
+}
+
+// SG-1 like angular pruning by r/R
+static int sg1_angular_points(double rr){
+
+        if(rr < 0.25) return 6;
+        if(rr < 0.5)  return 38;
+        if(rr < 1.0)  return 86;
+        if(rr < 4.5)  return 194;
+        return 86;
+}
+
+/* A cell list over atomic positions to find the nearest atom of a grid point*/
+struct atom_cell_list{
+
+        double xmin, ymin, zmin;
+        double cell_size;
+        int nx, ny, nz;
+        vector<int> cell_counter;
+        vector<int> atoms;
+};
+
+static void build_atom_cell_list(const bench_system &s, atom_cell_list *acl){
+
+        int natoms = (int) s.iz.size();
+        double xmax = -1.0e30, ymax = -1.0e30, zmax = -1.0e30;
+
+        acl->xmin = acl->ymin = acl->zmin = 1.0e30;
+        for(int i=0; i<natoms; i++){
+                acl->xmin = min(acl->xmin, s.xyz[3*i]);   xmax = max(xmax, s.xyz[3*i]);
+                acl->ymin = min(acl->ymin, s.xyz[3*i+1]); ymax = max(ymax, s.xyz[3*i+1]);
+                acl->zmin = min(acl->zmin, s.xyz[3*i+2]); zmax = max(zmax, s.xyz[3*i+2]);
+        }
+
+        acl->cell_size = 4.0;
+        acl->nx = (int)((xmax - acl->xmin) / acl->cell_size) + 1;
+        acl->ny = (int)((ymax - acl->ymin) / acl->cell_size) + 1;
+        acl->nz = (int)((zmax - acl->zmin) / acl->cell_size) + 1;
+
+        int ncells = acl->nx * acl->ny * acl->nz;
+        vector<int> cell(natoms);
+
+        acl->cell_counter.assign(ncells+1, 0);
+        for(int i=0; i<natoms; i++){
+                int ix = (int)((s.xyz[3*i]   - acl->xmin) / acl->cell_size);
+                int iy = (int)((s.xyz[3*i+1] - acl->ymin) / acl->cell_size);
+                int iz = (int)((s.xyz[3*i+2] - acl->zmin) / acl->cell_size);
+                cell[i] = (iz * acl->ny + iy) * acl->nx + ix;
+                acl->cell_counter[cell[i]+1]++;
+        }
+
+        for(int c=0; c<ncells; c++) acl->cell_counter[c+1] += acl->cell_counter[c];
+
+        vector<int> fill(acl->cell_counter.begin(), acl->cell_counter.end()-1);
+        acl->atoms.resize(natoms);
+        for(int i=0; i<natoms; i++) acl->atoms[fill[cell[i]]++] = i;
+}
+
+// nearest atom of a point, searched over shells of cells of increasing distance
+static int nearest_atom(const bench_system &s, const atom_cell_list &acl, double x, double y, double z){
+
+        int cx = min(max((int)floor((x - acl.xmin) / acl.cell_size), 0), acl.nx-1);
+        int cy = min(max((int)floor((y - acl.ymin) / acl.cell_size), 0), acl.ny-1);
+        int cz = min(max((int)floor((z - acl.zmin) / acl.cell_size), 0), acl.nz-1);
+
+        int kmax = max(acl.nx, max(acl.ny, acl.nz));
+        int best = -1;
+        double best_r2 = 1.0e30;
+
+        for(int k=0; k<=kmax; k++){
+                for(int iz=cz-k; iz<=cz+k; iz++){
+                        if(iz < 0 || iz >= acl.nz) continue;
+                        for(int iy=cy-k; iy<=cy+k; iy++){
+                                if(iy < 0 || iy >= acl.ny) continue;
+                                for(int ix=cx-k; ix<=cx+k; ix++){
+                                        if(ix < 0 || ix >= acl.nx) continue;
+                                        // visit only the shell of cells at distance k
+                                        if(abs(ix-cx) != k && abs(iy-cy) != k && abs(iz-cz) != k) continue;
+
+                                        int c = (iz * acl.ny + iy) * acl.nx + ix;
+                                        for(int j=acl.cell_counter[c]; j<acl.cell_counter[c+1]; j++){
+                                                int a = acl.atoms[j];
+                                                double dx = x - s.xyz[3*a], dy = y - s.xyz[3*a+1], dz = z - s.xyz[3*a+2];
+                                                double r2 = dx*dx + dy*dy + dz*dz;
+                                                if(r2 < best_r2 || (r2 == best_r2 && a < best)){
+                                                        best_r2 = r2;
+                                                        best = a;
+                                                }
+                                        }
+                                }
+                        }
+                }
+
+                // atoms beyond this shell are at least k cells away
+                double reach = k * acl.cell_size;
+                if(best >= 0 && best_r2 <= reach*reach) break;
+        }
+
+        return best;
+}
+
+// Builds the unpruned atom centered grid. Euler-Maclaurin radial points with SG-1 like angular pruning.
+// The Stratmann-Scuseria weights are replaced by their a->0 limit, a nearest atom partition, so that
+// the packer sees a realistic number of points with zero weight without an O(N^2) weight evaluation.
+static void make_grid(const bench_system &s, bench_input *in){
+
+        atom_cell_list acl;
+        build_atom_cell_list(s, &acl);
+
+        vector<vector<double> > sph(195);
+        int nang[5] = {6, 38, 86, 194, 86};
+        for(int i=0; i<5; i++) if(sph[nang[i]].empty()) sphere_points(nang[i], &sph[nang[i]]);
+
+        for(int i=0; i<(int) s.iz.size(); i++){
+                double rad = sg1_radius(s.iz[i]);
+
+                for(int ir=1; ir<=NRAD; ir++){
+                        double x  = (double) ir / (NRAD + 1);
+                        double r  = rad * x*x / ((1.0-x)*(1.0-x));
+                        double wr = 2.0 * pow(rad, 3) * pow(x, 5) / pow(1.0-x, 7) / (NRAD + 1);
+
+                        if(r > MAX_GRID_RADIUS) break;
+
+                        int n = sg1_angular_points(r / rad);
+                        const vector<double> &p = sph[n];
+
+                        for(int k=0; k<n; k++){
+                                double gx = s.xyz[3*i]   + r * p[3*k];
+                                double gy = s.xyz[3*i+1] + r * p[3*k+1];
+                                double gz = s.xyz[3*i+2] + r * p[3*k+2];
+                                double sw = (nearest_atom(s, acl, gx, gy, gz) == i) ? 1.0 : 0.0;
+
+                                in->gridx.push_back(gx);
+                                in->gridy.push_back(gy);
+                                in->gridz.push_back(gz);
+                                in->sswt.push_back(sw);
+                                in->weight.push_back(sw * wr * 4.0 * M_PI / n);
+                                in->atm.push_back(i+1);
+                        }
+                }
+        }
+}
+
+/*------------------------------- driver ------------------------------------*/
+
+static double wall_time(){
+
+        return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// packs the grid of a system once and fills in the results, runs in a forked process so
+// that the peak resident memory belongs to a single case
+static void run_case(const string &name, int natoms, int nthreads, bench_result *res){
+
+        bench_system s;
+        bench_input in;
+
+        make_system(name, natoms, &s);
+        make_basis(s, &in);
+        make_grid(s, &in);
+
+        int na = (int) s.iz.size();
+        int npts = (int) in.gridx.size();
+        int maxc = MAXCONTRACT;
+        double dmcutoff = DM_CUTOFF;
+        int ngpts, ntgpts, nbins, nbtotbf, nbtotpf, nsswpts;
+        double toct, tprscrn, tssw, tpack;
+
+        double start = wall_time();
+
+        gpack_initialize_();
+
+        gpack_pack_pts_(in.gridx.data(), in.gridy.data(), in.gridz.data(), in.atm.data(), in.sswt.data(), in.weight.data(),
+                        &npts, &na, &in.nbasis, &maxc, &dmcutoff, in.sigrad2.data(), in.ncontract.data(), in.aexp.data(),
+                        in.dcoeff.data(), in.ncenter.data(), in.itype.data(), s.xyz.data(), &nthreads, &ngpts, &ntgpts,
+                        &nbins, &nbtotbf, &nbtotpf, &toct, &tprscrn);
+
+        gpack_get_pack_stats_(&tssw, &toct, &tprscrn, &tpack, &nsswpts);
+
+        double tpacked = wall_time();
+
+        // the fortran side keeps these arrays for the whole scf
+        vector<float> gx(ngpts), gy(ngpts), gz(ngpts);
+        vector<double> org(3*nbins), ssw(ngpts), w(ngpts), cost(nbins);
+        vector<int> atm(ngpts), basf(nbtotbf), basf_counter(nbins+1), primf_counter(nbtotbf+1), bin_counter(nbins+1);
+        vector<short> primf(nbtotpf);
+
+        get_cpu_grid_info_(gx.data(), gy.data(), gz.data(), org.data(), ssw.data(), w.data(), atm.data(), basf.data(),
+                           primf.data(), basf_counter.data(), primf_counter.data(), bin_counter.data(), cost.data());
+
+        gpack_finalize_();
+
+        double end = wall_time();
+
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+
+        memset(res, 0, sizeof(bench_result));
+        strncpy(res->system, name.c_str(), sizeof(res->system)-1);
+        res->natoms           = na;
+        res->nbasis           = in.nbasis;
+        res->nthreads         = nthreads;
+        res->npts             = npts;
+        res->nsswpts          = nsswpts;
+        res->ngpts            = ngpts;
+        res->ntgpts           = ntgpts;
+        res->nbins            = nbins;
+        res->nbtotbf          = nbtotbf;
+        res->nbtotpf          = nbtotpf;
+        res->time_ssw_prune   = tssw;
+        res->time_octree      = toct;
+        res->time_prescreen   = tprscrn;
+        res->time_pack_output = tpack;
+        res->time_transfer    = end - tpacked;
+        res->time_total       = end - start;
+        res->peak_rss_kb      = ru.ru_maxrss;
+}
+
+static bool run_case_forked(const string &name, int natoms, int nthreads, bench_result *res){
+
+        int fd[2];
+        if(pipe(fd) != 0) return false;
+
+        pid_t pid = fork();
+        if(pid < 0) return false;
+
+        if(pid == 0){
+                close(fd[0]);
+                bench_result r;
+                run_case(name, natoms, nthreads, &r);
+                ssize_t nw = write(fd[1], &r, sizeof(r));
+                close(fd[1]);
+                _exit(nw == (ssize_t) sizeof(r) ? 0 : 1);
+        }
+
+        close(fd[1]);
+        ssize_t nr = read(fd[0], res, sizeof(bench_result));
+        close(fd[0]);
+
+        int status;
+        waitpid(pid, &status, 0);
+
+        return nr == (ssize_t) sizeof(bench_result) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void write_json_case(FILE *f, const bench_result &r){
+
+        fprintf(f, "{\"system\": \"%s\", \"natoms\": %d, \"nbasis\": %d, \"threads\": %d, \"npts\": %d, \"nsswpts\": %d, "
+                   "\"ngpts\": %d, \"ntgpts\": %d, \"nbins\": %d, \"nbtotbf\": %d, \"nbtotpf\": %d, "
+                   "\"time\": {\"ssw_prune\": %.6f, \"octree\": %.6f, \"prescreen\": %.6f, \"pack_output\": %.6f, "
+                   "\"transfer\": %.6f, \"total\": %.6f}, \"peak_rss_kb\": %ld}",
+                r.system, r.natoms, r.nbasis, r.nthreads, r.npts, r.nsswpts, r.ngpts, r.ntgpts, r.nbins, r.nbtotbf,
+                r.nbtotpf, r.time_ssw_prune, r.time_octree, r.time_prescreen, r.time_pack_output, r.time_transfer,
+                r.time_total, r.peak_rss_kb);
+}
+
+// reads a file written by write_json, one case per line
+static vector<bench_result> read_json(const char *fname){
+
+        vector<bench_result> cases;
+        FILE *f = fopen(fname, "r");
+        if(f == NULL) return cases;
+
+        char line[2048];
+        while(fgets(line, sizeof(line), f) != NULL){
+                bench_result r;
+                memset(&r, 0, sizeof(r));
+                const char *p = strstr(line, "{\"system\"");
+                if(p == NULL) continue;
+                int n = sscanf(p, "{\"system\": \"%15[^\"]\", \"natoms\": %d, \"nbasis\": %d, \"threads\": %d, \"npts\": %d, "
+                                  "\"nsswpts\": %d, \"ngpts\": %d, \"ntgpts\": %d, \"nbins\": %d, \"nbtotbf\": %d, \"nbtotpf\": %d, "
+                                  "\"time\": {\"ssw_prune\": %lf, \"octree\": %lf, \"prescreen\": %lf, \"pack_output\": %lf, "
+                                  "\"transfer\": %lf, \"total\": %lf}, \"peak_rss_kb\": %ld}",
+                               r.system, &r.natoms, &r.nbasis, &r.nthreads, &r.npts, &r.nsswpts, &r.ngpts, &r.ntgpts,
+                               &r.nbins, &r.nbtotbf, &r.nbtotpf, &r.time_ssw_prune, &r.time_octree, &r.time_prescreen,
+                               &r.time_pack_output, &r.time_transfer, &r.time_total, &r.peak_rss_kb);
+                if(n == 18) cases.push_back(r);
+        }
+
+        fclose(f);
+        return cases;
+}
+
+static void write_json(const char *fname, const vector<bench_result> &cases){
+
+        FILE *f = fopen(fname, "w");
+        if(f == NULL){
+                fprintf(stderr, "gpack_bench: cannot open %s\n", fname);
+                return;
+        }
+
+        fprintf(f, "{\"cases\": [\n");
+        for(int i=0; i<(int) cases.size(); i++){
+                fprintf(f, "  ");
+                write_json_case(f, cases[i]);
+                fprintf(f, "%s\n", i+1 < (int) cases.size() ? "," : "");
+        }
+        fprintf(f, "]}\n");
+
+        fclose(f);
+}
+
+// compares against a baseline, counts must match exactly while times are reported as ratios
+static int compare_baseline(const char *fname, const vector<bench_result> &cases){
+
+        vector<bench_result> base = read_json(fname);
+        int nmismatch = 0;
+
+        printf("\n%-8s %6s %4s %10s %10s %10s  %s\n", "system", "atoms", "thr", "t/t_base", "rss/base", "counts", "");
+
+        for(int i=0; i<(int) cases.size(); i++){
+                const bench_result &r = cases[i];
+                const bench_result *b = NULL;
+
+                for(int j=0; j<(int) base.size(); j++)
+                        if(strcmp(base[j].system, r.system) == 0 && base[j].natoms == r.natoms && base[j].nthreads == r.nthreads)
+                                b = &base[j];
+
+                if(b == NULL){
+                        printf("%-8s %6d %4d %10s\n", r.system, r.natoms, r.nthreads, "no baseline");
+                        continue;
+                }
+
+                bool same = r.nsswpts == b->nsswpts && r.ntgpts == b->ntgpts && r.nbins == b->nbins &&
+                            r.nbtotbf == b->nbtotbf && r.nbtotpf == b->nbtotpf;
+                if(!same) nmismatch++;
+
+                printf("%-8s %6d %4d %10.3f %10.3f %10s\n", r.system, r.natoms, r.nthreads,
+                       b->time_total > 0.0 ? r.time_total / b->time_total : 0.0,
+                       b->peak_rss_kb > 0 ? (double) r.peak_rss_kb / b->peak_rss_kb : 0.0, same ? "same" : "CHANGED");
+        }
+
+        return nmismatch;
+}
+
+static vector<int> parse_list(const char *s){
+
+        vector<int> v;
+        const char *p = s;
+        while(*p){
+                v.push_back(atoi(p));
+                while(*p && *p != ',') p++;
+                if(*p == ',') p++;
+        }
+        return v;
+}
+
+static void usage(){
+
+        fprintf(stderr, "usage: gpack_bench [--system water|peptide|box|all] [--atoms n,...] [--threads n,...]\n"
+                        "                   [--repeat n] [--json file] [--baseline file]\n");
+}
+
+int main(int argc, char **argv){
+
+        vector<string> systems;
+        vector<int> atoms;
+        vector<int> threads(1, 1);
+        int repeat = 1;
+        const char *json = NULL;
+        const char *baseline = NULL;
+
+        for(int i=1; i<argc; i++){
+                string arg = argv[i];
+                if(i+1 >= argc){
+                        usage();
+                        return 1;
+                }
+                if(arg == "--system"){
+                        string sys = argv[++i];
+                        if(sys == "all"){
+                                systems.push_back("water");
+                                systems.push_back("peptide");
+                                systems.push_back("box");
+                        }else{
+                                systems.push_back(sys);
+                        }
+                }
+                else if(arg == "--atoms")    atoms = parse_list(argv[++i]);
+                else if(arg == "--threads")  threads = parse_list(argv[++i]);
+                else if(arg == "--repeat")   repeat = max(1, atoi(argv[++i]));
+                else if(arg == "--json")     json = argv[++i];
+                else if(arg == "--baseline") baseline = argv[++i];
+                else{
+                        usage();
+                        return 1;
+                }
+        }
+
+        if(systems.empty()){
+                systems.push_back("water");
+                systems.push_back("peptide");
+                systems.push_back("box");
+        }
+
+        if(atoms.empty()){
+                atoms.push_back(10);
+                atoms.push_back(100);
+                atoms.push_back(1000);
+        }
+
+        for(int i=0; i<(int) systems.size(); i++){
+                bench_system s;
+                if(!make_system(systems[i], 1, &s)){
+                        fprintf(stderr, "gpack_bench: unknown system %s\n", systems[i].c_str());
+                        return 1;
+                }
+        }
+
+        vector<bench_result> cases;
+
+        printf("%-8s %6s %6s %4s %9s %9s %9s %7s %9s %10s %8s %8s %8s %8s %8s %8s %9s\n", "system", "atoms", "nbasis",
+               "thr", "npts", "nsswpts", "ntgpts", "nbins", "nbtotbf", "nbtotpf", "t_ssw", "t_oct", "t_prscr", "t_pack",
+               "t_xfer", "t_total", "rss(MB)");
+
+        for(int i=0; i<(int) systems.size(); i++){
+                for(int j=0; j<(int) atoms.size(); j++){
+                        for(int k=0; k<(int) threads.size(); k++){
+
+                                // the fastest of the repeats is kept
+                                bench_result best;
+                                bool ok = false;
+
+                                for(int n=0; n<repeat; n++){
+                                        bench_result r;
+                                        if(!run_case_forked(systems[i], atoms[j], threads[k], &r)){
+                                                fprintf(stderr, "gpack_bench: %s with %d atoms failed\n", systems[i].c_str(), atoms[j]);
+                                                continue;
+                                        }
+                                        if(!ok || r.time_total < best.time_total) best = r;
+                                        ok = true;
+                                }
+
+                                if(!ok) continue;
+
+                                cases.push_back(best);
+
+                                printf("%-8s %6d %6d %4d %9d %9d %9d %7d %9d %10d %8.3f %8.3f %8.3f %8.3f %8.3f %8.3f %9.1f\n",
+                                       best.system, best.natoms, best.nbasis, best.nthreads, best.npts, best.nsswpts,
+                                       best.ntgpts, best.nbins, best.nbtotbf, best.nbtotpf, best.time_ssw_prune,
+                                       best.time_octree, best.time_prescreen, best.time_pack_output, best.time_transfer,
+                                       best.time_total, best.peak_rss_kb / 1024.0);
+                                fflush(stdout);
+                        }
+                }
+        }
+
+        if(json != NULL) write_json(json, cases);
+
+        if(baseline != NULL && compare_baseline(baseline, cases) > 0) return 2;
+
+        return 0;
+}
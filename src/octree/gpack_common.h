@@ -2,6 +2,23 @@
 //Constants for packing grid points
 static const int MAX_POINTS_PER_CLUSTER = 256;
 static const int OCTREE_DEPTH = 64;
+//Leaves below MAX_POINTS_PER_CLUSTER are split further while their estimated xc cost exceeds MAX_BIN_COST,
+//but not below MIN_POINTS_PER_CLUSTER points. MAX_BIN_COST is the cost of a full bin with 256 basis functions.
+static const int MIN_POINTS_PER_CLUSTER = 32;
+static const double MAX_BIN_COST = 256.0 * 256.0 * 256.0;
+//Upper limit for the number of cells along each direction of the basis function cell list
+static const int MAX_BF_CELLS_PER_DIM = 64;
 
 //void pack_grid_pts();
 extern "C" void gpu_get_octree_info(double *gridx, double *gridy, double *gridz, double *sigrad2, unsigned char *gpweight, unsigned int *cfweight, unsigned int *pfweight, int count);
+
+//Significant basis & primitive functions of each bin are flagged in bitsets of 32 bit words.
+//Each bin starts at a word boundary, so that bins can be flagged concurrently.
+static inline unsigned long gpack_bitset_words(unsigned long nbits){ return (nbits + 31) / 32; }
+
+static inline void gpack_set_bit(unsigned int *bits, unsigned long i){ bits[i >> 5] |= 1u << (i & 31); }
+
+static inline bool gpack_test_bit(const unsigned int *bits, unsigned long i){ return (bits[i >> 5] >> (i & 31)) & 1u; }
+
+//Estimated xc cost of a bin. Density and operator builds loop over pairs of basis functions at each point.
+static inline double gpack_bin_cost(double npts, double nbf){ return npts * nbf * nbf; }
@@ -5,6 +5,10 @@
 #include <string.h>
 #include <stdio.h>
 #include <iostream>
+#include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 using namespace std;
 
 // setup a debug file
@@ -46,6 +50,26 @@ static FILE *gpackDebugFile = NULL;
 #define PRINTOCTMEMCOUNT(s,a,b)
 #endif
 
+// wall clock time in seconds. clock() is not used since it adds up the time of all threads.
+static inline double gpack_wtime(){
+#ifdef _OPENMP
+    return omp_get_wtime();
+#else
+    return ((double) clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+// splits n elements into contiguous chunks and returns the chunk of the calling thread in [ist,iend)
+static inline void gpack_thread_range(int n, int *ist, int *iend){
+    int tid = 0;
+    int nt  = 1;
+#ifdef _OPENMP
+    tid = omp_get_thread_num();
+    nt  = omp_get_num_threads();
+#endif
+    *ist  = (int)(((long long) n * tid) / nt);
+    *iend = (int)(((long long) n * (tid + 1)) / nt);
+}
 
 template <typename T> struct gpack_buffer_type;
 
@@ -65,6 +89,7 @@ struct gpack_type{
    int nbasis;   // total number of basis functions
    int maxcontract; // maximum number of contractions
    double DMCutoff; // Density matrix cut off
+   int nthreads;    // number of threads used for grid packing
    gpack_buffer_type<double>* sigrad2; // square of the radius of sigificance
    gpack_buffer_type<int>* ncontract; // number of contraction functions
    gpack_buffer_type<double>* aexp; // alpha values of the gaussian primivite function exponents
@@ -91,8 +116,11 @@ struct gpack_type{
    int nbtotpf;     // total number of primitive functions
    int ntgpts;  // total number of true grid points(i.e. excluding dummy points)
 
+   double time_ssw_prune; // time for pruning grid points by ss weights
    double time_octree; // time for running octree algorithm
    double time_bfpf_prescreen; // time for prescreening basis and primitive functions
+   double time_pack_output; // time for preparing prescreening input and assembling packed arrays
+   int nsswpts; // number of grid points retained after ss weight pruning
 
 #ifdef DEBUG
    FILE *gpackDebugFile;
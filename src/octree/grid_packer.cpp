@@ -20,15 +20,24 @@
 #include "grid_packer.h"
 #include "gpack_type.h"
 #include <cmath>
+#include <cfloat>
 #include <fstream>
 #include <time.h>
 
+// packing state kept for incremental repacking, NULL unless grid reuse is on
+static gpack_reuse_type *gpr = NULL;
+
 
 // initialize data structure for grid partitioning algorithm
 void gpack_initialize_(){
 
     gps = new gpack_type;
     gps->totalGPACKMemory = 0;
+    gps->time_ssw_prune      = 0.0;
+    gps->time_octree         = 0.0;
+    gps->time_bfpf_prescreen = 0.0;
+    gps->time_pack_output    = 0.0;
+    gps->nsswpts             = 0;
 
 #if defined MPIV && !defined CUDA_MPIV
     MPI_Comm_rank(MPI_COMM_WORLD, &mpirank);
@@ -106,6 +115,21 @@ void gpack_finalize_(){
 
 }
 
+// keep packing state between calls, so that displaced grids can be repacked
+void gpack_reuse_initialize_(){
+
+    if(gpr == NULL) gpr = new gpack_reuse_type;
+
+}
+
+// relinquish the packing state kept for repacking
+void gpack_reuse_finalize_(){
+
+    delete gpr;
+    gpr = NULL;
+
+}
+
 #if defined CUDA || defined CUDA_MPIV
 // loads packed grid information into f90 data structures
 void get_gpu_grid_info_(double *gridx, double *gridy, double *gridz, double *ssw, double *weight, int *atm, int *dweight, int *basf, int *primf, int *basf_counter, int *primf_counter){
@@ -124,41 +148,72 @@ void get_gpu_grid_info_(double *gridx, double *gridy, double *gridz, double *ssw
 
 }
 #else
-// loads packed grid information into f90 data structures
-void get_cpu_grid_info_(double *gridx, double *gridy, double *gridz, double *ssw, double *weight, int *atm, int *basf, int *primf, int *basf_counter, int *primf_counter, int *bin_counter){
+// loads packed grid information into f90 data structures. Points are stored as single precision offsets
+// from the center of their bin and primitive numbers in 16 bits, which shrinks the grid kept during scf.
+// The estimated xc cost of each bin is exported for load balancing.
+void get_cpu_grid_info_(float *gridx, float *gridy, float *gridz, double *gridorg, double *ssw, double *weight, int *atm, int *basf, short *primf, int *basf_counter, int *primf_counter, int *bin_counter, double *bin_cost){
 
-        gps->gridxb->Transfer(gridx);
-        gps->gridyb->Transfer(gridy);
-        gps->gridzb->Transfer(gridz);
         gps->gridb_sswt->Transfer(ssw);
         gps->gridb_weight->Transfer(weight);
         gps->gridb_atm->Transfer(atm);
         gps->basf->Transfer(basf);
-        gps->primf->Transfer(primf);
         gps->basf_counter->Transfer(basf_counter);
         gps->primf_counter->Transfer(primf_counter);
 	gps->bin_counter->Transfer(bin_counter);
 
+#pragma omp parallel for schedule(dynamic) num_threads(gps->nthreads)
+        for(int b=0; b<gps->nbins; b++){
+                int pstart = gps->bin_counter->_cppData[b];
+                int pend   = gps->bin_counter->_cppData[b+1];
+
+                double *gx = gps->gridxb->_cppData;
+                double *gy = gps->gridyb->_cppData;
+                double *gz = gps->gridzb->_cppData;
+
+                double xmin = gx[pstart], xmax = xmin;
+                double ymin = gy[pstart], ymax = ymin;
+                double zmin = gz[pstart], zmax = zmin;
+
+                for(int k=pstart+1; k<pend; k++){
+                        xmin = min(xmin, gx[k]);
+                        xmax = max(xmax, gx[k]);
+                        ymin = min(ymin, gy[k]);
+                        ymax = max(ymax, gy[k]);
+                        zmin = min(zmin, gz[k]);
+                        zmax = max(zmax, gz[k]);
+                }
+
+                double cx = 0.5 * (xmin + xmax);
+                double cy = 0.5 * (ymin + ymax);
+                double cz = 0.5 * (zmin + zmax);
+
+                gridorg[0+b*3] = cx;
+                gridorg[1+b*3] = cy;
+                gridorg[2+b*3] = cz;
+
+                for(int k=pstart; k<pend; k++){
+                        gridx[k] = (float) (gx[k] - cx);
+                        gridy[k] = (float) (gy[k] - cy);
+                        gridz[k] = (float) (gz[k] - cz);
+                }
+
+                bin_cost[b] = gpack_bin_cost(pend - pstart, gps->basf_counter->_cppData[b+1] - gps->basf_counter->_cppData[b]);
+        }
+
+        for(int i=0; i<gps->nbtotpf; i++){
+                primf[i] = (short) gps->primf->_cppData[i];
+        }
+
 }
 #endif
 
 
 /*Fortran accessible method to pack grid points*/
-void gpack_pack_pts_(double *grid_ptx, double *grid_pty, double *grid_ptz, int *grid_atm, double *grid_sswt, double *grid_weight, int *arr_size, int *natoms, int *nbasis, int *maxcontract, double *DMCutoff, double *sigrad2, int *ncontract, double *aexp, double *dcoeff, int *ncenter, int *itype, double *xyz, int *ngpts, int *ntgpts, int *nbins, int *nbtotbf, int *nbtotpf, double *toct, double *tprscrn){
+void gpack_pack_pts_(double *grid_ptx, double *grid_pty, double *grid_ptz, int *grid_atm, double *grid_sswt, double *grid_weight, int *arr_size, int *natoms, int *nbasis, int *maxcontract, double *DMCutoff, double *sigrad2, int *ncontract, double *aexp, double *dcoeff, int *ncenter, int *itype, double *xyz, int *nthreads, int *ngpts, int *ntgpts, int *nbins, int *nbtotbf, int *nbtotpf, double *toct, double *tprscrn){
         
         gps->arr_size    = *arr_size;
-        gps->natoms      = *natoms;
-        gps->nbasis      = *nbasis;
-        gps->maxcontract = *maxcontract;
-        gps->DMCutoff    = *DMCutoff;
 
-        gps->sigrad2     = new gpack_buffer_type<double>(sigrad2, gps->nbasis);
-        gps->ncontract   = new gpack_buffer_type<int>(ncontract, gps->nbasis);
-        gps->aexp        = new gpack_buffer_type<double>(aexp, gps->maxcontract, gps->nbasis);
-        gps->dcoeff      = new gpack_buffer_type<double>(dcoeff, gps->maxcontract, gps->nbasis);
-        gps->xyz         = new gpack_buffer_type<double>(xyz, 3, gps->natoms);
-        gps->ncenter     = new gpack_buffer_type<int>(ncenter, gps->nbasis);
-        gps->itype       = new gpack_buffer_type<int>(itype, 3, gps->nbasis);
+        gpack_load_input(natoms, nbasis, maxcontract, DMCutoff, sigrad2, ncontract, aexp, dcoeff, ncenter, itype, xyz, nthreads);
 
 #if defined MPIV && !defined CUDA_MPIV
     if(mpirank==0){
@@ -170,8 +225,26 @@ void gpack_pack_pts_(double *grid_ptx, double *grid_pty, double *grid_ptz, int *
         gps->ss_weight   = new gpack_buffer_type<double>(grid_weight, gps->arr_size);
         gps->grid_atm    = new gpack_buffer_type<int>(grid_atm, gps->arr_size);
 
+        // keep the layout of the unpruned grid if the next geometry is to be repacked
+        if(gpr != NULL){
+                gpr->arr_size    = *arr_size;
+                gpr->natoms      = *natoms;
+                gpr->nbasis      = *nbasis;
+                gpr->maxcontract = *maxcontract;
+                gpr->xyz.assign(xyz, xyz + 3 * (*natoms));
+                gpr->binned.assign(*arr_size, 0);
+                gpr->leaves.clear();
+        }
+
+        double start = gpack_wtime();
+
         get_ssw_pruned_grid();
 
+        gps->time_ssw_prune = gpack_wtime() - start;
+        gps->nsswpts        = gps->arr_size;
+
+        PRINTOCTTIME("SSW PRUNING", gps->time_ssw_prune)
+
 #if defined MPIV && !defined CUDA_MPIV
     }
 #endif
@@ -196,6 +269,310 @@ void gpack_pack_pts_(double *grid_ptx, double *grid_pty, double *grid_ptz, int *
 
 }
 
+// returns per phase timings and the ss weight pruned grid size of the last packing, used for benchmarking
+void gpack_get_pack_stats_(double *tssw, double *toct, double *tprscrn, double *tpack, int *nsswpts){
+
+        *tssw    = gps->time_ssw_prune;
+        *toct    = gps->time_octree;
+        *tprscrn = gps->time_bfpf_prescreen;
+        *tpack   = gps->time_pack_output;
+        *nsswpts = gps->nsswpts;
+
+}
+
+// loads basis set & geometry information shared by packing and repacking
+void gpack_load_input(int *natoms, int *nbasis, int *maxcontract, double *DMCutoff, double *sigrad2, int *ncontract, double *aexp, double *dcoeff, int *ncenter, int *itype, double *xyz, int *nthreads){
+
+        gps->natoms      = *natoms;
+        gps->nbasis      = *nbasis;
+        gps->maxcontract = *maxcontract;
+        gps->DMCutoff    = *DMCutoff;
+
+        // use all available threads unless a thread count is requested
+#ifdef _OPENMP
+        gps->nthreads    = (*nthreads > 0) ? *nthreads : omp_get_max_threads();
+#else
+        gps->nthreads    = 1;
+#endif
+
+        gps->sigrad2     = new gpack_buffer_type<double>(sigrad2, gps->nbasis);
+        gps->ncontract   = new gpack_buffer_type<int>(ncontract, gps->nbasis);
+        gps->aexp        = new gpack_buffer_type<double>(aexp, gps->maxcontract, gps->nbasis);
+        gps->dcoeff      = new gpack_buffer_type<double>(dcoeff, gps->maxcontract, gps->nbasis);
+        gps->xyz         = new gpack_buffer_type<double>(xyz, 3, gps->natoms);
+        gps->ncenter     = new gpack_buffer_type<int>(ncenter, gps->nbasis);
+        gps->itype       = new gpack_buffer_type<int>(itype, 3, gps->nbasis);
+
+}
+
+#if !defined CUDA && !defined CUDA_MPIV
+/*Fortran accessible method to repack a displaced grid. Grid points keep the leaves of the last full pack, so the
+  octree is skipped. Basis function lists only depend on the relative positions of bin points and basis function
+  centers, hence a leaf is prescreened again only if its active points or candidates changed, or if its points and
+  candidate centers moved relative to each other by more than the slack, so that a candidate may have reached a
+  point that was outside of its sphere of significance.*/
+void gpack_repack_pts_(double *grid_ptx, double *grid_pty, double *grid_ptz, int *grid_atm, double *grid_sswt, double *grid_weight, int *arr_size, int *natoms, int *nbasis, int *maxcontract, double *DMCutoff, double *sigrad2, int *ncontract, double *aexp, double *dcoeff, int *ncenter, int *itype, double *xyz, int *nthreads, int *ngpts, int *ntgpts, int *nbins, int *nbtotbf, int *nbtotpf, double *tprscrn, int *ierr){
+
+        double start = gpack_wtime();
+
+        gps->arr_size    = *arr_size;
+
+        gpack_load_input(natoms, nbasis, maxcontract, DMCutoff, sigrad2, ncontract, aexp, dcoeff, ncenter, itype, xyz, nthreads);
+
+        // the unpruned grid is read in place, packed arrays are only created on success
+        gps->gridx = NULL;
+        gps->gridy = NULL;
+        gps->gridz = NULL;
+        gps->sswt = NULL;
+        gps->ss_weight = NULL;
+        gps->grid_atm = NULL;
+        gps->gridxb = NULL;
+        gps->gridyb = NULL;
+        gps->gridzb = NULL;
+        gps->gridb_sswt = NULL;
+        gps->gridb_weight = NULL;
+        gps->gridb_atm = NULL;
+        gps->basf = NULL;
+        gps->primf = NULL;
+        gps->basf_counter = NULL;
+        gps->primf_counter = NULL;
+        gps->bin_counter = NULL;
+
+        *ierr = 0;
+
+        if(gpr == NULL || gpr->leaves.empty() || gpr->arr_size != *arr_size || gpr->natoms != *natoms || gpr->nbasis != *nbasis || gpr->maxcontract != *maxcontract){
+                *ierr = 1;
+                return;
+        }
+
+        //A point that was pruned when the leaves were formed has no leaf to go to
+        int nlost = 0;
+
+#pragma omp parallel for reduction(+:nlost) num_threads(gps->nthreads)
+        for(int i=0; i<gps->arr_size; i++){
+                if(gpr->binned[i] == 0 && grid_weight[i] > gps->DMCutoff) nlost++;
+        }
+
+        if(nlost > 0){
+                *ierr = 1;
+                return;
+        }
+
+        //Displacement of each atom since the leaves were last visited
+        vector<double> disp(3 * gps->natoms);
+
+        for(int k=0; k<3 * gps->natoms; k++){
+                disp[k] = xyz[k] - gpr->xyz[k];
+        }
+
+        bf_cell_list bfcl;
+        build_bf_cell_list(&bfcl);
+
+        unsigned long cfwords = gpack_bitset_words(gps->nbasis);
+        unsigned long pfwords = gpack_bitset_words((unsigned long) gps->nbasis * gps->maxcontract);
+        int leaf_count = gpr->leaves.size();
+        int ndirty = 0;
+
+#pragma omp parallel num_threads(gps->nthreads) reduction(+:ndirty)
+        {
+        vector<double> lx, ly, lz;
+        vector<unsigned char> lgp;
+        vector<unsigned int> cfbits(cfwords), pfbits(pfwords);
+        vector<int> cand, atms;
+
+#pragma omp for schedule(dynamic)
+        for(int i=0; i<leaf_count; i++){
+                gpack_leaf_state *ls = &gpr->leaves[i];
+                bool dirty = false;
+
+                lx.clear();
+                ly.clear();
+                lz.clear();
+                atms.clear();
+
+                //Collect the points that pass the ss weight cutoff at this geometry
+                for(unsigned int j=0; j<ls->pts.size(); j++){
+                        int gid = ls->pts[j];
+                        unsigned char act = (grid_weight[gid] > gps->DMCutoff) ? 1 : 0;
+
+                        if(act != ls->active[j]){
+                                ls->active[j] = act;
+                                dirty = true;
+                        }
+
+                        if(act){
+                                lx.push_back(grid_ptx[gid]);
+                                ly.push_back(grid_pty[gid]);
+                                lz.push_back(grid_ptz[gid]);
+                                atms.push_back(grid_atm[gid]-1);
+                        }
+                }
+
+                get_pts_candidate_bfs(&bfcl, lx.data(), ly.data(), lz.data(), 0, lx.size(), &cand);
+
+                if(cand != ls->cand) dirty = true;
+
+                //Largest relative displacement of a parent atom and a candidate center since the last visit
+                sort(atms.begin(), atms.end());
+                atms.erase(unique(atms.begin(), atms.end()), atms.end());
+
+                double dmax2 = 0.0;
+
+                for(unsigned int k=0; k<cand.size() && !dirty; k++){
+                        int c = gps->ncenter->_cppData[cand[k]]-1;
+
+                        for(unsigned int a=0; a<atms.size(); a++){
+                                double dx = disp[0+atms[a]*3] - disp[0+c*3];
+                                double dy = disp[1+atms[a]*3] - disp[1+c*3];
+                                double dz = disp[2+atms[a]*3] - disp[2+c*3];
+                                dmax2 = max(dmax2, dx*dx+dy*dy+dz*dz);
+                        }
+                }
+
+                ls->drift += sqrt(dmax2);
+
+                if(ls->drift > ls->slack) dirty = true;
+
+                if(!dirty) continue;
+
+                ndirty++;
+
+                unsigned int nact = lx.size();
+
+                lgp.assign(nact, 1);
+                fill(cfbits.begin(), cfbits.end(), 0);
+                fill(pfbits.begin(), pfbits.end(), 0);
+
+                for(unsigned int j=0; j<nact; j++){
+                        cpu_get_primf_contraf_lists_method_new_imp(lx[j], ly[j], lz[j], lgp.data(), cfbits.data(), pfbits.data(), j, cand.data(), cand.size());
+                }
+
+                for(unsigned int j=0, c=0; j<ls->pts.size(); j++){
+                        ls->gpweight[j] = ls->active[j] ? lgp[c++] : 0;
+                }
+
+                save_leaf_state(ls, cfbits.data(), pfbits.data(), &cand, lx.data(), ly.data(), lz.data(), 0, nact);
+        }
+        }
+
+        gpr->xyz.assign(xyz, xyz + 3 * gps->natoms);
+
+#ifdef DEBUG
+        fprintf(gps->gpackDebugFile,"FILE: %s, LINE: %d, FUNCTION: %s, Number of leaves prescreened again: %i of %i \n", __FILE__, __LINE__, __func__, ndirty, leaf_count);
+#endif
+
+        //Number of significant points, contracted and primitive functions of each leaf, turned into offsets below
+        vector<unsigned int> pt_offset(leaf_count+1, 0);
+        vector<unsigned int> cf_offset(leaf_count+1, 0);
+        vector<unsigned int> pf_offset(leaf_count+1, 0);
+
+#pragma omp parallel for schedule(dynamic) num_threads(gps->nthreads)
+        for(int i=0; i<leaf_count; i++){
+                gpack_leaf_state *ls = &gpr->leaves[i];
+
+                cf_offset[i] = ls->basf.size();
+                pf_offset[i] = ls->primf.size();
+
+                if(cf_offset[i]>0){
+                        for(unsigned int j=0; j<ls->pts.size(); j++){
+                                if(ls->active[j] && ls->gpweight[j]) pt_offset[i]++;
+                        }
+                }
+        }
+
+        vector<int> sigbins;
+        sigbins.reserve(leaf_count);
+
+        unsigned int ppt_count=0;
+        unsigned int pcf_count=0;
+        unsigned int ppf_count=0;
+
+        for(int i=0; i<leaf_count; i++){
+                unsigned int npt = pt_offset[i];
+                unsigned int ncf = cf_offset[i];
+                unsigned int npf = pf_offset[i];
+
+                pt_offset[i] = ppt_count;
+                cf_offset[i] = pcf_count;
+                pf_offset[i] = ppf_count;
+
+                ppt_count += npt;
+                pcf_count += ncf;
+                ppf_count += npf;
+
+                if(ncf>0) sigbins.push_back(i);
+        }
+
+        gps->gridb_count   = ppt_count;
+        gps->nbins         = sigbins.size();
+        gps->nbtotbf       = pcf_count;
+        gps->nbtotpf       = ppf_count;
+        gps->ntgpts        = gps->gridb_count;
+
+        gps->gridxb        = new gpack_buffer_type<double>(gps->gridb_count);
+        gps->gridyb        = new gpack_buffer_type<double>(gps->gridb_count);
+        gps->gridzb        = new gpack_buffer_type<double>(gps->gridb_count);
+        gps->gridb_sswt    = new gpack_buffer_type<double>(gps->gridb_count);
+        gps->gridb_weight  = new gpack_buffer_type<double>(gps->gridb_count);
+        gps->gridb_atm     = new gpack_buffer_type<int>(gps->gridb_count);
+        gps->basf          = new gpack_buffer_type<int>(gps->nbtotbf);
+        gps->primf         = new gpack_buffer_type<int>(gps->nbtotpf);
+        gps->basf_counter  = new gpack_buffer_type<int>(gps->nbins + 1);
+        gps->primf_counter = new gpack_buffer_type<int>(gps->nbtotbf + 1);
+        gps->bin_counter   = new gpack_buffer_type<int>(gps->nbins + 1);
+
+#pragma omp parallel for schedule(dynamic) num_threads(gps->nthreads)
+        for(int b=0; b<gps->nbins; b++){
+                int i = sigbins[b];
+                gpack_leaf_state *ls = &gpr->leaves[i];
+                unsigned int k = pt_offset[i];
+
+                gps->bin_counter->_cppData[b]  = pt_offset[i];
+                gps->basf_counter->_cppData[b] = cf_offset[i];
+
+                for(unsigned int j=0; j<ls->pts.size(); j++){
+                        if(ls->active[j] && ls->gpweight[j]){
+                                int gid = ls->pts[j];
+
+                                gps->gridxb->_cppData[k]       = grid_ptx[gid];
+                                gps->gridyb->_cppData[k]       = grid_pty[gid];
+                                gps->gridzb->_cppData[k]       = grid_ptz[gid];
+                                gps->gridb_sswt->_cppData[k]   = grid_sswt[gid];
+                                gps->gridb_weight->_cppData[k] = grid_weight[gid];
+                                gps->gridb_atm->_cppData[k]    = grid_atm[gid];
+                                k++;
+                        }
+                }
+
+                for(unsigned int j=0; j<ls->basf.size(); j++){
+                        gps->basf->_cppData[cf_offset[i]+j]          = ls->basf[j];
+                        gps->primf_counter->_cppData[cf_offset[i]+j] = pf_offset[i] + ls->primf_counter[j];
+                }
+
+                for(unsigned int j=0; j<ls->primf.size(); j++){
+                        gps->primf->_cppData[pf_offset[i]+j] = ls->primf[j];
+                }
+        }
+
+        gps->bin_counter->_cppData[gps->nbins]     = ppt_count;
+        gps->basf_counter->_cppData[gps->nbins]    = pcf_count;
+        gps->primf_counter->_cppData[gps->nbtotbf] = ppf_count;
+
+        gps->time_octree = 0.0;
+        gps->time_bfpf_prescreen = gpack_wtime() - start;
+
+        PRINTOCTTIME("REPACK GRID POINTS", gps->time_bfpf_prescreen)
+
+        *ngpts   = gps->gridb_count;
+        *ntgpts  = gps->ntgpts;
+        *nbins   = gps->nbins;
+        *nbtotbf = gps->nbtotbf;
+        *nbtotpf = gps->nbtotpf;
+        *tprscrn = gps->time_bfpf_prescreen;
+
+}
+#endif
+
 //Prints the spatial grid used to generate the octree.
 void write_vmd_grid(vector<node> octree, string filename){
 
@@ -244,7 +621,7 @@ void write_vmd_grid(vector<node> octree, string filename){
 		txtOut << "draw line {" << n.xmax << " " << n.ymax << " " << n.zmax << "} {" << n.xmin << " " << n.ymax << " " << n.zmax << "} width 1 \n"; /*p7-p8*/
 		txtOut << "draw line {" << n.xmin << " " << n.ymax << " " << n.zmax << "} {" << n.xmin << " " << n.ymin << " " << n.zmax << "} width 1 \n"; /*p8-p5*/
 
-		tot_pts += n.ptlst.size();
+		tot_pts += n.end - n.begin;
 
 	}
 
@@ -254,7 +631,7 @@ void write_vmd_grid(vector<node> octree, string filename){
 }
 
 //Write a .xyz file contanining grid points
-void write_xyz(vector<node> *octree, vector<point> *ptlst, bool isptlst, string filename){
+void write_xyz(vector<node> *octree, vector<int> *ptidx, vector<point> *ptlst, bool isptlst, string filename){
 
 	ofstream txtOut;
 	//Convert the string file name into char array
@@ -270,10 +647,13 @@ void write_xyz(vector<node> *octree, vector<point> *ptlst, bool isptlst, string
 	if( isptlst == false ){
         	for(int i=0; i<octree->size();i++){
                 	node n = octree->at(i);
-			vector<point> tmp_ptlst = n.ptlst;
 
-			for(int j=0; j<tmp_ptlst.size(); j++){
-				point p = tmp_ptlst.at(j);			
+			for(int j=n.begin; j<n.end; j++){
+				int gid = ptidx->at(j);
+				point p;
+				p.x = &gps->gridx->_cppData[gid];
+				p.y = &gps->gridy->_cppData[gid];
+				p.z = &gps->gridz->_cppData[gid];
 				allpts.push_back(p);
 			}
 		}
@@ -362,7 +742,7 @@ void get_rep_pts(node *n, vector<point> *rep_pts){
 void pack_grid_pts(){
 
 
-        clock_t start, end;
+        double start, end;
         double time_octree;
 
 #if defined MPIV && !defined CUDA_MPIV
@@ -371,18 +751,29 @@ void pack_grid_pts(){
 
 	vector<node> octree;
 
+	vector<int> ptidx; // grid point indices, ordered such that each octree node owns a contiguous range
+
+	//Index basis functions by their centers, so that each bin only visits the ones that reach it
+	bf_cell_list bfcl;
+	build_bf_cell_list(&bfcl);
+
 #if defined MPIV && !defined CUDA_MPIV
     if(mpirank==0){
 #endif
 
-	start = clock();
+	start = gpack_wtime();
 
 	//Generate the octree
-        octree = generate_octree(gps, MAX_POINTS_PER_CLUSTER, OCTREE_DEPTH);
+#if defined CUDA || defined CUDA_MPIV
+        //GPU bins are padded to MAX_POINTS_PER_CLUSTER points, so they are only split by point count
+        octree = generate_octree(gps, &ptidx, MAX_POINTS_PER_CLUSTER, OCTREE_DEPTH, NULL, NULL, MIN_POINTS_PER_CLUSTER, MAX_BIN_COST);
+#else
+        octree = generate_octree(gps, &ptidx, MAX_POINTS_PER_CLUSTER, OCTREE_DEPTH, get_node_cost, &bfcl, MIN_POINTS_PER_CLUSTER, MAX_BIN_COST);
+#endif
 
-	end = clock();
+	end = gpack_wtime();
 
-	time_octree = ((double) (end - start)) / CLOCKS_PER_SEC;
+	time_octree = end - start;
 
 	PRINTOCTTIME("OCTREE ALGORITHM", time_octree)
 
@@ -394,7 +785,7 @@ void pack_grid_pts(){
 
 	vector<bflist> new_imp_bflst;
 
-	int new_imp_total_pts = gpu_get_pfbased_basis_function_lists_new_imp(&octree, &new_imp_signodes, &new_imp_bflst);
+	int new_imp_total_pts = gpu_get_pfbased_basis_function_lists_new_imp(&octree, &ptidx, &new_imp_signodes, &new_imp_bflst);
 
 #else
 
@@ -404,7 +795,7 @@ void pack_grid_pts(){
     MPI_Barrier(MPI_COMM_WORLD);
 #endif
 
-    cpu_get_pfbased_basis_function_lists_new_imp(&octree);
+    cpu_get_pfbased_basis_function_lists_new_imp(&octree, &ptidx, &bfcl);
 
 #if defined MPIV && !defined CUDA_MPIV
     delete_gpack_mpi();
@@ -417,25 +808,66 @@ void pack_grid_pts(){
 /*Prune grid points based on ss weights*/
 void get_ssw_pruned_grid(){
 
-        // initialize temporary vectors
-	vector<double> gridx_out;
-	vector<double> gridy_out;
-	vector<double> gridz_out;
-	vector<int> grid_atm_out;
-	vector<double> sswt_out;
-	vector<double> weight_out;
-
-        // screen data based on a threshold weight
-        for(int i=0;i<gps->arr_size;i++){
-                if(gps->ss_weight->_cppData[i] > gps->DMCutoff){
-
-                        gridx_out.push_back(gps->gridx->_cppData[i]);
-                        gridy_out.push_back(gps->gridy->_cppData[i]);
-                        gridz_out.push_back(gps->gridz->_cppData[i]);
-                        sswt_out.push_back(gps->sswt->_cppData[i]);
-                        weight_out.push_back(gps->ss_weight->_cppData[i]);
-                        grid_atm_out.push_back(gps->grid_atm->_cppData[i]);
+        // number of points kept by each thread, converted into output offsets below
+        vector<int> tcount(gps->nthreads+1, 0);
+
+        gpack_buffer_type<double>* gridx_out;
+        gpack_buffer_type<double>* gridy_out;
+        gpack_buffer_type<double>* gridz_out;
+        gpack_buffer_type<double>* sswt_out;
+        gpack_buffer_type<double>* weight_out;
+        gpack_buffer_type<int>* grid_atm_out;
+
+        // each thread screens a contiguous chunk of points, so the pruned grid keeps the original order
+#pragma omp parallel num_threads(gps->nthreads)
+        {
+                int tid = 0;
+                int nt  = 1;
+#ifdef _OPENMP
+                tid = omp_get_thread_num();
+                nt  = omp_get_num_threads();
+#endif
+                int ist, iend;
+                gpack_thread_range(gps->arr_size, &ist, &iend);
 
+                // screen data based on a threshold weight
+                for(int i=ist;i<iend;i++){
+                        if(gps->ss_weight->_cppData[i] > gps->DMCutoff){
+                                tcount[tid+1]++;
+                        }
+                }
+
+#pragma omp barrier
+#pragma omp single
+                {
+                        for(int t=0;t<nt;t++){
+                                tcount[t+1] += tcount[t];
+                        }
+
+                        // create new arrays based on new size
+                        gridx_out    = new gpack_buffer_type<double>(tcount[nt]);
+                        gridy_out    = new gpack_buffer_type<double>(tcount[nt]);
+                        gridz_out    = new gpack_buffer_type<double>(tcount[nt]);
+                        sswt_out     = new gpack_buffer_type<double>(tcount[nt]);
+                        weight_out   = new gpack_buffer_type<double>(tcount[nt]);
+                        grid_atm_out = new gpack_buffer_type<int>(tcount[nt]);
+
+                        if(gpr != NULL) gpr->ptid.resize(tcount[nt]);
+                }
+
+                // copy data of significant points into new arrays
+                int j = tcount[tid];
+                for(int i=ist;i<iend;i++){
+                        if(gps->ss_weight->_cppData[i] > gps->DMCutoff){
+                                gridx_out->_cppData[j]    = gps->gridx->_cppData[i];
+                                gridy_out->_cppData[j]    = gps->gridy->_cppData[i];
+                                gridz_out->_cppData[j]    = gps->gridz->_cppData[i];
+                                sswt_out->_cppData[j]     = gps->sswt->_cppData[i];
+                                weight_out->_cppData[j]   = gps->ss_weight->_cppData[i];
+                                grid_atm_out->_cppData[j] = gps->grid_atm->_cppData[i];
+                                if(gpr != NULL) gpr->ptid[j] = i;
+                                j++;
+                        }
                 }
         }
 
@@ -448,56 +880,40 @@ void get_ssw_pruned_grid(){
         delete gps->grid_atm;
 
         // set new array size
-        gps->arr_size = gridx_out.size();
-
-        // create new arrays based on new size
-        gps->gridx     = new gpack_buffer_type<double>(gps->arr_size);
-        gps->gridy     = new gpack_buffer_type<double>(gps->arr_size);
-        gps->gridz     = new gpack_buffer_type<double>(gps->arr_size);
-        gps->sswt      = new gpack_buffer_type<double>(gps->arr_size);
-        gps->ss_weight = new gpack_buffer_type<double>(gps->arr_size);
-        gps->grid_atm  = new gpack_buffer_type<int>(gps->arr_size);
-
-        // copy data from temporary vectors into arrays
-        copy(gridx_out.begin(), gridx_out.end(), gps->gridx->_cppData);
-        copy(gridy_out.begin(), gridy_out.end(), gps->gridy->_cppData);
-        copy(gridz_out.begin(), gridz_out.end(), gps->gridz->_cppData);
-        copy(sswt_out.begin(), sswt_out.end(), gps->sswt->_cppData);
-        copy(weight_out.begin(), weight_out.end(), gps->ss_weight->_cppData);
-        copy(grid_atm_out.begin(), grid_atm_out.end(), gps->grid_atm->_cppData);        
+        gps->arr_size = gridx_out->_length;
+
+        gps->gridx     = gridx_out;
+        gps->gridy     = gridy_out;
+        gps->gridz     = gridz_out;
+        gps->sswt      = sswt_out;
+        gps->ss_weight = weight_out;
+        gps->grid_atm  = grid_atm_out;
 
 }
 
 
 #if defined CUDA || defined CUDA_MPIV
-int gpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree, vector<node> *signodes, vector<bflist> *bflst){
+int gpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree, vector<int> *ptidx, vector<node> *signodes, vector<bflist> *bflst){
 
         double *gridx, *gridy, *gridz, *sswt, *weight;	                 			//Keeps all grid points
-        unsigned int *cfweight, *pfweight;   //Holds 1 or 0 depending on the significance of each candidate
+        unsigned int *cfweight, *pfweight;   //Bitsets flagging the significant candidates of each bin
 	unsigned char *gpweight;
 	int *iatm;
 
-	//get the number of octree leaves 
-	unsigned int leaf_count = 0;
+	//get the octree leaves in Morton order, bins keep this order so that consecutive bins are spatially close
+	vector<int> leaves = get_leaf_nodes(octree, OCTREE_DEPTH);
+	unsigned int leaf_count = leaves.size();
 
 #ifdef DEBUG
 	vector<node> dbg_leaf_nodes; //Store leaves for grid visialization
 	vector<node> dbg_signodes;   //Store significant nodes for grid visualization
 	vector<int>  dbg_signdidx;    //Keeps track of leaf node indices to remove
 	vector<point> dbg_pts; 	     //Keeps all pruned grid points
-#endif
 
-        for(int i=0; i<octree -> size();i++){
-
-                node n = octree->at(i);
-
-                if(n.has_children == false || n.level == OCTREE_DEPTH-1){
-			leaf_count++;
-#ifdef DEBUG
-			dbg_leaf_nodes.push_back(n);
-#endif
-		}
+	for(int i=0; i<leaf_count; i++){
+		dbg_leaf_nodes.push_back(octree->at(leaves[i]));
 	}
+#endif
 
 #ifdef DEBUG
 	fprintf(gps->gpackDebugFile,"FILE: %s, LINE: %d, FUNCTION: %s, Total number of leaf nodes: %i \n", __FILE__, __LINE__, __func__, leaf_count);
@@ -512,57 +928,49 @@ int gpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree, vector<no
 
         //bin_counter = (unsigned int*) malloc((leaf_count + 1) * sizeof(unsigned int));
         gpweight = (unsigned char*) malloc(init_arr_size * sizeof(unsigned char));
-        cfweight = (unsigned int*) malloc(leaf_count * gps->nbasis * sizeof(unsigned int));
-        pfweight = (unsigned int*) malloc(leaf_count * gps->nbasis * gps->maxcontract * sizeof(unsigned int));
+        cfweight = (unsigned int*) calloc(leaf_count * gpack_bitset_words(gps->nbasis), sizeof(unsigned int));
+        pfweight = (unsigned int*) calloc(leaf_count * gpack_bitset_words((unsigned long) gps->nbasis * gps->maxcontract), sizeof(unsigned int));
 	iatm     = (int*) malloc(init_arr_size * sizeof(int));
 
         unsigned int cgp = 0; //current grid point
 
-	clock_t start, end;
+	double start, end;
         double time_prep_gpu_input;
         double time_run_gpu;
         double time_proc_gpu_output;
 
-        start = clock();
-
-        for(int i=0; i<octree -> size();i++){
-                node n = octree->at(i);
-
-                if(n.has_children == false || n.level == OCTREE_DEPTH-1){
-                        //Get all the points in current bin
-                        vector<point> pts;
-
-                        pts = n.ptlst;
-
-                        //Go through all points in current bin
-                        unsigned int ptofcount = pts.size();
-                        for(int r=0;r<ptofcount;r++){
-                                point rp = pts.at(r);
-                                
-                                gridx[cgp] = *rp.x;
-                                gridy[cgp] = *rp.y;
-                                gridz[cgp] = *rp.z;
-				sswt[cgp]  = *rp.sswt;
-				weight[cgp]= *rp.weight;
-				iatm[cgp]  = *rp.iatm;
-
-				gpweight[cgp] = 1;
-                                cgp++;
-                        }
-
-			for(int r=ptofcount; r < MAX_POINTS_PER_CLUSTER; r++){
-				gridx[cgp] = 0.0;
-				gridy[cgp] = 0.0;
-				gridz[cgp] = 0.0;
-				sswt[cgp]  = 0.0;
-				weight[cgp]= 0.0;
-				iatm[cgp]  = 0;
+        start = gpack_wtime();
+
+        for(int i=0; i<leaf_count;i++){
+                node n = octree->at(leaves[i]);
+
+                //Go through all points in current bin
+                unsigned int ptofcount = n.end - n.begin;
+                for(int r=n.begin;r<n.end;r++){
+                        int gid = ptidx->at(r);
+                        
+                        gridx[cgp] = gps->gridx->_cppData[gid];
+                        gridy[cgp] = gps->gridy->_cppData[gid];
+                        gridz[cgp] = gps->gridz->_cppData[gid];
+			sswt[cgp]  = gps->sswt->_cppData[gid];
+			weight[cgp]= gps->ss_weight->_cppData[gid];
+			iatm[cgp]  = gps->grid_atm->_cppData[gid];
+
+			gpweight[cgp] = 1;
+                        cgp++;
+                }
 
-				gpweight[cgp] = 0;
-				cgp++;
-			}
+		for(int r=ptofcount; r < MAX_POINTS_PER_CLUSTER; r++){
+			gridx[cgp] = 0.0;
+			gridy[cgp] = 0.0;
+			gridz[cgp] = 0.0;
+			sswt[cgp]  = 0.0;
+			weight[cgp]= 0.0;
+			iatm[cgp]  = 0;
 
-                }
+			gpweight[cgp] = 0;
+			cgp++;
+		}
 
         }
 
@@ -577,123 +985,137 @@ int gpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree, vector<no
 
         fprintf(gps->gpackDebugFile,"FILE: %s, LINE: %d, FUNCTION: %s, Total number of true grid points before pruning: %i \n", __FILE__, __LINE__, __func__, init_true_gpcount);
 #endif
-	//Also set result arrays to zero
-	for(int i=0; i<leaf_count * gps->nbasis;i++){
-		cfweight[i]=0;
-		for(int j=0; j<gps->maxcontract ; j++){
-			pfweight[i*gps->maxcontract+j]=0;
-		}
-	}
-
-	
-        end = clock();
+        end = gpack_wtime();
 
-        time_prep_gpu_input = ((double) (end - start)) / CLOCKS_PER_SEC;
+        time_prep_gpu_input = end - start;
 
         PRINTOCTTIME("PRESCREEN BASIS & PRIMITIVE FUNCTIONS : PREP GPU INPUT", time_prep_gpu_input)
 
-	start = clock();
+	start = gpack_wtime();
 
         gpu_get_octree_info(gridx, gridy, gridz, gps->sigrad2->_cppData, gpweight, cfweight, pfweight, init_arr_size);
 
-	end = clock();
+	end = gpack_wtime();
 
-        time_run_gpu = ((double) (end - start)) / CLOCKS_PER_SEC;
+        time_run_gpu = end - start;
 
         PRINTOCTTIME("PRESCREEN BASIS & PRIMITIVE FUNCTIONS : GPU RUN", time_run_gpu)
 
 	gps -> time_bfpf_prescreen = time_run_gpu;
 
-	start = clock();
-
-	//pruned grid info lists
-	vector<int> pgpweight;
-	vector<double> pgridx;
-	vector<double> pgridy;
-	vector<double> pgridz;
-	vector<double> psswt;
-	vector<double> pweight;
-	vector<int> piatm;
-	vector<int> pcfweight;
-	vector<int> ppfweight;
-	vector<int> pcf_counter;
-	vector<int> ppf_counter;
-	
+	//Words per bin in the contracted & primitive function bitsets
+	unsigned long cfwords = gpack_bitset_words(gps->nbasis);
+	unsigned long pfwords = gpack_bitset_words((unsigned long) gps->nbasis * gps->maxcontract);
 
-#ifdef DEBUG
-        int dbg_totncf = 0;
-#endif
+	start = gpack_wtime();
+
+	//Number of true grid points, contracted and primitive functions of each bin, turned into offsets below
+	vector<unsigned int> pt_count(leaf_count, 0);
+	vector<unsigned int> cf_offset(leaf_count+1, 0);
+	vector<unsigned int> pf_offset(leaf_count+1, 0);
+
+#pragma omp parallel for schedule(dynamic) num_threads(gps->nthreads)
+	for(int i=0; i<leaf_count;i++){
+		get_bin_function_counts(&cfweight[i * cfwords], &pfweight[i * pfwords], &cf_offset[i], &pf_offset[i]);
+
+		for(int j=0; j< MAX_POINTS_PER_CLUSTER; j++){
+			if(gpweight[i*MAX_POINTS_PER_CLUSTER+j]>0) pt_count[i]++;
+		}
+	}
+
+	//Get the pruned grid, bins keep their padding so that each of them fills a gpu block
+	vector<int> sigbins;
+	sigbins.reserve(leaf_count);
 
 	unsigned int pcf_count=0;
 	unsigned int ppf_count=0;
+	int ntgpts = 0;
 
-	pcf_counter.push_back(pcf_count);
-	ppf_counter.push_back(ppf_count);
-
-	//Get the pruned grid
 	for(int i=0; i<leaf_count;i++){
-		int cfcount = 0;
-		for(int j=0; j<gps -> nbasis; j++){
-			if(cfweight[(i * gps -> nbasis) + j] >0){
-				cfcount++;
-#ifdef DEBUG
-				dbg_totncf++;
-#endif
-			}
-		}
+		unsigned int ncf = cf_offset[i];
+		unsigned int npf = pf_offset[i];
+
+		cf_offset[i] = pcf_count;
+		pf_offset[i] = ppf_count;
+
+		pcf_count += ncf;
+		ppf_count += npf;
+
 		//If there is at least one cf per bin, the bin is significant
-		if(cfcount>0){
-			for(int j=0; j< MAX_POINTS_PER_CLUSTER; j++){
-				pgpweight.push_back(gpweight[i*MAX_POINTS_PER_CLUSTER+j]);
-				pgridx.push_back(gridx[i*MAX_POINTS_PER_CLUSTER+j]);
-				pgridy.push_back(gridy[i*MAX_POINTS_PER_CLUSTER+j]);
-				pgridz.push_back(gridz[i*MAX_POINTS_PER_CLUSTER+j]);
-				psswt.push_back(sswt[i*MAX_POINTS_PER_CLUSTER+j]);
-				pweight.push_back(weight[i*MAX_POINTS_PER_CLUSTER+j]);
-				piatm.push_back(iatm[i*MAX_POINTS_PER_CLUSTER+j]);
-#ifdef DEBUG
-				point db_p;
-				db_p.x = &gridx[i*MAX_POINTS_PER_CLUSTER+j];
-				db_p.y = &gridy[i*MAX_POINTS_PER_CLUSTER+j];
-				db_p.z = &gridz[i*MAX_POINTS_PER_CLUSTER+j];
-				dbg_pts.push_back(db_p);				
-#endif
-			}
-		
-			//Save the corresponding contraction function list
-			for(int j=0; j<gps -> nbasis; j++){
-				if(cfweight[(i * gps -> nbasis) + j] >0){
-					pcfweight.push_back(j);
-					pcf_count++;
-					
-					//Save the corresponding primitive list
-					for(int k=0; k<gps -> maxcontract; k++){
-						if(pfweight[(i * gps -> nbasis * gps -> maxcontract) + j*gps -> maxcontract + k]>0){
-							ppfweight.push_back(k);
-							ppf_count++;
-						}
-					}
-					ppf_counter.push_back(ppf_count);
+		if(ncf>0){
+			sigbins.push_back(i);
+			ntgpts += pt_count[i];
+		}
+	}
+
+        gps->nbins         = sigbins.size();
+        gps->gridb_count   = gps->nbins * MAX_POINTS_PER_CLUSTER;
+        gps->nbtotbf       = pcf_count;
+        gps->nbtotpf       = ppf_count;
+        gps->ntgpts        = ntgpts;
+
+        gps->gridxb        = new gpack_buffer_type<double>(gps->gridb_count);
+        gps->gridyb        = new gpack_buffer_type<double>(gps->gridb_count);        
+        gps->gridzb        = new gpack_buffer_type<double>(gps->gridb_count);
+        gps->gridb_sswt    = new gpack_buffer_type<double>(gps->gridb_count);
+        gps->gridb_weight  = new gpack_buffer_type<double>(gps->gridb_count);
+        gps->gridb_atm     = new gpack_buffer_type<int>(gps->gridb_count);
+        gps->dweight       = new gpack_buffer_type<int>(gps->gridb_count);
+        gps->basf          = new gpack_buffer_type<int>(gps->nbtotbf);
+        gps->primf         = new gpack_buffer_type<int>(gps->nbtotpf);
+        gps->basf_counter  = new gpack_buffer_type<int>(gps->nbins + 1);
+        gps->primf_counter = new gpack_buffer_type<int>(gps->nbtotbf + 1);
+
+	//Each significant bin writes its points and function lists straight into the packed arrays
+#pragma omp parallel for schedule(dynamic) num_threads(gps->nthreads)
+	for(int b=0; b<gps->nbins; b++){
+		int i = sigbins[b];
+
+		for(int j=0; j< MAX_POINTS_PER_CLUSTER; j++){
+			unsigned int k = b*MAX_POINTS_PER_CLUSTER+j;
+			unsigned int r = i*MAX_POINTS_PER_CLUSTER+j;
+
+			gps->gridxb->_cppData[k]       = gridx[r];
+			gps->gridyb->_cppData[k]       = gridy[r];
+			gps->gridzb->_cppData[k]       = gridz[r];
+			gps->gridb_sswt->_cppData[k]   = sswt[r];
+			gps->gridb_weight->_cppData[k] = weight[r];
+			gps->gridb_atm->_cppData[k]    = iatm[r];
+			gps->dweight->_cppData[k]      = gpweight[r];
+		}
+
+		gps->basf_counter->_cppData[b] = cf_offset[i];
+
+		pack_bin_function_lists(&cfweight[i * cfwords], &pfweight[i * pfwords], &gps->basf->_cppData[cf_offset[i]], &gps->primf->_cppData[pf_offset[i]], &gps->primf_counter->_cppData[cf_offset[i]], pf_offset[i]);
+	}
+
+	gps->basf_counter->_cppData[gps->nbins]    = pcf_count;
+	gps->primf_counter->_cppData[gps->nbtotbf] = ppf_count;
 
-				}
-			}
-		
-			pcf_counter.push_back(pcf_count);					
 #ifdef DEBUG
-			dbg_signodes.push_back(dbg_leaf_nodes.at(i));
-#endif
+	for(int b=0; b<gps->nbins; b++){
+		int i = sigbins[b];
+
+		dbg_signodes.push_back(dbg_leaf_nodes.at(i));
 
+		for(int j=0; j< MAX_POINTS_PER_CLUSTER; j++){
+			point db_p;
+			db_p.x = &gridx[i*MAX_POINTS_PER_CLUSTER+j];
+			db_p.y = &gridy[i*MAX_POINTS_PER_CLUSTER+j];
+			db_p.z = &gridz[i*MAX_POINTS_PER_CLUSTER+j];
+			dbg_pts.push_back(db_p);
 		}
 	}
+#endif
 
 #if defined DEBUG && defined WRITE_TCL_XYZ
 
-        fprintf(gps->gpackDebugFile,"FILE: %s, LINE: %d, FUNCTION: %s, Total number of contracted functions: %i \n", __FILE__, __LINE__, __func__, pcfweight.size());
-        fprintf(gps->gpackDebugFile,"FILE: %s, LINE: %d, FUNCTION: %s, Total number of primitive functions: %i \n", __FILE__, __LINE__, __func__, ppfweight.size());
+        fprintf(gps->gpackDebugFile,"FILE: %s, LINE: %d, FUNCTION: %s, Total number of contracted functions: %i \n", __FILE__, __LINE__, __func__, gps->nbtotbf);
+        fprintf(gps->gpackDebugFile,"FILE: %s, LINE: %d, FUNCTION: %s, Total number of primitive functions: %i \n", __FILE__, __LINE__, __func__, gps->nbtotpf);
 
 	//print grid for vmd visualization
         write_vmd_grid(dbg_leaf_nodes, "initgrid.tcl");
-        write_xyz(&dbg_leaf_nodes, NULL, false, "initgpts.xyz");
+        write_xyz(&dbg_leaf_nodes, ptidx, NULL, false, "initgpts.xyz");
 
 	//dbg_signodes = dbg_leaf_nodes;
 	//write first 3 levels of the octree for vmd visualization
@@ -720,50 +1142,9 @@ int gpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree, vector<no
 
 	//Prints only the significant bins and points 
 	write_vmd_grid(dbg_signodes, "pgrid.tcl");
-	write_xyz(NULL, &dbg_pts, true, "bgpts.xyz");
+	write_xyz(NULL, NULL, &dbg_pts, true, "bgpts.xyz");
 #endif
 
-	//Convert lists into arrays
-         
-        gps->gridb_count   = pgpweight.size();
-        gps->nbins         = (gps->gridb_count)/MAX_POINTS_PER_CLUSTER;
-        gps->nbtotbf       = pcfweight.size();
-        gps->nbtotpf       = ppfweight.size();
-
-        gps->gridxb        = new gpack_buffer_type<double>(gps->gridb_count);
-        gps->gridyb        = new gpack_buffer_type<double>(gps->gridb_count);        
-        gps->gridzb        = new gpack_buffer_type<double>(gps->gridb_count);
-        gps->gridb_sswt    = new gpack_buffer_type<double>(gps->gridb_count);
-        gps->gridb_weight  = new gpack_buffer_type<double>(gps->gridb_count);
-        gps->gridb_atm     = new gpack_buffer_type<int>(gps->gridb_count);
-        gps->dweight       = new gpack_buffer_type<int>(gps->gridb_count);
-        gps->basf          = new gpack_buffer_type<int>(gps->nbtotbf);
-        gps->primf         = new gpack_buffer_type<int>(gps->nbtotpf);
-        gps->basf_counter  = new gpack_buffer_type<int>(gps->nbins + 1);
-        gps->primf_counter = new gpack_buffer_type<int>(gps->nbtotbf + 1);
-
-	copy(pgridx.begin(), pgridx.end(), gps->gridxb->_cppData);
-	copy(pgridy.begin(), pgridy.end(), gps->gridyb->_cppData);
-	copy(pgridz.begin(), pgridz.end(), gps->gridzb->_cppData);
-	copy(psswt.begin(), psswt.end(), gps->gridb_sswt->_cppData);
-	copy(pweight.begin(), pweight.end(), gps->gridb_weight->_cppData);
-        copy(piatm.begin(), piatm.end(), gps->gridb_atm->_cppData);
-	copy(pgpweight.begin(), pgpweight.end(), gps->dweight->_cppData);
-	copy(pcfweight.begin(), pcfweight.end(), gps->basf->_cppData);
-	copy(ppfweight.begin(), ppfweight.end(), gps->primf->_cppData);
-	copy(pcf_counter.begin(), pcf_counter.end(), gps->basf_counter->_cppData);
-	copy(ppf_counter.begin(), ppf_counter.end(), gps->primf_counter->_cppData);
-
-	int ntgpts = 0;
-	for(int i=0; i<gps->gridb_count; i++){
-		if(gps->dweight->_cppData[i] > 0){
-
-			ntgpts++;
-		}
-	}
-
-        gps->ntgpts = ntgpts;
-
         free(gridx);
         free(gridy);
         free(gridz);
@@ -778,12 +1159,14 @@ int gpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree, vector<no
         fprintf(gps->gpackDebugFile,"FILE: %s, LINE: %d, FUNCTION: %s, Total number of true bins & grid points after pruning: %i %i\n", __FILE__, __LINE__, __func__, gps->nbins, gps->ntgpts);
 #endif
 
-        end = clock();
+        end = gpack_wtime();
 
-        time_proc_gpu_output = ((double) (end - start)) / CLOCKS_PER_SEC;
+        time_proc_gpu_output = end - start;
 
         PRINTOCTTIME("PRESCREEN BASIS & PRIMITIVE FUNCTIONS : PROCESS GPU OUTPUT", time_proc_gpu_output)
 
+        gps -> time_pack_output = time_prep_gpu_input + time_proc_gpu_output;
+
 }
 #endif
 
@@ -791,37 +1174,27 @@ int gpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree, vector<no
 
 
 // This function prepares primitive and contracted function lists in serial and mpi versions
-void cpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree){
+void cpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree, vector<int> *ptidx, bf_cell_list *bfcl){
 
         double *gridx, *gridy, *gridz, *sswt, *weight;                                          //Keeps all grid points
-        unsigned int *cfweight, *pfweight;   //Holds 1 or 0 depending on the significance of each candidate
+        unsigned int *cfweight, *pfweight;   //Bitsets flagging the significant candidates of each bin
 	unsigned int *bs_tracker;  //Keeps track of bin sizes 
         unsigned char *gpweight;
         int *iatm; 
 
-	unsigned char *tmp_gpweight;
-	unsigned int *tmp_cfweight, *tmp_pfweight;
-        //get the number of octree leaves 
-        unsigned int leaf_count = 0;
+        //get the octree leaves in Morton order, bins keep this order so that consecutive bins are spatially close
+        vector<int> leaves = get_leaf_nodes(octree, OCTREE_DEPTH);
+        unsigned int leaf_count = leaves.size();
 
 #ifdef CBFPF_DEBUG
         vector<node> dbg_leaf_nodes; //Store leaves for grid visualization
         vector<node> dbg_signodes;   //Store significant nodes for grid visualization
-        vector<int>  dbg_signdidx;    //Keeps track of leaf node indices to remove
         vector<point> dbg_pts;       //Keeps all pruned grid points
-#endif
-
-        for(int i=0; i<octree -> size();i++){
 
-                node n = octree->at(i);
-
-                if(n.has_children == false || n.level == OCTREE_DEPTH-1){
-                        leaf_count++;
-#ifdef CBFPF_DEBUG
-                        dbg_leaf_nodes.push_back(n);
-#endif
-                }
+        for(int i=0; i<leaf_count; i++){
+                dbg_leaf_nodes.push_back(octree->at(leaves[i]));
         }
+#endif
 
 #ifdef CBFPF_DEBUG
         fprintf(gps->gpackDebugFile,"FILE: %s, LINE: %d, FUNCTION: %s, Total number of leaf nodes: %i \n", __FILE__, __LINE__, __func__, leaf_count);
@@ -838,21 +1211,21 @@ void cpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree){
 #if defined MPIV && !defined CUDA_MPIV
         MPI_Bcast(&leaf_count, 1, MPI_INT, 0, MPI_COMM_WORLD); 
 #endif
-	tmp_gpweight = (unsigned char*) malloc(init_arr_size * sizeof(unsigned char));
-	tmp_cfweight = (unsigned int*) malloc(leaf_count * gps->nbasis * sizeof(unsigned int));
-	tmp_pfweight = (unsigned int*) malloc(leaf_count * gps->nbasis * gps->maxcontract * sizeof(unsigned int));
 
-        //bin_counter = (unsigned int*) malloc((leaf_count + 1) * sizeof(unsigned int));
+        //Words per bin in the contracted & primitive function bitsets
+        unsigned long cfwords = gpack_bitset_words(gps->nbasis);
+        unsigned long pfwords = gpack_bitset_words((unsigned long) gps->nbasis * gps->maxcontract);
+
         gpweight = (unsigned char*) malloc(init_arr_size * sizeof(unsigned char));
-        cfweight = (unsigned int*) malloc(leaf_count * gps->nbasis * sizeof(unsigned int));
-        pfweight = (unsigned int*) malloc(leaf_count * gps->nbasis * gps->maxcontract * sizeof(unsigned int));
+        cfweight = (unsigned int*) calloc(leaf_count * cfwords, sizeof(unsigned int));
+        pfweight = (unsigned int*) calloc(leaf_count * pfwords, sizeof(unsigned int));
         iatm     = (int*) malloc(init_arr_size * sizeof(int));
 	bs_tracker = (unsigned int*) malloc((leaf_count+1) * sizeof(unsigned int));	
 
         unsigned int cgp = 0; //current grid point
 	unsigned int cb = 0;
 
-        clock_t start, end;
+        double start, end;
         double time_prep_input;
         double run_time;
         double time_proc_output;
@@ -867,79 +1240,75 @@ void cpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree){
         if(mpirank == 0){
 #endif
 
-        start = clock();
+        start = gpack_wtime();
 
 	bs_tracker[cb] = 0;
 
-        for(int i=0; i<octree -> size();i++){
-                node n = octree->at(i);
+	//Set the offset of each bin
+	for(int i=0; i<leaf_count; i++){
+		node *n = &octree->at(leaves[i]);
+		cgp += n->end - n->begin;
+		cb++;
+		bs_tracker[cb] = cgp;
+	}
 
-                if(n.has_children == false || n.level == OCTREE_DEPTH-1){
-                        //Get all the points in current bin
-                        vector<point> pts;
-
-                        pts = n.ptlst;
-
-                        //Go through all points in current bin
-                        unsigned int ptofcount = pts.size();
-                        for(int r=0;r<ptofcount;r++){
-                                point rp = pts.at(r);
-
-                                gridx[cgp] = *rp.x;
-                                gridy[cgp] = *rp.y;
-                                gridz[cgp] = *rp.z;
-                                sswt[cgp]  = *rp.sswt;
-                                weight[cgp]= *rp.weight;
-                                iatm[cgp]  = *rp.iatm;
-                                gpweight[cgp] = 1;
-				
-                                cgp++;
-                        }
-			cb++;
-			bs_tracker[cb] = cgp;
+	//Leaves remember their points in the unpruned grid if the packing state is kept
+	if(gpr != NULL) gpr->leaves.assign(leaf_count, gpack_leaf_state());
 
-                }
+	//Go through all points in each bin
+#pragma omp parallel for schedule(dynamic) num_threads(gps->nthreads)
+	for(int i=0; i<leaf_count; i++){
+		node *n = &octree->at(leaves[i]);
+		unsigned int k = bs_tracker[i];
 
-        }
+		for(int r=n->begin;r<n->end;r++){
+			int gid = ptidx->at(r);
+
+			if(gpr != NULL){
+				gpr->leaves[i].pts.push_back(gpr->ptid[gid]);
+				gpr->binned[gpr->ptid[gid]] = 1;
+			}
+
+			gridx[k] = gps->gridx->_cppData[gid];
+			gridy[k] = gps->gridy->_cppData[gid];
+			gridz[k] = gps->gridz->_cppData[gid];
+			sswt[k]  = gps->sswt->_cppData[gid];
+			weight[k]= gps->ss_weight->_cppData[gid];
+			iatm[k]  = gps->grid_atm->_cppData[gid];
+			gpweight[k] = 1;
+
+			k++;
+		}
+	}
 
 #ifdef CBFPF_DEBUG
         fprintf(gps->gpackDebugFile,"FILE: %s, LINE: %d, FUNCTION: %s, Total number of true grid points before pruning: %i \n", __FILE__, __LINE__, __func__, init_arr_size);
 #endif
-        //Also set result arrays to zero
-        for(int i=0; i<leaf_count * gps->nbasis;i++){
-                cfweight[i]=0;
-		tmp_cfweight[i]=0;
-                for(int j=0; j<gps->maxcontract ; j++){
-                        pfweight[i*gps->maxcontract+j]=0;
-			tmp_pfweight[i*gps->maxcontract+j]=0;
-                }
-        }
-
 
-        end = clock();
+        end = gpack_wtime();
 
-        time_prep_input = ((double) (end - start)) / CLOCKS_PER_SEC;
+        time_prep_input = end - start;
 
         PRINTOCTTIME("PRESCREEN BASIS & PRIMITIVE FUNCTIONS : PREP INPUT", time_prep_input)
 
-        start = clock();
+        start = gpack_wtime();
 
 #if defined MPIV && !defined CUDA_MPIV
 	}
 
-	setup_gpack_mpi_2(leaf_count, gridx, gridy, gridz, gpweight, tmp_gpweight, cfweight, tmp_cfweight, pfweight, tmp_pfweight, sswt, weight, iatm, bs_tracker);
+	setup_gpack_mpi_2(leaf_count, gridx, gridy, gridz, gpweight, sswt, weight, iatm, bs_tracker);
 
 #endif
 
 #if defined MPIV && !defined CUDA_MPIV
 	if(mpirank == 0){
-	end = clock();
+	end = gpack_wtime();
 
-        mpi_prep_time = ((double) (end - start)) / CLOCKS_PER_SEC;
+        mpi_prep_time = end - start;
 
         PRINTOCTTIME("PRESCREEN BASIS & PRIMITIVE FUNCTIONS : BROADCAST INPUT", mpi_prep_time)
 
-	start = clock();
+	start = gpack_wtime();
 	}
 
 #endif
@@ -954,21 +1323,31 @@ void cpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree){
         bend=leaf_count;        
 #endif
 
-	for(unsigned int i=bstart; i< bend; i++){
+	//Bins write to disjoint parts of the weight arrays, so they are prescreened concurrently
+#pragma omp parallel num_threads(gps->nthreads)
+	{
+	vector<int> cand;
+
+#pragma omp for schedule(dynamic)
+	for(int i=bstart; i< bend; i++){
+
+		get_pts_candidate_bfs(bfcl, gridx, gridy, gridz, bs_tracker[i], bs_tracker[i+1], &cand);
+
 		for(unsigned int j=bs_tracker[i]; j<bs_tracker[i+1]; j++){
-			cpu_get_primf_contraf_lists_method_new_imp(gridx[j], gridy[j], gridz[j], gpweight, cfweight, pfweight, i, j);	
+			cpu_get_primf_contraf_lists_method_new_imp(gridx[j], gridy[j], gridz[j], gpweight, &cfweight[i * cfwords], &pfweight[i * pfwords], j, cand.data(), cand.size());	
 		}	
 	}
+	}
 
 #if defined MPIV && !defined CUDA_MPIV
         if(mpirank == 0){
-        end = clock();
+        end = gpack_wtime();
 
-        mpi_run_time = ((double) (end - start)) / CLOCKS_PER_SEC;
+        mpi_run_time = end - start;
 
         PRINTOCTTIME("PRESCREEN BASIS & PRIMITIVE FUNCTIONS : RUN TIME", mpi_run_time)
         
-        start = clock();
+        start = gpack_wtime();
         }
 
 #endif
@@ -977,136 +1356,163 @@ void cpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree){
 
 #if defined MPIV && !defined CUDA_MPIV
         
-        get_slave_primf_contraf_lists(leaf_count, gpweight, tmp_gpweight, cfweight, tmp_cfweight, pfweight, tmp_pfweight, bs_tracker);
+        get_slave_primf_contraf_lists(leaf_count, gpweight, cfweight, pfweight, cfwords, pfwords);
 
         if(mpirank == 0){
 
-	  end = clock();
+	  end = gpack_wtime();
 
-	  mpi_post_proc_time = ((double) (end - start)) / CLOCKS_PER_SEC;
+	  mpi_post_proc_time = end - start;
 
           PRINTOCTTIME("PRESCREEN BASIS & PRIMITIVE FUNCTIONS : PROCESS OUTPUT", mpi_post_proc_time)
 
 	  gps -> time_bfpf_prescreen = mpi_post_proc_time+mpi_run_time+mpi_prep_time;
 #else
 
-          end = clock();
+          end = gpack_wtime();
 
-          run_time = ((double) (end - start)) / CLOCKS_PER_SEC;
+          run_time = end - start;
 
 	  PRINTOCTTIME("PRESCREEN BASIS & PRIMITIVE FUNCTIONS : RUN TIME", run_time)        
 
           gps -> time_bfpf_prescreen = run_time;
 #endif
-          start = clock();
-
-          //pruned grid info lists
-          vector<int> pgpweight;
-          vector<double> pgridx;
-          vector<double> pgridy;
-          vector<double> pgridz;
-          vector<double> psswt;
-          vector<double> pweight;
-          vector<int> piatm;
-          vector<int> pcfweight;
-          vector<int> ppfweight;
-          vector<int> pcf_counter;
-          vector<int> ppf_counter;
-	  vector<int> pbs_tracker;
+          start = gpack_wtime();
 
+          //Number of significant points, contracted and primitive functions of each bin, turned into offsets below
+          vector<unsigned int> pt_offset(leaf_count+1, 0);
+          vector<unsigned int> cf_offset(leaf_count+1, 0);
+          vector<unsigned int> pf_offset(leaf_count+1, 0);
 
-#ifdef CBFPF_DEBUG
-          int dbg_totncf = 0;
-#endif
+#pragma omp parallel for schedule(dynamic) num_threads(gps->nthreads)
+          for(int i=0; i<leaf_count;i++){
+                  get_bin_function_counts(&cfweight[i * cfwords], &pfweight[i * pfwords], &cf_offset[i], &pf_offset[i]);
+
+                  //If there is at least one cf per bin, the bin is significant
+                  if(cf_offset[i]>0){
+                          for(unsigned int j=bs_tracker[i]; j< bs_tracker[i+1]; j++){
+                                  if(gpweight[j]>0) pt_offset[i]++;
+                          }
+                  }
+          }
+
+          //Get the pruned grid
+          vector<int> sigbins;
+          sigbins.reserve(leaf_count);
 
+          unsigned int ppt_count=0;
           unsigned int pcf_count=0;
           unsigned int ppf_count=0;
-	  unsigned int ppt_count=0;
 
-          pcf_counter.push_back(pcf_count);
-          ppf_counter.push_back(ppf_count);
-	  pbs_tracker.push_back(ppt_count);	
-
-          //Get the pruned grid
           for(int i=0; i<leaf_count;i++){
-                  int cfcount = 0;
-                  for(int j=0; j<gps -> nbasis; j++){
-                          if(cfweight[(i * gps -> nbasis) + j] >0){
-                                  cfcount++;
-#ifdef CBFPF_DEBUG
-                                  dbg_totncf++;
-#endif
-                          }
-                  }
-                  //If there is at least one cf per bin, the bin is significant
-                  if(cfcount>0){
-
-                        for(int j=bs_tracker[i]; j< bs_tracker[i+1]; j++){
-		  		if(gpweight[j]>0){				
-                                  	pgridx.push_back(gridx[j]);
-                                	pgridy.push_back(gridy[j]);
-                                	pgridz.push_back(gridz[j]);
-                                	psswt.push_back(sswt[j]);
-                                	pweight.push_back(weight[j]);
-                                	piatm.push_back(iatm[j]);
-					ppt_count++;
-#ifdef CBFPF_DEBUG
-                                	point db_p;
-                                	db_p.x = &gridx[j];
-                                	db_p.y = &gridy[j];
-                                	db_p.z = &gridz[j];
-                                	dbg_pts.push_back(db_p);
-#endif
-				}
-                        }
+                  unsigned int npt = pt_offset[i];
+                  unsigned int ncf = cf_offset[i];
+                  unsigned int npf = pf_offset[i];
 
-			pbs_tracker.push_back(ppt_count);
+                  pt_offset[i] = ppt_count;
+                  cf_offset[i] = pcf_count;
+                  pf_offset[i] = ppf_count;
 
-                        //Save the corresponding contraction function list
-                        for(int j=0; j<gps -> nbasis; j++){
-                                if(cfweight[(i * gps -> nbasis) + j] >0){
-                                        pcfweight.push_back(j);
-                                        pcf_count++;
+                  ppt_count += npt;
+                  pcf_count += ncf;
+                  ppf_count += npf;
 
-                                        //Save the corresponding primitive list
-                                        for(int k=0; k<gps -> maxcontract; k++){
-                                                if(pfweight[(i * gps -> nbasis * gps -> maxcontract) + j*gps -> maxcontract + k]>0){
-                                                        ppfweight.push_back(k);
-                                                        ppf_count++;
-                                                }
-                                        }
-                                        ppf_counter.push_back(ppf_count);
+                  if(ncf>0) sigbins.push_back(i);
+          }
 
-                                }
-                        }
+          gps->gridb_count   = ppt_count;
+          gps->nbins         = sigbins.size();
+          gps->nbtotbf       = pcf_count;
+          gps->nbtotpf       = ppf_count;
+          gps->ntgpts        = gps->gridb_count;
 
-                        pcf_counter.push_back(pcf_count);
-#ifdef CBFPF_DEBUG
-                        dbg_signodes.push_back(dbg_leaf_nodes.at(i));
+          gps->gridxb        = new gpack_buffer_type<double>(gps->gridb_count);
+          gps->gridyb        = new gpack_buffer_type<double>(gps->gridb_count);
+          gps->gridzb        = new gpack_buffer_type<double>(gps->gridb_count);
+          gps->gridb_sswt    = new gpack_buffer_type<double>(gps->gridb_count);
+          gps->gridb_weight  = new gpack_buffer_type<double>(gps->gridb_count);
+          gps->gridb_atm     = new gpack_buffer_type<int>(gps->gridb_count);
+          gps->basf          = new gpack_buffer_type<int>(gps->nbtotbf);
+          gps->primf         = new gpack_buffer_type<int>(gps->nbtotpf);
+          gps->basf_counter  = new gpack_buffer_type<int>(gps->nbins + 1);
+          gps->primf_counter = new gpack_buffer_type<int>(gps->nbtotbf + 1);
+          gps->bin_counter   = new gpack_buffer_type<int>(gps->nbins + 1);
 
-                        for(int j=0; j<gps -> nbasis; j++){
+          //Each significant bin writes its points and function lists straight into the packed arrays
+#pragma omp parallel for schedule(dynamic) num_threads(gps->nthreads)
+          for(int b=0; b<gps->nbins; b++){
+                  int i = sigbins[b];
+                  unsigned int k = pt_offset[i];
+
+                  gps->bin_counter->_cppData[b]  = pt_offset[i];
+                  gps->basf_counter->_cppData[b] = cf_offset[i];
+
+                  for(unsigned int j=bs_tracker[i]; j< bs_tracker[i+1]; j++){
+                          if(gpweight[j]>0){
+                                  gps->gridxb->_cppData[k]       = gridx[j];
+                                  gps->gridyb->_cppData[k]       = gridy[j];
+                                  gps->gridzb->_cppData[k]       = gridz[j];
+                                  gps->gridb_sswt->_cppData[k]   = sswt[j];
+                                  gps->gridb_weight->_cppData[k] = weight[j];
+                                  gps->gridb_atm->_cppData[k]    = iatm[j];
+                                  k++;
+                          }
+                  }
 
-                                //Save the corresponding primitive list
-                                for(int k=0; k<gps -> maxcontract; k++){
-//					printf("Debugging cpu vs gpu Leaf: %i bfct: %i pfct: %i \n", i, cfweight[(i * gps -> nbasis) + j], pfweight[(i * gps -> nbasis * gps -> maxcontract) + j*gps -> maxcontract + k]);
-                                }
+                  pack_bin_function_lists(&cfweight[i * cfwords], &pfweight[i * pfwords], &gps->basf->_cppData[cf_offset[i]], &gps->primf->_cppData[pf_offset[i]], &gps->primf_counter->_cppData[cf_offset[i]], pf_offset[i]);
+          }
 
-                        }
+          gps->bin_counter->_cppData[gps->nbins]     = ppt_count;
+          gps->basf_counter->_cppData[gps->nbins]    = pcf_count;
+          gps->primf_counter->_cppData[gps->nbtotbf] = ppf_count;
 
-#endif
+          //Keep the prescreening results of each leaf for repacking
+          if(gpr != NULL){
+#pragma omp parallel num_threads(gps->nthreads)
+                  {
+                  vector<int> cand;
+
+#pragma omp for schedule(dynamic)
+                  for(int i=0; i<leaf_count; i++){
+                          gpack_leaf_state *ls = &gpr->leaves[i];
+
+                          get_pts_candidate_bfs(bfcl, gridx, gridy, gridz, bs_tracker[i], bs_tracker[i+1], &cand);
+
+                          ls->active.assign(ls->pts.size(), 1);
+                          ls->gpweight.assign(&gpweight[bs_tracker[i]], &gpweight[bs_tracker[i+1]]);
 
+                          save_leaf_state(ls, &cfweight[i * cfwords], &pfweight[i * pfwords], &cand, gridx, gridy, gridz, bs_tracker[i], bs_tracker[i+1]);
+                  }
                   }
           }
 
+#ifdef CBFPF_DEBUG
+          for(int b=0; b<gps->nbins; b++){
+                  int i = sigbins[b];
+
+                  dbg_signodes.push_back(dbg_leaf_nodes.at(i));
+
+                  for(unsigned int j=bs_tracker[i]; j< bs_tracker[i+1]; j++){
+                          if(gpweight[j]>0){
+                                  point db_p;
+                                  db_p.x = &gridx[j];
+                                  db_p.y = &gridy[j];
+                                  db_p.z = &gridz[j];
+                                  dbg_pts.push_back(db_p);
+                          }
+                  }
+          }
+#endif
+
 #if defined DEBUG && defined WRITE_TCL_XYZ
 
-          fprintf(gps->gpackDebugFile,"FILE: %s, LINE: %d, FUNCTION: %s, Total number of contracted functions: %i \n", __FILE__, __LINE__, __func__, pcfweight.size());
-          fprintf(gps->gpackDebugFile,"FILE: %s, LINE: %d, FUNCTION: %s, Total number of primitive functions: %i \n", __FILE__, __LINE__, __func__, ppfweight.size());
+          fprintf(gps->gpackDebugFile,"FILE: %s, LINE: %d, FUNCTION: %s, Total number of contracted functions: %i \n", __FILE__, __LINE__, __func__, gps->nbtotbf);
+          fprintf(gps->gpackDebugFile,"FILE: %s, LINE: %d, FUNCTION: %s, Total number of primitive functions: %i \n", __FILE__, __LINE__, __func__, gps->nbtotpf);
 
 
           //print grid for vmd visualization
           write_vmd_grid(dbg_leaf_nodes, "initgrid.tcl");
-          write_xyz(&dbg_leaf_nodes, NULL, false, "initgpts.xyz");
+          write_xyz(&dbg_leaf_nodes, ptidx, NULL, false, "initgpts.xyz");
 
           //dbg_signodes = dbg_leaf_nodes;
           //write first 3 levels of the octree for vmd visualization
@@ -1133,52 +1539,21 @@ void cpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree){
 
           //Prints only the significant bins and points 
           write_vmd_grid(dbg_signodes, "pgrid.tcl");
-          write_xyz(NULL, &dbg_pts, true, "bgpts.xyz");
+          write_xyz(NULL, NULL, &dbg_pts, true, "bgpts.xyz");
 #endif
 
-          //Convert lists into arrays
-//        int pgridinfo_arr_size = ppt_count;
-
-          gps->gridb_count   = ppt_count;
-          gps->nbins         = pbs_tracker.size() - 1;
-          gps->nbtotbf       = pcfweight.size();
-          gps->nbtotpf       = ppfweight.size();
-          gps->ntgpts        = gps->gridb_count;
-
-          gps->gridxb        = new gpack_buffer_type<double>(gps->gridb_count);
-          gps->gridyb        = new gpack_buffer_type<double>(gps->gridb_count);
-          gps->gridzb        = new gpack_buffer_type<double>(gps->gridb_count);
-          gps->gridb_sswt    = new gpack_buffer_type<double>(gps->gridb_count);
-          gps->gridb_weight  = new gpack_buffer_type<double>(gps->gridb_count);
-          gps->gridb_atm     = new gpack_buffer_type<int>(gps->gridb_count);
-          gps->basf          = new gpack_buffer_type<int>(gps->nbtotbf);
-          gps->primf         = new gpack_buffer_type<int>(gps->nbtotpf);
-          gps->basf_counter  = new gpack_buffer_type<int>(gps->nbins + 1);
-          gps->primf_counter = new gpack_buffer_type<int>(gps->nbtotbf + 1);
-          gps->bin_counter   = new gpack_buffer_type<int>(gps->nbins + 1);
-
-          copy(pgridx.begin(), pgridx.end(), gps->gridxb->_cppData);
-          copy(pgridy.begin(), pgridy.end(), gps->gridyb->_cppData);
-          copy(pgridz.begin(), pgridz.end(), gps->gridzb->_cppData);
-          copy(psswt.begin(), psswt.end(), gps->gridb_sswt->_cppData);
-          copy(pweight.begin(), pweight.end(), gps->gridb_weight->_cppData);
-          copy(piatm.begin(), piatm.end(), gps->gridb_atm->_cppData);
-          copy(pcfweight.begin(), pcfweight.end(), gps->basf->_cppData);
-          copy(ppfweight.begin(), ppfweight.end(), gps->primf->_cppData);
-          copy(pcf_counter.begin(), pcf_counter.end(), gps->basf_counter->_cppData);
-          copy(ppf_counter.begin(), ppf_counter.end(), gps->primf_counter->_cppData);
-	  copy(pbs_tracker.begin(), pbs_tracker.end(), gps->bin_counter->_cppData);
-
 #ifdef DEBUG
           fprintf(gps->gpackDebugFile,"FILE: %s, LINE: %d, FUNCTION: %s, Total number of true bins & grid points after pruning: %i %i\n", __FILE__, __LINE__, __func__, gps->nbins, gps->ntgpts);
 #endif
 
-          end = clock();
+          end = gpack_wtime();
 
-          time_proc_output = ((double) (end - start)) / CLOCKS_PER_SEC;
+          time_proc_output = end - start;
 
           PRINTOCTTIME("PRESCREEN BASIS & PRIMITIVE FUNCTIONS : PROCESS OUTPUT", time_proc_output)
 
+          gps -> time_pack_output = time_prep_input + time_proc_output;
+
 #if defined MPIV && !defined CUDA_MPIV
 	}
 #endif
@@ -1194,24 +1569,259 @@ void cpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree){
         free(bs_tracker);
         free(iatm);
 
-	free(tmp_gpweight);
-	free(tmp_cfweight);
-	free(tmp_pfweight);
+}
+
+// Counts the significant contracted functions of a bin and their significant primitives
+void get_bin_function_counts(unsigned int *cfbits, unsigned int *pfbits, unsigned int *ncf, unsigned int *npf){
+
+        unsigned int cfcount = 0;
+        unsigned int pfcount = 0;
+
+        for(int j=0; j<gps -> nbasis; j++){
+                if(gpack_test_bit(cfbits, j)){
+                        cfcount++;
+
+                        for(int k=0; k<gps -> maxcontract; k++){
+                                if(gpack_test_bit(pfbits, (unsigned long) j * gps -> maxcontract + k)) pfcount++;
+                        }
+                }
+        }
+
+        *ncf = cfcount;
+        *npf = pfcount;
+}
+
+// Writes the contracted and primitive function lists of a bin, primf_counter entries are offset by pfstart
+void pack_bin_function_lists(unsigned int *cfbits, unsigned int *pfbits, int *basf, int *primf, int *primf_counter, int pfstart){
+
+        int cfcount = 0;
+        int pfcount = 0;
+
+        for(int j=0; j<gps -> nbasis; j++){
+                if(gpack_test_bit(cfbits, j)){
+                        basf[cfcount] = j;
+                        primf_counter[cfcount] = pfstart + pfcount;
+                        cfcount++;
+
+                        for(int k=0; k<gps -> maxcontract; k++){
+                                if(gpack_test_bit(pfbits, (unsigned long) j * gps -> maxcontract + k)){
+                                        primf[pfcount] = k;
+                                        pfcount++;
+                                }
+                        }
+                }
+        }
+}
+
+// Keeps the function lists and candidate basis functions of a leaf. The slack is the smallest distance by which a
+// candidate misses the sphere of significance at a leaf point, a candidate outside of the sphere at a point stays
+// out of it as long as the point and the center move relative to each other by less than that.
+void save_leaf_state(gpack_leaf_state *ls, unsigned int *cfbits, unsigned int *pfbits, vector<int> *cand, double *gridx, double *gridy, double *gridz, unsigned int pstart, unsigned int pend){
+
+        unsigned int ncf, npf;
 
+        get_bin_function_counts(cfbits, pfbits, &ncf, &npf);
+
+        ls->basf.resize(ncf);
+        ls->primf.resize(npf);
+        ls->primf_counter.resize(ncf + 1);
+
+        pack_bin_function_lists(cfbits, pfbits, ls->basf.data(), ls->primf.data(), ls->primf_counter.data(), 0);
+
+        ls->primf_counter[ncf] = npf;
+
+        ls->cand = *cand;
+        ls->drift = 0.0;
+
+        ls->slack = DBL_MAX;
+
+        for(unsigned int k=0; k<cand->size(); k++){
+                int ibas = cand->at(k);
+                unsigned int nc = gps->ncenter->_cppData[ibas]-1;
+                double rad = sqrt(gps->sigrad2->_cppData[ibas]);
+
+                for(unsigned int j=pstart; j<pend; j++){
+                        double x1 = gridx[j] - gps->xyz->_cppData[0+nc*3];
+                        double y1 = gridy[j] - gps->xyz->_cppData[1+nc*3];
+                        double z1 = gridz[j] - gps->xyz->_cppData[2+nc*3];
+                        double dist2 = x1*x1+y1*y1+z1*z1;
+
+                        if(dist2 > gps->sigrad2->_cppData[ibas]){
+                                ls->slack = min(ls->slack, sqrt(dist2) - rad);
+                        }
+                }
+        }
 }
 
 
 
-void cpu_get_primf_contraf_lists_method_new_imp(double gridx, double gridy, double gridz, unsigned char *gpweight, unsigned int *cfweight, unsigned int *pfweight, unsigned int bin_id, unsigned int gid){
+/*Sorts basis functions into a uniform grid of cells based on their centers. The cell edge is at least the
+  largest radius of significance, so the candidates of a bin are found in the few cells overlapping the bin.*/
+void build_bf_cell_list(bf_cell_list *bfcl){
+
+	double *xyz = gps->xyz->_cppData;
+	int *ncenter = gps->ncenter->_cppData;
+
+	//Get the extent of basis function centers and the largest radius of significance
+	unsigned int nc = ncenter[0]-1;
+	double xmax = xyz[0+nc*3];
+	double ymax = xyz[1+nc*3];
+	double zmax = xyz[2+nc*3];
+
+	bfcl->xmin = xmax;
+	bfcl->ymin = ymax;
+	bfcl->zmin = zmax;
+	bfcl->rmax = 0.0;
+
+	for(int ibas=0; ibas<gps->nbasis; ibas++){
+		nc = ncenter[ibas]-1;
+		bfcl->xmin = min(bfcl->xmin, xyz[0+nc*3]);
+		bfcl->ymin = min(bfcl->ymin, xyz[1+nc*3]);
+		bfcl->zmin = min(bfcl->zmin, xyz[2+nc*3]);
+		xmax = max(xmax, xyz[0+nc*3]);
+		ymax = max(ymax, xyz[1+nc*3]);
+		zmax = max(zmax, xyz[2+nc*3]);
+		bfcl->rmax = max(bfcl->rmax, sqrt(gps->sigrad2->_cppData[ibas]));
+	}
+
+	//Keep the number of cells bounded when radii are small compared to the system
+	double extent = max(xmax-bfcl->xmin, max(ymax-bfcl->ymin, zmax-bfcl->zmin));
+
+	bfcl->cell_size = max(bfcl->rmax, extent/MAX_BF_CELLS_PER_DIM);
+
+	if(bfcl->cell_size <= 0.0){
+		bfcl->cell_size = 1.0;
+	}
+
+	bfcl->nx = (int)((xmax-bfcl->xmin)/bfcl->cell_size)+1;
+	bfcl->ny = (int)((ymax-bfcl->ymin)/bfcl->cell_size)+1;
+	bfcl->nz = (int)((zmax-bfcl->zmin)/bfcl->cell_size)+1;
+
+	//Count basis functions per cell, convert counts into offsets and fill the cells
+	int ncells = bfcl->nx*bfcl->ny*bfcl->nz;
+	vector<int> cell_id(gps->nbasis);
+
+	bfcl->cell_counter.assign(ncells+1, 0);
+	bfcl->bfs.resize(gps->nbasis);
+
+	for(int ibas=0; ibas<gps->nbasis; ibas++){
+		nc = ncenter[ibas]-1;
+		int ix = min((int)((xyz[0+nc*3]-bfcl->xmin)/bfcl->cell_size), bfcl->nx-1);
+		int iy = min((int)((xyz[1+nc*3]-bfcl->ymin)/bfcl->cell_size), bfcl->ny-1);
+		int iz = min((int)((xyz[2+nc*3]-bfcl->zmin)/bfcl->cell_size), bfcl->nz-1);
+		cell_id[ibas] = (iz*bfcl->ny+iy)*bfcl->nx+ix;
+		bfcl->cell_counter[cell_id[ibas]+1]++;
+	}
+
+	for(int c=0; c<ncells; c++){
+		bfcl->cell_counter[c+1] += bfcl->cell_counter[c];
+	}
+
+	vector<int> fill(bfcl->cell_counter.begin(), bfcl->cell_counter.end()-1);
+
+	for(int ibas=0; ibas<gps->nbasis; ibas++){
+		bfcl->bfs[fill[cell_id[ibas]]++] = ibas;
+	}
+
+}
+
+/*Estimated xc cost of an octree node from its number of points and the basis functions that may reach its box*/
+double get_node_cost(node *n, void *data){
+
+	vector<int> cand;
+	get_bin_candidate_bfs((bf_cell_list*) data, n->xmin, n->xmax, n->ymin, n->ymax, n->zmin, n->zmax, &cand);
+
+	return gpack_bin_cost(n->end - n->begin, cand.size());
+
+}
+
+/*Collects the candidate basis functions of the points pstart to pend-1 through their bounding box*/
+void get_pts_candidate_bfs(bf_cell_list *bfcl, double *gridx, double *gridy, double *gridz, unsigned int pstart, unsigned int pend, vector<int> *cand){
+
+	if(pstart >= pend){
+		cand->clear();
+		return;
+	}
+
+	double bxmin = gridx[pstart], bxmax = bxmin;
+	double bymin = gridy[pstart], bymax = bymin;
+	double bzmin = gridz[pstart], bzmax = bzmin;
+
+	for(unsigned int j=pstart+1; j<pend; j++){
+		bxmin = min(bxmin, gridx[j]);
+		bxmax = max(bxmax, gridx[j]);
+		bymin = min(bymin, gridy[j]);
+		bymax = max(bymax, gridy[j]);
+		bzmin = min(bzmin, gridz[j]);
+		bzmax = max(bzmax, gridz[j]);
+	}
+
+	get_bin_candidate_bfs(bfcl, bxmin, bxmax, bymin, bymax, bzmin, bzmax, cand);
+
+}
+
+/*Collects basis functions whose sphere of significance intersects the given box into cand, in ascending
+  order. Any basis function that is significant at a point inside the box is guaranteed to be included.*/
+void get_bin_candidate_bfs(bf_cell_list *bfcl, double xmin, double xmax, double ymin, double ymax, double zmin, double zmax, vector<int> *cand){
+
+	double *xyz = gps->xyz->_cppData;
+	int *ncenter = gps->ncenter->_cppData;
+
+	cand->clear();
+
+	//Range of cells overlapping the box extended by the largest radius
+	int ixmin = max((int)floor((xmin-bfcl->rmax-bfcl->xmin)/bfcl->cell_size), 0);
+	int iymin = max((int)floor((ymin-bfcl->rmax-bfcl->ymin)/bfcl->cell_size), 0);
+	int izmin = max((int)floor((zmin-bfcl->rmax-bfcl->zmin)/bfcl->cell_size), 0);
+	int ixmax = min((int)floor((xmax+bfcl->rmax-bfcl->xmin)/bfcl->cell_size), bfcl->nx-1);
+	int iymax = min((int)floor((ymax+bfcl->rmax-bfcl->ymin)/bfcl->cell_size), bfcl->ny-1);
+	int izmax = min((int)floor((zmax+bfcl->rmax-bfcl->zmin)/bfcl->cell_size), bfcl->nz-1);
+
+	for(int iz=izmin; iz<=izmax; iz++){
+		for(int iy=iymin; iy<=iymax; iy++){
+			for(int ix=ixmin; ix<=ixmax; ix++){
+
+				int c = (iz*bfcl->ny+iy)*bfcl->nx+ix;
+
+				for(int k=bfcl->cell_counter[c]; k<bfcl->cell_counter[c+1]; k++){
+
+					int ibas = bfcl->bfs[k];
+					unsigned int nc = ncenter[ibas]-1;
+					double cx = xyz[0+nc*3];
+					double cy = xyz[1+nc*3];
+					double cz = xyz[2+nc*3];
+
+					//Distance between the basis function center and the closest point of the box
+					double dx = 0.0, dy = 0.0, dz = 0.0;
+
+					if(cx < xmin) dx = xmin - cx; else if(cx > xmax) dx = cx - xmax;
+					if(cy < ymin) dy = ymin - cy; else if(cy > ymax) dy = cy - ymax;
+					if(cz < zmin) dz = zmin - cz; else if(cz > zmax) dz = cz - zmax;
+
+					if(dx*dx+dy*dy+dz*dz <= gps->sigrad2->_cppData[ibas]){
+						cand->push_back(ibas);
+					}
+				}
+			}
+		}
+	}
+
+	sort(cand->begin(), cand->end());
+
+}
+
+void cpu_get_primf_contraf_lists_method_new_imp(double gridx, double gridy, double gridz, unsigned char *gpweight, unsigned int *cfweight, unsigned int *pfweight, unsigned int gid, int *cand, int ncand){
 
         unsigned int sigcfcount=0;
 
         // relative coordinates between grid point and basis function I.
+        // only the candidates of the bin are visited, others are not significant at this point.
 
-        for(int ibas=0; ibas<gps->nbasis;ibas++){
+        for(int icand=0; icand<ncand; icand++){
+
+		int ibas = cand[icand];
 
 		unsigned int nc = (gps->ncenter->_cppData[ibas])-1;
-                unsigned long cfwid = bin_id * gps->nbasis + ibas; //Change here
         	double x1 = gridx - gps->xyz->_cppData[0+nc*3];
         	double y1 = gridy - gps->xyz->_cppData[1+nc*3];
         	double z1 = gridz - gps->xyz->_cppData[2+nc*3];
@@ -1264,7 +1874,7 @@ void cpu_get_primf_contraf_lists_method_new_imp(double gridx, double gridy, doub
                                }
                                for(int kprim=0; kprim< gps->ncontract->_cppData[ibas]; kprim++){
 
-                                       unsigned long pfwid = bin_id * gps->nbasis * gps->maxcontract + ibas * gps->maxcontract + kprim; //Change
+                                       unsigned long pfwid = (unsigned long) ibas * gps->maxcontract + kprim;
 				       double alpha = gps->aexp->_cppData[kprim + ibas * gps->maxcontract];
 				       double tmp = (gps->dcoeff->_cppData[kprim + ibas * gps->maxcontract]) * exp( -alpha * dist);
 
@@ -1279,7 +1889,7 @@ void cpu_get_primf_contraf_lists_method_new_imp(double gridx, double gridy, doub
 
                                        //Check the significance of the primitive
                                        if(abs(tmp+tmpdx+tmpdy+tmpdz) > gps->DMCutoff){
-                                               pfweight[pfwid] += 1;
+                                               gpack_set_bit(pfweight, pfwid);
                                        }
                                }
 
@@ -1291,7 +1901,7 @@ void cpu_get_primf_contraf_lists_method_new_imp(double gridx, double gridy, doub
                        }
 
                        if (abs(phi+dphidx+dphidy+dphidz)> gps->DMCutoff ){
-                               cfweight[cfwid] += 1;
+                               gpack_set_bit(cfweight, ibas);
                                sigcfcount++;
                        }
 
@@ -1311,7 +1921,7 @@ void setup_gpack_mpi_1(){
 }
 
 
-void setup_gpack_mpi_2(unsigned int nbins, double *gridx, double *gridy, double *gridz, unsigned char *gpweight, unsigned char *tmp_gpweight, unsigned int *cfweight, unsigned int *tmp_cfweight, unsigned int *pfweight, unsigned int *tmp_pfweight, double *sswt, double *weight, int *iatm, unsigned int *bs_tracker){
+void setup_gpack_mpi_2(unsigned int nbins, double *gridx, double *gridy, double *gridz, unsigned char *gpweight, double *sswt, double *weight, int *iatm, unsigned int *bs_tracker){
 	unsigned int tmp_arr[mpisize];
 	unsigned int *tmp_mpi_binlst;
 
@@ -1360,8 +1970,6 @@ void setup_gpack_mpi_2(unsigned int nbins, double *gridx, double *gridy, double
 	MPI_Bcast(gridy, gps->arr_size, MPI_DOUBLE, 0, MPI_COMM_WORLD);
 	MPI_Bcast(gridz, gps->arr_size, MPI_DOUBLE, 0, MPI_COMM_WORLD);
 	MPI_Bcast(gpweight, gps->arr_size, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-	MPI_Bcast(cfweight, nbins*gps->nbasis, MPI_INT, 0, MPI_COMM_WORLD);
-	MPI_Bcast(pfweight, nbins*gps->nbasis*gps->maxcontract, MPI_INT, 0, MPI_COMM_WORLD);
 	MPI_Bcast(sswt, gps->arr_size, MPI_DOUBLE, 0, MPI_COMM_WORLD);
 	MPI_Bcast(weight, gps->arr_size, MPI_DOUBLE, 0, MPI_COMM_WORLD);
 	MPI_Bcast(iatm, gps->arr_size, MPI_INT, 0, MPI_COMM_WORLD);
@@ -1372,61 +1980,24 @@ void setup_gpack_mpi_2(unsigned int nbins, double *gridx, double *gridy, double
 }
 
 
-void get_slave_primf_contraf_lists(unsigned int nbins, unsigned char *gpweight, unsigned char *tmp_gpweight, unsigned int *cfweight, unsigned int *tmp_cfweight, unsigned int *pfweight, unsigned int *tmp_pfweight, unsigned int *bs_tracker){
-
-        MPI_Status status;
-	clock_t start, end;
+void get_slave_primf_contraf_lists(unsigned int nbins, unsigned char *gpweight, unsigned int *cfweight, unsigned int *pfweight, unsigned long cfwords, unsigned long pfwords){
 
+	//Each rank only clears the points and sets the function bits of its own bins,
+	//so the master collects the results through bitwise reductions
         if(mpirank != 0){
 
-                        MPI_Send(gpweight, gps->arr_size, MPI_UNSIGNED_CHAR, 0, mpirank+600, MPI_COMM_WORLD);
-                        MPI_Send(cfweight, nbins*gps->nbasis, MPI_INT, 0, mpirank+700, MPI_COMM_WORLD);
-                        MPI_Send(pfweight, nbins*gps->nbasis*gps->maxcontract, MPI_INT, 0, mpirank+800, MPI_COMM_WORLD);
+		MPI_Reduce(gpweight, NULL, gps->arr_size, MPI_UNSIGNED_CHAR, MPI_BAND, 0, MPI_COMM_WORLD);
+		MPI_Reduce(cfweight, NULL, nbins*cfwords, MPI_UNSIGNED, MPI_BOR, 0, MPI_COMM_WORLD);
+		MPI_Reduce(pfweight, NULL, nbins*pfwords, MPI_UNSIGNED, MPI_BOR, 0, MPI_COMM_WORLD);
 
         }else{
 
-		start=clock();
-
-		for(unsigned int i=1; i< mpisize; i++){
-
-			MPI_Recv(tmp_gpweight, gps->arr_size, MPI_UNSIGNED_CHAR, i, i+600, MPI_COMM_WORLD, &status);
-			MPI_Recv(tmp_cfweight, nbins*gps->nbasis, MPI_INT, i, i+700, MPI_COMM_WORLD, &status);
-			MPI_Recv(tmp_pfweight, nbins*gps->nbasis*gps->maxcontract, MPI_INT, i, i+800, MPI_COMM_WORLD, &status);
-
-		        unsigned int bstart=mpi_binlst[i];
-			unsigned int bend=mpi_binlst[i+1];	
-
-			for(unsigned int j=bstart; j< bend; j++){
-
-				for(unsigned int k=bs_tracker[j]; k<bs_tracker[j+1]; k++){
-					gpweight[k] = tmp_gpweight[k];
-
-				}
-				for(unsigned int kbas=j*gps->nbasis;kbas<((j+1)*gps->nbasis);kbas++){
-					cfweight[kbas] += tmp_cfweight[kbas];
-
-					unsigned long init_pfid = kbas*gps->maxcontract;
-					for(unsigned int kprim=0;kprim<gps->maxcontract;kprim++){
-						unsigned long pfwid = init_pfid+kprim;
-						pfweight[pfwid] += tmp_pfweight[pfwid]; 
-					}
-
-				}
-
-				
-
-			}
-
-		}
-
-		end = clock();
-
-	//	printf("Time for running through data: %f \n",  ((double) (end - start)) / CLOCKS_PER_SEC);
+		MPI_Reduce(MPI_IN_PLACE, gpweight, gps->arr_size, MPI_UNSIGNED_CHAR, MPI_BAND, 0, MPI_COMM_WORLD);
+		MPI_Reduce(MPI_IN_PLACE, cfweight, nbins*cfwords, MPI_UNSIGNED, MPI_BOR, 0, MPI_COMM_WORLD);
+		MPI_Reduce(MPI_IN_PLACE, pfweight, nbins*pfwords, MPI_UNSIGNED, MPI_BOR, 0, MPI_COMM_WORLD);
 
         }
 
-        MPI_Barrier(MPI_COMM_WORLD);
-
 }
 
 void delete_gpack_mpi(){
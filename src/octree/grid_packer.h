@@ -20,6 +20,50 @@ struct bflist{
         vector<bas_func> bfs;
 };
 
+/* A cell list over basis function centers, used to find the basis functions that may be significant in a bin*/
+struct bf_cell_list{
+
+        double xmin; /*Origin of the cell grid*/
+        double ymin;
+        double zmin;
+        double cell_size; /*Edge length of a cell*/
+        double rmax; /*Largest radius of significance*/
+        int nx; /*Number of cells along each direction*/
+        int ny;
+        int nz;
+
+        vector<int> cell_counter; /*Basis functions of cell c are bfs[cell_counter[c]] to bfs[cell_counter[c+1]-1]*/
+        vector<int> bfs;
+};
+
+/* Prescreening results of an octree leaf, kept to repack the grid of the next geometry*/
+struct gpack_leaf_state{
+
+        vector<int> pts; /*Indices of the leaf points in the unpruned grid*/
+        vector<unsigned char> active; /*1 if the point passed the ss weight cutoff*/
+        vector<unsigned char> gpweight; /*1 if the point has at least one significant basis function*/
+        vector<int> cand; /*Candidate basis functions, in ascending order*/
+        double slack; /*Smallest gap between a leaf point and the sphere of significance of a candidate it lies outside of*/
+        double drift; /*Bound on the relative motion of leaf points and candidate centers since the leaf was prescreened*/
+        vector<int> basf; /*Significant contracted functions*/
+        vector<int> primf_counter; /*Primitives of basf[j] are primf[primf_counter[j]] to primf[primf_counter[j+1]-1]*/
+        vector<int> primf;
+};
+
+/* Packing state kept between calls. Leaves keep their points, so that the grid of a slightly displaced geometry
+   is repacked without running the octree, and only leaves whose candidates or relative geometry changed are prescreened again.*/
+struct gpack_reuse_type{
+
+        int arr_size; /*Size of the unpruned grid*/
+        int natoms;
+        int nbasis;
+        int maxcontract;
+        vector<double> xyz; /*Atomic positions the leaf states belong to*/
+        vector<int> ptid; /*Unpruned index of each ss weight pruned grid point*/
+        vector<unsigned char> binned; /*1 if an unpruned grid point belongs to a leaf*/
+        vector<gpack_leaf_state> leaves;
+};
+
 /*Fortran interface to prune & pack grid points*/
 extern "C" {
 
@@ -30,28 +74,58 @@ void gpack_finalize_();
 void pack_grid_pts();
 
 /*Fortran interface to prune & pack grid points*/
-void gpack_pack_pts_(double *grid_ptx, double *grid_pty, double *grid_ptz, int *grid_atm, double *grid_sswt, double *grid_weight, int *arr_size, int *natoms, int *nbasis, int *maxcontract, double *DMCutoff, double *sigrad2, int *ncontract, double *aexp, double *dcoeff, int *ncenter, int *itype, double *xyz, int *ngpts, int *ntgpts, int *nbins, int *nbtotbf, int *nbtotpf, double *toct, double *tprscrn);
+void gpack_pack_pts_(double *grid_ptx, double *grid_pty, double *grid_ptz, int *grid_atm, double *grid_sswt, double *grid_weight, int *arr_size, int *natoms, int *nbasis, int *maxcontract, double *DMCutoff, double *sigrad2, int *ncontract, double *aexp, double *dcoeff, int *ncenter, int *itype, double *xyz, int *nthreads, int *ngpts, int *ntgpts, int *nbins, int *nbtotbf, int *nbtotpf, double *toct, double *tprscrn);
+
+/*Fortran interface to keep the packing state for incremental repacking*/
+void gpack_reuse_initialize_();
+
+void gpack_reuse_finalize_();
+
+#if !defined CUDA && !defined CUDA_MPIV
+/*Fortran interface to repack a displaced grid using the kept packing state, ierr is set if a full pack is required*/
+void gpack_repack_pts_(double *grid_ptx, double *grid_pty, double *grid_ptz, int *grid_atm, double *grid_sswt, double *grid_weight, int *arr_size, int *natoms, int *nbasis, int *maxcontract, double *DMCutoff, double *sigrad2, int *ncontract, double *aexp, double *dcoeff, int *ncenter, int *itype, double *xyz, int *nthreads, int *ngpts, int *ntgpts, int *nbins, int *nbtotbf, int *nbtotpf, double *tprscrn, int *ierr);
+#endif
+
+/*interface to retrieve per phase timings (s) and the number of ss weight pruned points of the last packing*/
+void gpack_get_pack_stats_(double *tssw, double *toct, double *tprscrn, double *tpack, int *nsswpts);
 
 /*interface to save packed info in fortran data structures*/
 #if defined CUDA || defined CUDA_MPIV
 void get_gpu_grid_info_(double *gridx, double *gridy, double *gridz, double *ssw, double *weight, int *atm, int *dweight, int *basf, int *primf, int *basf_counter, int *primf_counter);
 
 #else
-void get_cpu_grid_info_(double *gridx, double *gridy, double *gridz, double *ssw, double *weight, int *atm, int *basf, int *primf, int *basf_counter, int *primf_counter, int *bin_counter);
+void get_cpu_grid_info_(float *gridx, float *gridy, float *gridz, double *gridorg, double *ssw, double *weight, int *atm, int *basf, short *primf, int *basf_counter, int *primf_counter, int *bin_counter, double *bin_cost);
 #endif
 
 }
 
+// loads basis set & geometry information shared by packing and repacking
+void gpack_load_input(int *natoms, int *nbasis, int *maxcontract, double *DMCutoff, double *sigrad2, int *ncontract, double *aexp, double *dcoeff, int *ncenter, int *itype, double *xyz, int *nthreads);
+
 // prunes grid based on ssw
 void get_ssw_pruned_grid();
 
 #if defined CUDA || defined CUDA_MPIV
-int gpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree, vector<node> *signodes, vector<bflist> *bflst);
+int gpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree, vector<int> *ptidx, vector<node> *signodes, vector<bflist> *bflst);
 #endif
 
-void cpu_get_primf_contraf_lists_method_new_imp(double gridx, double gridy, double gridz, unsigned char *gpweight, unsigned int *cfweight, unsigned int *pfweight, unsigned int bin_id, unsigned int gid);
+void build_bf_cell_list(bf_cell_list *bfcl);
+
+void get_bin_candidate_bfs(bf_cell_list *bfcl, double xmin, double xmax, double ymin, double ymax, double zmin, double zmax, vector<int> *cand);
+
+double get_node_cost(node *n, void *data);
+
+void get_pts_candidate_bfs(bf_cell_list *bfcl, double *gridx, double *gridy, double *gridz, unsigned int pstart, unsigned int pend, vector<int> *cand);
+
+void save_leaf_state(gpack_leaf_state *ls, unsigned int *cfbits, unsigned int *pfbits, vector<int> *cand, double *gridx, double *gridy, double *gridz, unsigned int pstart, unsigned int pend);
+
+void cpu_get_primf_contraf_lists_method_new_imp(double gridx, double gridy, double gridz, unsigned char *gpweight, unsigned int *cfweight, unsigned int *pfweight, unsigned int gid, int *cand, int ncand);
+
+void cpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree, vector<int> *ptidx, bf_cell_list *bfcl);
+
+void get_bin_function_counts(unsigned int *cfbits, unsigned int *pfbits, unsigned int *ncf, unsigned int *npf);
 
-void cpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree);
+void pack_bin_function_lists(unsigned int *cfbits, unsigned int *pfbits, int *basf, int *primf, int *primf_counter, int pfstart);
 
 //MPI setup for the grid operations
 #if defined MPIV && !defined CUDA_MPIV
@@ -64,9 +138,9 @@ void cpu_get_pfbased_basis_function_lists_new_imp(vector<node> *octree);
 
 void setup_gpack_mpi_1();
 
-void setup_gpack_mpi_2(unsigned int nbins, double *gridx, double *gridy, double *gridz, unsigned char *gpweight, unsigned char *tmp_gpweight, unsigned int *cfweight, unsigned int *tmp_cfweight, unsigned int *pfweight, unsigned int *tmp_pfweight, double *sswt, double *weight, int *iatm, unsigned int *bs_tracker);
+void setup_gpack_mpi_2(unsigned int nbins, double *gridx, double *gridy, double *gridz, unsigned char *gpweight, double *sswt, double *weight, int *iatm, unsigned int *bs_tracker);
 
-void get_slave_primf_contraf_lists(unsigned int nbins, unsigned char *gpweight, unsigned char *tmp_gpweight, unsigned int *cfweight, unsigned int *tmp_cfweight, unsigned int *pfweight, unsigned int *tmp_pfweight, unsigned int *bs_tracker);
+void get_slave_primf_contraf_lists(unsigned int nbins, unsigned char *gpweight, unsigned int *cfweight, unsigned int *pfweight, unsigned long cfwords, unsigned long pfwords);
 
 void delete_gpack_mpi();
 
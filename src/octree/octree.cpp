@@ -18,49 +18,43 @@
 #include "octree.h"
 #include "gpack_type.h"
 
-void get_boundaries(_gpack_type gps, vector<point> *ptlst, double *xmin, double *xmax, double *ymin, double *ymax, double *zmin, double *zmax){
+void get_boundaries(_gpack_type gps, double *xmin, double *xmax, double *ymin, double *ymax, double *zmin, double *zmax){
 
 	PRINTOCTDEBUG("COMPUTING GRID BOUNDARIES")
 
-        point pt0= ptlst->at(0);
-        double *x0 = (double*) pt0.x;
-	double *y0 = (double*) pt0.y;
-	double *z0 = (double*) pt0.z;
+        double *x = gps->gridx->_cppData;
+        double *y = gps->gridy->_cppData;
+        double *z = gps->gridz->_cppData;
 
-	*xmin = *x0;
-	*ymin = *y0;
-        *zmin = *z0;
+	*xmin = x[0];
+	*ymin = y[0];
+        *zmin = z[0];
 
-        *xmax = *x0;
-        *ymax = *y0;
-        *zmax = *z0;
+        *xmax = x[0];
+        *ymax = y[0];
+        *zmax = z[0];
 
-        for(int i=1;i<ptlst->size();i++){
+        for(int i=1;i<gps->arr_size;i++){
 
-		point pt = ptlst->at(i);
-		double *x = (double*) pt.x;
-		double *y = (double*) pt.y;
-		double *z = (double*) pt.z;
-
-                if(*xmin > *x){
-                        *xmin = *x;
+                if(*xmin > x[i]){
+                        *xmin = x[i];
                 }
-		if(*xmax < *x){
-			*xmax = *x;
+		if(*xmax < x[i]){
+			*xmax = x[i];
 		}
 
-                if(*ymin > *y){
-                        *ymin = *y;
+                if(*ymin > y[i]){
+                        *ymin = y[i];
                 }
-		if(*ymax < *y){
-			*ymax = *y;
+		if(*ymax < y[i]){
+			*ymax = y[i];
 		}
 
-                if(*zmin > *z){
-                        *zmin = *z;
+                if(*zmin > z[i]){
+                        *zmin = z[i];
                 }
-		if(*zmax < *z){
-                        *zmax = *z;
+		if(*zmax < z[i]){
+                        *zmax = z[i];
                 }
 
         }	
@@ -77,74 +71,131 @@ void get_boundaries(_gpack_type gps, vector<point> *ptlst, double *xmin, double
 
 }
 
-void generate_gridpt_list(_gpack_type gps, vector<point> *ptlst){
+/*Returns the child label (see generate_octree) of the octet a point falls into*/
+static inline int get_octet_id(double x, double y, double z, double xmid, double ymid, double zmid){
 
-        PRINTOCTDEBUG("GENERATING GRID POINT LISTS")
+	return (x < xmid ? 0 : 1) | (y < ymid ? 0 : 2) | (z < zmid ? 0 : 4);
+}
 
-	for(int i=0;i<gps->arr_size;i++){
-		point pt;
-		pt.x      = &gps->gridx->_cppData[i];
-		pt.y      = &gps->gridy->_cppData[i];
-		pt.z      = &gps->gridz->_cppData[i];
-		pt.sswt   = &gps->sswt->_cppData[i];
-		pt.weight = &gps->ss_weight->_cppData[i];	
-		pt.iatm   = &gps->grid_atm->_cppData[i];		
-
-		ptlst->push_back(pt);
-	}
+/*Spreads the lowest 10 bits of v so that there are two zero bits between consecutive bits*/
+static inline unsigned int spread_bits(unsigned int v){
 
-        PRINTOCTDEBUG("END GENERATING GRID POINT LISTS")
+	v &= 0x3ff;
+	v = (v | (v << 16)) & 0x030000ff;
+	v = (v | (v << 8))  & 0x0300f00f;
+	v = (v | (v << 4))  & 0x030c30c3;
+	v = (v | (v << 2))  & 0x09249249;
 
+	return v;
 }
 
-/*This method distributes parent's grid points to a child node*/
-/*Takes parent grid point list and new node pointers as arguments*/
-void distribute_grid_pts(vector<point> *ptlst, node *n){
-
-	double xmin = n->xmin;
-	double xmax = n->xmax;
-	double ymin = n->ymin;
-	double ymax = n->ymax;
-	double zmin = n->zmin;
-	double zmax = n->zmax;
-
-	/*New point list for node n*/
-	vector<point> nptlst;
-
-	for(int i=0; i < (ptlst->size()); i++){
-		point p = ptlst->at(i);
-		double *x = (double*) p.x;
-		double *y = (double*) p.y;
-		double *z = (double*) p.z;
-
-		/*Push grid point into new list if it is within bounds*/
-		if( (*x >= xmin) and (*x < xmax) and (*y >= ymin) and (*y < ymax) and (*z >= zmin) and (*z <zmax) ){
-			nptlst.push_back(p);
+/*Morton key of a point inside a box, 10 bits per direction*/
+static inline unsigned int get_morton_key(double x, double y, double z, node *n){
+
+	double sx = 1024.0 / (n->xmax - n->xmin);
+	double sy = 1024.0 / (n->ymax - n->ymin);
+	double sz = 1024.0 / (n->zmax - n->zmin);
+
+	unsigned int ix = (unsigned int) min(max((x - n->xmin) * sx, 0.0), 1023.0);
+	unsigned int iy = (unsigned int) min(max((y - n->ymin) * sy, 0.0), 1023.0);
+	unsigned int iz = (unsigned int) min(max((z - n->zmin) * sz, 0.0), 1023.0);
+
+	return spread_bits(ix) | (spread_bits(iy) << 1) | (spread_bits(iz) << 2);
+}
+
+/*This method distributes a parent's grid points among its 8 children in a single pass. The parent's
+  range of the point index list is reordered in place so that the children occupy consecutive sub-ranges,
+  whose limits are returned in cbegin and cend. The partition is stable, i.e. each child keeps the point
+  order of its parent. scratch and octet are work arrays of at least gps->arr_size elements. With nthreads > 1,
+  each thread handles a contiguous chunk of the range and the chunks are concatenated in thread order.*/
+void distribute_grid_pts(_gpack_type gps, int *ptidx, int *scratch, unsigned char *octet, node *n, int *cbegin, int *cend, int nthreads){
+
+	double *x = gps->gridx->_cppData;
+	double *y = gps->gridy->_cppData;
+	double *z = gps->gridz->_cppData;
+
+	double xmid = (n->xmax+n->xmin)/2;
+	double ymid = (n->ymax+n->ymin)/2;
+	double zmid = (n->zmax+n->zmin)/2;
+
+	/*Number of points of each child in the chunk of each thread*/
+	vector<int> count(8*nthreads, 0);
+
+#pragma omp parallel num_threads(nthreads) if(nthreads > 1)
+	{
+		int tid = 0;
+		int nt  = 1;
+#ifdef _OPENMP
+		tid = omp_get_thread_num();
+		nt  = omp_get_num_threads();
+#endif
+		int ist, iend;
+		gpack_thread_range(n->end - n->begin, &ist, &iend);
+		ist  += n->begin;
+		iend += n->begin;
+
+		int *tcount = &count[8*tid];
+
+		/*Label each point and count the points of each child*/
+		for(int i=ist; i<iend; i++){
+			int p = ptidx[i];
+			unsigned char k = get_octet_id(x[p], y[p], z[p], xmid, ymid, zmid);
+			octet[i] = k;
+			tcount[k]++;
 		}
-	}
 
-	/*Fianlly, store the point list in node*/
-	n->ptlst = nptlst;
+#pragma omp barrier
+#pragma omp single
+		{
+			/*Set child ranges and the position of each chunk inside them*/
+			int offset = n->begin;
+			for(int k=0; k<8; k++){
+				cbegin[k] = offset;
+				for(int t=0; t<nt; t++){
+					int c = count[8*t+k];
+					count[8*t+k] = offset;
+					offset += c;
+				}
+				cend[k] = offset;
+			}
+		}
+
+		/*Scatter the indices into their child ranges and copy them back*/
+		for(int i=ist; i<iend; i++){
+			scratch[tcount[octet[i]]++] = ptidx[i];
+		}
+
+#pragma omp barrier
+
+		copy(scratch+ist, scratch+iend, ptidx+ist);
+	}
 
 }
 
 /*For a given series of grid points, this function will generate an octree and return it as a vector of nodes.
   The required grid point properties are x, y, z coordinates and weights of the grid points. The total grid point
   count is also required. These are provided through gps struct. Furthermore, bin_size is the maximum amount of grid 
-  points for a node. max_lvl is the depth of tree.*/
-vector<node> generate_octree(_gpack_type gps, int bin_size, int max_lvl){
+  points for a node. max_lvl is the depth of tree. Nodes do not store their grid points, instead ptidx is filled with
+  grid point indices ordered such that each node owns the [begin,end) range of it. If node_cost is given, nodes with
+  more than min_bin_size points are also split while their estimated cost is above max_cost.*/
+vector<node> generate_octree(_gpack_type gps, vector<int> *ptidx, int bin_size, int max_lvl, node_cost_fn node_cost, void *cost_data, int min_bin_size, double max_cost){
 
         PRINTOCTDEBUG("STARTING OCTREE ALGORITHM")
 
-	/*Organize the coordinates into point type*/
-	vector<point> ptlst;
+	/*Initialize the point index list, the root owns all points*/
+	ptidx->resize(gps->arr_size);
+	for(int i=0;i<gps->arr_size;i++){
+		ptidx->at(i) = i;
+	}
 
-	generate_gridpt_list(gps, &ptlst);
+	/*Work arrays for distributing points among children*/
+	vector<int> scratch(gps->arr_size);
+	vector<unsigned char> octet(gps->arr_size);
 
 	/*Calculate the boundaries of the grid*/
 	double xmin, ymin, zmin, xmax, ymax, zmax;
 
-	get_boundaries(gps, &ptlst, &xmin, &xmax, &ymin, &ymax, &zmin, &zmax);	
+	get_boundaries(gps, &xmin, &xmax, &ymin, &ymax, &zmin, &zmax);	
 
 #ifdef DEBUG	
         fprintf(gps->gpackDebugFile,"Computed grid boundaries: minX: %f, maxX: %f, minY: %f, maxY: %f, minZ: %f, maxZ: %f \n", xmin,xmax,ymin,ymax,zmin,zmax);
@@ -172,7 +223,8 @@ vector<node> generate_octree(_gpack_type gps, int bin_size, int max_lvl){
 	root.level = 0;
 	root.id = id;
 	root.parent = -1;
-	root.ptlst = ptlst;
+	root.begin = 0;
+	root.end = gps->arr_size;
 	root.xmin = xmin;
 	root.ymin = ymin;
 	root.zmin = zmin;
@@ -180,12 +232,16 @@ vector<node> generate_octree(_gpack_type gps, int bin_size, int max_lvl){
 	root.ymax = ymax;
 	root.zmax = zmax;
 
-	if(root.ptlst.size() > bin_size){
+	if(root.end - root.begin > bin_size){
 		root.has_children = true;		
 	}else{
 		root.has_children = false;
 	}
 
+	if(node_cost != NULL && root.has_children == false && root.end - root.begin > min_bin_size){
+		root.has_children = node_cost(&root, cost_data) > max_cost;
+	}
+
 	/*Push root to octree*/
 	octree.push_back(root);
 
@@ -233,6 +289,28 @@ vector<node> generate_octree(_gpack_type gps, int bin_size, int max_lvl){
 		fprintf(gps->gpackDebugFile," i: %i nlvls: %i lvlstart: %i lvlend: %i nnodes_at_lvl: %i \n", i, nlvls, lvlstart, lvlend ,nnodes_at_lvl);
 #endif
 
+		/*Sort the points of each parent at this level into its children. Parents own disjoint ranges of
+		  the point index list, so they are processed concurrently. If there are only a few parents, all
+		  threads work on each of them instead.*/
+		int nnodes = lvlend - lvlstart;
+		vector<int> lvl_cbegin(8*nnodes);
+		vector<int> lvl_cend(8*nnodes);
+
+		if(nnodes < gps->nthreads){
+			for(int j=lvlstart;j<lvlend;j++){
+				if(octree[j].has_children == true){
+					distribute_grid_pts(gps, &ptidx->front(), &scratch.front(), &octet.front(), &octree[j], &lvl_cbegin[8*(j-lvlstart)], &lvl_cend[8*(j-lvlstart)], gps->nthreads);
+				}
+			}
+		}else{
+#pragma omp parallel for schedule(dynamic) num_threads(gps->nthreads)
+			for(int j=lvlstart;j<lvlend;j++){
+				if(octree[j].has_children == true){
+					distribute_grid_pts(gps, &ptidx->front(), &scratch.front(), &octet.front(), &octree[j], &lvl_cbegin[8*(j-lvlstart)], &lvl_cend[8*(j-lvlstart)], 1);
+				}
+			}
+		}
+
 		/*This loops goes through each node at a given level*/
 		for(int j=lvlstart;j<lvlend;j++){
 
@@ -240,32 +318,24 @@ vector<node> generate_octree(_gpack_type gps, int bin_size, int max_lvl){
 
 			if(n.has_children == true){
 
+				/*Child ranges of n*/
+				int *cbegin = &lvl_cbegin[8*(j-lvlstart)];
+				int *cend = &lvl_cend[8*(j-lvlstart)];
+
 				double xmid = (n.xmax+n.xmin)/2;
 				double ymid = (n.ymax+n.ymin)/2;
 				double zmid = (n.zmax+n.zmin)/2;
 
-				/*We now label new bins as follows*/
-				/*Rear, B,T,L,R stands for bottom, top, L and right respectively*/
-				/********************************
-				*		*		*
- 				*     (RTL,3)	*    (RTR,2)	*
- 				*		*		*
-				*********************************
- 				*		*		*
- 				*     (RBL,0)	*    (RBR,1)	*
- 				*		*		*
- 				*********************************/
-
-				/*Front, B,T,L,R stands for bottom, top, L and right respectively*/
-				/********************************
-				*               *               *
-				*    (FTL,7)    *    (FTR,6)	*
-				*               *		*
-				*********************************
-				*		*		*
-				*     (FBL,4)	*    (FBR,5)	*
-				*		*		*               
-				*********************************/ 
+				/*Children are labeled in Morton order, bits 0, 1 and 2 of the label are set if the
+				  child lies in the upper half along x, y and z respectively. Since children take
+				  consecutive sub-ranges of the point index list in label order, the leaves and
+				  their points end up ordered along a Z-order curve.*/
+				/*        z < zmid                 z >= zmid
+				*****************        *****************
+				*   2   *   3   *        *   6   *   7   *
+				*****************        *****************     y
+				*   0   *   1   *        *   4   *   5   *     |
+				*****************        *****************     |___ x */
 
 				/*Define a new node and set temporary boundaries*/
 				node nnew;
@@ -283,55 +353,16 @@ vector<node> generate_octree(_gpack_type gps, int bin_size, int max_lvl){
 
 					node nk = nnew;
 				
-					switch(k){
-						case 0: 
-							nk.xmax = xmid;
-							nk.zmax = zmid;
-							nk.ymin = ymid;
-							
-							break;
-						case 1:
-							nk.xmin = xmid;
-							nk.zmax = zmid;
-							nk.ymin = ymid;
-							break;
-						case 2:
-							nk.xmin = xmid;
-							nk.zmin = zmid;
-							nk.ymin = ymid;
-							break;
-						case 3:
-							nk.xmax = xmid;
-							nk.zmin = zmid;
-							nk.ymin = ymid;
-							break;
-						case 4: 
-							nk.xmax = xmid;
-							nk.zmax = zmid;
-							nk.ymax = ymid;
-							break;
-						case 5:
-							nk.xmin = xmid;
-							nk.zmax = zmid;
-							nk.ymax = ymid;
-							break;
-						case 6:
-							nk.xmin = xmid;
-							nk.zmin = zmid;
-							nk.ymax = ymid;
-							break;
-						case 7:
-							nk.xmax = xmid;
-							nk.zmin = zmid;
-							nk.ymax = ymid;
-							break;
-					}
+					if(k & 1) nk.xmin = xmid; else nk.xmax = xmid;
+					if(k & 2) nk.ymin = ymid; else nk.ymax = ymid;
+					if(k & 4) nk.zmin = zmid; else nk.zmax = zmid;
 
-					/*Load the grid points into node*/
-					distribute_grid_pts(&(n.ptlst), &nk);
+					/*Set the grid point range of new node*/
+					nk.begin = cbegin[k];
+					nk.end = cend[k];
 
 					/*Get the grid point count of new node*/
-					int numpts = nk.ptlst.size();
+					int numpts = nk.end - nk.begin;
 
 					/*Set if node should have children*/					
 					if(numpts > bin_size){
@@ -357,6 +388,17 @@ vector<node> generate_octree(_gpack_type gps, int bin_size, int max_lvl){
 			}
 		}
 
+		/*Children that are small enough by point count are split further if they are expensive*/
+		if(node_cost != NULL){
+#pragma omp parallel for schedule(dynamic) num_threads(gps->nthreads)
+			for(int j=lvlend;j<lvlend+child_count;j++){
+				node *n = &octree[j];
+				if(n->has_children == false && n->end - n->begin > min_bin_size){
+					n->has_children = node_cost(n, cost_data) > max_cost;
+				}
+			}
+		}
+
 #ifdef DEBUG
 		fprintf(gps->gpackDebugFile," i: %i lvl_node_counter.at(i): %i child_count: %i\n", i, lvl_node_counter.at(i), child_count);
 #endif
@@ -366,9 +408,63 @@ vector<node> generate_octree(_gpack_type gps, int bin_size, int max_lvl){
 
 	}
 
+	/*Order the points of each leaf along the same curve*/
+	vector<int> leaves = get_leaf_nodes(&octree, max_lvl);
+
+#pragma omp parallel num_threads(gps->nthreads)
+	{
+	vector< pair<unsigned int, int> > keys;
+
+#pragma omp for schedule(dynamic)
+	for(int i=0; i<(int) leaves.size(); i++){
+		node *n = &octree[leaves[i]];
+
+		keys.clear();
+		for(int r=n->begin; r<n->end; r++){
+			int p = ptidx->at(r);
+			keys.push_back(make_pair(get_morton_key(gps->gridx->_cppData[p], gps->gridy->_cppData[p], gps->gridz->_cppData[p], n), p));
+		}
+
+		sort(keys.begin(), keys.end());
+
+		for(int r=n->begin; r<n->end; r++){
+			ptidx->at(r) = keys[r - n->begin].second;
+		}
+	}
+	}
+
         PRINTOCTDEBUG("END RUNNING OCTREE ALGORITHM")
 
 	return octree;
 
 }
 
+
+/*Returns the indices of the octree leaves ordered by their range of the point index list. As children are
+  labeled in Morton order (see generate_octree), this is the Z-order traversal of the leaves, so that consecutive
+  leaves are spatially close.*/
+vector<int> get_leaf_nodes(vector<node> *octree, int max_lvl){
+
+	vector<int> leaves;
+
+	for(int i=0; i<octree->size(); i++){
+		node *n = &octree->at(i);
+		if(n->has_children == false || n->level == max_lvl-1){
+			leaves.push_back(i);
+		}
+	}
+
+	/*Leaves own disjoint ranges, hence sorting the range starts is enough*/
+	vector< pair<int, int> > begins;
+	for(int i=0; i<leaves.size(); i++){
+		begins.push_back(make_pair(octree->at(leaves[i]).begin, leaves[i]));
+	}
+
+	sort(begins.begin(), begins.end());
+
+	for(int i=0; i<leaves.size(); i++){
+		leaves[i] = begins[i].second;
+	}
+
+	return leaves;
+}
@@ -13,7 +13,7 @@ using namespace std;
 // Write octree into the debug file
 #define WRITE_OCTREE
 
-/*Struct to hold grid point value pointers*/
+/*Struct to hold grid point value pointers, used by the debug writers*/
 struct point{
         double *x;
         double *y;
@@ -41,8 +41,14 @@ struct node{
         double zmin; /*z lower boundary*/
         double zmax; /*z upper boundary*/
 
-        vector<point> ptlst; /*Keeps a list of points belonging to each node*/
+        /*Range of the point index list belonging to this node, [begin,end)*/
+        int begin;
+        int end;
 };
 
-vector<node> generate_octree(_gpack_type gps, int bin_size, int max_lvl);
+/*Estimates the cost of a node, data is passed through from generate_octree*/
+typedef double (*node_cost_fn)(node *n, void *data);
 
+vector<node> generate_octree(_gpack_type gps, vector<int> *ptidx, int bin_size, int max_lvl, node_cost_fn node_cost, void *cost_data, int min_bin_size, double max_cost);
+
+vector<int> get_leaf_nodes(vector<node> *octree, int max_lvl);
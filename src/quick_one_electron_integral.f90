@@ -81,7 +81,7 @@ subroutine fullx
    ! Now diagonalize HOLD to generate the eigenvectors and eigenvalues.
    call cpu_time(timer_begin%T1eSD)
 
-   call DIAG(NBASIS,quick_scratch%hold,NBASIS,quick_method%DMCutoff,V,Sminhalf,IDEGEN1,quick_scratch%hold2,IERROR)
+   call DIAGDC(NBASIS,quick_scratch%hold,NBASIS,quick_method%DMCutoff,V,Sminhalf,IDEGEN1,quick_scratch%hold2,IERROR)
 
    call cpu_time(timer_end%T1eSD)
    timer_cumer%T1eSD=timer_cumer%T1eSD+timer_end%T1eSD-timer_begin%T1eSD
@@ -1918,6 +1918,7 @@ subroutine attrashell(IIsh,JJsh)
    common /xiaoattra/attra,aux,AA,BB,CC,PP,g
 
    double precision RA(3),RB(3),RP(3),inv_g,g_table(200)
+   double precision, allocatable :: Ubatch(:),auxbatch(:,:)
 
    ! Variables needed later:
    !    pi=3.1415926535897932385
@@ -1953,6 +1954,8 @@ subroutine attrashell(IIsh,JJsh)
    NJJ2=quick_basis%Qfinal(JJsh)
    Maxm=NII2+NJJ2
 
+   nCenters=natom+quick_molspec%nextatom
+   allocate(Ubatch(nCenters),auxbatch(nCenters,0:Maxm))
 
    do ips=1,quick_basis%kprim(IIsh)
       a=quick_basis%gcexpo(ips,quick_basis%ksumtype(IIsh))
@@ -1969,8 +1972,31 @@ subroutine attrashell(IIsh,JJsh)
          constanttemp=dexp(-((a*b*((Ax - Bx)**2.d0 + (Ay - By)**2.d0 + (Az - Bz)**2.d0))*inv_g))
          constant = overlap_core(a,b,0,0,0,0,0,0,Ax,Ay,Az,Bx,By,Bz,Px,Py,Pz,g_table) * 2.d0 * sqrt(g/Pi)*constanttemp
 
+         ! Gather the Boys function arguments of all centers and evaluate
+         ! them in one batch
+         do iatom=1,nCenters
+            if(iatom<=natom)then
+               Cx=xyz(1,iatom)
+               Cy=xyz(2,iatom)
+               Cz=xyz(3,iatom)
+            else
+               Cx=quick_molspec%extxyz(1,iatom-natom)
+               Cy=quick_molspec%extxyz(2,iatom-natom)
+               Cz=quick_molspec%extxyz(3,iatom-natom)
+            endif
+
+            !Calculate the last term of O&S Eqn A21
+            PCsquare = (Px-Cx)**2 + (Py -Cy)**2 + (Pz -Cz)**2
+
+            !Compute O&S Eqn A21
+            Ubatch(iatom) = g* PCsquare
+         enddo
+
+         !Calculate the last term of O&S Eqn A20
+         call FmT_batch(nCenters,Maxm,Ubatch,nCenters,auxbatch)
+
          !nextatom=number of external MM point charges. set to 0 if none used
-         do iatom=1,natom+quick_molspec%nextatom
+         do iatom=1,nCenters
             if(iatom<=natom)then
                Cx=xyz(1,iatom)
                Cy=xyz(2,iatom)
@@ -1984,24 +2010,16 @@ subroutine attrashell(IIsh,JJsh)
             endif
             constant2=constanttemp*Z
 
-            !Calculate the last term of O&S Eqn A21
-            PCsquare = (Px-Cx)**2 + (Py -Cy)**2 + (Pz -Cz)**2
 !            if(quick_method%fMM .and. a*b*PCsquare/g.gt.33.0d0)then
 !               xdistance=1.0d0/dsqrt(PCsquare)
 !               call fmmone(ips,jps,IIsh,JJsh,NIJ1,Ax,Ay,Az,Bx,By,Bz, &
 !                     Cx,Cy,Cz,Px,Py,Pz,iatom,constant2,a,b,xdistance)
 !            else
 
-               !Compute O&S Eqn A21
-               U = g* PCsquare
-
-               !Calculate the last term of O&S Eqn A20
-               call FmT(Maxm,U,aux)
-
                !Calculate all the auxilary integrals and store in attraxiao
                !array
                do L = 0,maxm
-                  aux(L) = aux(L)*constant*Z
+                  aux(L) = auxbatch(iatom,L)*constant*Z
                   attraxiao(1,1,L)=aux(L)
                enddo
 
@@ -2031,6 +2049,8 @@ subroutine attrashell(IIsh,JJsh)
 
 !stop
 
+   deallocate(Ubatch,auxbatch)
+
    ! Xiao HE remember to multiply Z   01/12/2008
    !    attraction = attraction*(-1.d0)* Z
    201 return
@@ -68,6 +68,8 @@ subroutine electdiis(jscf)
 
    logical :: diisdone = .false.  ! flag to indicate if diis is done
    logical :: deltaO   = .false.  ! delta Operator
+   integer :: ndelta = 0          ! delta Operator cycles since the last full build
+   double precision :: deltaCutoff ! integral cutoff of the last operator build
    integer :: idiis = 0           ! diis iteration
    integer :: IDIISfinal,iidiis,current_diis
    integer :: lsolerr = 0
@@ -75,6 +77,11 @@ subroutine electdiis(jscf)
    double precision :: BIJ,DENSEJI,errormax,OJK,temp
    double precision :: Sum2Mat,rms
    integer :: I,J,K,L,IERROR
+   logical :: purified            ! density of this cycle from purification
+   integer :: npurified           ! cycles whose density came from purification
+#if defined CUDA || defined CUDA_MPIV
+   logical :: cudaco              ! CO from cuda_diag, see the sign fix after the SCF
+#endif
 
    double precision :: oldEnergy=0.0d0,E1e ! energy for last iteriation, and 1e-energy
    double precision :: PRMS,PCHANGE, tmp
@@ -120,6 +127,17 @@ subroutine electdiis(jscf)
 
    call allocate_quick_scf()
 
+#ifdef MPIV
+   !-------------- MPI / ALL NODE ---------------
+   ! Setup MPI integral configuration
+   if (bMPI) call MPI_setup_hfoperator
+   !-------------- END MPI / ALL NODE -----------
+#endif
+
+   ! semi-direct scf: choose the quartets to cache, in MPI from the shells
+   ! MPI_setup_hfoperator gave this node
+   if (quick_method%semidirectMem .gt. 0.0d0 .and. .not. quick_method%nodirect) call eriCachePlan
+
    if(master) then
       write(ioutfile,'(40x," SCF ENERGY")')
       if (quick_method%printEnergy) then
@@ -138,13 +156,6 @@ subroutine electdiis(jscf)
       endif
    endif
 
-#ifdef MPIV
-   !-------------- MPI / ALL NODE ---------------
-   ! Setup MPI integral configuration
-   if (bMPI) call MPI_setup_hfoperator
-   !-------------- END MPI / ALL NODE -----------
-#endif
-
    ! First, let's get 1e opertor which only need 1-time calculation
    ! and store them in oneElecO and fetch it every scf time.
    call get1e(oneElecO)
@@ -174,10 +185,14 @@ subroutine electdiis(jscf)
 
       endif
    endif
+   cudaco = .false.
 #endif
 
    diisdone = .false.
    deltaO = .false.
+   ndelta = 0
+   npurified = 0
+   deltaCutoff = quick_method%integralCutoff
    idiis = 0
    ! Now Begin DIIS
    do while (.not.diisdone)
@@ -204,8 +219,17 @@ subroutine electdiis(jscf)
       ! Triger Operator timer
       call cpu_time(timer_begin%TOp)
 
-      ! if want to calculate operator difference?
-      if(jscf.ge.quick_method%ncyc) deltaO = .true.
+      ! if want to calculate operator difference? The operator is rebuilt from
+      ! the full density every nrebuild cycles and whenever the integral cutoff
+      ! was tightened, so that the screening error does not accumulate.
+      deltaO = jscf.gt.1 .and. jscf.ge.quick_method%ncyc .and. ndelta.lt.quick_method%nrebuild &
+            .and. deltaCutoff.eq.quick_method%integralCutoff
+      if (deltaO) then
+         ndelta = ndelta+1
+      else
+         ndelta = 0
+      endif
+      deltaCutoff = quick_method%integralCutoff
 
       if (quick_method%debug)  call debug_SCF(jscf)
 
@@ -484,60 +508,91 @@ subroutine electdiis(jscf)
          ! 8) Diagonalize the operator matrix to form a new density matrix.
          ! First you have to transpose this into an orthogonal basis, which
          ! is accomplished by calculating Transpose[X] . O . X.
+         ! With PURIFY the density is purified from Transpose[X] . O . X
+         ! instead, which needs matrix multiplies only. The operator is
+         ! still diagonalized when the purification fails, and once on the
+         ! last cycle to get the orbitals.
          !-----------------------------------------------
+         purified = .false.
+         if (quick_method%purify) then
+            call cpu_time(timer_begin%TDiag)
 #if defined(CUDA) || defined(CUDA_MPIV)
+            call cublas_DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, quick_qm_struct%o, &
+                  nbasis, quick_qm_struct%x, nbasis, 0.0d0, quick_scratch%hold,nbasis)
 
-        call cpu_time(timer_begin%TDiag)
-        call cuda_diag(quick_qm_struct%o, quick_qm_struct%x, quick_scratch%hold,&
-              quick_qm_struct%E, quick_qm_struct%idegen, &
-              quick_qm_struct%vec, quick_qm_struct%co, &
-              V2, nbasis)
-         call cpu_time(timer_end%TDiag)
+            call cublas_DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, quick_qm_struct%x, &
+                  nbasis, quick_scratch%hold, nbasis, 0.0d0, quick_scratch%hold2,nbasis)
+#else
+            call DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, quick_qm_struct%o, &
+                  nbasis, quick_qm_struct%x, nbasis, 0.0d0, quick_scratch%hold,nbasis)
 
-         call cublas_DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, quick_qm_struct%x, &
-               nbasis, quick_scratch%hold, nbasis, 0.0d0, quick_qm_struct%o,nbasis)
+            call DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, quick_qm_struct%x, &
+                  nbasis, quick_scratch%hold, nbasis, 0.0d0, quick_scratch%hold2,nbasis)
+#endif
+            call CopyDMat(quick_qm_struct%dense,quick_scratch%hold,nbasis) ! Save DENSE to HOLD
+            call purify_density(nbasis,quick_molspec%nelec/2,quick_scratch%hold2,quick_qm_struct%x, &
+                  quick_qm_struct%dense,IERROR)
+            purified = (IERROR == 0)
+            if (purified) npurified = npurified+1
+            call cpu_time(timer_end%TDiag)
+         endif
+
+         if (.not. purified) then
+#if defined(CUDA) || defined(CUDA_MPIV)
+
+            call cpu_time(timer_begin%TDiag)
+            call cuda_diag(quick_qm_struct%o, quick_qm_struct%x, quick_scratch%hold,&
+                  quick_qm_struct%E, quick_qm_struct%idegen, &
+                  quick_qm_struct%vec, quick_qm_struct%co, &
+                  V2, nbasis)
+            call cpu_time(timer_end%TDiag)
+            cudaco = .true.
+
+            call cublas_DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, quick_qm_struct%x, &
+                  nbasis, quick_scratch%hold, nbasis, 0.0d0, quick_qm_struct%o,nbasis)
 #else
-         call DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, quick_qm_struct%o, &
-               nbasis, quick_qm_struct%x, nbasis, 0.0d0, quick_scratch%hold,nbasis)
+            call DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, quick_qm_struct%o, &
+                  nbasis, quick_qm_struct%x, nbasis, 0.0d0, quick_scratch%hold,nbasis)
 
-         call DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, quick_qm_struct%x, &
-               nbasis, quick_scratch%hold, nbasis, 0.0d0, quick_qm_struct%o,nbasis)
+            call DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, quick_qm_struct%x, &
+                  nbasis, quick_scratch%hold, nbasis, 0.0d0, quick_qm_struct%o,nbasis)
 
-         ! Now diagonalize the operator matrix.
-         call cpu_time(timer_begin%TDiag)
-         call DIAG(nbasis,quick_qm_struct%o,nbasis,quick_method%DMCutoff,V2,quick_qm_struct%E,&
-               quick_qm_struct%idegen,quick_qm_struct%vec,IERROR)
-         call cpu_time(timer_end%TDiag)
+            ! Now diagonalize the operator matrix.
+            call cpu_time(timer_begin%TDiag)
+            call DIAGDC(nbasis,quick_qm_struct%o,nbasis,quick_method%DMCutoff,V2,quick_qm_struct%E,&
+                  quick_qm_struct%idegen,quick_qm_struct%vec,IERROR)
+            call cpu_time(timer_end%TDiag)
 
 #endif
 
-         ! Calculate C = XC' and form a new density matrix.
-         ! The C' is from the above diagonalization.  Also, save the previous
-         ! Density matrix to check for convergence.
-         !        call DMatMul(nbasis,X,VEC,CO)    ! C=XC'
+            ! Calculate C = XC' and form a new density matrix.
+            ! The C' is from the above diagonalization.  Also, save the previous
+            ! Density matrix to check for convergence.
+            !        call DMatMul(nbasis,X,VEC,CO)    ! C=XC'
 
 #if defined(CUDA) || defined(CUDA_MPIV)
 
-         call cublas_DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, quick_qm_struct%x, &
-               nbasis, quick_qm_struct%vec, nbasis, 0.0d0, quick_qm_struct%co,nbasis)
+            call cublas_DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, quick_qm_struct%x, &
+                  nbasis, quick_qm_struct%vec, nbasis, 0.0d0, quick_qm_struct%co,nbasis)
 #else
-         call DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, quick_qm_struct%x, &
-               nbasis, quick_qm_struct%vec, nbasis, 0.0d0, quick_qm_struct%co,nbasis)
+            call DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, quick_qm_struct%x, &
+                  nbasis, quick_qm_struct%vec, nbasis, 0.0d0, quick_qm_struct%co,nbasis)
 #endif
 
 
-         call CopyDMat(quick_qm_struct%dense,quick_scratch%hold,nbasis) ! Save DENSE to HOLD
+            call CopyDMat(quick_qm_struct%dense,quick_scratch%hold,nbasis) ! Save DENSE to HOLD
 
-         ! PIJ=SIGMA[i=1,nelec/2]2CJK*CIK
-         do I=1,nbasis
-            do J=1,nbasis
-               DENSEJI = 0.d0
-               do K=1,quick_molspec%nelec/2
-                  DENSEJI = DENSEJI + (quick_qm_struct%co(J,K)*quick_qm_struct%co(I,K))
+            ! PIJ=SIGMA[i=1,nelec/2]2CJK*CIK
+            do I=1,nbasis
+               do J=1,nbasis
+                  DENSEJI = 0.d0
+                  do K=1,quick_molspec%nelec/2
+                     DENSEJI = DENSEJI + (quick_qm_struct%co(J,K)*quick_qm_struct%co(I,K))
+                  enddo
+                  quick_qm_struct%dense(J,I) = DENSEJI*2.d0
                enddo
-               quick_qm_struct%dense(J,I) = DENSEJI*2.d0
             enddo
-         enddo
+         endif
 
          call cpu_time(timer_end%TDII)
 
@@ -551,6 +606,25 @@ subroutine electdiis(jscf)
          enddo
          PRMS = rms(quick_qm_struct%dense,quick_scratch%hold,nbasis)
 
+         ! The purified density has no orbitals. On the last cycle diagonalize
+         ! Transpose[X] . O . X, still in HOLD2, for the orbitals and energies.
+         if (purified .and. ((PRMS < quick_method%pmaxrms .and. pchange < quick_method%pmaxrms*100.d0 &
+               .and. jscf.gt.MIN_SCF) .or. jscf >= quick_method%iscf-1 &
+               .or. idiis.gt.MAX_DII_CYCLE_TIME*quick_method%maxdiisscf)) then
+            call cpu_time(timer_begin%TDiag)
+            call DIAGDC(nbasis,quick_scratch%hold2,nbasis,quick_method%DMCutoff,V2,quick_qm_struct%E,&
+                  quick_qm_struct%idegen,quick_qm_struct%vec,IERROR)
+#if defined(CUDA) || defined(CUDA_MPIV)
+            call cublas_DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, quick_qm_struct%x, &
+                  nbasis, quick_qm_struct%vec, nbasis, 0.0d0, quick_qm_struct%co,nbasis)
+            cudaco = .false.
+#else
+            call DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, quick_qm_struct%x, &
+                  nbasis, quick_qm_struct%vec, nbasis, 0.0d0, quick_qm_struct%co,nbasis)
+#endif
+            call cpu_time(timer_end%TDiag)
+         endif
+
          tmp = quick_method%integralCutoff
          call adjust_cutoff(PRMS,PCHANGE,quick_method)  !from quick_method_module
       endif
@@ -573,6 +647,10 @@ subroutine electdiis(jscf)
          current_diis=mod(idiis-1,quick_method%maxdiisscf)
          current_diis=current_diis+1
 
+         ! mark the full operator builds between the delta density cycles
+         if (jscf.gt.1 .and. jscf.ge.quick_method%ncyc .and. .not.deltaO) &
+               write(ioutfile, '(4x, "--------------- FULL OPERATOR REBUILD AT CYCLE ", i3, " -------------")') jscf
+
          write (ioutfile,'(I3,1x)',advance="no") jscf
          if(quick_method%printEnergy)then
             write (ioutfile,'(F16.9,2x)',advance="no") quick_qm_struct%Eel+quick_qm_struct%Ecore
@@ -602,6 +680,7 @@ subroutine electdiis(jscf)
             write (ioutfile,'(" REACH CONVERGENCE AFTER ",i3," CYLCES")') jscf
             write (ioutfile,'(" MAX ERROR = ",E12.6,2x," RMS CHANGE = ",E12.6,2x," MAX CHANGE = ",E12.6)') &
                   errormax,prms,pchange
+            if (quick_method%purify) write (ioutfile,'(" DENSITY PURIFIED IN ",i3," OF ",i3," CYCLES")') npurified,jscf
             write (ioutfile,*) '-----------------------------------------------'
             if (quick_method%DFT .or. quick_method%SEDFT) then
                write (ioutfile,'("ALPHA ELECTRON DENSITY    =",F16.10)') quick_qm_struct%aelec
@@ -636,6 +715,9 @@ subroutine electdiis(jscf)
          call MPI_BCAST(quick_qm_struct%dense,nbasis*nbasis,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
          call MPI_BCAST(quick_qm_struct%denseOld,nbasis*nbasis,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
          call MPI_BCAST(quick_qm_struct%co,nbasis*nbasis,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
+#ifdef CUDA_MPIV
+         call MPI_BCAST(cudaco,1,mpi_logical,0,MPI_COMM_WORLD,mpierror)
+#endif
          call MPI_BCAST(quick_qm_struct%E,nbasis,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
          call MPI_BCAST(quick_method%integralCutoff,1,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
          call MPI_BCAST(quick_method%primLimit,1,mpi_double_precision,0,MPI_COMM_WORLD,mpierror)
@@ -646,9 +728,10 @@ subroutine electdiis(jscf)
    enddo
 
 #if defined CUDA || defined CUDA_MPIV
-   if(quick_method%bCUDA) then
+   if(quick_method%bCUDA .and. cudaco) then
       ! sign of the coefficient matrix resulting from cusolver is not consistent
       ! with rest of the code (e.g. gradients). We have to correct this.
+      ! Not when the last CO came from DIAGDC on the purified path.
       call scalarMatMul(quick_qm_struct%co,nbasis,nbasis,-1.0d0)       
    endif
 #endif
@@ -915,7 +998,7 @@ subroutine electdiisdc(jscf,PRMS)
          !--------------------------------------------
          call cpu_time(timer_begin%TDiag) ! Trigger the dc timer for subsytem
 
-         call DIAG(NtempN,Odcsubtemp,NtempN,quick_method%DMCutoff,Vtemp,EVAL1temp,IDEGEN1temp,VECtemp,IERROR)
+         call DIAGDC(NtempN,Odcsubtemp,NtempN,quick_method%DMCutoff,Vtemp,EVAL1temp,IDEGEN1temp,VECtemp,IERROR)
 
          call cpu_time(timer_end%TDiag)  ! Stop the timer
 
@@ -1308,3 +1391,139 @@ subroutine fermiSCF(efermi,jscf)
    call flush(ioutfile)
 
 end subroutine fermiSCF
+
+
+
+!*******************************************************
+! purify_density
+!-------------------------------------------------------
+! Density matrix by trace resetting 4th order purification (TRS4,
+! A. M. N. Niklasson, Phys. Rev. B 66, 155115 (2002)) of the operator
+! f in the orthogonal basis. Only matrix multiplies are needed. On
+! return dense = 2 X P X with P the projector on the nocc lowest
+! eigenvectors of f. ierr is not 0 when the purification does not
+! converge, dense is then left untouched.
+!
+subroutine purify_density(nbasis,nocc,f,x,dense,ierr)
+   implicit none
+
+   integer, intent(in) :: nbasis, nocc
+   double precision, intent(in) :: f(nbasis,nbasis), x(nbasis,nbasis)
+   double precision, intent(inout) :: dense(nbasis,nbasis)
+   integer, intent(out) :: ierr
+
+   integer, parameter :: maxit = 100
+   double precision, dimension(:,:), allocatable :: p, p2, w
+   double precision :: emin, emax, r, gamma, idem, idemOld
+   double precision :: trp, trp2, trp3, trp4, trf, trg
+   integer :: i, j, it
+
+   ierr = 1
+   if (nocc <= 0 .or. nocc >= nbasis) return
+
+   allocate(p(nbasis,nbasis),p2(nbasis,nbasis),w(nbasis,nbasis))
+
+   ! Gershgorin bounds of the spectrum of f
+   emin = huge(1.0d0)
+   emax = -huge(1.0d0)
+   do j = 1, nbasis
+      r = 0.0d0
+      do i = 1, nbasis
+         if (i /= j) r = r + abs(f(i,j))
+      enddo
+      emin = min(emin, f(j,j) - r)
+      emax = max(emax, f(j,j) + r)
+   enddo
+
+   ! start from f mapped onto [0,1], the lowest eigenvalue going to 1
+   do j = 1, nbasis
+      do i = 1, nbasis
+         p(i,j) = -f(i,j) / (emax - emin)
+      enddo
+      p(j,j) = p(j,j) + emax / (emax - emin)
+   enddo
+
+   idemOld = huge(1.0d0)
+   do it = 1, maxit
+#if defined(CUDA) || defined(CUDA_MPIV)
+      call cublas_DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, p, &
+            nbasis, p, nbasis, 0.0d0, p2, nbasis)
+#else
+      call DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, p, &
+            nbasis, p, nbasis, 0.0d0, p2, nbasis)
+#endif
+
+      ! traces of p**k, p and p2 are symmetric
+      trp = 0.0d0
+      trp2 = 0.0d0
+      trp3 = 0.0d0
+      trp4 = 0.0d0
+      do j = 1, nbasis
+         trp = trp + p(j,j)
+         trp2 = trp2 + p2(j,j)
+         do i = 1, nbasis
+            trp3 = trp3 + p2(i,j)*p(i,j)
+            trp4 = trp4 + p2(i,j)*p2(i,j)
+         enddo
+      enddo
+
+      ! idempotency error tr(p - p**2), stop once it reaches the
+      ! rounding level or stops going down
+      idem = trp - trp2
+      if (idem < 1.0d-11 .or. (idem < 1.0d-6 .and. idem >= idemOld)) then
+         if (nint(trp) == nocc) ierr = 0
+         exit
+      endif
+      idemOld = idem
+
+      ! p = F(p) + gamma G(p) with F = p**2 (4p - 3p**2) and
+      ! G = p**2 (1 - p)**2, gamma keeps the trace at nocc
+      trf = 4.0d0*trp3 - 3.0d0*trp4
+      trg = trp2 - 2.0d0*trp3 + trp4
+      gamma = 0.0d0
+      if (trg > 0.0d0) gamma = (nocc - trf) / trg
+
+      if (gamma > 6.0d0) then
+         p = 2.0d0*p - p2
+      else if (gamma < 0.0d0) then
+         p = p2
+      else
+         w = (4.0d0 - 2.0d0*gamma)*p + (gamma - 3.0d0)*p2
+         do j = 1, nbasis
+            w(j,j) = w(j,j) + gamma
+         enddo
+#if defined(CUDA) || defined(CUDA_MPIV)
+         call cublas_DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, p2, &
+               nbasis, w, nbasis, 0.0d0, p, nbasis)
+#else
+         call DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, p2, &
+               nbasis, w, nbasis, 0.0d0, p, nbasis)
+#endif
+         ! p2 and w commute, keep p symmetric against rounding
+         do j = 1, nbasis
+            do i = j+1, nbasis
+               r = 0.5d0*(p(i,j) + p(j,i))
+               p(i,j) = r
+               p(j,i) = r
+            enddo
+         enddo
+      endif
+   enddo
+
+   if (ierr == 0) then
+#if defined(CUDA) || defined(CUDA_MPIV)
+      call cublas_DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, p, &
+            nbasis, x, nbasis, 0.0d0, w, nbasis)
+      call cublas_DGEMM ('n', 'n', nbasis, nbasis, nbasis, 2.0d0, x, &
+            nbasis, w, nbasis, 0.0d0, dense, nbasis)
+#else
+      call DGEMM ('n', 'n', nbasis, nbasis, nbasis, 1.0d0, p, &
+            nbasis, x, nbasis, 0.0d0, w, nbasis)
+      call DGEMM ('n', 'n', nbasis, nbasis, nbasis, 2.0d0, x, &
+            nbasis, w, nbasis, 0.0d0, dense, nbasis)
+#endif
+   endif
+
+   deallocate(p,p2,w)
+
+end subroutine purify_density
@@ -34,12 +34,8 @@ subroutine scf_operator(oneElecO, deltaO)
    logical :: deltaO
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2, I, J
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
-#ifdef MPIV
-   integer ierror
-   double precision,allocatable:: temp2d(:,:)
-
-   allocate(temp2d(nbasis,nbasis))
-#endif
+   !$omp threadprivate(/hrrstore/)
+   double precision,allocatable:: o1e(:,:)
 !-----------------------------------------------------------------
 !  Step 1. evaluate 1e integrals
 !-----------------------------------------------------------------
@@ -61,16 +57,24 @@ subroutine scf_operator(oneElecO, deltaO)
    endif
 #endif
 
-!  if only calculate operation difference
+!  The 2e integrals are summed into the operator on their own and the 1e
+!  part is added back afterwards, so that the 2e part can be saved for
+!  the next cycle.
+   allocate(o1e(nbasis,nbasis))
+   call CopyDMat(quick_qm_struct%o,o1e,nbasis)
+
+!  if only calculate operation difference, start from the 2e part of
+!  the last cycle and build from the delta density
    if (deltaO) then
 !     save density matrix
       call CopyDMat(quick_qm_struct%dense,quick_qm_struct%denseSave,nbasis)
-      call CopyDMat(quick_qm_struct%oSave,quick_qm_struct%o,nbasis)
+      call CopyDMat(quick_qm_struct%o2eSave,quick_qm_struct%o,nbasis)
 
       do I=1,nbasis; do J=1,nbasis
          quick_qm_struct%dense(J,I)=quick_qm_struct%dense(J,I)-quick_qm_struct%denseOld(J,I)
       enddo; enddo
-
+   else
+      call zeroMatrix(quick_qm_struct%o,nbasis)
    endif
 
 !  Delta density matrix cutoff
@@ -141,19 +145,12 @@ subroutine scf_operator(oneElecO, deltaO)
 !  Every nodes will take about jshell/nodes shells integrals such as 1 water, which has 
 !  4 jshell, and 2 nodes will take 2 jshell respectively.
    if(bMPI) then
-      do i=1,mpi_jshelln(mpirank)
-         ii=mpi_jshell(mpirank,i)
-         call get2e(II)
-      enddo
+      call get2e_omp(mpi_jshelln(mpirank),mpi_jshell(mpirank,1:mpi_jshelln(mpirank)))
    else
-      do II=1,jshell
-         call get2e(II)
-      enddo
+      call get2e_omp(jshell,(/(I,I=1,jshell)/))
    endif        
 #else
-      do II=1,jshell
-         call get2e(II)
-      enddo
+      call get2e_omp(jshell,(/(I,I=1,jshell)/))
 #endif
 
 #if defined CUDA || defined CUDA_MPIV 
@@ -162,31 +159,10 @@ subroutine scf_operator(oneElecO, deltaO)
    endif
 
 #ifdef MPIV
-call MPI_BARRIER(MPI_COMM_WORLD,mpierror)
-
-!  After evaluation of 2e integrals, we can communicate every node so
-!  that we can sum all integrals. slave node will send infos.
-   if(.not.master) then
-!  Copy Opertor to a temp array and then send it to master
-      call copyDMat(quick_qm_struct%o,temp2d,nbasis)
-!  Send operator to master node
-      call MPI_SEND(temp2d,nbasis*nbasis,mpi_double_precision,0,mpirank,MPI_COMM_WORLD,IERROR)
-   else
-
-!  master node will receive infos from every nodes
-      do i=1,mpisize-1
-!  receive opertors from slave nodes
-         call MPI_RECV(temp2d,nbasis*nbasis,mpi_double_precision,i,i,MPI_COMM_WORLD,MPI_STATUS,IERROR)
-!   Sum them into operator
-         do ii=1,nbasis
-            do jj=1,nbasis
-               quick_qm_struct%o(ii,jj)=quick_qm_struct%o(ii,jj)+temp2d(ii,jj)
-            enddo
-         enddo
-      enddo
-   endif
-!  Sync all nodes
-   call MPI_BARRIER(MPI_COMM_WORLD,mpierror)
+!  After evaluation of 2e integrals, sum the operators of all nodes into
+!  the master. Only the lower triangle is reduced, as the master completes
+!  the operator with copySym below.
+   call reduce_lower_mpi(quick_qm_struct%o,nbasis)
 #endif
 
 !  recover density if calculate difference
@@ -198,6 +174,10 @@ call MPI_BARRIER(MPI_COMM_WORLD,mpierror)
 !  Remember the operator is symmetric
    call copySym(quick_qm_struct%o,nbasis)
 
+!  Save the 2e part and add the 1e part back
+   call CopyDMat(quick_qm_struct%o,quick_qm_struct%o2eSave,nbasis)
+   quick_qm_struct%o = quick_qm_struct%o + o1e
+
 !  Give the energy, E=1/2*sigma[i,j](Pij*(Fji+Hcoreji))
    if(quick_method%printEnergy) call get2eEnergy()
 
@@ -276,10 +256,12 @@ subroutine get_xc
 !  df/dgab is the derivative of the functional by the dot product of
 !  the gradient of the alpha density with the beta density.
 !  Grad(Phimu Phinu) is the gradient of Phimu times Phinu. 
+!
+!  The grid is processed a bin at a time: the densities of all points
+!  of a bin come from the bin's density matrix sub-block with one DSYMM
+!  and the bin's operator block is formed with one DSYR2K (xc_bin.f90).
 !----------------------------------------------------------------
    use allmod
-   use xc_f90_types_m
-   use xc_f90_lib_m
    implicit none
 
 #ifdef MPIV
@@ -289,26 +271,23 @@ subroutine get_xc
    !integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2, I, J
    !common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
 
-   double precision, dimension(1) :: libxc_rho
-   double precision, dimension(1) :: libxc_sigma
-   double precision, dimension(1) :: libxc_exc
-   double precision, dimension(1) :: libxc_vrhoa
-   double precision, dimension(1) :: libxc_vsigmaa
-   type(xc_f90_pointer_t), dimension(quick_method%nof_functionals) :: xc_func
-   type(xc_f90_pointer_t), dimension(quick_method%nof_functionals) :: xc_info   
-   integer :: iatm, ibas, ibin, icount, ifunc, igp, jbas, jcount, ierror 
+!  libxc input and output of the points of a bin
+   double precision, allocatable, dimension(:) :: libxc_rho, libxc_sigma, libxc_exc, &
+   libxc_vrhoa, libxc_vsigmaa
+   integer :: ibin, igp, ip, mbf, mpt, nbf, nd, npt
    double precision :: density, densityb, densitysum, dfdgaa, dfdgaa2, dfdgab, &
-   dfdgab2, dfdr, dfdr2, dphi2dx, dphi2dy, dphi2dz, dphidx, dphidy, dphidz, &
-   gax, gay, gaz, gbx, gby, gbz, gridx, gridy, gridz, phi, phi2, quicktest, &
-   sigma, sswt, temp, tempgx, tempgy, tempgz, tsttmp_exc, tsttmp_vrhoa, &
-   tsttmp_vsigmaa, weight, xdot, ydot, zdot, xiaodot, zkec, Ex, Ec, Eelxc
+   dfdgab2, dfdr, dfdr2, gax, gay, gaz, gbx, gby, gbz, &
+   sigma, weight, xdot, ydot, zdot, xiaodot, zkec, Ex, Ec, Eelxc
 
-#ifdef MPIV
-   integer :: i, ii, irad_end, irad_init, jj
-   double precision :: Eelxcslave
-   double precision, allocatable:: temp2d(:,:)
+!  Bin scratch: grid points and basis functions of the bin, the functions
+!  and their gradients at those points, densities and weighted potentials,
+!  see xc_bin.f90
+   integer, allocatable :: bgp(:), bfn(:)
+   double precision, allocatable :: bphi(:,:,:), bmat(:,:), btmp(:,:), bdens(:,:), bpot(:,:)
 
-   allocate(temp2d(nbasis,nbasis))
+#ifdef MPIV
+   integer :: irad_end, irad_init
+   double precision :: Eelxcsum, txcstart, txcrank
 
 !  Braodcast libxc information to slaves
    call MPI_BCAST(quick_method%nof_functionals,1,mpi_integer,0,MPI_COMM_WORLD,mpierror)        
@@ -324,7 +303,6 @@ subroutine get_xc
 #ifdef MPIV
 !  Set the values of slave operators to zero
    if (.not.master) quick_qm_struct%o = 0.0d0
-   temp2d = 0.0d0
 #endif
 
 #if defined CUDA || defined CUDA_MPIV
@@ -343,19 +321,18 @@ subroutine get_xc
    endif
 #else
 
-   if(quick_method%uselibxc) then
-!  Initiate the libxc functionals
-      do ifunc=1, quick_method%nof_functionals
-         if(quick_method%xc_polarization > 0 ) then
-            call xc_f90_func_init(xc_func(ifunc), xc_info(ifunc), &
-                  quick_method%functional_id(ifunc),XC_POLARIZED)
-         else
-            call xc_f90_func_init(xc_func(ifunc), &
-                  xc_info(ifunc),quick_method%functional_id(ifunc),XC_UNPOLARIZED)
-         endif
-      enddo
-   endif
+!  Initiate the libxc functionals, the handles are kept across calls
+   if(quick_method%uselibxc) call init_libxc_handles(quick_method)
 
+!  Size the bin scratch for the largest bin
+   mpt=1
+   mbf=1
+   do Ibin=1, quick_dft_grid%nbins
+      mpt=max(mpt,quick_dft_grid%bin_counter(Ibin+1)-quick_dft_grid%bin_counter(Ibin))
+      mbf=max(mbf,quick_dft_grid%basf_counter(Ibin+1)-quick_dft_grid%basf_counter(Ibin))
+   enddo
+   allocate(bgp(mpt),bfn(mbf),bphi(mpt,mbf,4),bmat(mbf,mbf),btmp(mpt,mbf),bdens(mpt,4),bpot(mpt,4))
+   allocate(libxc_rho(mpt),libxc_sigma(mpt),libxc_exc(mpt),libxc_vrhoa(mpt),libxc_vsigmaa(mpt))
 
 #if defined MPIV && !defined CUDA_MPIV
       if(bMPI) then
@@ -365,204 +342,140 @@ subroutine get_xc
          irad_init = 1
          irad_end = quick_dft_grid%nbins
       endif
+      txcstart = MPI_Wtime()
    do Ibin=irad_init, irad_end
    
 #else
     do Ibin=1, quick_dft_grid%nbins
 #endif
 
-        Igp=quick_dft_grid%bin_counter(Ibin)+1
+        nbf=quick_dft_grid%basf_counter(Ibin+1)-quick_dft_grid%basf_counter(Ibin)
+
+!  Collect the grid points of the bin that carry weight
+        npt=0
+        do Igp=quick_dft_grid%bin_counter(Ibin)+1, quick_dft_grid%bin_counter(Ibin+1)
+           if (quick_dft_grid%gridb_weight(Igp) >= quick_method%DMCutoff ) then
+              npt=npt+1
+              bgp(npt)=Igp
+           endif
+        enddo
+
+        if (npt == 0 .or. nbf == 0) cycle
+
+!  Next, evaluate the basis functions of the bin at all of its points and
+!  from them the densities and their gradients at every point.
+        call xc_bin_density(Ibin,npt,mpt,mbf,bgp,bfn,nd,bphi,bmat,btmp,bdens)
+
+!  Evaluate the libxc functionals for all points of the bin at once
+        if(quick_method%uselibxc) then
+           do ip=1,npt
+              libxc_rho(ip)=2.0d0*bdens(ip,1)
+              libxc_sigma(ip)=4.0d0*(bdens(ip,2)**2+bdens(ip,3)**2+bdens(ip,4)**2)
+           enddo
+           call xc_bin_libxc(npt,libxc_rho,libxc_sigma,libxc_exc,libxc_vrhoa,libxc_vsigmaa)
+        endif
+
+        do ip=1,npt
+           weight=quick_dft_grid%gridb_weight(bgp(ip))
+
+           density=bdens(ip,1)
+           gax=bdens(ip,2)
+           gay=bdens(ip,3)
+           gaz=bdens(ip,4)
+           densityb=density
+           gbx=gax
+           gby=gay
+           gbz=gaz
+
+           bpot(ip,:)=0.0d0
+
+           if (density < quick_method%DMCutoff ) then
+              continue
+           else
+
+!  This allows the calculation of the derivative of the functional with regard to the 
+!  density (dfdr), with regard to the alpha-alpha density invariant (df/dgaa), and the
+!  alpha-beta density invariant.
+
+              densitysum=2.0d0*density
+              sigma=4.0d0*(gax*gax+gay*gay+gaz*gaz)
 
-        do while(Igp < quick_dft_grid%bin_counter(Ibin+1)+1)
+              if(quick_method%uselibxc) then
+                 zkec=densitysum*libxc_exc(ip)
+                 dfdr=libxc_vrhoa(ip)
+                 xiaodot=libxc_vsigmaa(ip)*4
 
-           gridx=quick_dft_grid%gridxb(Igp)
-           gridy=quick_dft_grid%gridyb(Igp)
-           gridz=quick_dft_grid%gridzb(Igp)
+!  Calculate the first term in the dot product shown above,
+!  i.e.: (2 df/dgaa Grad(rho a) + df/dgab Grad(rho b)) doT Grad(Phimu Phinu))
+                 xdot=xiaodot*gax
+                 ydot=xiaodot*gay
+                 zdot=xiaodot*gaz
 
-           sswt=quick_dft_grid%gridb_sswt(Igp)
-           weight=quick_dft_grid%gridb_weight(Igp)
-           Iatm=quick_dft_grid%gridb_atm(Igp)
+              elseif(quick_method%BLYP) then
 
-            if (weight < quick_method%DMCutoff ) then
-               continue
-            else
+                 call becke_E(density, densityb, gax, gay, gaz, gbx, gby,gbz, Ex)
+                 call lyp_e(density, densityb, gax, gay, gaz, gbx, gby, gbz,Ec)
 
-               icount=quick_dft_grid%basf_counter(Ibin)+1
-               do while (icount < quick_dft_grid%basf_counter(Ibin+1)+1)
-               Ibas=quick_dft_grid%basf(icount)+1
-                  call pteval(gridx,gridy,gridz,phi,dphidx,dphidy, &
-                  dphidz,Ibas)
-                  phixiao(Ibas)=phi
-                  dphidxxiao(Ibas)=dphidx
-                  dphidyxiao(Ibas)=dphidy
-                  dphidzxiao(Ibas)=dphidz
+                 zkec=Ex+Ec
 
-                  icount=icount+1
-               enddo
+                 call becke(density, gax, gay, gaz, gbx, gby, gbz, dfdr, dfdgaa, dfdgab)
+                 call lyp(density, densityb, gax, gay, gaz, gbx, gby, gbz, dfdr2, dfdgaa2, dfdgab2)
 
-!  Next, evaluate the densities at the grid point and the gradient
-!  at that grid point.
+                 dfdr = dfdr + dfdr2
+                 dfdgaa = dfdgaa + dfdgaa2
+                 dfdgab = dfdgab + dfdgab2
 
-!               call denspt(gridx,gridy,gridz,density,densityb,gax,gay,gaz, &
-!               gbx,gby,gbz)
+                 xdot = 2.d0*dfdgaa*gax + dfdgab*gbx
+                 ydot = 2.d0*dfdgaa*gay + dfdgab*gby
+                 zdot = 2.d0*dfdgaa*gaz + dfdgab*gbz
 
-               call denspt_new_imp(gridx,gridy,gridz,density,densityb,gax,gay,gaz, &
-               gbx,gby,gbz,Ibin)
+              elseif(quick_method%B3LYP) then
 
-               if (density < quick_method%DMCutoff ) then
-                  continue
-               else
+                 call b3lyp_e(densitysum, sigma, zkec)
+                 call b3lypf(densitysum, sigma, dfdr, xiaodot)
 
-!  This allows the calculation of the derivative of the functional with regard to the 
-!  density (dfdr), with regard to the alpha-alpha density invariant (df/dgaa), and the
-!  alpha-beta density invariant.
+                 xdot=xiaodot*gax
+                 ydot=xiaodot*gay
+                 zdot=xiaodot*gaz
 
-                  densitysum=2.0d0*density
-                  sigma=4.0d0*(gax*gax+gay*gay+gaz*gaz)
-
-                  libxc_rho(1)=densitysum
-                  libxc_sigma(1)=sigma
-
-                  tsttmp_exc=0.0d0
-                  tsttmp_vrhoa=0.0d0
-                  tsttmp_vsigmaa=0.0d0
-
-                  if(quick_method%uselibxc) then
-                     do ifunc=1, quick_method%nof_functionals
-                        select case(xc_f90_info_family(xc_info(ifunc)))
-                           case(XC_FAMILY_LDA)
-                              call xc_f90_lda_exc_vxc(xc_func(ifunc),1,libxc_rho(1), &
-                              libxc_exc(1), libxc_vrhoa(1))
-                              libxc_vsigmaa(1) = 0.0d0
-                           case(XC_FAMILY_GGA, XC_FAMILY_HYB_GGA)
-                              call xc_f90_gga_exc_vxc(xc_func(ifunc),1,libxc_rho(1), libxc_sigma(1), &
-                              libxc_exc(1), libxc_vrhoa(1), libxc_vsigmaa(1))
-                        end select
-
-                        tsttmp_exc=tsttmp_exc+libxc_exc(1)
-                        tsttmp_vrhoa=tsttmp_vrhoa+libxc_vrhoa(1)
-                        tsttmp_vsigmaa=tsttmp_vsigmaa+libxc_vsigmaa(1)
-                     enddo
-
-                     zkec=densitysum*tsttmp_exc
-                     dfdr=tsttmp_vrhoa
-                     xiaodot=tsttmp_vsigmaa*4
+              endif
 
-!  Calculate the first term in the dot product shown above,
-!  i.e.: (2 df/dgaa Grad(rho a) + df/dgab Grad(rho b)) doT Grad(Phimu Phinu))
-                     xdot=xiaodot*gax
-                     ydot=xiaodot*gay
-                     zdot=xiaodot*gaz
-
-                  elseif(quick_method%BLYP) then
-
-                     call becke_E(density, densityb, gax, gay, gaz, gbx, gby,gbz, Ex)
-                     call lyp_e(density, densityb, gax, gay, gaz, gbx, gby, gbz,Ec)
-
-                     zkec=Ex+Ec
-                     
-                     call becke(density, gax, gay, gaz, gbx, gby, gbz, dfdr, dfdgaa, dfdgab)
-                     call lyp(density, densityb, gax, gay, gaz, gbx, gby, gbz, dfdr2, dfdgaa2, dfdgab2)
-
-                     dfdr = dfdr + dfdr2
-                     dfdgaa = dfdgaa + dfdgaa2
-                     dfdgab = dfdgab + dfdgab2
-
-                     xdot = 2.d0*dfdgaa*gax + dfdgab*gbx
-                     ydot = 2.d0*dfdgaa*gay + dfdgab*gby
-                     zdot = 2.d0*dfdgaa*gaz + dfdgab*gbz
-
-                  elseif(quick_method%B3LYP) then
-
-                     call b3lyp_e(densitysum, sigma, zkec)
-                     call b3lypf(densitysum, sigma, dfdr, xiaodot)
-
-                     xdot=xiaodot*gax
-                     ydot=xiaodot*gay
-                     zdot=xiaodot*gaz
-
-                  endif
-
-                  Eelxc = Eelxc + zkec*weight
-
-                  quick_qm_struct%aelec = weight*density+quick_qm_struct%aelec
-                  quick_qm_struct%belec = weight*densityb+quick_qm_struct%belec
-
-!  Now loop over basis functions and compute the addition to the matrix element.
-!                  do Ibas=1,nbasis
-                  icount=quick_dft_grid%basf_counter(Ibin)+1
-                  do while (icount < quick_dft_grid%basf_counter(Ibin+1)+1)
-                  Ibas=quick_dft_grid%basf(icount)+1
-
-                     phi=phixiao(Ibas)
-                     dphidx=dphidxxiao(Ibas)
-                     dphidy=dphidyxiao(Ibas)
-                     dphidz=dphidzxiao(Ibas)
-                     quicktest = DABS(dphidx+dphidy+dphidz+phi)
-
-                     if (quicktest < quick_method%DMCutoff ) then
-                        continue
-                     else
-                        jcount=icount
-                        do while(jcount<quick_dft_grid%basf_counter(Ibin+1)+1)
-                        Jbas = quick_dft_grid%basf(jcount)+1
-                        !do Jbas=Ibas,nbasis
-                           phi2=phixiao(Jbas)
-                           dphi2dx=dphidxxiao(Jbas)
-                           dphi2dy=dphidyxiao(Jbas)
-                           dphi2dz=dphidzxiao(Jbas)
-                           temp = phi*phi2
-                           tempgx = phi*dphi2dx + phi2*dphidx
-                           tempgy = phi*dphi2dy + phi2*dphidy
-                           tempgz = phi*dphi2dz + phi2*dphidz
-                           quick_qm_struct%o(Jbas,Ibas)=quick_qm_struct%o(Jbas,Ibas)+(temp*dfdr+&
-                           xdot*tempgx+ydot*tempgy+zdot*tempgz)*weight
-                           jcount=jcount+1
-                        enddo
-                     endif
-                     icount=icount+1
-                  enddo
-               endif
-            endif
-         !enddo
-
-         Igp=Igp+1
-      enddo
+              Eelxc = Eelxc + zkec*weight
+
+              quick_qm_struct%aelec = weight*density+quick_qm_struct%aelec
+              quick_qm_struct%belec = weight*densityb+quick_qm_struct%belec
+
+!  Weighted potential of the point, contracted with the basis functions below
+              bpot(ip,1)=dfdr*weight
+              bpot(ip,2)=xdot*weight
+              bpot(ip,3)=ydot*weight
+              bpot(ip,4)=zdot*weight
+           endif
+        enddo
+
+!  Now add the contribution of the whole bin to the operator.
+        call xc_bin_fock(npt,mpt,mbf,nbf,bfn,bphi,bpot,btmp,bmat)
    enddo
 
-   if(quick_method%uselibxc) then
-!  Uninitilize libxc functionals
-      do ifunc=1, quick_method%nof_functionals
-         call xc_f90_func_end(xc_func(ifunc))
-      enddo
-   endif
+#if defined MPIV && !defined CUDA_MPIV
+   txcrank = MPI_Wtime()-txcstart
 #endif
 
-#ifdef MPIV
-   if(.not. master) then
-!  Send the Exc energy value
-      Eelxcslave=Eelxc
-      call MPI_SEND(Eelxcslave,1,mpi_double_precision,0,mpirank,MPI_COMM_WORLD,IERROR)
-      call copyDMat(quick_qm_struct%o,temp2d,nbasis)
-      call MPI_SEND(temp2d,nbasis*nbasis,mpi_double_precision,0,mpirank,MPI_COMM_WORLD,IERROR)
-   else
+   deallocate(bgp,bfn,bphi,bmat,btmp,bdens,bpot)
+   deallocate(libxc_rho,libxc_sigma,libxc_exc,libxc_vrhoa,libxc_vsigmaa)
+#endif
 
-!  Master node will receive infos from every nodes
-      do i=1,mpisize-1
-!  Receive exchange correlation energy from slaves
-         call MPI_RECV(Eelxcslave,1,mpi_double_precision,i,i,MPI_COMM_WORLD,MPI_STATUS,IERROR)
-         Eelxc=Eelxc+Eelxcslave
-!  Receive opertors from slave nodes
-         call  MPI_RECV(temp2d,nbasis*nbasis,mpi_double_precision,i,i,MPI_COMM_WORLD,MPI_STATUS,IERROR)
-!  Sum them into operator
-         do ii=1,nbasis
-            do jj=1,nbasis
-               quick_qm_struct%o(ii,jj)=quick_qm_struct%o(ii,jj)+temp2d(ii,jj)
-            enddo
-         enddo
-      enddo
-   endif
-   call MPI_BARRIER(MPI_COMM_WORLD,mpierror)
+#ifdef MPIV
+!  Sum the exchange correlation energy and the lower triangle of the
+!  operator of all nodes into the master, see reduce_lower_mpi
+   call MPI_REDUCE(Eelxc,Eelxcsum,1,mpi_double_precision,MPI_SUM,0,MPI_COMM_WORLD,mpierror)
+   if(master) Eelxc=Eelxcsum
+   call reduce_lower_mpi(quick_qm_struct%o,nbasis)
+
+#ifndef CUDA_MPIV
+!  Move bins away from ranks that took longer than the others
+   if(bMPI) call rebalance_xc_mpi(txcrank)
+#endif
 #endif
 
 #ifdef MPIV
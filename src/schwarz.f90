@@ -38,8 +38,223 @@ subroutine schwarzoff
       endif
 #endif
 
+  call shellPairList
+
 end subroutine schwarzoff
 
+!------------------------------------------------
+! shellPairList
+!------------------------------------------------
+subroutine shellPairList
+  !------------------------------------------------
+  ! This subroutine is to sort the shell pairs by decreasing
+  ! Ycutoff, so that get2e_pair can stop at the first ket pair
+  ! that cannot pass the cutoff, and to gather the primitive
+  ! pair data of every shell pair contiguously for shell.
+  ! It must be called after the Schwarz cutoffs of a geometry.
+  !------------------------------------------------
+  use allmod
+
+  Implicit none
+
+  integer :: II,JJ,ips,jps,Nprii,Nprij,ipair,iprim
+  integer, allocatable :: pairOrder(:),pairTemp(:,:)
+  double precision, allocatable :: pairY(:)
+
+  nshellpair=jshell*(jshell+1)/2
+  allocate(pairOrder(nshellpair),pairTemp(2,nshellpair),pairY(nshellpair))
+
+  ipair=0
+  do JJ=1,jshell
+     do II=1,JJ
+        ipair=ipair+1
+        pairOrder(ipair)=ipair
+        pairTemp(1,ipair)=II
+        pairTemp(2,ipair)=JJ
+        pairY(ipair)=Ycutoff(II,JJ)
+     enddo
+  enddo
+
+  call DIndexOrder(nshellpair,pairY,pairOrder)
+
+  do ipair=1,nshellpair
+     shellPair(1:2,ipair)=pairTemp(1:2,pairOrder(ipair))
+  enddo
+
+  ! the second primitive is the outer loop in shell
+  iprim=0
+  do JJ=1,jshell
+     do II=1,jshell
+        pairPrimStart(II,JJ)=iprim+1
+        do jps=1,quick_basis%kprim(JJ)
+           Nprij=quick_basis%kstart(JJ)+jps-1
+           do ips=1,quick_basis%kprim(II)
+              Nprii=quick_basis%kstart(II)+ips-1
+              iprim=iprim+1
+              pairPrim(1,iprim)=Apri(Nprii,Nprij)
+              pairPrim(2:4,iprim)=Ppri(1:3,Nprii,Nprij)
+              pairPrim(5,iprim)=cutprim(Nprii,Nprij)
+           enddo
+        enddo
+     enddo
+  enddo
+
+  deallocate(pairOrder,pairTemp,pairY)
+
+end subroutine shellPairList
+
+!------------------------------------------------
+! eriCachePlan
+!------------------------------------------------
+subroutine eriCachePlan
+  !------------------------------------------------
+  ! This subroutine is to choose the shell quartets whose
+  ! integrals semi-direct scf keeps in eriCache. Quartets are
+  ! ranked by the work to compute them per stored integral,
+  ! which grows with their primitive count and angular momenta,
+  ! and taken from the top until semidirectMem is used up. The
+  ! cache is filled by the first operator build, see shellcache,
+  ! and refilled whenever adjust_cutoff lowers primLimit.
+  ! In MPI every node only plans the quartets of the II shells
+  ! it computes, within its own semidirectMem.
+  ! It must be called after shellPairList and MPI_setup_hfoperator.
+  !------------------------------------------------
+  use allmod
+
+  Implicit none
+
+  integer, parameter :: nbin = 64
+  integer :: II,JJ,KK,LL,ipair,ibin,tbin,ipass,nentry
+  integer :: nfunc(jshell),lmax(jshell)
+  logical :: ownII(jshell)
+  integer(kind=longLongInt) :: nvalue,box
+  double precision :: budget,used,work,entryBytes,binBytes(0:nbin-1),cacheBytes
+#ifdef MPIV
+  integer :: nentryAll
+  double precision :: cacheBytesAll
+  include 'mpif.h'
+#endif
+
+  ! bytes of a cache entry besides its integrals: ket, offset and filled flag
+  entryBytes = 16.0d0
+  budget = quick_method%semidirectMem*1024.0d0*1024.0d0
+
+  do II=1,jshell
+     nfunc(II) = quick_basis%Qfbasis(II,quick_basis%Qfinal(II))-quick_basis%Qsbasis(II,quick_basis%Qstart(II))+1
+     lmax(II) = quick_basis%Qfinal(II)
+  enddo
+
+  ! first shells of the quartets get2e_omp computes on this node
+  ownII = .true.
+#if defined MPIV && !defined CUDA_MPIV
+  if (bMPI) then
+     ownII = .false.
+     ownII(mpi_jshell(mpirank,1:mpi_jshelln(mpirank))) = .true.
+  endif
+#endif
+
+  if (allocated(eriCacheBra)) deallocate(eriCacheBra,eriCacheKet,eriCacheOffset,eriCacheFilled,eriCache)
+  allocate(eriCacheBra(2,jshell,jshell))
+
+  ! bytes of the quartets in every bin of log2(work per integral)
+  binBytes = 0.0d0
+  do JJ=1,jshell
+     do II=1,JJ
+        if (.not. ownII(II)) cycle
+        do ipair=1,nshellpair
+           KK=shellPair(1,ipair)
+           LL=shellPair(2,ipair)
+           if (Ycutoff(II,JJ)*Ycutoff(KK,LL) .le. quick_method%integralCutoff) exit
+           if (KK .ge. II) then
+              call quartetWork
+              binBytes(ibin) = binBytes(ibin)+8.0d0*box+entryBytes
+           endif
+        enddo
+     enddo
+  enddo
+
+  ! all quartets of the bins above tbin fit, those of tbin as far as they go
+  used = 0.0d0
+  tbin = -1
+  do ibin=nbin-1,0,-1
+     if (used+binBytes(ibin) .gt. budget) then
+        tbin = ibin
+        exit
+     endif
+     used = used+binBytes(ibin)
+  enddo
+
+  ! count the cached quartets, then fill the index
+  do ipass=1,2
+     nentry = 0
+     nvalue = 0
+     used = 0.0d0
+     do ibin=tbin+1,nbin-1
+        used = used+binBytes(ibin)
+     enddo
+     do JJ=1,jshell
+        do II=1,JJ
+           eriCacheBra(1,II,JJ) = nentry+1
+           do ipair=1,nshellpair
+              KK=shellPair(1,ipair)
+              LL=shellPair(2,ipair)
+              if (.not. ownII(II)) exit
+              if (Ycutoff(II,JJ)*Ycutoff(KK,LL) .le. quick_method%integralCutoff) exit
+              if (KK .ge. II) then
+                 call quartetWork
+                 if (ibin .eq. tbin) then
+                    if (used+8.0d0*box+entryBytes .gt. budget) cycle
+                    used = used+8.0d0*box+entryBytes
+                 else if (ibin .lt. tbin) then
+                    cycle
+                 endif
+                 nentry = nentry+1
+                 if (ipass .eq. 2) then
+                    eriCacheKet(nentry) = ipair
+                    eriCacheOffset(nentry) = nvalue
+                 endif
+                 nvalue = nvalue+box
+              endif
+           enddo
+           eriCacheBra(2,II,JJ) = nentry
+           eriCacheBra(1:2,JJ,II) = eriCacheBra(1:2,II,JJ)
+        enddo
+     enddo
+     if (ipass .eq. 1) then
+        allocate(eriCacheKet(max(nentry,1)),eriCacheOffset(max(nentry,1)),eriCacheFilled(max(nentry,1)), &
+              eriCache(max(nvalue,1_longLongInt)))
+     endif
+  enddo
+  eriCacheFilled = .false.
+  eriCachePrimLimit = quick_method%primLimit
+
+  cacheBytes = 8.0d0*nvalue+entryBytes*nentry
+#if defined MPIV && !defined CUDA_MPIV
+  if (bMPI) then
+     call MPI_REDUCE(nentry,nentryAll,1,mpi_integer,MPI_SUM,0,MPI_COMM_WORLD,mpierror)
+     call MPI_REDUCE(cacheBytes,cacheBytesAll,1,mpi_double_precision,MPI_SUM,0,MPI_COMM_WORLD,mpierror)
+     nentry = nentryAll
+     cacheBytes = cacheBytesAll
+  endif
+#endif
+
+  ! summed over the nodes in MPI
+  if (master) write(ioutfile,'("  SEMI-DIRECT INTEGRAL CACHE = ",i10," QUARTETS, ",f10.2," MB")') &
+        nentry, cacheBytes/1024.0d0/1024.0d0
+
+contains
+
+  ! box is the integral count of (II JJ|KK LL), ibin its log2 of the primitive
+  ! quartets times the vrr size per integral
+  subroutine quartetWork
+     box = int(nfunc(II),longLongInt)*nfunc(JJ)*nfunc(KK)*nfunc(LL)
+     work = dble(quick_basis%kprim(II)*quick_basis%kprim(JJ))*quick_basis%kprim(KK)*quick_basis%kprim(LL) &
+           *Sumindex(lmax(II)+lmax(JJ))*Sumindex(lmax(KK)+lmax(LL))/box
+     ibin = min(nbin-1,max(0,int(log(work)/log(2.0d0))+nbin/4))
+  end subroutine quartetWork
+
+end subroutine eriCachePlan
+
 
 
 subroutine shellcutoff(II,JJ,Ymax)
@@ -48,14 +263,15 @@ subroutine shellcutoff(II,JJ,Ymax)
   Implicit double precision(a-h,o-z)
   double precision P(3),Q(3),W(3),KAB,KCD
   Parameter(NN=13)
-  double precision FM(0:13)
   double precision RA(3),RB(3),RC(3),RD(3)
 
   double precision Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
 
   COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+  !$omp threadprivate(/VRRcom/)
 
   COMMON /COM1/RA,RB,RC,RD
+  !$omp threadprivate(/COM1/)
 
   KK=II
   LL=JJ
@@ -93,6 +309,32 @@ subroutine shellcutoff(II,JJ,Ymax)
   NABCD=NII2+NJJ2+NKK2+NLL2
   ITT=0
 
+  ! Evaluate the Boys function of all primitive quartets in one batch
+  do JJJ=1,quick_basis%kprim(JJ)
+     Nprij=quick_basis%kstart(JJ)+JJJ-1
+     do III=1,quick_basis%kprim(II)
+        Nprii=quick_basis%kstart(II)+III-1
+        AB=Apri(Nprii,Nprij)
+        do LLL=1,quick_basis%kprim(LL)
+           Npril=quick_basis%kstart(LL)+LLL-1
+           do KKK=1,quick_basis%kprim(KK)
+              Nprik=quick_basis%kstart(KK)+KKK-1
+              CD=Apri(Nprik,Npril)
+              ROU=AB*CD/(AB+CD)
+              RPQ=0.0d0
+              do M=1,3
+                 XXXtemp=Ppri(M,Nprii,Nprij)-Ppri(M,Nprik,Npril)
+                 RPQ=RPQ+XXXtemp*XXXtemp
+              enddo
+              ITT=ITT+1
+              Tbatch(ITT)=RPQ*ROU
+           enddo
+        enddo
+     enddo
+  enddo
+  call FmT_batch(ITT,NABCD,Tbatch,size(FMbatch,1),FMbatch)
+  ITT=0
+
   do JJJ=1,quick_basis%kprim(JJ)
      Nprij=quick_basis%kstart(JJ)+JJJ-1
      do III=1,quick_basis%kprim(II)
@@ -109,8 +351,6 @@ subroutine shellcutoff(II,JJ,Ymax)
               Nprik=quick_basis%kstart(KK)+KKK-1
               CD=Apri(Nprik,Npril)
               ABCD=AB+CD
-              ROU=AB*CD/ABCD
-              RPQ=0.0d0
               ABCDxiao=dsqrt(ABCD)    
 
               CDtemp=0.5d0/CD
@@ -121,21 +361,16 @@ subroutine shellcutoff(II,JJ,Ymax)
               do M=1,3
                  Q(M)=Ppri(M,Nprik,Npril)
                  W(M)=(P(M)*AB+Q(M)*CD)/ABCD
-                 XXXtemp=P(M)-Q(M)
-                 RPQ=RPQ+XXXtemp*XXXtemp
                  Qtemp(M)=Q(M)-RC(M)
                  WQtemp(M)=W(M)-Q(M)
                  WPtemp(M)=W(M)-P(M)
               enddo
-              T=RPQ*ROU
+              ITT=ITT+1
 
-              call FmT(NABCD,T,FM)
               do iitemp=0,NABCD
-                 Yxiaotemp(1,1,iitemp)=FM(iitemp)/ABCDxiao
+                 Yxiaotemp(1,1,iitemp)=FMbatch(ITT,iitemp)/ABCDxiao
               enddo
 
-              ITT=ITT+1
-
               call vertical(NABCDTYPE)
 
               do I2=NNC,NNCD
@@ -225,11 +460,13 @@ subroutine classcutoff(I,J,K,L,II,JJ,KK,LL,NNA,NNC,NNAB,NNCD,Ymax)
   integer angxiaoL(20),angxiaoR(20),numangularL,numangularR
 
   COMMON /COM1/RA,RB,RC,RD
+  !$omp threadprivate(/COM1/)
   COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
   COMMON /COM4/P,Q,W
   COMMON /COM5/FM
 
   common /xiaostore/store
+  !$omp threadprivate(/xiaostore/)
 
   ITT=0
   do JJJ=1,quick_basis%kprim(JJ)
@@ -398,11 +635,13 @@ subroutine classprim(I,J,K,L,II,JJ,KK,LL,NNA,NNC,NNAB,NNCD,Ymax1,IIIxiao,JJJxiao
   integer angxiaoL(20),angxiaoR(20),numangularL,numangularR
 
   COMMON /COM1/RA,RB,RC,RD
+  !$omp threadprivate(/COM1/)
   COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
   COMMON /COM4/P,Q,W
   COMMON /COM5/FM
 
   common /xiaostore/store
+  !$omp threadprivate(/xiaostore/)
 
 
   ITT=0
@@ -595,4 +834,6 @@ subroutine densityCutoff
          Cutmatrix(JJ,II)=DNtemp
       enddo
    enddo
+
+   cutmatrixMax=maxval(cutmatrix(1:jshell,1:jshell))
 end subroutine densityCutoff
@@ -86,30 +86,6 @@ subroutine g2eshell
 
 end subroutine g2eshell
 
-subroutine writeInt(iIntFile, intDim, a, b, int)
-   Implicit none
-   integer i,intDim, iIntFile
-   integer a(intDim), b(intDim)
-   double precision int(intDim)
-
-   write(iIntFile) a, b, int
-
-!do i = 1, intDim
- !  write(*,*) i, a(i),b(i),int(i)
-!enddo
-end subroutine writeInt
-
-
-subroutine readInt(iIntFile, intDim, a, b, int)
-   Implicit none
-   integer, parameter :: llInt = selected_int_kind (16)
-   integer iIntFile, i
-   integer(kind=llInt) intDim
-   integer a(intDim), b(intDim)
-   double precision int(intDim)
-   read(iIntFile) a, b, int
-end subroutine readInt
-
 !-------------------------
 !  aoint
 !  writen by Yipu Miao 07/16/12
@@ -119,10 +95,15 @@ subroutine aoint
    !  This subroutine is used to store 2e-integral into files
    !------------------------------
    use allmod
+!$ use omp_lib
    Implicit none
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2,INTNUM, INTBEG, INTTOT, I, J
    double precision leastIntegralCutoff, t1, t2
+   integer ierr, nthreads
+   integer, allocatable :: shellFirst(:), shellLast(:)
+   integer(kind=longLongInt) :: intFileBytes
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
    call PrtAct(ioutfile,"Begin Calculation 2E TO DISK")
 
@@ -145,10 +126,18 @@ subroutine aoint
    inttot = intindex
 #else
 
-   if (quick_method%nodirect) then
-      !call quick_open(iIntFile, intFileName, 'R', 'U', 'R',.true.)
-      !open(unit=iIntFile, file=intFileName, form="unformatted", access="stream",convert='big_endian')
-      open(unit=iIntFile, file=intFileName,  form="unformatted", access="stream") 
+   ! integrals are stored by shell quartet, indexed inside the basis function range of each shell
+   allocate(shellFirst(jshell), shellLast(jshell))
+   do II = 1, jshell
+      shellFirst(II) = quick_basis%ksumtype(II)+quick_basis%Qsbasis(II,quick_basis%Qstart(II))
+      shellLast(II) = quick_basis%ksumtype(II)+quick_basis%Qfbasis(II,quick_basis%Qfinal(II))
+   enddo
+   call intstore_create(intFileName, len_trim(intFileName), nbasis, jshell, shellFirst, shellLast, &
+         quick_method%maxIntegralCutoff, ierr)
+   deallocate(shellFirst, shellLast)
+   if (ierr .ne. 0) then
+      call PrtErr(iOutFile, 'UNABLE TO CREATE THE 2E INTEGRAL FILE FOR NODIRECT')
+      call quick_exit(iOutFile, 1)
    endif
 
 
@@ -164,6 +153,10 @@ subroutine aoint
             if ( Ycutoff(II,JJ)*Ycutoff(KK,LL).gt. quick_method%leastIntegralCutoff) then
                dnmax = 1.0
                call shell
+               if (.not. incoreInt) then
+                  call intstore_put(bufferInt, aBuffer, bBuffer, intBuffer)
+                  bufferInt = 0
+               endif
                intnum = intnum+1
             endif
          enddo; enddo;
@@ -179,17 +172,11 @@ subroutine aoint
          bIncore(i+incoreIndex) = bBuffer(i)
          intIncore(i+incoreIndex) = intBuffer(i)
       enddo
-   else
-      call writeInt(iIntFile, bufferInt, aBuffer, bBuffer, intBuffer)
    endif
 
-
-
    inttot = intbeg
 
-   if (quick_method%nodirect) then
-      close(iIntFile)
-   endif
+   call intstore_close(intFileBytes)
 #endif
 
 
@@ -199,9 +186,17 @@ subroutine aoint
 
    write(ioutfile, '("-----------------------------")')
    write(ioutfile, '("      TOTAL INTEGRAL     = ", i12)') inttot
+#ifdef CUDA
    write(ioutfile, '("      INTEGRAL FILE SIZE = ", f12.2, " MB")')  &
          dble(dble(intindex) * (kind(0.0d0) + 2 * kind(I))/1024/1024)
    write(ioutfile, '("      INTEGRAL RECORD    = ", i12)') intindex / bufferSize + 1
+#else
+   write(ioutfile, '("      INTEGRAL FILE SIZE = ", f12.2, " MB")') dble(intFileBytes)/1024/1024
+   ! threads addInt contracts the file on, one without OpenMP
+   nthreads = 1
+!$ nthreads = omp_get_max_threads()
+   write(ioutfile, '("      CONTRACT THREADS   = ", i12)') nthreads
+#endif
    write(ioutfile, '("      USAGE TIME         = ", f12.2, " s")')  timer_cumer%T2eAll
    call PrtAct(ioutfile,"FINISH 2E Calculation")
 
@@ -209,252 +204,29 @@ end subroutine aoint
 
 
 subroutine addInt
+   !------------------------------
+   !  This subroutine is to add the 2e integrals stored by aoint
+   !  to the operator, J[P]-x_hybrid_coeff/2*K[P] as in iclass.
+   !  The contraction runs over the shell quartet records of the
+   !  integral file on the OpenMP threads, see intstore.cpp.
+   !------------------------------
    use allmod
    Implicit none
 
-   integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2,INTNUM, INTBEG, INTTOT
-   common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
-   double precision DENSEKI, DENSEKJ, DENSELJ, DENSELI, DENSELK, DENSEJI, DENSEII, DENSEJJ, DENSEKK
-   integer  I,J,K,L
-   integer*4 A, B
-   integer III1, III2, JJJ1, JJJ2, KKK1, KKK2, LLL1, LLL2
-   integer NII1, NII2, NJJ1, NJJ2, NKK1, NKK2, NLL1, NLL2
-   logical intSkip
-
-   integer bufferPackNum, remainingBufffer, totalInt
-   integer(kind=longLongInt) :: thisBuffer
-
-   if (quick_method%nodirect) then
-      !call quick_open(iIntFile, intFileName, 'O', 'U', 'W',.true.)
-      !open(unit=iIntFile, file=intFileName,  form="unformatted", access="direct", recl=kind(1.0d0)+2*kind(1), status="old")
-      open(unit=iIntFile, file=intFileName,  form="unformatted", access="stream")
-   endif
-
-   bufferPackNum = intindex / bufferSize + 1
-   remainingBufffer = intindex
-   rewind(iIntFile)
-
-   totalInt = 0
-   incoreIndex = 0
+   integer ierr
 
    if (incoreInt) then
-      bufferPackNum = 1
-      thisBuffer = intindex
-   endif
-
-   do II = 1, bufferPackNum
-
-      if (.not. incoreInt) then
-         if (remainingBufffer .gt. bufferSize) then
-            thisBuffer = bufferSize
-            remainingBufffer = remainingBufffer - bufferSize
-         else
-            thisBuffer = remainingBufffer
-         endif
-         call readInt(iIntFile, thisBuffer, aBuffer, bBuffer, intBuffer)
+      call intstore_contract_list(intindex, aIncore, bIncore, intIncore, nbasis, quick_qm_struct%dense, &
+            0.5d0*quick_method%x_hybrid_coeff, quick_qm_struct%o)
+   else
+      call intstore_contract(intFileName, len_trim(intFileName), nbasis, quick_qm_struct%dense, &
+            0.5d0*quick_method%x_hybrid_coeff, quick_qm_struct%o, ierr)
+      if (ierr .ne. 0) then
+         call PrtErr(iOutFile, 'UNABLE TO READ THE 2E INTEGRAL FILE FOR NODIRECT')
+         call quick_exit(iOutFile, 1)
       endif
-
-
-      do i = 1, thisBuffer
-
-         if (incoreInt) then
-            A = aIncore(i)
-            B = bIncore(i)
-            Y = intIncore(i)
-         else
-            A = aBuffer(i)
-            B = bBuffer(i)
-            Y = intBuffer(i)
-         endif
-         III = int(A/nbasis) + 1
-         JJJ = mod(A, nbasis) + 1
-         KKK = int(B/nbasis) + 1
-         LLL = mod(B, nbasis) + 1
-
-!write(*,*) III,JJJ,KKK,LLL, Y
-         if(III.lt.JJJ.and.III.lt.KKK.and.KKK.lt.LLL)then
-
-            !write(*,*) IJKLTYPE,NABCDTYPE, Y, II,JJ,KK,LL,III,JJJ,KKK,LLL
-            DENSEKI=quick_qm_struct%dense(KKK,III)
-            DENSEKJ=quick_qm_struct%dense(KKK,JJJ)
-            DENSELJ=quick_qm_struct%dense(LLL,JJJ)
-            DENSELI=quick_qm_struct%dense(LLL,III)
-            DENSELK=quick_qm_struct%dense(LLL,KKK)
-            DENSEJI=quick_qm_struct%dense(JJJ,III)
-
-            ! Find the (ij|kl) integrals where j>i,k>i,l>k. Note that k and j
-            ! can be equal.
-            quick_qm_struct%o(JJJ,III) = quick_qm_struct%o(JJJ,III)+2.d0*DENSELK*Y
-            quick_qm_struct%o(LLL,KKK) = quick_qm_struct%o(LLL,KKK)+2.d0*DENSEJI*Y
-            quick_qm_struct%o(KKK,III) = quick_qm_struct%o(KKK,III)-.5d0*DENSELJ*Y
-            quick_qm_struct%o(LLL,III) = quick_qm_struct%o(LLL,III)-.5d0*DENSEKJ*Y
-            quick_qm_struct%o(JJJ,KKK) = quick_qm_struct%o(JJJ,KKK)-.5d0*DENSELI*Y
-            quick_qm_struct%o(JJJ,LLL) = quick_qm_struct%o(JJJ,LLL)-.5d0*DENSEKI*Y
-            quick_qm_struct%o(KKK,JJJ) = quick_qm_struct%o(KKK,JJJ)-.5d0*DENSELI*Y
-            quick_qm_struct%o(LLL,JJJ) = quick_qm_struct%o(LLL,JJJ)-.5d0*DENSEKI*Y
-
-         else
-            if(III.LT.KKK)then
-               if(III.lt.JJJ.and.KKK.lt.LLL)then
-
-                  DENSEKI=quick_qm_struct%dense(KKK,III)
-                  DENSEKJ=quick_qm_struct%dense(KKK,JJJ)
-                  DENSELJ=quick_qm_struct%dense(LLL,JJJ)
-                  DENSELI=quick_qm_struct%dense(LLL,III)
-                  DENSELK=quick_qm_struct%dense(LLL,KKK)
-                  DENSEJI=quick_qm_struct%dense(JJJ,III)
-
-                  ! Find the (ij|kl) integrals where j>i,k>i,l>k. Note that k and j
-                  ! can be equal.
-
-                  quick_qm_struct%o(JJJ,III) = quick_qm_struct%o(JJJ,III)+2.d0*DENSELK*Y
-                  quick_qm_struct%o(LLL,KKK) = quick_qm_struct%o(LLL,KKK)+2.d0*DENSEJI*Y
-                  quick_qm_struct%o(KKK,III) = quick_qm_struct%o(KKK,III)-.5d0*DENSELJ*Y
-                  quick_qm_struct%o(LLL,III) = quick_qm_struct%o(LLL,III)-.5d0*DENSEKJ*Y
-                  quick_qm_struct%o(JJJ,KKK) = quick_qm_struct%o(JJJ,KKK)-.5d0*DENSELI*Y
-                  quick_qm_struct%o(JJJ,LLL) = quick_qm_struct%o(JJJ,LLL)-.5d0*DENSEKI*Y
-                  quick_qm_struct%o(KKK,JJJ) = quick_qm_struct%o(KKK,JJJ)-.5d0*DENSELI*Y
-                  quick_qm_struct%o(LLL,JJJ) = quick_qm_struct%o(LLL,JJJ)-.5d0*DENSEKI*Y
-
-               else if(III.eq.JJJ.and.KKK.eq.LLL)then
-
-                  DENSEJI=quick_qm_struct%dense(KKK,III)
-                  DENSEJJ=quick_qm_struct%dense(KKK,KKK)
-                  DENSEII=quick_qm_struct%dense(III,III)
-                  ! Find  all the (ii|jj) integrals.
-                  quick_qm_struct%o(III,III) = quick_qm_struct%o(III,III)+DENSEJJ*Y
-                  quick_qm_struct%o(KKK,KKK) = quick_qm_struct%o(KKK,KKK)+DENSEII*Y
-                  quick_qm_struct%o(KKK,III) = quick_qm_struct%o(KKK,III)-.5d0*DENSEJI*Y
-
-               else if(JJJ.eq.KKK.and.JJJ.eq.LLL)then
-
-                  DENSEJI=quick_qm_struct%dense(JJJ,III)
-                  DENSEJJ=quick_qm_struct%dense(JJJ,JJJ)
-
-                  ! Find  all the (ij|jj) integrals.
-                  quick_qm_struct%o(JJJ,III) = quick_qm_struct%o(JJJ,III)+.5d0*DENSEJJ*Y
-                  quick_qm_struct%o(JJJ,JJJ) = quick_qm_struct%o(JJJ,JJJ)+DENSEJI*Y
-                  !        ! Find  all the (ii|ij) integrals.
-                  !        ! Find all the (ij|ij) integrals
-
-
-                  ! Find all the (ij|ik) integrals where j>i,k>j
-               else if(KKK.eq.LLL.and.III.lt.JJJ.and.JJJ.ne.KKK)then
-
-                  DENSEKI=quick_qm_struct%dense(KKK,III)
-                  DENSEKJ=quick_qm_struct%dense(KKK,JJJ)
-                  DENSEKK=quick_qm_struct%dense(KKK,KKK)
-                  DENSEJI=quick_qm_struct%dense(JJJ,III)
-
-                  ! Find all the (ij|kk) integrals where j>i, k>j.
-                  quick_qm_struct%o(JJJ,III) = quick_qm_struct%o(JJJ,III)+DENSEKK*Y
-                  quick_qm_struct%o(KKK,KKK) = quick_qm_struct%o(KKK,KKK)+2.d0*DENSEJI*Y
-                  quick_qm_struct%o(KKK,III) = quick_qm_struct%o(KKK,III)-.5d0*DENSEKJ*Y
-                  quick_qm_struct%o(KKK,JJJ) = quick_qm_struct%o(KKK,JJJ)-.5d0*DENSEKI*Y
-                  quick_qm_struct%o(JJJ,KKK) = quick_qm_struct%o(JJJ,KKK)-.5d0*DENSEKI*Y
-                  !        ! Find all the (ik|jj) integrals where j>i, k>j.
-
-               else if(III.eq.JJJ.and.KKK.lt.LLL)then
-
-                  DENSEII=quick_qm_struct%dense(III,III)
-                  DENSEJI=quick_qm_struct%dense(KKK,III)
-                  DENSEKI=quick_qm_struct%dense(LLL,III)
-                  DENSEKJ=quick_qm_struct%dense(LLL,KKK)
-
-                  ! Find all the (ii|jk) integrals where j>i, k>j.
-                  quick_qm_struct%o(LLL,KKK) = quick_qm_struct%o(LLL,KKK)+DENSEII*Y
-                  quick_qm_struct%o(III,III) = quick_qm_struct%o(III,III)+2.d0*DENSEKJ*Y
-                  quick_qm_struct%o(KKK,III) = quick_qm_struct%o(KKK,III)-.5d0*DENSEKI*Y
-                  quick_qm_struct%o(LLL,III) = quick_qm_struct%o(LLL,III)-.5d0*DENSEJI*Y
-
-               endif
-            else
-               if(JJJ.LE.LLL)then
-                  if(III.eq.JJJ.and.III.eq.KKK.and.III.eq.LLL)then
-
-                     DENSEII=quick_qm_struct%dense(III,III)
-
-                     ! do all the (ii|ii) integrals.
-                     quick_qm_struct%o(III,III) = quick_qm_struct%o(III,III)+.5d0*DENSEII*Y
-
-                  else if(III.eq.JJJ.and.III.eq.KKK.and.III.lt.LLL)then
-
-                     DENSEJI=quick_qm_struct%dense(LLL,III)
-                     DENSEII=quick_qm_struct%dense(III,III)
-
-                     ! Find  all the (ii|ij) integrals.
-                     quick_qm_struct%o(LLL,III) = quick_qm_struct%o(LLL,III)+.5d0*DENSEII*Y
-                     quick_qm_struct%o(III,III) = quick_qm_struct%o(III,III)+DENSEJI*Y
-
-                  else if(III.eq.KKK.and.JJJ.eq.LLL.and.III.lt.JJJ)then
-
-                     DENSEJI=quick_qm_struct%dense(JJJ,III)
-                     DENSEJJ=quick_qm_struct%dense(JJJ,JJJ)
-                     DENSEII=quick_qm_struct%dense(III,III)
-
-                     ! Find all the (ij|ij) integrals
-                     quick_qm_struct%o(JJJ,III) = quick_qm_struct%o(JJJ,III)+1.50*DENSEJI*Y
-                     quick_qm_struct%o(JJJ,JJJ) = quick_qm_struct%o(JJJ,JJJ)-.5d0*DENSEII*Y
-                     quick_qm_struct%o(III,III) = quick_qm_struct%o(III,III)-.5d0*DENSEJJ*Y
-
-                  else if(III.eq.KKK.and.III.lt.JJJ.and.JJJ.lt.LLL)then
-
-                     DENSEKI=quick_qm_struct%dense(LLL,III)
-                     DENSEKJ=quick_qm_struct%dense(LLL,JJJ)
-                     DENSEII=quick_qm_struct%dense(III,III)
-                     DENSEJI=quick_qm_struct%dense(JJJ,III)
-
-                     ! Find all the (ij|ik) integrals where j>i,k>j
-                     quick_qm_struct%o(JJJ,III) = quick_qm_struct%o(JJJ,III)+1.5d0*DENSEKI*Y
-                     quick_qm_struct%o(LLL,III) = quick_qm_struct%o(LLL,III)+1.5d0*DENSEJI*Y
-                     quick_qm_struct%o(III,III) = quick_qm_struct%o(III,III)-1.d0*DENSEKJ*Y
-                     quick_qm_struct%o(LLL,JJJ) = quick_qm_struct%o(LLL,JJJ)-.5d0*DENSEII*Y
-
-                  endif
-               endif
-            endif
-
-
-         endif
-         1000     continue
-      enddo
-   enddo
-
-   if (quick_method%nodirect) then
-      close(iIntFile)
    endif
 
-   goto 100
-
-   ! this part is designed for integral that has accuracy that beyond 2e integral file
-   quick_method%nodirect = .false.
-
-
-   do II = 1,jshell
-      do JJ = II,jshell
-         do KK = II,jshell
-            do LL = KK,jshell
-               DNmax =  max(4.0d0*cutmatrix(II,JJ), &
-                     4.0d0*cutmatrix(KK,LL), &
-                     cutmatrix(II,LL), &
-                     cutmatrix(II,KK), &
-                     cutmatrix(JJ,KK), &
-                     cutmatrix(JJ,LL))
-               ! (IJ|KL)^2<=(II|JJ)*(KK|LL) if smaller than cutoff criteria, then
-               ! ignore the calculation to save computation time
-               if ( (Ycutoff(II,JJ)*Ycutoff(KK,LL)        .gt. quick_method%integralCutoff).and. &
-                     (Ycutoff(II,JJ)*Ycutoff(KK,LL)*DNmax  .gt. quick_method%integralCutoff) .and. &
-                     (Ycutoff(II,JJ)*Ycutoff(KK,LL)  .lt. quick_method%leastIntegralCutoff))  &
-                     call shell
-
-            enddo
-         enddo
-
-      enddo
-   enddo
-   quick_method%nodirect = .true.
-   100 continue
-
 end subroutine addInt
 
 
@@ -466,15 +238,17 @@ subroutine shell
    Implicit double precision(a-h,o-z)
    double precision P(3),Q(3),W(3),KAB,KCD,AAtemp(3)
    Parameter(NN=13)
-   double precision FM(0:13)
    double precision RA(3),RB(3),RC(3),RD(3)
 
    double precision Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
 
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
    COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+   !$omp threadprivate(/VRRcom/)
    COMMON /COM1/RA,RB,RC,RD
+   !$omp threadprivate(/COM1/)
 
    do M=1,3
       RA(M)=xyz(M,quick_basis%katom(II))
@@ -525,164 +299,186 @@ subroutine shell
   !stop
 !--------------------Madu--------------------------
 
-   !  the first cycle is for j prim
-   !  JJJ and NpriJ are the tracking indices
-   do JJJ=1,quick_basis%kprim(JJ)
-     
-      Nprij=quick_basis%kstart(JJ)+JJJ-1
-
-      ! the second cycle is for i prim
-      ! II and NpriI are the tracking indices
-      do III=1,quick_basis%kprim(II)
-         Nprii=quick_basis%kstart(II)+III-1
-         !For NpriI and NpriJ primitives, we calculate the following quantities
-         AB=Apri(Nprii,Nprij)    ! AB = Apri = expo(NpriI)+expo(NpriJ). Eqn 8 of HGP.
-         ABtemp=0.5d0/AB         ! ABtemp = 1/(2Apri) = 1/2(expo(NpriI)+expo(NpriJ))
-         ! This is term is required for Eqn 6 of HGP. 
-         cutoffprim1=dnmax*cutprim(Nprii,Nprij)
-
-         do M=1,3
-            !Eqn 9 of HGP
-            ! P' is the weighting center of NpriI and NpriJ
-            !                           --->           --->
-            ! ->  ------>       expo(I)*xyz(I)+expo(J)*xyz(J)
-            ! P = P'(I,J)  = ------------------------------
-            !                       expo(I) + expo(J)
-            P(M)=Ppri(M,Nprii,Nprij)
-           
-            !Multiplication of Eqns 9  by Eqn 8 of HGP.. 
-            !                        -->            -->
-            ! ----->         expo(I)*xyz(I)+expo(J)*xyz(J)                                 -->            -->
-            ! AAtemp = ----------------------------------- * (expo(I) + expo(J)) = expo(I)*xyz(I)+expo(J)*xyz(J)
-            !                  expo(I) + expo(J)
-            AAtemp(M)=P(M)*AB
-
-            !Requires for HGP Eqn 6. 
-            ! ----->   ->  ->
-            ! Ptemp  = P - A
-            Ptemp(M)=P(M)-RA(M)
-         enddo
-
-         ! the third cycle is for l prim
-         ! LLL and npriL are the tracking indices
-         do LLL=1,quick_basis%kprim(LL)
-            Npril=quick_basis%kstart(LL)+LLL-1
-
-            ! the forth cycle is for k prim
-            ! the KKK and nprik are the tracking indices
-            do KKK=1,quick_basis%kprim(KK)
-               Nprik=quick_basis%kstart(KK)+KKK-1
-
-               ! prim cutoff: cutoffprim(I,J,K,L) = dnmax * cutprim(I,J) * cutprim(K,L)
-               cutoffprim=cutoffprim1*cutprim(Nprik,Npril)
-               if(cutoffprim.gt.quick_method%primLimit)then
-
-                  !Nita quantity of HGP Eqn 10. This is same as
-                  !zita (AB) above. 
-                  CD=Apri(Nprik,Npril)  ! CD = Apri = expo(NpriK) + expo(NpriL)
-
-                  !First term of HGP Eqn 12 without sqrt. 
-                  ABCD=AB+CD            ! ABCD = expo(NpriI)+expo(NpriJ)+expo(NpriK)+expo(NpriL)
-
-                  !First term of HGP Eqn 13.
-                  !         AB * CD      (expo(I)+expo(J))*(expo(K)+expo(L))
-                  ! Rou = ----------- = ------------------------------------
-                  !         AB + CD         expo(I)+expo(J)+expo(K)+expo(L)
-                  ROU=AB*CD/ABCD
-
-                  RPQ=0.0d0
-                  
-                  !First term of HGP Eqn 12 with sqrt. 
-                  !              _______________________________
-                  ! ABCDxiao = \/expo(I)+expo(J)+expo(K)+expo(L)
-                  ABCDxiao=dsqrt(ABCD)
-
-                  !Not sure why we calculate the following. 
-                  CDtemp=0.5d0/CD       ! CDtemp =  1/2(expo(NpriK)+expo(NpriL))
-
-                  !These terms are required for HGP Eqn 6.
-                  !                expo(I)+expo(J)                        expo(K)+expo(L)
-                  ! ABcom = --------------------------------  CDcom = --------------------------------
-                  !          expo(I)+expo(J)+expo(K)+expo(L)           expo(I)+expo(J)+expo(K)+expo(L)
-                  ABcom=AB/ABCD
-                  CDcom=CD/ABCD
-
-                  ! ABCDtemp = 1/2(expo(I)+expo(J)+expo(K)+expo(L))
-                  ABCDtemp=0.5d0/ABCD
-
-                  do M=1,3
-
-                     !Calculate Q of HGP 10, which is same as P above. 
-                     ! Q' is the weighting center of NpriK and NpriL
-                     !                           --->           --->
-                     ! ->  ------>       expo(K)*xyz(K)+expo(L)*xyz(L)
-                     ! Q = P'(K,L)  = ------------------------------
-                     !                       expo(K) + expo(L)
-                     Q(M)=Ppri(M,Nprik,Npril)
-
-                     !HGP Eqn 10. 
-                     ! W' is the weight center for NpriI,NpriJ,NpriK and NpriL
-                     !                --->             --->             --->            --->
-                     ! ->     expo(I)*xyz(I) + expo(J)*xyz(J) + expo(K)*xyz(K) +expo(L)*xyz(L)
-                     ! W = -------------------------------------------------------------------
-                     !                    expo(I) + expo(J) + expo(K) + expo(L)
-                     W(M)=(AAtemp(M)+Q(M)*CD)/ABCD
+   ! the integrals of a cached quartet are read back by iclass
+   if (eriCacheMode .eq. 2) goto 100
+
+   ! The primitive pairs of (II,JJ) and (KK,LL) are contiguous in pairPrim,
+   ! see shellPairList.
+   iAB1=pairPrimStart(II,JJ)
+   iAB2=iAB1+quick_basis%kprim(II)*quick_basis%kprim(JJ)-1
+   iCD1=pairPrimStart(KK,LL)
+   iCD2=iCD1+quick_basis%kprim(KK)*quick_basis%kprim(LL)-1
+
+   ! Gather the Boys function arguments of all primitive quartets that pass
+   ! the primitive cutoff and evaluate them in one FmT_batch call. The loop
+   ! below visits the same quartets in the same order, so quartet ITT reads
+   ! its Fm values from FMbatch(ITT,:).
+   do iAB=iAB1,iAB2
+      AB=pairPrim(1,iAB)
+      cutoffprim1=dnmax*pairPrim(5,iAB)
+      do iCD=iCD1,iCD2
+         cutoffprim=cutoffprim1*pairPrim(5,iCD)
+         if(cutoffprim.gt.quick_method%primLimit)then
+            CD=pairPrim(1,iCD)
+
+            !First term of HGP Eqn 13.
+            !         AB * CD      (expo(I)+expo(J))*(expo(K)+expo(L))
+            ! Rou = ----------- = ------------------------------------
+            !         AB + CD         expo(I)+expo(J)+expo(K)+expo(L)
+            ROU=AB*CD/(AB+CD)
+
+            !Required for HGP Eqn 13.
+            !        ->  ->  2
+            ! RPQ =| P - Q |
+            RPQ=0.0d0
+            do M=1,3
+               XXXtemp=pairPrim(1+M,iAB)-pairPrim(1+M,iCD)
+               RPQ=RPQ+XXXtemp*XXXtemp
+            enddo
 
-                     !Required for HGP Eqn 13.
-                     !        ->  ->  2
-                     ! RPQ =| P - Q |
-                     XXXtemp=P(M)-Q(M)
-                     RPQ=RPQ+XXXtemp*XXXtemp
-                        
-                     !Not sure why we need the next two terms. 
-                     ! ---->   ->  ->
-                     ! Qtemp = Q - K
-                     Qtemp(M)=Q(M)-RC(M)
+            !HGP Eqn 13.
+            !             ->  -> 2
+            ! T = ROU * | P - Q|
+            ITT=ITT+1
+            Tbatch(ITT)=RPQ*ROU
+         endif
+      enddo
+   enddo
 
-                     ! ----->   ->  ->
-                     ! WQtemp = W - Q
-                     ! ----->   ->  ->
-                     ! WPtemp = W - P
-                     WQtemp(M)=W(M)-Q(M)
+   !                         2m        2
+   ! Fm(T) = integral(1,0) {t   exp(-Tt )dt}
+   ! NABCD is the m value, and FMbatch returns the FmT values
+   call FmT_batch(ITT,NABCD,Tbatch,size(FMbatch,1),FMbatch)
+   ITT=0
 
-                     !Required for HGP Eqns 6 and 16.
-                     WPtemp(M)=W(M)-P(M)
-                  enddo
+   !  the first cycle is for the i,j prim pairs, j prim outer
+   !  iAB is the tracking index
+   do iAB=iAB1,iAB2
+      !For NpriI and NpriJ primitives, we calculate the following quantities
+      AB=pairPrim(1,iAB)      ! AB = Apri = expo(NpriI)+expo(NpriJ). Eqn 8 of HGP.
+      ABtemp=0.5d0/AB         ! ABtemp = 1/(2Apri) = 1/2(expo(NpriI)+expo(NpriJ))
+      ! This is term is required for Eqn 6 of HGP. 
+      cutoffprim1=dnmax*pairPrim(5,iAB)
+
+      do M=1,3
+         !Eqn 9 of HGP
+         ! P' is the weighting center of NpriI and NpriJ
+         !                           --->           --->
+         ! ->  ------>       expo(I)*xyz(I)+expo(J)*xyz(J)
+         ! P = P'(I,J)  = ------------------------------
+         !                       expo(I) + expo(J)
+         P(M)=pairPrim(1+M,iAB)
+           
+         !Multiplication of Eqns 9  by Eqn 8 of HGP.. 
+         !                        -->            -->
+         ! ----->         expo(I)*xyz(I)+expo(J)*xyz(J)                                 -->            -->
+         ! AAtemp = ----------------------------------- * (expo(I) + expo(J)) = expo(I)*xyz(I)+expo(J)*xyz(J)
+         !                  expo(I) + expo(J)
+         AAtemp(M)=P(M)*AB
+
+         !Requires for HGP Eqn 6. 
+         ! ----->   ->  ->
+         ! Ptemp  = P - A
+         Ptemp(M)=P(M)-RA(M)
+      enddo
 
-                  !HGP Eqn 13. 
-                  !             ->  -> 2
-                  ! T = ROU * | P - Q|
-                  T=RPQ*ROU
-                  !                         2m        2
-                  ! Fm(T) = integral(1,0) {t   exp(-Tt )dt}
-                  ! NABCD is the m value, and FM returns the FmT value
-                  call FmT(NABCD,T,FM)
+      ! the second cycle is for the k,l prim pairs, l prim outer
+      ! iCD is the tracking index
+      do iCD=iCD1,iCD2
+
+         ! prim cutoff: cutoffprim(I,J,K,L) = dnmax * cutprim(I,J) * cutprim(K,L)
+         cutoffprim=cutoffprim1*pairPrim(5,iCD)
+         if(cutoffprim.gt.quick_method%primLimit)then
+
+            !Nita quantity of HGP Eqn 10. This is same as
+            !zita (AB) above. 
+            CD=pairPrim(1,iCD)    ! CD = Apri = expo(NpriK) + expo(NpriL)
+
+            !First term of HGP Eqn 12 without sqrt. 
+            ABCD=AB+CD            ! ABCD = expo(NpriI)+expo(NpriJ)+expo(NpriK)+expo(NpriL)
+
+            !First term of HGP Eqn 12 with sqrt. 
+            !              _______________________________
+            ! ABCDxiao = \/expo(I)+expo(J)+expo(K)+expo(L)
+            ABCDxiao=dsqrt(ABCD)
+
+            !Not sure why we calculate the following. 
+            CDtemp=0.5d0/CD       ! CDtemp =  1/2(expo(NpriK)+expo(NpriL))
+
+            !These terms are required for HGP Eqn 6.
+            !                expo(I)+expo(J)                        expo(K)+expo(L)
+            ! ABcom = --------------------------------  CDcom = --------------------------------
+            !          expo(I)+expo(J)+expo(K)+expo(L)           expo(I)+expo(J)+expo(K)+expo(L)
+            ABcom=AB/ABCD
+            CDcom=CD/ABCD
+
+            ! ABCDtemp = 1/2(expo(I)+expo(J)+expo(K)+expo(L))
+            ABCDtemp=0.5d0/ABCD
+
+            do M=1,3
+
+               !Calculate Q of HGP 10, which is same as P above. 
+               ! Q' is the weighting center of NpriK and NpriL
+               !                           --->           --->
+               ! ->  ------>       expo(K)*xyz(K)+expo(L)*xyz(L)
+               ! Q = P'(K,L)  = ------------------------------
+               !                       expo(K) + expo(L)
+               Q(M)=pairPrim(1+M,iCD)
+
+               !HGP Eqn 10. 
+               ! W' is the weight center for NpriI,NpriJ,NpriK and NpriL
+               !                --->             --->             --->            --->
+               ! ->     expo(I)*xyz(I) + expo(J)*xyz(J) + expo(K)*xyz(K) +expo(L)*xyz(L)
+               ! W = -------------------------------------------------------------------
+               !                    expo(I) + expo(J) + expo(K) + expo(L)
+               W(M)=(AAtemp(M)+Q(M)*CD)/ABCD
+
+               !Not sure why we need the next two terms. 
+               ! ---->   ->  ->
+               ! Qtemp = Q - K
+               Qtemp(M)=Q(M)-RC(M)
+
+               ! ----->   ->  ->
+               ! WQtemp = W - Q
+               ! ----->   ->  ->
+               ! WPtemp = W - P
+               WQtemp(M)=W(M)-Q(M)
+
+               !Required for HGP Eqns 6 and 16.
+               WPtemp(M)=W(M)-P(M)
+            enddo
 
-                  !Go through all m values, obtain Fm values from FM array we
-                  !just computed and calculate quantities required for HGP Eqn
-                  !12. 
-                  do iitemp=0,NABCD
-                     ! Yxiaotemp(1,1,iitemp) is the starting point of recurrsion
-                     Yxiaotemp(1,1,iitemp)=FM(iitemp)/ABCDxiao
-                     !              _______________________________
-                     ! ABCDxiao = \/expo(I)+expo(J)+expo(K)+expo(L)
-                  enddo
+            ITT=ITT+1
 
-                  ITT=ITT+1
-                  ! now we will do vrr and and the double-electron integral
-                  call vertical(NABCDTYPE)
-                  do I2=NNC,NNCD
-                     do I1=NNA,NNAB
-                        Yxiao(ITT,I1,I2)=Yxiaotemp(I1,I2,0)
-                     enddo
-                  enddo
-               endif
+            !Go through all m values, obtain Fm values from FMbatch we
+            !computed above and calculate quantities required for HGP Eqn
+            !12. 
+            do iitemp=0,NABCD
+               ! FMbatch(ITT,iitemp) is the starting point of recurrsion
+               FMbatch(ITT,iitemp)=FMbatch(ITT,iitemp)/ABCDxiao
+               !              _______________________________
+               ! ABCDxiao = \/expo(I)+expo(J)+expo(K)+expo(L)
             enddo
-         enddo
+
+            ! keep the vrr parameters of this quartet for vertical_batch
+            VRRbatch(ITT,1:3)=Ptemp
+            VRRbatch(ITT,4:6)=WPtemp
+            VRRbatch(ITT,7:9)=Qtemp
+            VRRbatch(ITT,10:12)=WQtemp
+            VRRbatch(ITT,13)=ABtemp
+            VRRbatch(ITT,14)=CDtemp
+            VRRbatch(ITT,15)=ABcom
+            VRRbatch(ITT,16)=CDcom
+            VRRbatch(ITT,17)=ABCDtemp
+         endif
       enddo
    enddo
 
-   do I=NII1,NII2
+   ! now we will do vrr of all primitive quartets and the double-electron integral
+   call vertical_batch(NII2+NJJ2,NKK2+NLL2,ITT,size(VRRbatch,1),VRRbatch,FMbatch, &
+         NNA,NNAB,NNC,NNCD,Yxiao,size(Yxiao,1),size(Yxiao,2))
+
+   100 do I=NII1,NII2
       NNA=Sumindex(I-1)+1
       do J=NJJ1,NJJ2
          NNAB=SumINDEX(I+J)
@@ -704,6 +500,63 @@ subroutine shell
    201 return
 end subroutine shell
 
+!------------------------------------------------
+! shellcache
+!------------------------------------------------
+subroutine shellcache(icache)
+   !------------------------------------------------
+   ! Semi-direct scf: add the integrals of the current
+   ! quartet, entry icache of the cache, to the operator.
+   ! The first call computes them with shell and stores
+   ! them, later calls read them back.
+   !------------------------------------------------
+   use allmod
+   Implicit none
+   integer icache
+   double precision dnmaxSave
+
+   eriCachePtr = eriCacheOffset(icache)
+   if (eriCacheFilled(icache)) then
+      eriCacheMode = 2
+      call shell
+   else
+      ! the stored integrals must not depend on the density
+      dnmaxSave = dnmax
+      dnmax = 1.0d0
+      eriCacheMode = 1
+      call shell
+      dnmax = dnmaxSave
+      eriCacheFilled(icache) = .true.
+   endif
+   eriCacheMode = 0
+
+end subroutine shellcache
+
+!------------------------------------------------
+! hrrcache
+!------------------------------------------------
+subroutine hrrcache
+   !------------------------------------------------
+   ! hrrwhole for the operator build of iclass, which
+   ! also stores Y to or reads it from the semi-direct
+   ! cache according to eriCacheMode
+   !------------------------------------------------
+   use allmod
+   Implicit none
+
+   if (eriCacheMode .eq. 2) then
+      eriCachePtr = eriCachePtr+1
+      Y = eriCache(eriCachePtr)
+   else
+      call hrrwhole
+      if (eriCacheMode .eq. 1) then
+         eriCachePtr = eriCachePtr+1
+         eriCache(eriCachePtr) = Y
+      endif
+   endif
+
+end subroutine hrrcache
+
 ! Horrizontal recursion and Fock matrix builder by Xiao HE 07/07/07 version
 subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
    use allmod
@@ -721,17 +574,22 @@ subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
    double precision Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
 
    COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+   !$omp threadprivate(/VRRcom/)
 
    double precision X44(129600)
 
    COMMON /COM1/RA,RB,RC,RD
+   !$omp threadprivate(/COM1/)
    COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
    COMMON /COM4/P,Q,W
    COMMON /COM5/FM
    integer*4 A, B
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /xiaostore/store
+   !$omp threadprivate(/xiaostore/)
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
+   double precision, dimension(:,:), pointer :: O2e
 
    do MM2 = NNC, NNCD
       do MM1 = NNA, NNAB
@@ -761,49 +619,52 @@ subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
    NABCDTYPE=(NII2+NJJ2)*10+(NKK2+NLL2)
 
    NABCD=NII2+NJJ2+NKK2+NLL2
-   itt = 0
-   do JJJ=1,quick_basis%kprim(JJ)
-      Nprij=quick_basis%kstart(JJ)+JJJ-1
+   ! a cached quartet reads its integrals back in hrrcache
+   if (eriCacheMode .ne. 2) then
+      itt = 0
+      do JJJ=1,quick_basis%kprim(JJ)
+         Nprij=quick_basis%kstart(JJ)+JJJ-1
 
-      do III=1,quick_basis%kprim(II)
-         Nprii=quick_basis%kstart(II)+III-1
+         do III=1,quick_basis%kprim(II)
+            Nprii=quick_basis%kstart(II)+III-1
 
-         !X0 = 2.0d0*(PI)**(2.5d0), constants for HGP 15 
-         ! multiplied twice for KAB and KCD
+            !X0 = 2.0d0*(PI)**(2.5d0), constants for HGP 15 
+            ! multiplied twice for KAB and KCD
 
-         X2=X0*quick_basis%Xcoeff(Nprii,Nprij,I,J)
-         cutoffprim1=dnmax*cutprim(Nprii,Nprij)
+            X2=X0*quick_basis%Xcoeff(Nprii,Nprij,I,J)
+            cutoffprim1=dnmax*cutprim(Nprii,Nprij)
 
-         do LLL=1,quick_basis%kprim(LL)
-            Npril=quick_basis%kstart(LL)+LLL-1
+            do LLL=1,quick_basis%kprim(LL)
+               Npril=quick_basis%kstart(LL)+LLL-1
 
-            do KKK=1,quick_basis%kprim(KK)
-               Nprik=quick_basis%kstart(KK)+KKK-1
-               cutoffprim=cutoffprim1*cutprim(Nprik,Npril)
+               do KKK=1,quick_basis%kprim(KK)
+                  Nprik=quick_basis%kstart(KK)+KKK-1
+                  cutoffprim=cutoffprim1*cutprim(Nprik,Npril)
 
-               if(cutoffprim.gt.quick_method%primLimit)then
+                  if(cutoffprim.gt.quick_method%primLimit)then
 
-                  itt = itt+1
-                  !This is the KAB x KCD value reqired for HGP 12.
-                  !itt is the m value.
-                  X44(ITT) = X2*quick_basis%Xcoeff(Nprik,Npril,K,L)
-               endif
+                     itt = itt+1
+                     !This is the KAB x KCD value reqired for HGP 12.
+                     !itt is the m value.
+                     X44(ITT) = X2*quick_basis%Xcoeff(Nprik,Npril,K,L)
+                  endif
+               enddo
             enddo
          enddo
       enddo
-   enddo
 
-   !Here we complete HGP 12. 
-   do MM2=NNC,NNCD
-      do MM1=NNA,NNAB
-         Ytemp=0.0d0
-         do itemp=1,ITT
-            Ytemp=Ytemp+X44(itemp)*Yxiao(itemp,MM1,MM2)
-         enddo
-         store(MM1,MM2)=Ytemp
+      !Here we complete HGP 12. 
+      do MM2=NNC,NNCD
+         do MM1=NNA,NNAB
+            Ytemp=0.0d0
+            do itemp=1,ITT
+               Ytemp=Ytemp+X44(itemp)*Yxiao(itemp,MM1,MM2)
+            enddo
+            store(MM1,MM2)=Ytemp
 !write(*,*) mpirank, Ytemp
+         enddo
       enddo
-   enddo
+   endif
 
 !Get the start and end basis numbers for each angular momentum. 
 !For eg. Qsbasis and Qfbasis are 1 and 3 for P basis. 
@@ -856,6 +717,13 @@ subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
   !stop
 !--------------------Madu--------------------------
 
+   ! worker threads of get2e_omp add to their own copy of the operator
+   if (allocated(o2eThread)) then
+      O2e => o2eThread
+   else
+      O2e => quick_qm_struct%o
+   endif
+
    if (quick_method%nodirect) then
       INTNUM = 0
       do III=III1,III2
@@ -883,7 +751,7 @@ subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
                         if (bufferInt .eq. bufferSize) then
                            if (incoreInt) then
                            else
-                              call writeInt(iIntFile, bufferSize, aBuffer, bBuffer, intBuffer)
+                              call intstore_put(bufferSize, aBuffer, bBuffer, intBuffer)
                            endif
 
                            bufferInt = 0
@@ -914,7 +782,7 @@ subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
                            if (incoreInt) then
 
                            else
-                              call writeInt(iIntFile, bufferSize, aBuffer, bBuffer, intBuffer)
+                              call intstore_put(bufferSize, aBuffer, bBuffer, intBuffer)
                            endif
                            bufferInt = 0
                         endif
@@ -934,7 +802,7 @@ subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
             do JJJ=JJJ1,JJJ2
                do KKK=KKK1,KKK2
                   do LLL=LLL1,LLL2
-                     call hrrwhole
+                     call hrrcache
                      !write(*,*) Y,III,JJJ,KKK,LLL
                      DENSEKI=quick_qm_struct%dense(KKK,III)
                      DENSEKJ=quick_qm_struct%dense(KKK,JJJ)
@@ -945,14 +813,14 @@ subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
 
                      ! Find the (ij|kl) integrals where j>i,k>i,l>k. Note that k and j
                      ! can be equal.
-                     quick_qm_struct%o(JJJ,III) = quick_qm_struct%o(JJJ,III)+2.d0*DENSELK*Y
-                     quick_qm_struct%o(LLL,KKK) = quick_qm_struct%o(LLL,KKK)+2.d0*DENSEJI*Y
-                     quick_qm_struct%o(KKK,III) = quick_qm_struct%o(KKK,III)-quick_method%x_hybrid_coeff*.5d0*DENSELJ*Y
-                     quick_qm_struct%o(LLL,III) = quick_qm_struct%o(LLL,III)-quick_method%x_hybrid_coeff*.5d0*DENSEKJ*Y
-                     quick_qm_struct%o(JJJ,KKK) = quick_qm_struct%o(JJJ,KKK)-quick_method%x_hybrid_coeff*.5d0*DENSELI*Y
-                     quick_qm_struct%o(JJJ,LLL) = quick_qm_struct%o(JJJ,LLL)-quick_method%x_hybrid_coeff*.5d0*DENSEKI*Y
-                     quick_qm_struct%o(KKK,JJJ) = quick_qm_struct%o(KKK,JJJ)-quick_method%x_hybrid_coeff*.5d0*DENSELI*Y
-                     quick_qm_struct%o(LLL,JJJ) = quick_qm_struct%o(LLL,JJJ)-quick_method%x_hybrid_coeff*.5d0*DENSEKI*Y
+                     O2e(JJJ,III) = O2e(JJJ,III)+2.d0*DENSELK*Y
+                     O2e(LLL,KKK) = O2e(LLL,KKK)+2.d0*DENSEJI*Y
+                     O2e(KKK,III) = O2e(KKK,III)-quick_method%x_hybrid_coeff*.5d0*DENSELJ*Y
+                     O2e(LLL,III) = O2e(LLL,III)-quick_method%x_hybrid_coeff*.5d0*DENSEKJ*Y
+                     O2e(JJJ,KKK) = O2e(JJJ,KKK)-quick_method%x_hybrid_coeff*.5d0*DENSELI*Y
+                     O2e(JJJ,LLL) = O2e(JJJ,LLL)-quick_method%x_hybrid_coeff*.5d0*DENSEKI*Y
+                     O2e(KKK,JJJ) = O2e(KKK,JJJ)-quick_method%x_hybrid_coeff*.5d0*DENSELI*Y
+                     O2e(LLL,JJJ) = O2e(LLL,JJJ)-quick_method%x_hybrid_coeff*.5d0*DENSEKI*Y
 
 !--------------------Madu---------------------------
 !write(*,*) "II<JJ and II < KK and KK<LL = true"
@@ -972,7 +840,7 @@ subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
                do KKK=max(III,KKK1),KKK2
                   do LLL=max(KKK,LLL1),LLL2
                      if(III.LT.KKK)then
-                        call hrrwhole
+                        call hrrcache
                           !write(*,*) Y,III,JJJ,KKK,LLL
                         if(III.lt.JJJ.and.KKK.lt.LLL)then
                            DENSEKI=quick_qm_struct%dense(KKK,III)
@@ -985,14 +853,14 @@ subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
                            ! Find the (ij|kl) integrals where j>i,k>i,l>k. Note that k and j
                            ! can be equal.
 
-                           quick_qm_struct%o(JJJ,III) = quick_qm_struct%o(JJJ,III)+2.d0*DENSELK*Y
-                           quick_qm_struct%o(LLL,KKK) = quick_qm_struct%o(LLL,KKK)+2.d0*DENSEJI*Y
-                           quick_qm_struct%o(KKK,III) = quick_qm_struct%o(KKK,III)-quick_method%x_hybrid_coeff*.5d0*DENSELJ*Y
-                           quick_qm_struct%o(LLL,III) = quick_qm_struct%o(LLL,III)-quick_method%x_hybrid_coeff*.5d0*DENSEKJ*Y
-                           quick_qm_struct%o(JJJ,KKK) = quick_qm_struct%o(JJJ,KKK)-quick_method%x_hybrid_coeff*.5d0*DENSELI*Y
-                           quick_qm_struct%o(JJJ,LLL) = quick_qm_struct%o(JJJ,LLL)-quick_method%x_hybrid_coeff*.5d0*DENSEKI*Y
-                           quick_qm_struct%o(KKK,JJJ) = quick_qm_struct%o(KKK,JJJ)-quick_method%x_hybrid_coeff*.5d0*DENSELI*Y
-                           quick_qm_struct%o(LLL,JJJ) = quick_qm_struct%o(LLL,JJJ)-quick_method%x_hybrid_coeff*.5d0*DENSEKI*Y
+                           O2e(JJJ,III) = O2e(JJJ,III)+2.d0*DENSELK*Y
+                           O2e(LLL,KKK) = O2e(LLL,KKK)+2.d0*DENSEJI*Y
+                           O2e(KKK,III) = O2e(KKK,III)-quick_method%x_hybrid_coeff*.5d0*DENSELJ*Y
+                           O2e(LLL,III) = O2e(LLL,III)-quick_method%x_hybrid_coeff*.5d0*DENSEKJ*Y
+                           O2e(JJJ,KKK) = O2e(JJJ,KKK)-quick_method%x_hybrid_coeff*.5d0*DENSELI*Y
+                           O2e(JJJ,LLL) = O2e(JJJ,LLL)-quick_method%x_hybrid_coeff*.5d0*DENSEKI*Y
+                           O2e(KKK,JJJ) = O2e(KKK,JJJ)-quick_method%x_hybrid_coeff*.5d0*DENSELI*Y
+                           O2e(LLL,JJJ) = O2e(LLL,JJJ)-quick_method%x_hybrid_coeff*.5d0*DENSEKI*Y
 
 !--------------------Madu---------------------------
 !write(*,*) "II<JJ and II < KK and KK<LL = false, III<KKK = true"
@@ -1012,9 +880,9 @@ subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
                            DENSEJJ=quick_qm_struct%dense(KKK,KKK)
                            DENSEII=quick_qm_struct%dense(III,III)
                            ! Find  all the (ii|jj) integrals.
-                           quick_qm_struct%o(III,III) = quick_qm_struct%o(III,III)+DENSEJJ*Y
-                           quick_qm_struct%o(KKK,KKK) = quick_qm_struct%o(KKK,KKK)+DENSEII*Y
-                           quick_qm_struct%o(KKK,III) = quick_qm_struct%o(KKK,III) &
+                           O2e(III,III) = O2e(III,III)+DENSEJJ*Y
+                           O2e(KKK,KKK) = O2e(KKK,KKK)+DENSEII*Y
+                           O2e(KKK,III) = O2e(KKK,III) &
                                 -quick_method%x_hybrid_coeff*.5d0*DENSEJI*Y
 
 !--------------------Madu---------------------------
@@ -1032,9 +900,9 @@ subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
                            DENSEJJ=quick_qm_struct%dense(JJJ,JJJ)
 
                            ! Find  all the (ij|jj) integrals.
-                           quick_qm_struct%o(JJJ,III) = quick_qm_struct%o(JJJ,III)+DENSEJJ*Y &
+                           O2e(JJJ,III) = O2e(JJJ,III)+DENSEJJ*Y &
                                 -quick_method%x_hybrid_coeff*.5d0*DENSEJJ*Y
-                           quick_qm_struct%o(JJJ,JJJ) = quick_qm_struct%o(JJJ,JJJ)+2.0d0*DENSEJI*Y &
+                           O2e(JJJ,JJJ) = O2e(JJJ,JJJ)+2.0d0*DENSEJI*Y &
                                 -quick_method%x_hybrid_coeff*DENSEJI*Y 
                            !        ! Find  all the (ii|ij) integrals.
                            !        ! Find all the (ij|ij) integrals
@@ -1058,11 +926,11 @@ subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
                            DENSEJI=quick_qm_struct%dense(JJJ,III)
 
                            ! Find all the (ij|kk) integrals where j>i, k>j.
-                           quick_qm_struct%o(JJJ,III) = quick_qm_struct%o(JJJ,III)+DENSEKK*Y
-                           quick_qm_struct%o(KKK,KKK) = quick_qm_struct%o(KKK,KKK)+2.d0*DENSEJI*Y
-                           quick_qm_struct%o(KKK,III) = quick_qm_struct%o(KKK,III)-quick_method%x_hybrid_coeff*.5d0*DENSEKJ*Y
-                           quick_qm_struct%o(KKK,JJJ) = quick_qm_struct%o(KKK,JJJ)-quick_method%x_hybrid_coeff*.5d0*DENSEKI*Y
-                           quick_qm_struct%o(JJJ,KKK) = quick_qm_struct%o(JJJ,KKK)-quick_method%x_hybrid_coeff*.5d0*DENSEKI*Y
+                           O2e(JJJ,III) = O2e(JJJ,III)+DENSEKK*Y
+                           O2e(KKK,KKK) = O2e(KKK,KKK)+2.d0*DENSEJI*Y
+                           O2e(KKK,III) = O2e(KKK,III)-quick_method%x_hybrid_coeff*.5d0*DENSEKJ*Y
+                           O2e(KKK,JJJ) = O2e(KKK,JJJ)-quick_method%x_hybrid_coeff*.5d0*DENSEKI*Y
+                           O2e(JJJ,KKK) = O2e(JJJ,KKK)-quick_method%x_hybrid_coeff*.5d0*DENSEKI*Y
 !--------------------Madu---------------------------
 !write(*,*) "II<JJ and II < KK and KK<LL = false, III<KKK = true"
 !write(*,*) "KKK==LLL and III<JJJ and JJJ != KKK"
@@ -1080,10 +948,10 @@ subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
                            DENSEKJ=quick_qm_struct%dense(LLL,KKK)
 
                            ! Find all the (ii|jk) integrals where j>i, k>j.
-                           quick_qm_struct%o(LLL,KKK) = quick_qm_struct%o(LLL,KKK)+DENSEII*Y
-                           quick_qm_struct%o(III,III) = quick_qm_struct%o(III,III)+2.d0*DENSEKJ*Y
-                           quick_qm_struct%o(KKK,III) = quick_qm_struct%o(KKK,III)-quick_method%x_hybrid_coeff*.5d0*DENSEKI*Y
-                           quick_qm_struct%o(LLL,III) = quick_qm_struct%o(LLL,III)-quick_method%x_hybrid_coeff*.5d0*DENSEJI*Y
+                           O2e(LLL,KKK) = O2e(LLL,KKK)+DENSEII*Y
+                           O2e(III,III) = O2e(III,III)+2.d0*DENSEKJ*Y
+                           O2e(KKK,III) = O2e(KKK,III)-quick_method%x_hybrid_coeff*.5d0*DENSEKI*Y
+                           O2e(LLL,III) = O2e(LLL,III)-quick_method%x_hybrid_coeff*.5d0*DENSEJI*Y
 !--------------------Madu---------------------------
 !write(*,*) "II<JJ and II < KK and KK<LL = false, III<KKK = true"
 !write(*,*) "III<JJJ and KKK<LLL"
@@ -1096,13 +964,13 @@ subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
 
                      else
                         if(JJJ.LE.LLL)then
-                           call hrrwhole
+                           call hrrcache
                            !   write(*,*) Y, III,JJJ,KKK,LLL
                            if(III.eq.JJJ.and.III.eq.KKK.and.III.eq.LLL)then
                               DENSEII=quick_qm_struct%dense(III,III)
 
                               ! do all the (ii|ii) integrals.
-                              quick_qm_struct%o(III,III) = quick_qm_struct%o(III,III)+DENSEII*Y &
+                              O2e(III,III) = O2e(III,III)+DENSEII*Y &
                                 -quick_method%x_hybrid_coeff*.5d0*DENSEII*Y
 !--------------------Madu---------------------------
 !write(*,*) "II<JJ and II < KK and KK<LL = false, III<KKK = false, JJJ<LLL=true"
@@ -1117,9 +985,9 @@ subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
                               DENSEII=quick_qm_struct%dense(III,III)
 
                               ! Find  all the (ii|ij) integrals.
-                              quick_qm_struct%o(LLL,III) = quick_qm_struct%o(LLL,III)+DENSEII*Y &
+                              O2e(LLL,III) = O2e(LLL,III)+DENSEII*Y &
                                 -quick_method%x_hybrid_coeff*.5d0*DENSEII*Y
-                              quick_qm_struct%o(III,III) = quick_qm_struct%o(III,III)+2.0d0*DENSEJI*Y &
+                              O2e(III,III) = O2e(III,III)+2.0d0*DENSEJI*Y &
                                 -quick_method%x_hybrid_coeff*DENSEJI*Y
 !--------------------Madu---------------------------
 !write(*,*) "II<JJ and II < KK and KK<LL = false, III<KKK = false, JJJ<LLL=true"
@@ -1136,10 +1004,10 @@ subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
                               DENSEII=quick_qm_struct%dense(III,III)
 
                               ! Find all the (ij|ij) integrals
-                              quick_qm_struct%o(JJJ,III) = quick_qm_struct%o(JJJ,III)+2.0d0*DENSEJI*Y &
+                              O2e(JJJ,III) = O2e(JJJ,III)+2.0d0*DENSEJI*Y &
                                 -quick_method%x_hybrid_coeff*0.5d0*DENSEJI*Y
-                              quick_qm_struct%o(JJJ,JJJ) = quick_qm_struct%o(JJJ,JJJ)-quick_method%x_hybrid_coeff*.5d0*DENSEII*Y
-                              quick_qm_struct%o(III,III) = quick_qm_struct%o(III,III)-quick_method%x_hybrid_coeff*.5d0*DENSEJJ*Y
+                              O2e(JJJ,JJJ) = O2e(JJJ,JJJ)-quick_method%x_hybrid_coeff*.5d0*DENSEII*Y
+                              O2e(III,III) = O2e(III,III)-quick_method%x_hybrid_coeff*.5d0*DENSEJJ*Y
 !--------------------Madu---------------------------
 !write(*,*) "II<JJ and II < KK and KK<LL = false, III<KKK = false, JJJ<LLL=true"
 !write(*,*) "III==KKK and JJJ==LLL and III<JJJ"
@@ -1155,12 +1023,12 @@ subroutine iclass(I,J,K,L,NNA,NNC,NNAB,NNCD)
                               DENSEJI=quick_qm_struct%dense(JJJ,III)
 
                               ! Find all the (ij|ik) integrals where j>i,k>j
-                              quick_qm_struct%o(JJJ,III) = quick_qm_struct%o(JJJ,III)+2.0d0*DENSEKI*Y &
+                              O2e(JJJ,III) = O2e(JJJ,III)+2.0d0*DENSEKI*Y &
                                 -quick_method%x_hybrid_coeff*0.5d0*DENSEKI*Y
-                              quick_qm_struct%o(LLL,III) = quick_qm_struct%o(LLL,III)+2.0d0*DENSEJI*Y &
+                              O2e(LLL,III) = O2e(LLL,III)+2.0d0*DENSEJI*Y &
                                 - quick_method%x_hybrid_coeff*0.5d0*DENSEJI*Y
-                              quick_qm_struct%o(III,III) = quick_qm_struct%o(III,III)-quick_method%x_hybrid_coeff*1.d0*DENSEKJ*Y
-                              quick_qm_struct%o(LLL,JJJ) = quick_qm_struct%o(LLL,JJJ)-quick_method%x_hybrid_coeff*.5d0*DENSEII*Y
+                              O2e(III,III) = O2e(III,III)-quick_method%x_hybrid_coeff*1.d0*DENSEKJ*Y
+                              O2e(LLL,JJJ) = O2e(LLL,JJJ)-quick_method%x_hybrid_coeff*.5d0*DENSEII*Y
 !--------------------Madu---------------------------
 !write(*,*) "II<JJ and II < KK and KK<LL = false, III<KKK = false, JJJ<LLL=true"
 !write(*,*) "III==KKK and III<JJJ and JJJ<LLL"
@@ -1310,10 +1178,13 @@ subroutine shellmp2(nstepmp2s,nsteplength)
    double precision Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
    COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+   !$omp threadprivate(/VRRcom/)
 
    COMMON /COM1/RA,RB,RC,RD
+   !$omp threadprivate(/COM1/)
 
    do M=1,3
       RA(M)=xyz(M,quick_basis%katom(II))
@@ -1457,10 +1328,13 @@ subroutine shellmp2divcon(i33,ittsub)
    double precision Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
    COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+   !$omp threadprivate(/VRRcom/)
 
    COMMON /COM1/RA,RB,RC,RD
+   !$omp threadprivate(/COM1/)
 
    do M=1,3
       RA(M)=xyz(M,quick_basis%katom(II))
@@ -1585,13 +1459,16 @@ subroutine classmp2divcon(I,J,K,L,NNA,NNC,NNAB,NNCD,i33,ittsub)
    double precision X44(129600)
 
    COMMON /COM1/RA,RB,RC,RD
+   !$omp threadprivate(/COM1/)
    COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
    COMMON /COM4/P,Q,W
    COMMON /COM5/FM
 
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /xiaostore/store
+   !$omp threadprivate(/xiaostore/)
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
    ITT=0
 
@@ -1753,13 +1630,16 @@ subroutine classmp2(I,J,K,L,NNA,NNC,NNAB,NNCD,nstepmp2s,nsteplength)
    double precision X44(129600)
 
    COMMON /COM1/RA,RB,RC,RD
+   !$omp threadprivate(/COM1/)
    COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
    COMMON /COM4/P,Q,W
    COMMON /COM5/FM
 
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /xiaostore/store
+   !$omp threadprivate(/xiaostore/)
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
    ITT=0
    do JJJ=1,quick_basis%kprim(JJ)
@@ -2055,10 +1935,13 @@ subroutine shellopt
    double precision Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2,NNABfirst,NNCDfirst
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
    COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+   !$omp threadprivate(/VRRcom/)
 
    COMMON /COM1/RA,RB,RC,RD
+   !$omp threadprivate(/COM1/)
 
    !    logical same
    !    same = .false.
@@ -2220,14 +2103,17 @@ subroutine classopt(I,J,K,L,NNA,NNC,NNAB,NNCD,NNABfirst,NNCDfirst)
    double precision AA,BB,CC,DD
 
    COMMON /COM1/RA,RB,RC,RD
+   !$omp threadprivate(/COM1/)
    COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
    COMMON /COM4/P,Q,W
    COMMON /COM5/FM
 
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /xiaostore/store
+   !$omp threadprivate(/xiaostore/)
    common /xiaostoreopt/storeaa,storebb,storecc,storedd
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
    ITT=0
    do JJJ=1,quick_basis%kprim(JJ)
@@ -2757,8 +2643,11 @@ subroutine shelldft(IItemp,JJtemp,KKtemp,LLtemp)
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
 
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
    COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+   !$omp threadprivate(/VRRcom/)
    COMMON /COM1/RA,RB,RC,RD
+   !$omp threadprivate(/COM1/)
 
    II=IItemp
    JJ=JJtemp
@@ -2937,13 +2826,16 @@ subroutine classdft(I,J,K,L,NNA,NNC,NNAB,NNCD)
    double precision X44(1296)
 
    COMMON /COM1/RA,RB,RC,RD
+   !$omp threadprivate(/COM1/)
    COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
    COMMON /COM4/P,Q,W
    COMMON /COM5/FM
 
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /xiaostore/store
+   !$omp threadprivate(/xiaostore/)
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
 !-----Madu--------------
    do MM2 = NNC, NNCD
@@ -3221,10 +3113,13 @@ subroutine shelldftb3lyp(IItemp,JJtemp,KKtemp,LLtemp)
    double precision Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
    COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+   !$omp threadprivate(/VRRcom/)
 
    COMMON /COM1/RA,RB,RC,RD
+   !$omp threadprivate(/COM1/)
 
    II=IItemp
    JJ=JJtemp
@@ -3376,13 +3271,16 @@ subroutine classdftb3lyp(I,J,K,L,NNA,NNC,NNAB,NNCD)
    double precision X44(1296)
 
    COMMON /COM1/RA,RB,RC,RD
+   !$omp threadprivate(/COM1/)
    COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
    COMMON /COM4/P,Q,W
    COMMON /COM5/FM
 
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /xiaostore/store
+   !$omp threadprivate(/xiaostore/)
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
    ITT=0
    do JJJ=1,quick_basis%kprim(JJ)
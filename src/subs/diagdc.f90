@@ -0,0 +1,43 @@
+!
+!	diagdc.f90
+!	new_quick
+!
+
+!-----------------------------------------------------------
+! DIAGDC
+!------------------------------------------------------------
+! SCF diagonalization driver, same arguments as DIAG.
+!-----------------------------------------------------------
+
+SUBROUTINE DIAGDC(NDIM,A,NEVEC1,TOLERA,V,EVAL1,IDEGEN1,EVEC1, &
+     IERROR)
+
+  ! SOLVES THE REAL SYMMETRIC EIGENPROBLEM OF A WITH THE EIGENSOLVER
+  ! SELECTED BY quick_method%iDiag:
+
+  ! iDiag = 0 - DIAG (QL ITERATION ON THE TRIDIAGONAL MATRIX).
+  ! iDiag = 1 - DIVIDE AND CONQUER (eigen_dc IN eigensolver.cpp).
+
+  ! ARGUMENTS AND RESULTS ARE THOSE OF DIAG. ALL EIGENVECTORS ARE
+  ! RETURNED BY THE DIVIDE AND CONQUER SOLVER, WHICH LEAVES A
+  ! UNTOUCHED, SO THAT DIAG CAN STILL BE CALLED WHEN IT FAILS.
+
+  use quick_method_module, only: quick_method
+  IMPLICIT doUBLE PRECISION (A-H,O-Z)
+
+  DIMENSION A(NDIM,NDIM),V(3,NDIM),IDEGEN1(NDIM),EVAL1(NDIM)
+  DIMENSION EVEC1(NDIM,NDIM)
+
+  if(quick_method%iDiag /= 0)then
+     CALL eigen_dc(NDIM,A,EVAL1,EVEC1,ANORM,IERROR)
+     if(IERROR == 0)then
+        TOLTMP = TOLERA
+        if(TOLTMP <= 0.0D0) TOLTMP = 1.0D-8
+        CALL DEGEN(NDIM,EVAL1,TOLTMP,ANORM,IDEGEN1)
+        RETURN
+     endif
+  endif
+
+  CALL DIAG(NDIM,A,NEVEC1,TOLERA,V,EVAL1,IDEGEN1,EVEC1,IERROR)
+
+end SUBROUTINE DIAGDC
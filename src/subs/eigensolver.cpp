@@ -0,0 +1,666 @@
+/*
+  !---------------------------------------------------------------------!
+  !                                                                     !
+  ! Copyright (C) 2020-2021 Merz lab                                    !
+  ! Copyright (C) 2020-2021 Götz lab                                    !
+  !                                                                     !
+  ! This Source Code Form is subject to the terms of the Mozilla Public !
+  ! License, v. 2.0. If a copy of the MPL was not distributed with this !
+  ! file, You can obtain one at http://mozilla.org/MPL/2.0/.            !
+  !_____________________________________________________________________!
+
+  !---------------------------------------------------------------------!
+  ! This source file contains the divide and conquer eigensolver used   !
+  ! by the SCF diagonalization (see DIAGDC). All eigenpairs of the real !
+  ! symmetric matrix are computed in three steps.                       !
+  !                                                                     !
+  ! 1. Householder reduction to tridiagonal form. Reflectors are built  !
+  !    in panels of NB columns, the trailing matrix is updated once per !
+  !    panel with a rank 2*NB update instead of NB rank 2 updates.      !
+  ! 2. Cuppen's divide and conquer on the tridiagonal matrix. Blocks of !
+  !    at most LEAF rows are solved by implicit QL, two halves are      !
+  !    merged by a rank one update: deflation, the secular equation     !
+  !    and the Gu-Eisenstat recomputation of z, which keeps the merged  !
+  !    eigenvectors orthogonal, followed by one matrix multiply.        !
+  ! 3. Back transformation of the eigenvectors, the reflectors of one   !
+  !    panel are applied at once in the compact WY form I - V T V^T.    !
+  !                                                                     !
+  ! The trailing update, the matrix-vector products, the root finding   !
+  ! and the merge multiply are spread over the OpenMP threads.          !
+  !---------------------------------------------------------------------!
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+extern "C" {
+void eigen_dc_(int *n, double *a, double *eval, double *evec, double *anorm, int *ierr);
+}
+
+namespace {
+
+// columns per panel of the tridiagonal reduction
+constexpr int NB = 32;
+
+// largest tridiagonal block solved directly by QL
+constexpr int LEAF = 32;
+
+// columns of the output handled by one thread in the blocked products
+constexpr int TILE = 64;
+
+// register and cache blocking of gemm, the micro kernel is written out for 4 x 4
+constexpr int MR = 4, NR = 4, KC = 256, MC = 128;
+
+// problems below this size are not worth waking the threads for
+constexpr int PARMIN = 96;
+
+const double EPS = std::numeric_limits<double>::epsilon();
+
+// ------------------------------------------------------------------
+// Serial matrix multiply, C(m x n) += alpha op(A) op(B), column major.
+// Callers split C into column tiles over the threads.
+// ------------------------------------------------------------------
+
+// a block of op(A) copied into slivers of MR rows, zero padded
+void packA(bool ta, int mc, int kc, const double *a, int lda, double *buf) {
+  for (int i0 = 0; i0 < mc; i0 += MR)
+    for (int p = 0; p < kc; p++)
+      for (int i = 0; i < MR; i++) {
+        const int r = i0 + i;
+        *buf++ = (r < mc) ? (ta ? a[p + (std::size_t)r * lda] : a[r + (std::size_t)p * lda]) : 0.0;
+      }
+}
+
+// a block of op(B) copied into slivers of NR columns, zero padded
+void packB(bool tb, int kc, int nc, const double *b, int ldb, double *buf) {
+  for (int j0 = 0; j0 < nc; j0 += NR)
+    for (int p = 0; p < kc; p++)
+      for (int j = 0; j < NR; j++) {
+        const int c = j0 + j;
+        *buf++ = (c < nc) ? (tb ? b[c + (std::size_t)p * ldb] : b[p + (std::size_t)c * ldb]) : 0.0;
+      }
+}
+
+void gemm(bool ta, bool tb, int m, int n, int k, double alpha, const double *a, int lda, const double *b,
+          int ldb, double *c, int ldc) {
+  if (m <= 0 || n <= 0 || k <= 0) return;
+  std::vector<double> ap((std::size_t)(MC + MR) * KC), bp((std::size_t)(n + NR) * KC);
+
+  for (int p0 = 0; p0 < k; p0 += KC) {
+    const int kc = std::min(KC, k - p0);
+    packB(tb, kc, n, tb ? b + (std::size_t)p0 * ldb : b + p0, ldb, bp.data());
+
+    for (int i0 = 0; i0 < m; i0 += MC) {
+      const int mc = std::min(MC, m - i0);
+      packA(ta, mc, kc, ta ? a + p0 + (std::size_t)i0 * lda : a + i0 + (std::size_t)p0 * lda, lda, ap.data());
+
+      for (int j0 = 0; j0 < n; j0 += NR) {
+        const double *bs = &bp[(std::size_t)j0 * kc];
+        for (int ir = 0; ir < mc; ir += MR) {
+          const double *as = &ap[(std::size_t)ir * kc];
+          // 4 x 4 block of C kept in registers
+          double c00 = 0.0, c10 = 0.0, c20 = 0.0, c30 = 0.0, c01 = 0.0, c11 = 0.0, c21 = 0.0, c31 = 0.0;
+          double c02 = 0.0, c12 = 0.0, c22 = 0.0, c32 = 0.0, c03 = 0.0, c13 = 0.0, c23 = 0.0, c33 = 0.0;
+          for (int p = 0; p < kc; p++) {
+            const double *ai = as + p * MR, *bj = bs + p * NR;
+            const double a0 = ai[0], a1 = ai[1], a2 = ai[2], a3 = ai[3];
+            const double b0 = bj[0], b1 = bj[1], b2 = bj[2], b3 = bj[3];
+            c00 += a0 * b0, c10 += a1 * b0, c20 += a2 * b0, c30 += a3 * b0;
+            c01 += a0 * b1, c11 += a1 * b1, c21 += a2 * b1, c31 += a3 * b1;
+            c02 += a0 * b2, c12 += a1 * b2, c22 += a2 * b2, c32 += a3 * b2;
+            c03 += a0 * b3, c13 += a1 * b3, c23 += a2 * b3, c33 += a3 * b3;
+          }
+          const double acc[NR][MR] = {
+              {c00, c10, c20, c30}, {c01, c11, c21, c31}, {c02, c12, c22, c32}, {c03, c13, c23, c33}};
+
+          const int ni = std::min(MR, mc - ir), nj = std::min(NR, n - j0);
+          for (int j = 0; j < nj; j++) {
+            double *cc = c + (i0 + ir) + (std::size_t)(j0 + j) * ldc;
+            for (int i = 0; i < ni; i++) cc[i] += alpha * acc[j][i];
+          }
+        }
+      }
+    }
+  }
+}
+
+// ------------------------------------------------------------------
+// Householder reduction
+// ------------------------------------------------------------------
+
+// Reduce the lower triangle of a (n x n, column major) to tridiagonal
+// form: d is the diagonal, e the subdiagonal. The reflector of column j
+// is H(j) = I - tau(j) v v^T with v(j+1) = 1 and v(j+2:n) kept in
+// a(j+2:n,j).
+void tridiagonalize(int n, std::vector<double> &a, std::vector<double> &d, std::vector<double> &e,
+                    std::vector<double> &tau) {
+  auto A = [&](int r, int c) -> double & { return a[r + (std::size_t)c * n]; };
+
+  int nt = 1;
+#ifdef _OPENMP
+  nt = omp_get_max_threads();
+#endif
+  std::vector<double> w((std::size_t)n * NB), y(n), ypart((std::size_t)nt * n);
+  auto W = [&](int r, int p) -> double & { return w[r + (std::size_t)p * n]; };
+
+  for (int k0 = 0; k0 < n - 1; k0 += NB) {
+    const int nbk = std::min(NB, n - 1 - k0);
+
+    for (int p = 0; p < nbk; p++) {
+      const int j = k0 + p;
+      const int m = n - j - 1;
+
+      // bring column j up to date with the earlier reflectors of the panel
+      for (int q = 0; q < p; q++) {
+        const int c = k0 + q;
+        const double wj = W(j, q), aj = A(j, c);
+        for (int r = j; r < n; r++) A(r, j) -= A(r, c) * wj + W(r, q) * aj;
+      }
+
+      // reflector annihilating a(j+2:n,j)
+      double alpha = A(j + 1, j), xnorm = 0.0;
+      for (int r = j + 2; r < n; r++) xnorm += A(r, j) * A(r, j);
+      xnorm = std::sqrt(xnorm);
+      double t = 0.0;
+      if (xnorm != 0.0) {
+        const double beta = -std::copysign(std::hypot(alpha, xnorm), alpha);
+        t = (beta - alpha) / beta;
+        const double s = 1.0 / (alpha - beta);
+        for (int r = j + 2; r < n; r++) A(r, j) *= s;
+        alpha = beta;
+      }
+      tau[j] = t;
+      e[j] = alpha;
+      A(j + 1, j) = 1.0;
+
+      // y = A(j+1:n,j+1:n) v from the lower triangle of the trailing matrix,
+      // one pass over the columns: the column dot gives the upper part and
+      // the strictly lower part goes to a per thread partial sum
+#pragma omp parallel if (m > PARMIN)
+      {
+        int tid = 0, nteam = 1;
+#ifdef _OPENMP
+        tid = omp_get_thread_num();
+        nteam = omp_get_num_threads();
+#endif
+        double *yp = &ypart[(std::size_t)tid * n];
+        std::fill(yp + j + 1, yp + n, 0.0);
+#pragma omp for schedule(dynamic, 16)
+        for (int c = j + 1; c < n; c++) {
+          const double *col = &A(0, c), *v = &A(0, j);
+          const double vc = v[c];
+          double s = col[c] * vc;
+          for (int r = c + 1; r < n; r++) {
+            s += col[r] * v[r];
+            yp[r] += col[r] * vc;
+          }
+          y[c] = s;
+        }
+#pragma omp for schedule(static)
+        for (int r = j + 1; r < n; r++)
+          for (int q = 0; q < nteam; q++) y[r] += ypart[(std::size_t)q * n + r];
+      }
+
+      // remove the part of the panel not yet applied to the trailing matrix
+      for (int q = 0; q < p; q++) {
+        const int c = k0 + q;
+        double s1 = 0.0, s2 = 0.0;
+        for (int r = j + 1; r < n; r++) {
+          s1 += W(r, q) * A(r, j);
+          s2 += A(r, c) * A(r, j);
+        }
+        for (int r = j + 1; r < n; r++) y[r] -= A(r, c) * s1 + W(r, q) * s2;
+      }
+
+      double dot = 0.0;
+      for (int r = j + 1; r < n; r++) {
+        y[r] *= t;
+        dot += y[r] * A(r, j);
+      }
+      const double half = -0.5 * t * dot;
+      for (int r = j + 1; r < n; r++) W(r, p) = y[r] + half * A(r, j);
+    }
+
+    // rank 2*nbk update A = A - V W^T - W V^T of the trailing matrix, by
+    // column tiles from their diagonal block down
+    const int t0 = k0 + nbk;
+    const int ntile = (n - t0 + TILE - 1) / TILE;
+#pragma omp parallel for schedule(dynamic, 1) if (n - t0 > PARMIN)
+    for (int it = 0; it < ntile; it++) {
+      const int c0 = t0 + it * TILE, nc = std::min(TILE, n - c0);
+      gemm(false, true, n - c0, nc, nbk, -1.0, &A(c0, k0), n, &W(c0, 0), n, &A(c0, c0), n);
+      gemm(false, true, n - c0, nc, nbk, -1.0, &W(c0, 0), n, &A(c0, k0), n, &A(c0, c0), n);
+    }
+  }
+
+  for (int j = 0; j < n; j++) d[j] = A(j, j);
+}
+
+// Apply H(0) H(1) ... H(n-2) to the columns of z. The reflectors of one
+// panel are applied together as I - V T V^T (compact WY form).
+void backtransform(int n, const std::vector<double> &a, const std::vector<double> &tau, double *z) {
+  const int ntile = (n + TILE - 1) / TILE;
+  std::vector<double> v, t((std::size_t)NB * NB), tmp(NB);
+
+  for (int k0 = ((n - 2) / NB) * NB; k0 >= 0; k0 -= NB) {
+    const int nbk = std::min(NB, n - 1 - k0);
+    const int l = n - k0 - 1; // rows k0+1:n touched by the panel
+
+    // V with the unit diagonal and the zeros above it stored explicitly
+    v.assign((std::size_t)l * nbk, 0.0);
+    for (int q = 0; q < nbk; q++) {
+      double *vq = &v[(std::size_t)q * l];
+      vq[q] = 1.0;
+      for (int r = q + 1; r < l; r++) vq[r] = a[(k0 + 1 + r) + (std::size_t)(k0 + q) * n];
+    }
+
+    // upper triangular T, column q is -tau(q) T(0:q,0:q) V(:,0:q)^T v(q)
+    for (int q = 0; q < nbk; q++) {
+      const double tq = tau[k0 + q];
+      for (int p = 0; p < q; p++) {
+        double s = 0.0;
+        for (int r = q; r < l; r++) s += v[r + (std::size_t)p * l] * v[r + (std::size_t)q * l];
+        tmp[p] = -tq * s;
+      }
+      for (int p = 0; p < q; p++) {
+        double s = 0.0;
+        for (int i = p; i < q; i++) s += t[p + i * NB] * tmp[i];
+        t[p + q * NB] = s;
+      }
+      t[q + q * NB] = tq;
+    }
+
+#pragma omp parallel for schedule(dynamic, 1) if (n > PARMIN)
+    for (int it = 0; it < ntile; it++) {
+      const int c0 = it * TILE, nc = std::min(TILE, n - c0);
+      double *zt = z + (k0 + 1) + (std::size_t)c0 * n;
+
+      // Z = Z - V (T (V^T Z))
+      std::vector<double> w((std::size_t)nbk * nc, 0.0), tw((std::size_t)nbk * nc);
+      gemm(true, false, nbk, nc, l, 1.0, v.data(), l, zt, n, w.data(), nbk);
+      for (int c = 0; c < nc; c++)
+        for (int p = 0; p < nbk; p++) {
+          double s = 0.0;
+          for (int i = p; i < nbk; i++) s += t[p + i * NB] * w[i + c * nbk];
+          tw[p + c * nbk] = s;
+        }
+      gemm(false, false, l, nc, nbk, -1.0, v.data(), l, tw.data(), nbk, zt, n);
+    }
+  }
+}
+
+// ------------------------------------------------------------------
+// Divide and conquer on the tridiagonal matrix
+// ------------------------------------------------------------------
+
+struct Tridiag {
+  int n;
+  std::vector<double> &d, &e;
+  double *q; // eigenvectors, leading dimension n
+
+  double &Q(int r, int c) { return q[r + (std::size_t)c * n]; }
+
+  // sort the eigenpairs of the block lo:lo+m into ascending order
+  void sort(int lo, int m, const std::vector<double> &val, const std::vector<double> &vec) {
+    std::vector<int> idx(m);
+    std::iota(idx.begin(), idx.end(), 0);
+    std::sort(idx.begin(), idx.end(), [&](int x, int y) { return val[x] < val[y]; });
+    for (int c = 0; c < m; c++) {
+      d[lo + c] = val[idx[c]];
+      const double *src = &vec[(std::size_t)idx[c] * m];
+      for (int r = 0; r < m; r++) Q(lo + r, lo + c) = src[r];
+    }
+  }
+
+  // implicit QL on a small block, false when it does not converge
+  bool leaf(int lo, int m) {
+    std::vector<double> dd(d.begin() + lo, d.begin() + lo + m), ee(m, 0.0), z((std::size_t)m * m, 0.0);
+    for (int i = 0; i < m - 1; i++) ee[i] = e[lo + i];
+    for (int i = 0; i < m; i++) z[i + (std::size_t)i * m] = 1.0;
+
+    for (int l = 0; l < m; l++) {
+      int iter = 0, k;
+      do {
+        for (k = l; k < m - 1; k++) {
+          const double dd2 = std::fabs(dd[k]) + std::fabs(dd[k + 1]);
+          if (std::fabs(ee[k]) <= EPS * dd2) break;
+        }
+        if (k != l) {
+          if (iter++ == 60) return false;
+          double g = (dd[l + 1] - dd[l]) / (2.0 * ee[l]);
+          double r = std::hypot(g, 1.0);
+          g = dd[k] - dd[l] + ee[l] / (g + std::copysign(r, g));
+          double s = 1.0, c = 1.0, p = 0.0;
+          int i;
+          for (i = k - 1; i >= l; i--) {
+            double f = s * ee[i], b = c * ee[i];
+            ee[i + 1] = (r = std::hypot(f, g));
+            if (r == 0.0) {
+              dd[i + 1] -= p;
+              ee[k] = 0.0;
+              break;
+            }
+            s = f / r;
+            c = g / r;
+            g = dd[i + 1] - p;
+            r = (dd[i] - g) * s + 2.0 * c * b;
+            dd[i + 1] = g + (p = s * r);
+            g = c * r - b;
+            double *zi = &z[(std::size_t)i * m], *zi1 = &z[(std::size_t)(i + 1) * m];
+            for (int row = 0; row < m; row++) {
+              f = zi1[row];
+              zi1[row] = s * zi[row] + c * f;
+              zi[row] = c * zi[row] - s * f;
+            }
+          }
+          if (r == 0.0 && i >= l) continue;
+          dd[l] -= p;
+          ee[l] = g;
+          ee[k] = 0.0;
+        }
+      } while (k != l);
+    }
+
+    sort(lo, m, dd, z);
+    return true;
+  }
+
+  // root of 1 + rho sum w(i)^2/(dl(i)-x) between dl(j) and dl(j+1), or
+  // above dl(k-1) for the last one; returned as dl(org) + tau with org the
+  // pole closer to the root, so that dl(i)-x is accurate near both poles
+  static void secular(int k, int j, const double *dl, const double *w, double rho, int &org, double &tau) {
+    const bool last = (j == k - 1);
+    double lo, hi;
+    if (last) {
+      org = j;
+      lo = 0.0;
+      hi = rho * std::inner_product(w, w + k, w, 0.0);
+    } else {
+      const double gap = dl[j + 1] - dl[j], mid = 0.5 * gap;
+      double f = 1.0;
+      for (int i = 0; i < k; i++) f += rho * w[i] * w[i] / ((dl[i] - dl[j]) - mid);
+      if (f >= 0.0) {
+        org = j;
+        lo = 0.0;
+        hi = mid;
+      } else {
+        org = j + 1;
+        lo = mid - gap;
+        hi = 0.0;
+      }
+    }
+
+    const double base = dl[org];
+    const double pl = dl[j] - base;
+    const double pr = last ? 0.0 : dl[j + 1] - base;
+    double t = 0.5 * (lo + hi);
+
+    for (int it = 0; it < 400; it++) {
+      double psi = 0.0, dpsi = 0.0, phi = 0.0, dphi = 0.0;
+      for (int i = 0; i <= j; i++) {
+        const double x = w[i] / ((dl[i] - base) - t);
+        psi += w[i] * x;
+        dpsi += x * x;
+      }
+      for (int i = j + 1; i < k; i++) {
+        const double x = w[i] / ((dl[i] - base) - t);
+        phi += w[i] * x;
+        dphi += x * x;
+      }
+      const double f = 1.0 + rho * (psi + phi);
+      const double err = EPS * (8.0 * rho * (phi - psi) + 2.0 + 3.0 * std::fabs(t) * rho * (dpsi + dphi));
+      if (std::fabs(f) <= err) break;
+      if (f < 0.0)
+        lo = t;
+      else
+        hi = t;
+
+      // model psi and phi by one pole each, matching value and slope at t
+      const double b = rho * dpsi * (pl - t) * (pl - t);
+      const double a = rho * psi - rho * dpsi * (pl - t);
+      double tn;
+      if (last) {
+        tn = pl + b / (1.0 + a);
+      } else {
+        const double dq = rho * dphi * (pr - t) * (pr - t);
+        const double cq = rho * phi - rho * dphi * (pr - t);
+        const double C = 1.0 + a + cq, g = pr - pl;
+        const double B = C * g + b + dq;
+        double u;
+        if (C == 0.0) {
+          u = -b * g / (b + dq);
+        } else {
+          const double disc = std::sqrt(std::max(0.0, B * B - 4.0 * C * b * g));
+          const double qq = -0.5 * (B + std::copysign(disc, B));
+          const double u1 = qq / C, u2 = (qq != 0.0) ? b * g / qq : u1;
+          u = (u1 < 0.0 && u1 > -g) ? u1 : u2;
+        }
+        tn = pl - u;
+      }
+      if (!(tn > lo && tn < hi)) tn = 0.5 * (lo + hi);
+      if (std::fabs(tn - t) <= 2.0 * EPS * std::fabs(tn) || hi - lo <= 2.0 * EPS * std::max(std::fabs(lo), std::fabs(hi))) {
+        t = tn;
+        break;
+      }
+      t = tn;
+    }
+    tau = t;
+  }
+
+  // merge the solved blocks lo:lo+n1 and lo+n1:lo+m coupled by beta
+  void merge(int lo, int n1, int m, double beta) {
+    std::vector<double> dv(d.begin() + lo, d.begin() + lo + m), z(m);
+    std::vector<double> qs((std::size_t)m * m, 0.0);
+    for (int c = 0; c < n1; c++)
+      for (int r = 0; r < n1; r++) qs[r + (std::size_t)c * m] = Q(lo + r, lo + c);
+    for (int c = n1; c < m; c++)
+      for (int r = n1; r < m; r++) qs[r + (std::size_t)c * m] = Q(lo + r, lo + c);
+
+    const double sgn = (beta < 0.0) ? -1.0 : 1.0;
+    for (int c = 0; c < n1; c++) z[c] = Q(lo + n1 - 1, lo + c);
+    for (int c = n1; c < m; c++) z[c] = sgn * Q(lo + n1, lo + c);
+    double rho = std::fabs(beta), znrm = 0.0;
+    for (int i = 0; i < m; i++) znrm += z[i] * z[i];
+    rho *= znrm;
+    znrm = std::sqrt(znrm);
+    for (int i = 0; i < m; i++) z[i] /= znrm;
+
+    std::vector<int> idx(m);
+    std::iota(idx.begin(), idx.end(), 0);
+    std::sort(idx.begin(), idx.end(), [&](int x, int y) { return dv[x] < dv[y]; });
+
+    double dmax = 0.0, zmax = 0.0;
+    for (int i = 0; i < m; i++) {
+      dmax = std::max(dmax, std::fabs(dv[i]));
+      zmax = std::max(zmax, std::fabs(z[i]));
+    }
+    const double tol = 8.0 * EPS * std::max(dmax, rho * zmax);
+
+    // deflation: drop tiny components of z, and rotate away the z component
+    // of one of two nearly equal entries of d. A rotation mixes a column of
+    // the first half into one of the second half.
+    std::vector<char> mixed(m, 0);
+    auto rotate = [&](int x, int y, double c, double s) {
+      if (mixed[x] || mixed[y] || (x < n1) != (y < n1)) mixed[x] = mixed[y] = 1;
+      double *cx = &qs[(std::size_t)x * m], *cy = &qs[(std::size_t)y * m];
+      for (int r = 0; r < m; r++) {
+        const double tx = cx[r], ty = cy[r];
+        cx[r] = c * tx + s * ty;
+        cy[r] = c * ty - s * tx;
+      }
+    };
+    std::vector<int> keep, gone;
+    int pj = -1;
+    for (int jj = 0; jj < m; jj++) {
+      const int nj = idx[jj];
+      if (rho * std::fabs(z[nj]) <= tol) {
+        gone.push_back(nj);
+        continue;
+      }
+      if (pj >= 0) {
+        double s = z[pj], c = z[nj];
+        const double h = std::hypot(c, s);
+        const double t = dv[nj] - dv[pj];
+        c /= h;
+        s = -s / h;
+        if (std::fabs(t * c * s) <= tol) {
+          z[nj] = h;
+          z[pj] = 0.0;
+          rotate(pj, nj, c, s);
+          const double dp = dv[pj] * c * c + dv[nj] * s * s;
+          dv[nj] = dv[pj] * s * s + dv[nj] * c * c;
+          dv[pj] = dp;
+          gone.push_back(pj);
+        } else {
+          keep.push_back(pj);
+        }
+      }
+      pj = nj;
+    }
+    if (pj >= 0) keep.push_back(pj);
+
+    // the rotations may have reordered the kept entries slightly
+    std::sort(keep.begin(), keep.end(), [&](int x, int y) { return dv[x] < dv[y]; });
+
+    const int k = (int)keep.size();
+    std::vector<double> val(m), vec((std::size_t)m * m);
+
+    if (k > 0) {
+      std::vector<double> dl(k), w(k), tau(k), zh(k), v((std::size_t)k * k);
+      std::vector<int> org(k);
+      for (int i = 0; i < k; i++) {
+        dl[i] = dv[keep[i]];
+        w[i] = z[keep[i]];
+      }
+      // dl(i) - lambda(j)
+      auto diff = [&](int i, int j) { return (dl[i] - dl[org[j]]) - tau[j]; };
+
+#pragma omp parallel if (k > PARMIN)
+      {
+#pragma omp for schedule(dynamic, 8)
+        for (int j = 0; j < k; j++) secular(k, j, dl.data(), w.data(), rho, org[j], tau[j]);
+
+#pragma omp for schedule(static)
+        for (int i = 0; i < k; i++) {
+          double p = -diff(i, i) / rho;
+          for (int j = 0; j < k; j++)
+            if (j != i) p *= -diff(i, j) / (dl[j] - dl[i]);
+          zh[i] = std::copysign(std::sqrt(std::fabs(p)), w[i]);
+        }
+
+#pragma omp for schedule(static)
+        for (int j = 0; j < k; j++) {
+          double *vj = &v[(std::size_t)j * k], s = 0.0;
+          for (int i = 0; i < k; i++) {
+            vj[i] = zh[i] / diff(i, j);
+            s += vj[i] * vj[i];
+          }
+          s = 1.0 / std::sqrt(s);
+          for (int i = 0; i < k; i++) vj[i] *= s;
+        }
+
+      }
+
+      // eigenvectors of the merged block, qs(:,keep) v. Rows of the first
+      // half only take the kept columns of the first half and the mixed
+      // ones, rows of the second half likewise.
+      std::vector<int> top, bot;
+      for (int l = 0; l < k; l++) {
+        const int c = keep[l];
+        if (c < n1 || mixed[c]) top.push_back(l);
+        if (c >= n1 || mixed[c]) bot.push_back(l);
+      }
+      const int nt = (int)top.size(), nb = (int)bot.size(), n2 = m - n1;
+      std::vector<double> qt((std::size_t)n1 * nt), vt((std::size_t)nt * k);
+      std::vector<double> qb((std::size_t)n2 * nb), vb((std::size_t)nb * k);
+      for (int l = 0; l < nt; l++) {
+        std::copy_n(&qs[(std::size_t)keep[top[l]] * m], n1, &qt[(std::size_t)l * n1]);
+        for (int j = 0; j < k; j++) vt[l + (std::size_t)j * nt] = v[top[l] + (std::size_t)j * k];
+      }
+      for (int l = 0; l < nb; l++) {
+        std::copy_n(&qs[(std::size_t)keep[bot[l]] * m + n1], n2, &qb[(std::size_t)l * n2]);
+        for (int j = 0; j < k; j++) vb[l + (std::size_t)j * nb] = v[bot[l] + (std::size_t)j * k];
+      }
+
+      const int ntile = (k + TILE - 1) / TILE;
+#pragma omp parallel for schedule(dynamic, 1) if (k > PARMIN)
+      for (int it = 0; it < ntile; it++) {
+        const int j0 = it * TILE, nc = std::min(TILE, k - j0);
+        double *out = &vec[(std::size_t)j0 * m];
+        gemm(false, false, n1, nc, nt, 1.0, qt.data(), n1, &vt[(std::size_t)j0 * nt], nt, out, m);
+        gemm(false, false, n2, nc, nb, 1.0, qb.data(), n2, &vb[(std::size_t)j0 * nb], nb, out + n1, m);
+      }
+      for (int j = 0; j < k; j++) val[j] = dl[org[j]] + tau[j];
+    }
+
+    for (std::size_t g = 0; g < gone.size(); g++) {
+      val[k + g] = dv[gone[g]];
+      std::copy_n(&qs[(std::size_t)gone[g] * m], m, &vec[(std::size_t)(k + g) * m]);
+    }
+
+    sort(lo, m, val, vec);
+  }
+
+  bool solve(int lo, int m) {
+    if (m <= LEAF) return leaf(lo, m);
+    const int n1 = m / 2;
+    const double beta = e[lo + n1 - 1];
+    d[lo + n1 - 1] -= std::fabs(beta);
+    d[lo + n1] -= std::fabs(beta);
+    if (!solve(lo, n1) || !solve(lo + n1, m - n1)) return false;
+    merge(lo, n1, m, beta);
+    return true;
+  }
+};
+
+} // namespace
+
+// Eigenvalues (ascending) and eigenvectors (in columns) of the symmetric
+// n x n matrix whose lower triangle is in a. a is left untouched so that
+// the caller can fall back to DIAG when ierr is not zero. anorm is the
+// largest absolute column sum of the tridiagonal matrix, as in DIAG.
+void eigen_dc_(int *n_, double *a_, double *eval, double *evec, double *anorm, int *ierr) {
+  const int n = *n_;
+  *ierr = 0;
+  if (n == 1) {
+    eval[0] = a_[0];
+    evec[0] = 1.0;
+    *anorm = std::fabs(a_[0]);
+    return;
+  }
+
+  std::vector<double> a(a_, a_ + (std::size_t)n * n), d(n), e(n, 0.0), tau(n - 1);
+  tridiagonalize(n, a, d, e, tau);
+
+  double norm = 0.0;
+  for (int i = 0; i < n; i++) {
+    double s = std::fabs(d[i]);
+    if (i > 0) s += std::fabs(e[i - 1]);
+    if (i < n - 1) s += std::fabs(e[i]);
+    norm = std::max(norm, s);
+  }
+  *anorm = norm;
+
+  std::fill(evec, evec + (std::size_t)n * n, 0.0);
+  Tridiag t{n, d, e, evec};
+  if (!t.solve(0, n)) {
+    *ierr = 1;
+    return;
+  }
+  for (int i = 0; i < n; i++) {
+    if (!std::isfinite(d[i])) {
+      *ierr = 1;
+      return;
+    }
+    eval[i] = d[i];
+  }
+
+  backtransform(n, a, tau, evec);
+}
@@ -9,76 +9,122 @@
 ! Ed Brothers. October 29, 2001
 ! 3456789012345678901234567890123456789012345678901234567890123456789012<<STOP
 
+!------------------------------------------------------------------------
+! Boys function Fm(T), m=0..MaxM, for a single argument. This is a thin
+! wrapper around FmT_batch so that every integral path shares one engine.
+!------------------------------------------------------------------------
 Subroutine FmT(MaxM,X,vals)
-  use quick_constants_module
-  implicit double precision (a-h,o-z)
+  implicit none
+  integer MaxM
+  double precision X
   double precision, dimension(0:20) :: vals
+  double precision Xbatch(1)
 
-  PIE4 = PI/4.0d0
-  XINV = 1.d0/X
-  E = exp(-X)
+  Xbatch(1) = X
+  call FmT_batch(1,MaxM,Xbatch,1,vals)
 
-  if (X > 5.d0) then
-     if (X > 15.d0) then
-        if (X > 33.d0) then
-           WW1 = sqrt(PIE4*XINV)
-        else
-           WW1 = (( 1.9623264149430d-01*XINV-4.9695241464490d-01)*XINV - &
-                6.0156581186481d-05)*E + sqrt(PIE4*XINV)
-        endif
-     else if (X > 10.d0) then
-        WW1 = (((-1.8784686463512d-01*XINV+2.2991849164985d-01)*XINV &
-             -4.9893752514047d-01)*XINV-2.1916512131607d-05)*E &
-             + sqrt(PIE4*XINV)
-     else
-        WW1 = (((((( 4.6897511375022d-01*XINV-6.9955602298985d-01)*XINV + &
-             5.3689283271887d-01)*XINV-3.2883030418398d-01)*XINV + &
-             2.4645596956002d-01)*XINV-4.9984072848436d-01)*XINV - &
-             3.1501078774085d-06)*E + sqrt(PIE4*XINV)
-     endif
-  else if (X > 1.d0)  then
-     if (X > 3.d0)  then
-        Y = X-4.d0
-        F1 = ((((((((((-2.62453564772299d-11*Y+3.24031041623823d-10 )*Y- &
-             3.614965656163d-09)*Y+3.760256799971d-08)*Y- &
-             3.553558319675d-07)*Y+3.022556449731d-06)*Y- &
-             2.290098979647d-05)*Y+1.526537461148d-04)*Y- &
-             8.81947375894379d-04 )*Y+4.33207949514611d-03 )*Y- &
-             1.75257821619926d-02 )*Y+5.28406320615584d-02
-        WW1 = (X+X)*F1+E
-     else
-        Y = X-2.d0
-        F1 = ((((((((((-1.61702782425558d-10*Y+1.96215250865776d-09 )*Y- &
-             2.14234468198419d-08 )*Y+2.17216556336318d-07 )*Y- &
-             1.98850171329371d-06 )*Y+1.62429321438911d-05 )*Y- &
-             1.16740298039895d-04 )*Y+7.24888732052332d-04 )*Y- &
-             3.79490003707156d-03 )*Y+1.61723488664661d-02 )*Y- &
-             5.29428148329736d-02 )*Y+1.15702180856167d-01
-        WW1 = (X+X)*F1+E
-     endif
-  else if (X > 3.0d-05 .or. (X>3.0d-07.and.maxm<4)) then
-     F1 =((((((((-8.36313918003957d-08*X+1.21222603512827d-06 )*X- &
-          1.15662609053481d-05 )*X+9.25197374512647d-05 )*X- &
-          6.40994113129432d-04 )*X+3.78787044215009d-03 )*X- &
-          1.85185172458485d-02 )*X+7.14285713298222d-02 )*X- &
-          1.99999999997023d-01 )*X+3.33333333333318d-01
+end subroutine fmt
 
-     WW1 = (X+X)*F1+E
-  else
-     WW1 = (1.d0-X)/dble(2*maxm+1)
-  endif
+!------------------------------------------------------------------------
+! Tabulates Fm(T0) on the grid T0 = k*FMT_DT, k=0..FMT_NGRID, together
+! with exp(-T0). Fm(T0) of the highest tabulated order is summed from its
+! series, Fm(T) = exp(-T) sum_i (2T)^i / ((2m+1)(2m+3)...(2m+2i+1)),
+! and the lower orders follow from downward recursion. Must be called
+! once before the first FmT or FmT_batch call.
+!------------------------------------------------------------------------
+subroutine FmT_init
+  implicit none
+  integer, parameter :: FMT_MAXM=20, FMT_NTAYLOR=8, FMT_NGRID=330
+  double precision, parameter :: FMT_DT=0.1d0
+  double precision FmTgrid(0:FMT_MAXM+FMT_NTAYLOR-1,0:FMT_NGRID)
+  double precision FmTexp(0:FMT_NGRID)
+  common /FmTtable/FmTgrid,FmTexp
+  integer k, m, i, mtop
+  double precision T0, E, term, total
 
-  if (X > 3.0d-5 .or. (X>3.0d-07.and.maxm<4) ) then
-     vals(0) = WW1
-     do m=1,maxm
-        vals(m) = (((2*m-1)*vals(m-1))- E)*0.5d0*XINV
+  mtop = FMT_MAXM+FMT_NTAYLOR-1
+  do k=0,FMT_NGRID
+     T0 = k*FMT_DT
+     E = exp(-T0)
+
+     term = 1.0d0/dble(2*mtop+1)
+     total = term
+     i = 0
+     do while (term .gt. 1.0d-17*total)
+        i = i+1
+        term = term*2.0d0*T0/dble(2*mtop+2*i+1)
+        total = total+term
      enddo
-  else
-     vals(maxm) = WW1
-     twot = X*2.d0
-     do m=maxm-1,0,-1
-        vals(m) = (twot * vals(m+1) + E) / dble(m*2+1)
+
+     FmTexp(k) = E
+     FmTgrid(mtop,k) = E*total
+     do m=mtop-1,0,-1
+        FmTgrid(m,k) = (2.0d0*T0*FmTgrid(m+1,k)+E)/dble(2*m+1)
      enddo
-  endif
+  enddo
 
-end subroutine fmt
+end subroutine FmT_init
+
+!------------------------------------------------------------------------
+! Boys function for a batch of n arguments X(1:n). On return
+! vals(i,m) = Fm(X(i)) for m=0..MaxM (MaxM <= 20), so each order is a
+! contiguous column and the loops below run over the batch.
+!
+! For X <= FMT_TMAX, Fm(X) of the top order and exp(-X) are Taylor
+! expanded around the nearest grid point of FmT_init and the lower
+! orders follow from downward recursion. Beyond the grid the asymptotic
+! F0 = sqrt(pi/4X) is recursed upward, as in the original FmT.
+!------------------------------------------------------------------------
+subroutine FmT_batch(n,MaxM,X,ldv,vals)
+  use quick_constants_module
+  implicit none
+  integer, parameter :: FMT_MAXM=20, FMT_NTAYLOR=8, FMT_NGRID=330
+  double precision, parameter :: FMT_DT=0.1d0, FMT_RDT=10.0d0, FMT_TMAX=FMT_NGRID*FMT_DT
+  ! 1/j! of the Taylor terms
+  double precision, parameter :: rfact(0:FMT_NTAYLOR-1) = (/ 1.0d0, 1.0d0, 1.0d0/2.0d0, &
+       1.0d0/6.0d0, 1.0d0/24.0d0, 1.0d0/120.0d0, 1.0d0/720.0d0, 1.0d0/5040.0d0 /)
+  double precision FmTgrid(0:FMT_MAXM+FMT_NTAYLOR-1,0:FMT_NGRID)
+  double precision FmTexp(0:FMT_NGRID)
+  common /FmTtable/FmTgrid,FmTexp
+  integer n, MaxM, ldv
+  double precision X(n), vals(ldv,0:MaxM)
+  double precision E(n)
+  integer i, j, k, m
+  double precision Xc, dX, ftop, etop, Ex, rm, XINV, PIE4
+
+  ! Grid part. Arguments past the table are clamped and overwritten below.
+  do i=1,n
+     Xc = min(X(i),FMT_TMAX)
+     k = nint(Xc*FMT_RDT)
+     dX = k*FMT_DT-Xc
+     ftop = FmTgrid(MaxM+FMT_NTAYLOR-1,k)*rfact(FMT_NTAYLOR-1)
+     etop = rfact(FMT_NTAYLOR-1)
+     do j=FMT_NTAYLOR-2,0,-1
+        ftop = ftop*dX+FmTgrid(MaxM+j,k)*rfact(j)
+        etop = etop*dX+rfact(j)
+     enddo
+     vals(i,MaxM) = ftop
+     E(i) = FmTexp(k)*etop
+  enddo
+
+  do m=MaxM-1,0,-1
+     rm = 1.0d0/dble(2*m+1)
+     do i=1,n
+        vals(i,m) = (2.0d0*X(i)*vals(i,m+1)+E(i))*rm
+     enddo
+  enddo
+
+  ! Asymptotic part
+  PIE4 = PI/4.0d0
+  do i=1,n
+     if (X(i) > FMT_TMAX) then
+        XINV = 1.0d0/X(i)
+        Ex = exp(-X(i))
+        vals(i,0) = sqrt(PIE4*XINV)
+        do m=1,MaxM
+           vals(i,m) = (((2*m-1)*vals(i,m-1))-Ex)*0.5d0*XINV
+        enddo
+     endif
+  enddo
+
+end subroutine FmT_batch
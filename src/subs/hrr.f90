@@ -16,10 +16,13 @@ subroutine hrrwhole
    integer angxiaoL(20),angxiaoR(20),numangularL,numangularR
 
    COMMON /COM1/RA,RB,RC,RD
+   !$omp threadprivate(/COM1/)
 
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /xiaostore/store
+   !$omp threadprivate(/xiaostore/)
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
    select case (IJKLtype)
 
@@ -880,11 +883,14 @@ subroutine hrrwholeopt
    integer angxiaoLnew(20),angxiaoRnew(20),numangularLnew,numangularRnew
 
    COMMON /COM1/RA,RB,RC,RD
+   !$omp threadprivate(/COM1/)
 
    integer II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
    common /xiaostore/store
+   !$omp threadprivate(/xiaostore/)
    common /xiaostoreopt/storeaa,storebb,storecc,storedd
    common /hrrstore/II,JJ,KK,LL,NBI1,NBI2,NBJ1,NBJ2,NBK1,NBK2,NBL1,NBL2
+   !$omp threadprivate(/hrrstore/)
 
    tempconstant=quick_basis%cons(III)*quick_basis%cons(JJJ)*quick_basis%cons(KKK)*quick_basis%cons(LLL)
 
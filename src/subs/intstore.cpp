@@ -0,0 +1,485 @@
+/*
+  !---------------------------------------------------------------------!
+  !                                                                     !
+  ! Copyright (C) 2020-2021 Merz lab                                    !
+  ! Copyright (C) 2020-2021 Götz lab                                    !
+  !                                                                     !
+  ! This Source Code Form is subject to the terms of the Mozilla Public !
+  ! License, v. 2.0. If a copy of the MPL was not distributed with this !
+  ! file, You can obtain one at http://mozilla.org/MPL/2.0/.            !
+  !_____________________________________________________________________!
+
+  !---------------------------------------------------------------------!
+  ! This source file contains the on-disk 2e integral store used by     !
+  ! nodirect SCF (aoint writes it once, addInt reads it every cycle).   !
+  !                                                                     !
+  ! Integrals are grouped into records of one shell quartet. A record   !
+  ! holds a 12 byte header (the four shells, the integral count and the !
+  ! value tier), a 16 bit position of every integral inside the shell   !
+  ! quartet and the values. Values are stored as integer multiples of   !
+  ! the integral cutoff tau, so the rounding error is at most tau/2,    !
+  ! in 16 or 32 bits when the largest value of the record fits and as   !
+  ! plain doubles otherwise.                                            !
+  !                                                                     !
+  ! addInt contracts the store with the density in intstore_contract.   !
+  ! The next chunk of the file is read on a second thread while the     !
+  ! records of the current chunk are decoded and contracted by the      !
+  ! OpenMP threads. A record touches only the shell blocks of its four  !
+  ! shells, so the Fock and density elements it uses stay in cache.     !
+  ! Every thread but the master adds to its own copy of the operator,   !
+  ! which is summed in at the end.                                      !
+  !---------------------------------------------------------------------!
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+extern "C" {
+void intstore_create_(char *fname, int *len, int *nbasis, int *nshell, int *first, int *last,
+                      double *tau, int *ierr);
+void intstore_put_(int *n, int *a, int *b, double *y);
+void intstore_close_(long long *nbytes);
+void intstore_contract_(char *fname, int *len, int *nbasis, double *dense, double *xfac, double *o,
+                        int *ierr);
+void intstore_contract_list_(long long *n, int *a, int *b, double *y, int *nbasis, double *dense,
+                             double *xfac, double *o);
+}
+
+namespace {
+
+const char MAGIC[8] = {'Q', 'K', 'I', 'N', 'T', '0', '0', '1'};
+
+// bytes moved between the file and memory at a time
+constexpr std::size_t CHUNK = 8u << 20;
+
+// a record never holds more integrals than its 16 bit count
+constexpr std::size_t MAXCOUNT = 65535;
+
+constexpr std::size_t HEADER = 12;
+constexpr std::size_t MAXRECORD = HEADER + MAXCOUNT * (sizeof(std::uint16_t) + sizeof(double));
+
+enum { TIER_INT16 = 1, TIER_INT32 = 2, TIER_DOUBLE = 3 };
+
+struct IntStore {
+  std::FILE *fp = nullptr;
+  bool writing = false;
+  long long nbytes = 0;
+
+  int nbasis = 0;
+  double tau = 0.0;
+  std::vector<int> first, size, shellOf;
+
+  // writer: the record being filled and the bytes not yet written
+  int quartet[4] = {-1, -1, -1, -1};
+  std::vector<std::uint16_t> pos;
+  std::vector<double> val;
+  std::vector<char> out;
+
+  // reader: two chunk buffers, each with room for a partial record in front
+  std::vector<char> buf[2];
+  int cur = 0;
+  const char *beg = nullptr, *end = nullptr;
+  std::future<std::size_t> next;
+  bool eof = false;
+};
+
+IntStore store;
+
+void flush_out() {
+  if (!store.out.empty()) {
+    std::fwrite(store.out.data(), 1, store.out.size(), store.fp);
+    store.nbytes += store.out.size();
+    store.out.clear();
+  }
+}
+
+template <typename T> void append(const T *p, std::size_t n) {
+  const char *c = reinterpret_cast<const char *>(p);
+  store.out.insert(store.out.end(), c, c + n * sizeof(T));
+}
+
+void flush_record() {
+  const std::size_t n = store.pos.size();
+  if (n == 0) return;
+
+  double ymax = 0.0;
+  for (double y : store.val) ymax = std::fmax(ymax, std::fabs(y));
+  const double qmax = std::nearbyint(ymax / store.tau);
+  const std::uint8_t tier = qmax <= INT16_MAX ? TIER_INT16 : qmax <= INT32_MAX ? TIER_INT32 : TIER_DOUBLE;
+
+  std::uint16_t head[6];
+  for (int s = 0; s < 4; s++) head[s] = static_cast<std::uint16_t>(store.quartet[s]);
+  head[4] = static_cast<std::uint16_t>(n);
+  head[5] = tier;
+  append(head, 6);
+  append(store.pos.data(), n);
+
+  if (tier == TIER_INT16) {
+    std::vector<std::int16_t> q(n);
+    for (std::size_t i = 0; i < n; i++) q[i] = static_cast<std::int16_t>(std::nearbyint(store.val[i] / store.tau));
+    append(q.data(), n);
+  } else if (tier == TIER_INT32) {
+    std::vector<std::int32_t> q(n);
+    for (std::size_t i = 0; i < n; i++) q[i] = static_cast<std::int32_t>(std::nearbyint(store.val[i] / store.tau));
+    append(q.data(), n);
+  } else {
+    append(store.val.data(), n);
+  }
+
+  store.pos.clear();
+  store.val.clear();
+  if (store.out.size() >= CHUNK) flush_out();
+}
+
+// start reading the next chunk of the file into the buffer not in use
+void prefetch() {
+  char *dst = store.buf[1 - store.cur].data() + MAXRECORD;
+  std::FILE *fp = store.fp;
+  store.next = std::async(std::launch::async, [dst, fp] { return std::fread(dst, 1, CHUNK, fp); });
+}
+
+std::size_t record_size(const char *r) {
+  std::uint16_t head[6];
+  std::memcpy(head, r, HEADER);
+  const std::size_t valsize = head[5] == TIER_INT16 ? 2 : head[5] == TIER_INT32 ? 4 : 8;
+  return HEADER + head[4] * (sizeof(std::uint16_t) + valsize);
+}
+
+bool record_ready() {
+  const std::size_t have = store.end - store.beg;
+  return have >= HEADER && have >= record_size(store.beg);
+}
+
+// make sure a whole record is available at beg, false at the end of the file
+bool fill() {
+  for (;;) {
+    if (record_ready()) return true;
+    if (store.eof) return false;
+
+    const std::size_t have = store.end - store.beg;
+    const std::size_t got = store.next.get();
+    const int nxt = 1 - store.cur;
+    char *data = store.buf[nxt].data() + MAXRECORD;
+    std::memmove(data - have, store.beg, have);
+    store.beg = data - have;
+    store.end = data + got;
+    store.cur = nxt;
+    if (got < CHUNK) store.eof = true;
+    else prefetch();
+  }
+}
+
+// the whole records of the current chunk, false at the end of the file.
+// They stay valid until the next call, which may reuse their buffer.
+bool collect(std::vector<const char *> &recs) {
+  recs.clear();
+  if (!fill()) return false;
+  while (record_ready()) {
+    recs.push_back(store.beg);
+    store.beg += record_size(store.beg);
+  }
+  return true;
+}
+
+bool read_header() {
+  char magic[8];
+  int dims[2];
+  if (std::fread(magic, 1, 8, store.fp) != 8 || std::memcmp(magic, MAGIC, 8) != 0) return false;
+  if (std::fread(dims, sizeof(int), 2, store.fp) != 2) return false;
+  if (std::fread(&store.tau, sizeof(double), 1, store.fp) != 1) return false;
+  store.nbasis = dims[0];
+  store.first.resize(dims[1]);
+  store.size.resize(dims[1]);
+  if (std::fread(store.first.data(), sizeof(int), dims[1], store.fp) != std::size_t(dims[1])) return false;
+  if (std::fread(store.size.data(), sizeof(int), dims[1], store.fp) != std::size_t(dims[1])) return false;
+  return true;
+}
+
+} // namespace
+
+// Creates the integral file and writes the shell layout it is indexed by.
+// first and last are the 1-based basis function ranges of the shells.
+// ierr is 1 if the file cannot be opened and 2 if the shells are too many
+// or too large for the 16 bit record indices.
+void intstore_create_(char *fname, int *len, int *nbasis, int *nshell, int *first, int *last,
+                      double *tau, int *ierr) {
+  *ierr = 0;
+  store = IntStore();
+  store.nbasis = *nbasis;
+  store.tau = *tau;
+  store.first.resize(*nshell);
+  store.size.resize(*nshell);
+  store.shellOf.assign(*nbasis, 0);
+
+  std::size_t maxsize = 0;
+  for (int s = 0; s < *nshell; s++) {
+    store.first[s] = first[s] - 1;
+    store.size[s] = last[s] - first[s] + 1;
+    maxsize = std::max<std::size_t>(maxsize, store.size[s]);
+    for (int i = first[s] - 1; i < last[s]; i++) store.shellOf[i] = s;
+  }
+  if (*nshell > UINT16_MAX || maxsize * maxsize * maxsize * maxsize > UINT16_MAX + 1u) {
+    *ierr = 2;
+    return;
+  }
+
+  store.fp = std::fopen(std::string(fname, *len).c_str(), "wb");
+  if (store.fp == nullptr) {
+    *ierr = 1;
+    return;
+  }
+  store.writing = true;
+
+  int dims[2] = {*nbasis, *nshell};
+  append(MAGIC, 8);
+  append(dims, 2);
+  append(tau, 1);
+  append(store.first.data(), *nshell);
+  append(store.size.data(), *nshell);
+}
+
+// Adds n integrals (a, b, y) in the aoint index convention
+// a = (i-1)*nbasis+j-1, b = (k-1)*nbasis+l-1 to the store.
+void intstore_put_(int *n, int *a, int *b, double *y) {
+  const int nb = store.nbasis;
+  for (int m = 0; m < *n; m++) {
+    const int ijkl[4] = {a[m] / nb, a[m] % nb, b[m] / nb, b[m] % nb};
+    int sh[4];
+    for (int s = 0; s < 4; s++) sh[s] = store.shellOf[ijkl[s]];
+
+    if (std::memcmp(sh, store.quartet, sizeof(sh)) != 0 || store.pos.size() == MAXCOUNT) {
+      flush_record();
+      std::memcpy(store.quartet, sh, sizeof(sh));
+    }
+
+    int p = 0;
+    for (int s = 0; s < 4; s++) p = p * store.size[sh[s]] + ijkl[s] - store.first[sh[s]];
+    store.pos.push_back(static_cast<std::uint16_t>(p));
+    store.val.push_back(y[m]);
+  }
+}
+
+namespace {
+
+// Closed shell operator of the stored integrals, J[dense] - xfac*K[dense],
+// added to the lower triangle like the direct iclass.
+struct Fock {
+  int nb;
+  const double *p;
+  double xf;
+  double *o;
+
+  double d(int r, int c) const { return p[r + static_cast<std::size_t>(c) * nb]; }
+  double &op(int r, int c) const { return o[r + static_cast<std::size_t>(c) * nb]; }
+
+  // (ij|kl) with i<j, i<k, k<l
+  void general(int i, int j, int k, int l, double y) const {
+    op(j, i) += 2.0 * d(l, k) * y;
+    op(l, k) += 2.0 * d(j, i) * y;
+    op(k, i) -= xf * d(l, j) * y;
+    op(l, i) -= xf * d(k, j) * y;
+    op(j, k) -= xf * d(l, i) * y;
+    op(j, l) -= xf * d(k, i) * y;
+    op(k, j) -= xf * d(l, i) * y;
+    op(l, j) -= xf * d(k, i) * y;
+  }
+
+  // any stored (ij|kl), i<=j, i<=k<=l and (i<k or j<=l)
+  void any(int i, int j, int k, int l, double y) const {
+    if (i < k) {
+      if (i < j && k < l) {
+        general(i, j, k, l, y);
+      } else if (i == j && k == l) {
+        // (ii|kk)
+        op(i, i) += d(k, k) * y;
+        op(k, k) += d(i, i) * y;
+        op(k, i) -= xf * d(k, i) * y;
+      } else if (j == k && j == l) {
+        // (ij|jj)
+        op(j, i) += (d(j, j) - xf * d(j, j)) * y;
+        op(j, j) += 2.0 * (d(j, i) - xf * d(j, i)) * y;
+      } else if (k == l && i < j) {
+        // (ij|kk), j/=k
+        op(j, i) += d(k, k) * y;
+        op(k, k) += 2.0 * d(j, i) * y;
+        op(k, i) -= xf * d(k, j) * y;
+        op(k, j) -= xf * d(k, i) * y;
+        op(j, k) -= xf * d(k, i) * y;
+      } else if (i == j && k < l) {
+        // (ii|kl)
+        op(l, k) += d(i, i) * y;
+        op(i, i) += 2.0 * d(l, k) * y;
+        op(k, i) -= xf * d(l, i) * y;
+        op(l, i) -= xf * d(k, i) * y;
+      }
+    } else if (j <= l) {
+      if (i == j && i == l) {
+        // (ii|ii)
+        op(i, i) += (d(i, i) - xf * d(i, i)) * y;
+      } else if (i == j) {
+        // (ii|il)
+        op(l, i) += (d(i, i) - xf * d(i, i)) * y;
+        op(i, i) += 2.0 * (d(l, i) - xf * d(l, i)) * y;
+      } else if (j == l) {
+        // (ij|ij)
+        op(j, i) += (2.0 * d(j, i) - xf * d(j, i)) * y;
+        op(j, j) -= xf * d(i, i) * y;
+        op(i, i) -= xf * d(j, j) * y;
+      } else {
+        // (ij|il), j<l
+        op(j, i) += (2.0 * d(l, i) - xf * d(l, i)) * y;
+        op(l, i) += (2.0 * d(j, i) - xf * d(j, i)) * y;
+        op(i, i) -= 2.0 * xf * d(l, j) * y;
+        op(l, j) -= xf * d(i, i) * y;
+      }
+    }
+  }
+};
+
+// decodes one record and adds it to f.o
+void contract_record(const char *r, const Fock &f) {
+  static thread_local std::vector<double> y;
+  std::uint16_t head[6];
+  std::memcpy(head, r, HEADER);
+  const int count = head[4];
+  const int si = head[0], sj = head[1], sk = head[2], sl = head[3];
+  const int nj = store.size[sj], nl = store.size[sl], nkl = store.size[sk] * nl;
+
+  const char *p = r + HEADER;
+  const char *v = p + count * sizeof(std::uint16_t);
+  y.resize(count);
+  if (head[5] == TIER_INT16) {
+    for (int c = 0; c < count; c++) {
+      std::int16_t q;
+      std::memcpy(&q, v + c * sizeof(q), sizeof(q));
+      y[c] = q * store.tau;
+    }
+  } else if (head[5] == TIER_INT32) {
+    for (int c = 0; c < count; c++) {
+      std::int32_t q;
+      std::memcpy(&q, v + c * sizeof(q), sizeof(q));
+      y[c] = q * store.tau;
+    }
+  } else {
+    std::memcpy(y.data(), v, count * sizeof(double));
+  }
+
+  // basis functions of the (i,j) and (k,l) pairs of the quartet
+  int ifun[256], jfun[256], kfun[256], lfun[256];
+  for (int ij = 0; ij < store.size[si] * nj; ij++) {
+    ifun[ij] = store.first[si] + ij / nj;
+    jfun[ij] = store.first[sj] + ij % nj;
+  }
+  for (int kl = 0; kl < nkl; kl++) {
+    kfun[kl] = store.first[sk] + kl / nl;
+    lfun[kl] = store.first[sl] + kl % nl;
+  }
+
+  // four distinct shells have no coinciding basis functions
+  const bool distinct = si < sj && si < sk && sk < sl;
+  for (int c = 0; c < count; c++) {
+    std::uint16_t q;
+    std::memcpy(&q, p + c * sizeof(q), sizeof(q));
+    const int ij = q / nkl, kl = q % nkl;
+    if (distinct) f.general(ifun[ij], jfun[ij], kfun[kl], lfun[kl], y[c]);
+    else f.any(ifun[ij], jfun[ij], kfun[kl], lfun[kl], y[c]);
+  }
+}
+
+// operator copies of the threads other than the master, and their sum into o
+std::vector<std::vector<double>> thread_fock(int nb) {
+  int nt = 1;
+#ifdef _OPENMP
+  nt = omp_get_max_threads();
+#endif
+  return std::vector<std::vector<double>>(nt - 1, std::vector<double>(static_cast<std::size_t>(nb) * nb, 0.0));
+}
+
+double *my_fock(std::vector<std::vector<double>> &priv, double *o) {
+  int t = 0;
+#ifdef _OPENMP
+  t = omp_get_thread_num();
+#endif
+  return t == 0 ? o : priv[t - 1].data();
+}
+
+void reduce_fock(const std::vector<std::vector<double>> &priv, double *o, int nb) {
+  const long long n = static_cast<long long>(nb) * nb;
+  for (const auto &ot : priv) {
+#pragma omp parallel for
+    for (long long m = 0; m < n; m++) o[m] += ot[m];
+  }
+}
+
+} // namespace
+
+// Adds the stored integrals of fname contracted with the densities to o,
+// see Fock. ierr is 1 if the file is missing or not a store.
+void intstore_contract_(char *fname, int *len, int *nbasis, double *dense, double *xfac, double *o,
+                        int *ierr) {
+  *ierr = 0;
+  store = IntStore();
+  store.fp = std::fopen(std::string(fname, *len).c_str(), "rb");
+  if (store.fp == nullptr || !read_header() || store.nbasis != *nbasis) {
+    if (store.fp != nullptr) std::fclose(store.fp);
+    store = IntStore();
+    *ierr = 1;
+    return;
+  }
+
+  for (auto &b : store.buf) b.resize(MAXRECORD + CHUNK);
+  store.cur = 1;
+  store.beg = store.end = store.buf[1].data() + MAXRECORD;
+  prefetch();
+
+  auto priv = thread_fock(*nbasis);
+  std::vector<const char *> recs;
+  while (collect(recs)) {
+    const long long nrec = recs.size();
+#pragma omp parallel for schedule(dynamic, 16)
+    for (long long r = 0; r < nrec; r++)
+      contract_record(recs[r], Fock{*nbasis, dense, *xfac, my_fock(priv, o)});
+  }
+  reduce_fock(priv, o, *nbasis);
+
+  long long nbytes;
+  intstore_close_(&nbytes);
+}
+
+// Same as intstore_contract for n integrals held in memory in the aoint
+// index convention a = (i-1)*nbasis+j-1, b = (k-1)*nbasis+l-1.
+void intstore_contract_list_(long long *n, int *a, int *b, double *y, int *nbasis, double *dense,
+                             double *xfac, double *o) {
+  const int nb = *nbasis;
+  auto priv = thread_fock(nb);
+#pragma omp parallel for schedule(static)
+  for (long long m = 0; m < *n; m++) {
+    const Fock f{nb, dense, *xfac, my_fock(priv, o)};
+    f.any(a[m] / nb, a[m] % nb, b[m] / nb, b[m] % nb, y[m]);
+  }
+  reduce_fock(priv, o, nb);
+}
+
+// Finishes the store. nbytes returns the file size when it was written.
+void intstore_close_(long long *nbytes) {
+  if (store.fp == nullptr) return;
+  if (store.writing) {
+    flush_record();
+    flush_out();
+  } else if (store.next.valid()) {
+    store.next.wait();
+  }
+  std::fclose(store.fp);
+  *nbytes = store.nbytes;
+  store = IntStore();
+}
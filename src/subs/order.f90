@@ -27,3 +27,48 @@ subroutine IOrder(n,arr)
   enddo
 
 end subroutine IOrder
+
+!-----------------------------------------------------------
+! DIndexOrder
+!-----------------------------------------------------------
+! heap sort of the index list idx(n) so that arr(idx(i)) is
+! in decreasing order, arr itself is left untouched
+!-----------------------------------------------------------
+
+subroutine DIndexOrder(n,arr,idx)
+  implicit none
+  integer n,idx(n),i,k
+  double precision arr(*)
+
+  do i=n/2,1,-1
+     call DIndexSift(i,n,arr,idx)
+  enddo
+
+  ! the smallest element is on top of the heap, move it to the end
+  do i=n,2,-1
+     k=idx(1);idx(1)=idx(i);idx(i)=k
+     call DIndexSift(1,i-1,arr,idx)
+  enddo
+
+end subroutine DIndexOrder
+
+subroutine DIndexSift(l,n,arr,idx)
+  implicit none
+  integer l,n,idx(n),i,j,k
+  double precision arr(*)
+
+  i=l
+  k=idx(i)
+  j=2*i
+  do while (j.le.n)
+     if (j.lt.n) then
+        if (arr(idx(j+1)).lt.arr(idx(j))) j=j+1
+     endif
+     if (arr(k).le.arr(idx(j))) exit
+     idx(i)=idx(j)
+     i=j
+     j=2*i
+  enddo
+  idx(i)=k
+
+end subroutine DIndexSift
@@ -16,8 +16,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -44,8 +46,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -72,8 +76,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -114,8 +120,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -166,8 +174,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -220,8 +230,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -281,8 +293,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -334,8 +348,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -401,8 +417,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -444,8 +462,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -487,8 +507,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -530,8 +552,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -574,8 +598,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
              
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -629,8 +655,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -677,8 +705,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -732,8 +762,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -781,8 +813,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
      
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -842,8 +876,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -904,8 +940,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -964,8 +1002,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -1024,8 +1064,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -1087,8 +1129,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -1152,8 +1196,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -1219,8 +1265,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -1283,8 +1331,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
@@ -1378,8 +1428,10 @@
      real*8 FM(0:13)
  real*8 Qtemp(3),WQtemp(3),CDtemp,ABcom,Ptemp(3),WPtemp(3),ABtemp,CDcom,ABCDtemp
  COMMON /VRRcom/Qtemp,WQtemp,CDtemp,ABcom,Ptemp,WPtemp,ABtemp,CDcom,ABCDtemp
+ !$omp threadprivate(/VRRcom/)
 
      COMMON /COM1/RA,RB,RC,RD
+     !$omp threadprivate(/COM1/)
      COMMON /COM2/AA,BB,CC,DD,AB,CD,ROU,ABCD
      COMMON /COM4/P,Q,W
      COMMON /COM5/FM
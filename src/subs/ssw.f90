@@ -212,3 +212,53 @@ double precision function ssw(gridx,gridy,gridz,iparent)
   ssw=wofparent/totalw
 
 end function ssw
+
+! Returns the largest atomic displacement (in bohr, measured from the current
+! geometry) for which the Stratmann-Scuseria weight of a grid point stays
+! pinned at exactly 0 or 1. A negative value means the weight is not pinned.
+!
+! The weight is 1 if every cell function of the parent atom saturates at 1
+! (confocal <= -a for all neighbors) and 0 if any of them saturates at 0
+! (confocal >= a). Since grid points move with their parent atom, r(iparent,g)
+! does not change, while r(j,g) and R(iparent,j) change by at most twice the
+! largest displacement. The saturation margins below are thus reduced by at
+! most (2+2a) times the displacement.
+double precision function ssw_pin_slack(gridx,gridy,gridz,iparent)
+  use allmod
+  implicit double precision(a-h,o-z)
+
+  if (natom == 1)  then
+     ssw_pin_slack=huge(1.d0)
+     return
+  endif
+
+  xparent=xyz(1,iparent)
+  yparent=xyz(2,iparent)
+  zparent=xyz(3,iparent)
+
+  rig=(gridx-xparent)*(gridx-xparent)
+  rig=rig+(gridy-yparent)*(gridy-yparent)
+  rig=rig+(gridz-zparent)*(gridz-zparent)
+  rig=Dsqrt(rig)
+
+  ! slack1 >= 0 pins the weight at 1, slack0 >= 0 pins it at 0
+  slack1=huge(1.d0)
+  slack0=-huge(1.d0)
+
+  do Jatm=1,natom
+     if (Jatm == iparent) cycle
+     rjg=(gridx-xyz(1,Jatm))*(gridx-xyz(1,Jatm))
+     rjg=rjg+(gridy-xyz(2,Jatm))*(gridy-xyz(2,Jatm))
+     rjg=rjg+(gridz-xyz(3,Jatm))*(gridz-xyz(3,Jatm))
+     rjg=Dsqrt(rjg)
+     Rij=(xparent-xyz(1,Jatm))*(xparent-xyz(1,Jatm))
+     Rij=Rij+(yparent-xyz(2,Jatm))*(yparent-xyz(2,Jatm))
+     Rij=Rij+(zparent-xyz(3,Jatm))*(zparent-xyz(3,Jatm))
+     Rij=Dsqrt(Rij)
+     slack1=min(slack1,rjg-rig-0.64d0*Rij)
+     slack0=max(slack0,rig-rjg-0.64d0*Rij)
+  enddo
+
+  ssw_pin_slack=max(slack1,slack0)/(2.d0+2.d0*0.64d0)
+
+end function ssw_pin_slack
@@ -0,0 +1,292 @@
+/*
+  !---------------------------------------------------------------------!
+  !                                                                     !
+  ! Copyright (C) 2020-2021 Merz lab                                    !
+  ! Copyright (C) 2020-2021 Götz lab                                    !
+  !                                                                     !
+  ! This Source Code Form is subject to the terms of the Mozilla Public !
+  ! License, v. 2.0. If a copy of the MPL was not distributed with this !
+  ! file, You can obtain one at http://mozilla.org/MPL/2.0/.            !
+  !_____________________________________________________________________!
+
+  !---------------------------------------------------------------------!
+  ! This source file contains the CPU vertical recursion (HGP Eqns 6    !
+  ! and 16) over a batch of primitive quartets of one shell quartet.    !
+  ! It replaces the per-primitive vertical(NABCDTYPE) calls in shell.   !
+  !                                                                     !
+  ! The recursion of every (la+lb, lc+ld) class is resolved at compile  !
+  ! time into a table of steps. Each step runs over a block of VRR_LANES!
+  ! primitive quartets stored side by side, so the arithmetic of every  !
+  ! step is a short vector loop with no index lookups or branches.      !
+  !---------------------------------------------------------------------!
+*/
+
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+extern "C" {
+void vertical_batch_(int *lab, int *lcd, int *nprim, int *ldp, double *prm, double *fm,
+                     int *nna, int *nnab, int *nnc, int *nncd, double *yxiao, int *ldy, int *dimy);
+}
+
+namespace {
+
+// primitive quartets processed together by one class kernel
+constexpr int VRR_LANES = 8;
+
+// highest la+lb (or lc+ld) handled by the kernels, f|f
+constexpr int VRR_MAXL = 6;
+
+// columns of the parameter block filled by shell for every primitive quartet
+enum { PRM_PTEMP = 0, PRM_WPTEMP = 3, PRM_QTEMP = 6, PRM_WQTEMP = 9, PRM_ABTEMP = 12,
+       PRM_CDTEMP, PRM_ABCOM, PRM_CDCOM, PRM_ABCDTEMP, PRM_COUNT };
+
+// Cartesian exponents of the functions in the order of Mcal in
+// quick_params_module, which is the order of the Yxiao indices
+constexpr int MCAL[84][3] = {
+    // l = 0
+    {0,0,0},
+    // l = 1
+    {1,0,0}, {0,1,0}, {0,0,1},
+    // l = 2
+    {1,1,0}, {0,1,1}, {1,0,1}, {2,0,0}, {0,2,0}, {0,0,2},
+    // l = 3
+    {1,1,1}, {2,1,0}, {1,2,0}, {2,0,1}, {1,0,2}, {0,2,1}, {0,1,2}, {3,0,0}, {0,3,0}, {0,0,3},
+    // l = 4
+    {2,2,0}, {2,0,2}, {0,2,2}, {2,1,1}, {1,2,1}, {1,1,2}, {3,0,1}, {1,0,3}, {3,1,0}, {1,3,0},
+    {0,3,1}, {0,1,3}, {4,0,0}, {0,4,0}, {0,0,4},
+    // l = 5
+    {1,2,2}, {2,1,2}, {2,2,1}, {3,1,1}, {1,3,1}, {1,1,3}, {0,2,3}, {0,3,2}, {2,0,3}, {3,0,2},
+    {2,3,0}, {3,2,0}, {0,1,4}, {0,4,1}, {1,0,4}, {4,0,1}, {1,4,0}, {4,1,0}, {5,0,0}, {0,5,0},
+    {0,0,5},
+    // l = 6
+    {4,1,1}, {1,4,1}, {1,1,4}, {1,2,3}, {1,3,2}, {2,1,3}, {3,1,2}, {2,3,1}, {3,2,1}, {2,2,2},
+    {0,1,5}, {0,5,1}, {1,0,5}, {5,0,1}, {1,5,0}, {5,1,0}, {0,2,4}, {0,4,2}, {2,0,4}, {4,0,2},
+    {2,4,0}, {4,2,0}, {0,3,3}, {3,0,3}, {3,3,0}, {6,0,0}, {0,6,0}, {0,0,6}
+};
+
+// number of functions with l <= L, sumindex(L) in the Fortran code
+constexpr int nfunc(int L) { return (L + 1) * (L + 2) * (L + 3) / 6; }
+
+constexpr int lval(int i) { return MCAL[i][0] + MCAL[i][1] + MCAL[i][2]; }
+
+constexpr int findex(int x, int y, int z) {
+    for (int i = 0; i < nfunc(VRR_MAXL); i++)
+        if (MCAL[i][0] == x && MCAL[i][1] == y && MCAL[i][2] == z) return i;
+    return -1;
+}
+
+// function index lowered by n in direction j
+constexpr int lower(int i, int j, int n) {
+    int e[3] = {MCAL[i][0], MCAL[i][1], MCAL[i][2]};
+    e[j] -= n;
+    return findex(e[0], e[1], e[2]);
+}
+
+// first direction with a nonzero exponent, the one the Fortran vrr reduces
+constexpr int firstdir(int i) { return MCAL[i][0] ? 0 : (MCAL[i][1] ? 1 : 2); }
+
+// One recursion step, producing [e|f]^m for m < nm. Offsets count rows of
+// VRR_LANES doubles in the class buffer. For e = 0 the step grows f (ket):
+//   [0|f] = Qtemp [0|f-1j] + WQtemp [0|f-1j]' + c1 CDtemp ([0|f-2j] - ABcom [0|f-2j]')
+// otherwise it grows e (bra):
+//   [e|f] = Ptemp [e-1j|f] + WPtemp [e-1j|f]' + c1 ABtemp ([e-2j|f] - CDcom [e-2j|f]')
+//         + c2 ABCDtemp [e-1j|f-1j]'
+// where ' is order m+1. Unused sources point at s1 with a zero coefficient.
+struct VRRStep {
+    int dst, s1, s2, s3, nm, j;
+    double c1, c2;
+};
+
+template <int LAB, int LCD>
+struct VRRClass {
+    static constexpr int NE = nfunc(LAB);
+    static constexpr int NF = nfunc(LCD);
+    static constexpr int M = LAB + LCD;
+    static constexpr int NSTEP = NE * NF - 1;
+    static constexpr int NKET = NF - 1;
+
+    struct Tables {
+        int off[NE][NF];
+        int rows;
+        VRRStep step[NSTEP > 0 ? NSTEP : 1];
+    };
+
+    static constexpr Tables build() {
+        Tables t{};
+        int rows = 0;
+        for (int e = 0; e < NE; e++)
+            for (int f = 0; f < NF; f++) {
+                t.off[e][f] = rows;
+                rows += M - lval(e) - lval(f) + 1;
+            }
+        t.rows = rows;
+
+        int s = 0;
+        for (int e = 0; e < NE; e++)
+            for (int f = 0; f < NF; f++) {
+                if (e == 0 && f == 0) continue;
+                VRRStep &st = t.step[s++];
+                st.dst = t.off[e][f];
+                st.nm = M - lval(e) - lval(f) + 1;
+                if (e == 0) {
+                    int j = firstdir(f), n = MCAL[f][j];
+                    st.j = j;
+                    st.s1 = t.off[0][lower(f, j, 1)];
+                    st.s2 = n > 1 ? t.off[0][lower(f, j, 2)] : st.s1;
+                    st.s3 = st.s1;
+                    st.c1 = n - 1;
+                    st.c2 = 0.0;
+                } else {
+                    int j = firstdir(e), n = MCAL[e][j], nf = MCAL[f][j];
+                    st.j = j;
+                    st.s1 = t.off[lower(e, j, 1)][f];
+                    st.s2 = n > 1 ? t.off[lower(e, j, 2)][f] : st.s1;
+                    st.s3 = nf > 0 ? t.off[lower(e, j, 1)][lower(f, j, 1)] : st.s1;
+                    st.c1 = n - 1;
+                    st.c2 = nf;
+                }
+            }
+        return t;
+    }
+
+    static constexpr Tables tab = build();
+};
+
+// Vertical recursion of one block of B primitive quartets. prm holds the
+// PRM_COUNT parameters and y00 the [0|0]^m, m=0..LAB+LCD, each as rows of B
+// lanes. buf receives [e|f]^m at the rows given by VRRClass::off.
+template <int LAB, int LCD, int B>
+void vrr_block(const double *prm, const double *y00, double *buf) {
+    using C = VRRClass<LAB, LCD>;
+    constexpr auto &tab = C::tab;
+
+    for (int i = 0; i < (C::M + 1) * B; i++) buf[i] = y00[i];
+
+    const double *cdtemp = prm + PRM_CDTEMP * B;
+    const double *abcom = prm + PRM_ABCOM * B;
+    for (int s = 0; s < C::NKET; s++) {
+        const VRRStep &st = tab.step[s];
+        const double *q = prm + (PRM_QTEMP + st.j) * B;
+        const double *wq = prm + (PRM_WQTEMP + st.j) * B;
+        double *d = buf + st.dst * B;
+        const double *a = buf + st.s1 * B;
+        const double *b = buf + st.s2 * B;
+        if (st.c1 == 0.0) {
+            for (int m = 0; m < st.nm; m++)
+                for (int p = 0; p < B; p++)
+                    d[m * B + p] = q[p] * a[m * B + p] + wq[p] * a[(m + 1) * B + p];
+        } else {
+            for (int m = 0; m < st.nm; m++)
+                for (int p = 0; p < B; p++)
+                    d[m * B + p] = q[p] * a[m * B + p] + wq[p] * a[(m + 1) * B + p]
+                                 + st.c1 * cdtemp[p] * (b[m * B + p] - abcom[p] * b[(m + 1) * B + p]);
+        }
+    }
+
+    const double *abtemp = prm + PRM_ABTEMP * B;
+    const double *cdcom = prm + PRM_CDCOM * B;
+    const double *abcdtemp = prm + PRM_ABCDTEMP * B;
+    for (int s = C::NKET; s < C::NSTEP; s++) {
+        const VRRStep &st = tab.step[s];
+        const double *pa = prm + (PRM_PTEMP + st.j) * B;
+        const double *wp = prm + (PRM_WPTEMP + st.j) * B;
+        double *d = buf + st.dst * B;
+        const double *a = buf + st.s1 * B;
+        const double *b = buf + st.s2 * B;
+        const double *c = buf + st.s3 * B;
+
+        // the zero terms are frequent enough to be worth their own loops
+        if (st.c1 == 0.0 && st.c2 == 0.0) {
+            for (int m = 0; m < st.nm; m++)
+                for (int p = 0; p < B; p++)
+                    d[m * B + p] = pa[p] * a[m * B + p] + wp[p] * a[(m + 1) * B + p];
+        } else if (st.c1 == 0.0) {
+            for (int m = 0; m < st.nm; m++)
+                for (int p = 0; p < B; p++)
+                    d[m * B + p] = pa[p] * a[m * B + p] + wp[p] * a[(m + 1) * B + p]
+                                 + st.c2 * abcdtemp[p] * c[(m + 1) * B + p];
+        } else if (st.c2 == 0.0) {
+            for (int m = 0; m < st.nm; m++)
+                for (int p = 0; p < B; p++)
+                    d[m * B + p] = pa[p] * a[m * B + p] + wp[p] * a[(m + 1) * B + p]
+                                 + st.c1 * abtemp[p] * (b[m * B + p] - cdcom[p] * b[(m + 1) * B + p]);
+        } else {
+            for (int m = 0; m < st.nm; m++)
+                for (int p = 0; p < B; p++)
+                    d[m * B + p] = pa[p] * a[m * B + p] + wp[p] * a[(m + 1) * B + p]
+                                 + st.c1 * abtemp[p] * (b[m * B + p] - cdcom[p] * b[(m + 1) * B + p])
+                                 + st.c2 * abcdtemp[p] * c[(m + 1) * B + p];
+        }
+    }
+}
+
+// Runs the class kernel over all nprim quartets and stores [e|f]^0 into
+// Yxiao(itt,e,f) for e in [nna,nnab] and f in [nnc,nncd] (Fortran indices)
+template <int LAB, int LCD>
+void vrr_class(int nprim, int ldp, const double *prm, const double *fm,
+               int nna, int nnab, int nnc, int nncd, double *yxiao, int ldy, int dimy) {
+    using C = VRRClass<LAB, LCD>;
+    constexpr auto &tab = C::tab;
+
+    thread_local std::vector<double> scratch;
+    std::size_t need = (std::size_t)(PRM_COUNT + C::M + 1 + tab.rows) * VRR_LANES;
+    if (scratch.size() < need) scratch.resize(need);
+    double *prmB = scratch.data();
+    double *y00B = prmB + PRM_COUNT * VRR_LANES;
+    double *buf = y00B + (C::M + 1) * VRR_LANES;
+
+    for (int i0 = 0; i0 < nprim; i0 += VRR_LANES) {
+        int n = nprim - i0 < VRR_LANES ? nprim - i0 : VRR_LANES;
+
+        // A full block runs the vector kernel, the remainder one quartet at a time
+        if (n == VRR_LANES) {
+            for (int k = 0; k < PRM_COUNT; k++)
+                for (int p = 0; p < VRR_LANES; p++) prmB[k * VRR_LANES + p] = prm[(std::size_t)k * ldp + i0 + p];
+            for (int m = 0; m <= C::M; m++)
+                for (int p = 0; p < VRR_LANES; p++) y00B[m * VRR_LANES + p] = fm[(std::size_t)m * ldp + i0 + p];
+
+            vrr_block<LAB, LCD, VRR_LANES>(prmB, y00B, buf);
+
+            for (int f = nnc - 1; f < nncd; f++)
+                for (int e = nna - 1; e < nnab; e++) {
+                    const double *src = buf + tab.off[e][f] * VRR_LANES;
+                    double *dst = yxiao + i0 + (std::size_t)ldy * (e + (std::size_t)dimy * f);
+                    for (int p = 0; p < VRR_LANES; p++) dst[p] = src[p];
+                }
+        } else {
+            for (int p = 0; p < n; p++) {
+                for (int k = 0; k < PRM_COUNT; k++) prmB[k] = prm[(std::size_t)k * ldp + i0 + p];
+                for (int m = 0; m <= C::M; m++) y00B[m] = fm[(std::size_t)m * ldp + i0 + p];
+
+                vrr_block<LAB, LCD, 1>(prmB, y00B, buf);
+
+                for (int f = nnc - 1; f < nncd; f++)
+                    for (int e = nna - 1; e < nnab; e++)
+                        yxiao[i0 + p + (std::size_t)ldy * (e + (std::size_t)dimy * f)] = buf[tab.off[e][f]];
+            }
+        }
+    }
+}
+
+typedef void (*VRRClassFn)(int, int, const double *, const double *, int, int, int, int, double *, int, int);
+
+template <int... I>
+constexpr std::array<VRRClassFn, sizeof...(I)> make_vrr_classes(std::integer_sequence<int, I...>) {
+    return {{&vrr_class<I / (VRR_MAXL + 1), I % (VRR_MAXL + 1)>...}};
+}
+
+constexpr auto vrr_classes = make_vrr_classes(std::make_integer_sequence<int, (VRR_MAXL + 1) * (VRR_MAXL + 1)>());
+
+}  // namespace
+
+// Fortran entry point, see shell. lab and lcd are la+lb and lc+ld, prm is
+// VRRbatch(ldp,PRM_COUNT) and fm is FMbatch(ldp,0:lab+lcd) already divided
+// by sqrt(ABCD), i.e. the [0|0]^m of HGP Eqn 12.
+void vertical_batch_(int *lab, int *lcd, int *nprim, int *ldp, double *prm, double *fm,
+                     int *nna, int *nnab, int *nnc, int *nncd, double *yxiao, int *ldy, int *dimy) {
+    vrr_classes[*lab * (VRR_MAXL + 1) + *lcd](*nprim, *ldp, prm, fm, *nna, *nnab, *nnc, *nncd,
+                                              yxiao, *ldy, *dimy);
+}
@@ -0,0 +1,268 @@
+!
+!	xc_bin.f90
+!	new_quick
+!
+!   Bin batched exchange correlation kernels used by get_xc and get_xc_grad.
+!   The GPU builds keep their own grid layout and do not use them.
+!   3456789012345678901234567890123456789012345678901234567890123456789012<<STOP
+
+#if !defined CUDA && !defined CUDA_MPIV
+
+!-----------------------------------------------------------
+! xc_bin_density
+!-----------------------------------------------------------
+! Evaluates the basis functions of bin Ibin and their gradients at the npt
+! grid points listed in igp, and from them the alpha density and its
+! gradient at every point:
+!   bphi(p,i,1)   = phi_i(p),  bphi(p,i,2:4) = grad phi_i(p)
+!   bdens(p,1)    = 1/2 sum_ij P_ij phi_i(p) phi_j(p)
+!   bdens(p,2:4)  = sum_ij P_ij phi_i(p) grad phi_j(p)
+! i and j run over the nbf basis functions of the bin only, so that
+! T = Phi P is a single DSYMM on the density matrix sub-block of the bin.
+!
+! Before the DSYMM the functions are screened over the whole bin: with
+! b_i the largest |phi_i| or |grad phi_i| at the points of the bin, every
+! pair ij contributes at most |P_ij| b_i b_j to the densities, and a
+! function whose pairs all stay below DMCutoff is left out. The columns
+! of bphi are reordered so that the nd functions kept come first, and
+! bfn(i) returns the position in quick_dft_grid%basf of column i.
+!-----------------------------------------------------------
+subroutine xc_bin_density(Ibin,npt,mpt,mbf,igp,bfn,nd,bphi,bmat,btmp,bdens)
+   use allmod
+   implicit none
+
+   integer, intent(in) :: Ibin, npt, mpt, mbf
+   integer, intent(in) :: igp(mpt)
+   integer, intent(out) :: bfn(mbf), nd
+   double precision, intent(out) :: bphi(mpt,mbf,4), bmat(mbf,mbf), btmp(mpt,mbf)
+   double precision, intent(out) :: bdens(mpt,4)
+
+   integer :: i, j, k, ip, ibas, jbas, ibf0, nbf
+   double precision :: gridx, gridy, gridz, pb, bmax(mbf)
+
+   ibf0=quick_dft_grid%basf_counter(Ibin)
+   nbf=quick_dft_grid%basf_counter(Ibin+1)-ibf0
+
+   do i=1,nbf
+      bfn(i)=ibf0+i
+      ibas=quick_dft_grid%basf(bfn(i))+1
+      do ip=1,npt
+         gridx=quick_dft_grid%gridb_org(1,Ibin)+dble(quick_dft_grid%gridxb(igp(ip)))
+         gridy=quick_dft_grid%gridb_org(2,Ibin)+dble(quick_dft_grid%gridyb(igp(ip)))
+         gridz=quick_dft_grid%gridb_org(3,Ibin)+dble(quick_dft_grid%gridzb(igp(ip)))
+         call pteval(gridx,gridy,gridz,bphi(ip,i,1),bphi(ip,i,2), &
+         bphi(ip,i,3),bphi(ip,i,4),ibas)
+      enddo
+   enddo
+
+   call xc_bin_bound(npt,mpt,mbf,nbf,bphi,bmax)
+
+!  Move the functions with a pair above the cutoff to the front
+   nd=0
+   do i=1,nbf
+      ibas=quick_dft_grid%basf(bfn(i))+1
+      pb=0.0d0
+      do j=1,nbf
+         jbas=quick_dft_grid%basf(bfn(j))+1
+         pb=max(pb,abs(quick_qm_struct%dense(jbas,ibas))*bmax(j))
+      enddo
+      if (pb*bmax(i) >= quick_method%DMCutoff) then
+         nd=nd+1
+         if (nd /= i) call xc_bin_swap(npt,mpt,mbf,nd,i,bfn,bphi,bmax)
+      endif
+   enddo
+
+!  Gather the lower triangle of the density matrix sub-block of the bin
+   do i=1,nd
+      ibas=quick_dft_grid%basf(bfn(i))+1
+      do j=i,nd
+         jbas=quick_dft_grid%basf(bfn(j))+1
+         bmat(j,i)=quick_qm_struct%dense(jbas,ibas)
+      enddo
+   enddo
+
+   call DSYMM('R','L',npt,nd,1.0d0,bmat,mbf,bphi,mpt,0.0d0,btmp,mpt)
+
+   bdens(1:npt,:)=0.0d0
+   do j=1,nd
+      do ip=1,npt
+         bdens(ip,1)=bdens(ip,1)+btmp(ip,j)*bphi(ip,j,1)
+      enddo
+      do k=2,4
+         do ip=1,npt
+            bdens(ip,k)=bdens(ip,k)+btmp(ip,j)*bphi(ip,j,k)
+         enddo
+      enddo
+   enddo
+   bdens(1:npt,1)=0.5d0*bdens(1:npt,1)
+
+end subroutine xc_bin_density
+
+!-----------------------------------------------------------
+! xc_bin_fock
+!-----------------------------------------------------------
+! Adds the exchange correlation operator of a bin to quick_qm_struct%o.
+! bphi and bfn are as returned by xc_bin_density for the nbf functions
+! of the bin, and bpot holds the weighted potential of every point,
+! bpot(p,1) = w df/drho and bpot(p,2:4) = w (xdot,ydot,zdot), so that
+! the bin block is
+!   F_ij = sum_p phi_i A_pj + A_pi phi_j
+!   A_pj = 1/2 bpot(p,1) phi_j + bpot(p,2:4) . grad phi_j
+! i.e. one DSYR2K of Phi with A. With v = sum_p 1/2 |bpot(p,1)| +
+! |bpot(p,2)| + |bpot(p,3)| + |bpot(p,4)|, |F_ij| is at most 2 v b_i b_j
+! (b as in xc_bin_density), and the functions whose pairs all stay below
+! DMCutoff are dropped from the DSYR2K. Only the lower triangle is added,
+! as the caller completes the operator with copySym.
+!-----------------------------------------------------------
+subroutine xc_bin_fock(npt,mpt,mbf,nbf,bfn,bphi,bpot,btmp,bmat)
+   use allmod
+   implicit none
+
+   integer, intent(in) :: npt, mpt, mbf, nbf
+   integer, intent(inout) :: bfn(mbf)
+   double precision, intent(inout) :: bphi(mpt,mbf,4)
+   double precision, intent(in) :: bpot(mpt,4)
+   double precision, intent(out) :: btmp(mpt,mbf), bmat(mbf,mbf)
+
+   integer :: i, j, ip, ibas, jbas, nf
+   double precision :: vsum, bmaxall, bmax(mbf)
+
+   vsum=0.0d0
+   do ip=1,npt
+      vsum=vsum+0.5d0*abs(bpot(ip,1))+abs(bpot(ip,2))+abs(bpot(ip,3))+abs(bpot(ip,4))
+   enddo
+
+   call xc_bin_bound(npt,mpt,mbf,nbf,bphi,bmax)
+   bmaxall=maxval(bmax(1:nbf))
+
+   nf=0
+   do i=1,nbf
+      if (2.0d0*vsum*bmax(i)*bmaxall >= quick_method%DMCutoff) then
+         nf=nf+1
+         if (nf /= i) call xc_bin_swap(npt,mpt,mbf,nf,i,bfn,bphi,bmax)
+      endif
+   enddo
+
+   do j=1,nf
+      do ip=1,npt
+         btmp(ip,j)=0.5d0*bpot(ip,1)*bphi(ip,j,1)+bpot(ip,2)*bphi(ip,j,2) &
+         +bpot(ip,3)*bphi(ip,j,3)+bpot(ip,4)*bphi(ip,j,4)
+      enddo
+   enddo
+
+   call DSYR2K('L','T',nf,npt,1.0d0,bphi,mpt,btmp,mpt,0.0d0,bmat,mbf)
+
+!  The columns are no longer in the order of the basis functions
+   do i=1,nf
+      ibas=quick_dft_grid%basf(bfn(i))+1
+      do j=i,nf
+         jbas=quick_dft_grid%basf(bfn(j))+1
+         quick_qm_struct%o(max(ibas,jbas),min(ibas,jbas))= &
+         quick_qm_struct%o(max(ibas,jbas),min(ibas,jbas))+bmat(j,i)
+      enddo
+   enddo
+
+end subroutine xc_bin_fock
+
+!-----------------------------------------------------------
+! xc_bin_bound
+!-----------------------------------------------------------
+! bmax(i) = largest |phi_i| or |grad phi_i| at the npt points of a bin.
+!-----------------------------------------------------------
+subroutine xc_bin_bound(npt,mpt,mbf,nbf,bphi,bmax)
+   implicit none
+
+   integer, intent(in) :: npt, mpt, mbf, nbf
+   double precision, intent(in) :: bphi(mpt,mbf,4)
+   double precision, intent(out) :: bmax(mbf)
+
+   integer :: i, k, ip
+
+   do i=1,nbf
+      bmax(i)=0.0d0
+      do k=1,4
+         do ip=1,npt
+            bmax(i)=max(bmax(i),abs(bphi(ip,i,k)))
+         enddo
+      enddo
+   enddo
+
+end subroutine xc_bin_bound
+
+!-----------------------------------------------------------
+! xc_bin_swap
+!-----------------------------------------------------------
+! Swaps the columns i and j of bphi, bfn and bmax.
+!-----------------------------------------------------------
+subroutine xc_bin_swap(npt,mpt,mbf,i,j,bfn,bphi,bmax)
+   implicit none
+
+   integer, intent(in) :: npt, mpt, mbf, i, j
+   integer, intent(inout) :: bfn(mbf)
+   double precision, intent(inout) :: bphi(mpt,mbf,4), bmax(mbf)
+
+   integer :: k, ip, itmp
+   double precision :: tmp
+
+   do k=1,4
+      do ip=1,npt
+         tmp=bphi(ip,i,k)
+         bphi(ip,i,k)=bphi(ip,j,k)
+         bphi(ip,j,k)=tmp
+      enddo
+   enddo
+
+   itmp=bfn(i)
+   bfn(i)=bfn(j)
+   bfn(j)=itmp
+
+   tmp=bmax(i)
+   bmax(i)=bmax(j)
+   bmax(j)=tmp
+
+end subroutine xc_bin_swap
+
+!-----------------------------------------------------------
+! xc_bin_libxc
+!-----------------------------------------------------------
+! Evaluates the libxc functionals of quick_method at np points with one
+! call per functional, through the handles of init_libxc_handles, and
+! returns the sums over the functionals of the energy per particle and
+! of the derivatives by the density and by sigma.
+!-----------------------------------------------------------
+subroutine xc_bin_libxc(np,rho,sigma,exc,vrho,vsigma)
+   use quick_method_module
+   use xc_f90_lib_m
+   implicit none
+
+   integer, intent(in) :: np
+   double precision, intent(in) :: rho(np), sigma(np)
+   double precision, intent(out) :: exc(np), vrho(np), vsigma(np)
+
+   double precision :: fexc(np), fvrho(np), fvsigma(np)
+   integer :: ifunc
+
+   exc=0.0d0
+   vrho=0.0d0
+   vsigma=0.0d0
+
+   do ifunc=1, libxc_nfunc
+      select case(libxc_family(ifunc))
+         case(XC_FAMILY_LDA)
+            call xc_f90_lda_exc_vxc(libxc_func(ifunc),np,rho(1),fexc(1),fvrho(1))
+            fvsigma=0.0d0
+         case(XC_FAMILY_GGA, XC_FAMILY_HYB_GGA)
+            call xc_f90_gga_exc_vxc(libxc_func(ifunc),np,rho(1),sigma(1), &
+            fexc(1),fvrho(1),fvsigma(1))
+         case default
+            cycle
+      end select
+
+      exc=exc+fexc
+      vrho=vrho+fvrho
+      vsigma=vsigma+fvsigma
+   enddo
+
+end subroutine xc_bin_libxc
+
+#endif
@@ -408,7 +408,7 @@ subroutine uelectdiis(jscf,PRMS)
 
       ! Now diagonalize the operator matrix.
 
-      CALL DIAG(nbasis,quick_qm_struct%o,nbasis,quick_method%DMCutoff,V2,quick_qm_struct%E, &
+      CALL DIAGDC(nbasis,quick_qm_struct%o,nbasis,quick_method%DMCutoff,V2,quick_qm_struct%E, &
             quick_qm_struct%idegen,quick_qm_struct%vec, &
             IERROR)
 
@@ -503,7 +503,7 @@ subroutine uelectdiis(jscf,PRMS)
 
       ! Now diagonalize the operator matrix.
 
-      CALL DIAG(nbasis,quick_qm_struct%o,nbasis,quick_method%DMCutoff,V2, &
+      CALL DIAGDC(nbasis,quick_qm_struct%o,nbasis,quick_method%DMCutoff,V2, &
         quick_qm_struct%EB,quick_qm_struct%idegen,quick_qm_struct%vec, IERROR)
 
 
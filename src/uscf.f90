@@ -134,7 +134,7 @@
     ! There is a problem if HOLD is used for evec1.
        
        
-        CALL DIAG(nbasis,quick_qm_struct%o,nbasis,quick_method%DMCutoff,V2,quick_qm_struct%E, &
+        CALL DIAGDC(nbasis,quick_qm_struct%o,nbasis,quick_method%DMCutoff,V2,quick_qm_struct%E, &
             quick_qm_struct%idegen,quick_qm_struct%vec, &
         IERROR)
         
@@ -229,7 +229,7 @@
     ! In this case VEC is now C'.
     ! There is a problem if HOLD is used for evec1.
 
-        CALL DIAG(nbasis,quick_qm_struct%o,nbasis,quick_method%DMCutoff,V2,&
+        CALL DIAGDC(nbasis,quick_qm_struct%o,nbasis,quick_method%DMCutoff,V2,&
         quick_qm_struct%EB,quick_qm_struct%idegen,quick_qm_struct%vec,IERROR)
 
     